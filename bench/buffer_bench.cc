@@ -0,0 +1,93 @@
+/**
+ * @file buffer_bench.cc
+ * @brief Микробенчмарк очереди отправки: Buffer против std::vector с erase из начала.
+ *
+ * Очередь заполняется до заданной глубины блоками по 4096 байт (как recv в Session::RecvAll),
+ * затем опустошается порциями по 1448 байт (типичный частичный send). Для каждой глубины
+ * печатается стоимость одного байта в наносекундах.
+ */
+
+#include <chrono>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include "../src/server/buffer/buffer.h"
+
+namespace {
+
+constexpr size_t RECV_CHUNK{4096};
+constexpr size_t SEND_CHUNK{1448};
+constexpr size_t MAX_VECTOR_DEPTH{size_t{4} << 20};
+
+using Clock = std::chrono::steady_clock;
+
+double BenchBuffer(size_t depth) {
+    Buffer buffer;
+    char chunk[RECV_CHUNK];
+    std::memset(chunk, 'x', sizeof(chunk));
+
+    auto start{Clock::now()};
+
+    for (size_t filled{}; filled < depth; filled += RECV_CHUNK) {
+        auto [data, size]{buffer.PrepareWrite()};
+        size_t n{std::min(size, RECV_CHUNK)};
+
+        std::memcpy(data, chunk, n);
+        buffer.CommitWrite(n);
+    }
+
+    size_t checksum{};
+
+    while (!buffer.Empty()) {
+        iovec iov[64];
+        size_t count{buffer.FillIovecs(iov, 64)};
+
+        checksum += count;
+        buffer.Consume(std::min(SEND_CHUNK, buffer.Size()));
+    }
+
+    auto elapsed{std::chrono::duration<double, std::nano>(Clock::now() - start).count()};
+
+    return checksum > 0 ? elapsed / static_cast<double>(depth) : 0.0;
+}
+
+double BenchVector(size_t depth) {
+    std::vector<char> buffer;
+    char chunk[RECV_CHUNK];
+    std::memset(chunk, 'x', sizeof(chunk));
+
+    auto start{Clock::now()};
+
+    for (size_t filled{}; filled < depth; filled += RECV_CHUNK) {
+        buffer.insert(buffer.end(), chunk, chunk + RECV_CHUNK);
+    }
+
+    while (!buffer.empty()) {
+        size_t n{std::min(SEND_CHUNK, buffer.size())};
+        buffer.erase(buffer.begin(), buffer.begin() + n);
+    }
+
+    auto elapsed{std::chrono::duration<double, std::nano>(Clock::now() - start).count()};
+
+    return elapsed / static_cast<double>(depth);
+}
+
+} // namespace
+
+int main() {
+    std::printf("%12s %16s %16s\n", "queue bytes", "Buffer ns/byte", "vector ns/byte");
+
+    for (size_t depth{size_t{64} << 10}; depth <= (size_t{64} << 20); depth <<= 2) {
+        double buffer_cost{BenchBuffer(depth)};
+
+        if (depth <= MAX_VECTOR_DEPTH) {
+            std::printf("%12zu %16.3f %16.3f\n", depth, buffer_cost, BenchVector(depth));
+        } else {
+            std::printf("%12zu %16.3f %16s\n", depth, buffer_cost, "-");
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,473 @@
+/**
+ * @file component_bench.cc
+ * @brief Микробенчмарки компонентов горячего пути: Session, Logger, TimestampCache и цикла событий.
+ *
+ * Каждый случай повторяется, пока не наберется TIME_BUDGET (или MAX_BYTES данных), и печатает
+ * нс на операцию, МБ/с полезных данных и выделения памяти на операцию в потоке бенчмарка:
+ *  - session: пачка из depth сообщений размера size пишется в socketpair клиента (PostgreSQL),
+ *    Session::RecvAll() читает ее в буфер противоположной стороны, Session::TrySend() отправляет
+ *    во второй socketpair, откуда пачка вычитывается; операция — одно сообщение. Для сравнения
+ *    тот же путь проходит recv() + send() через фиксированный буфер (copy);
+ *  - logger: Logger::SaveLogs() запроса размера size в текстовый лог (/dev/null) и в двоичные
+ *    сегменты во временном каталоге; очередь ждет поток записи (K_BLOCK), поэтому измеряется
+ *    установившаяся пропускная способность. Выделения потока записи не учитываются;
+ *  - timestamp: метка времени лога — Update() + Format() и копия из кэша (Format());
+ *  - poller: пробуждение цикла событий — запись байта в socketpair, Poller::Wait() и чтение байта.
+ *
+ * С --baseline PATH рядом печатается результат из файла и изменение нс/оп в процентах; изменения
+ * больше REGRESSION_PERCENT отмечаются '!'. --save PATH записывает результаты в этом формате.
+ */
+
+#include <new>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <algorithm>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+#include <filesystem>
+#include <unordered_map>
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+
+#include "../src/server/logger/logger.h"
+#include "../src/server/poller/poller.h"
+#include "../src/server/backend/backend.h"
+#include "../src/server/session/session.h"
+#include "../src/server/unique_fd/unique_fd.h"
+#include "../src/server/clock/timestamp_cache.h"
+
+namespace {
+
+thread_local size_t allocations{};
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::chrono::milliseconds TIME_BUDGET{300};
+constexpr size_t MAX_BYTES{size_t{256} << 20};
+constexpr int SOCKET_BUFFER{4 << 20};
+constexpr double REGRESSION_PERCENT{20.0};
+
+const size_t MESSAGE_SIZES[]{64, 1024, 4096};
+const size_t QUEUE_DEPTHS[]{1, 8, 32};
+const size_t QUERY_SIZES[]{32, 256, 2048};
+
+struct Result {
+    std::string name;
+    double ns_per_op;
+    double mb_per_s;
+    double allocs_per_op;
+};
+
+/**
+ * @brief Повторяет раунд, пока не истечет TIME_BUDGET или не наберется MAX_BYTES.
+ * @param name Название случая.
+ * @param ops_per_round Операций в раунде.
+ * @param bytes_per_op Полезных байт на операцию.
+ * @param round Раунд.
+ */
+template <typename Func>
+Result Measure(const std::string& name, size_t ops_per_round, size_t bytes_per_op, Func&& round) {
+    round();
+
+    size_t ops{};
+    size_t allocs_before{allocations};
+    auto start{Clock::now()};
+    auto elapsed{Clock::duration::zero()};
+
+    while (elapsed < TIME_BUDGET && ops * bytes_per_op < MAX_BYTES) {
+        round();
+        ops += ops_per_round;
+        elapsed = Clock::now() - start;
+    }
+
+    double ns{std::chrono::duration<double, std::nano>(elapsed).count()};
+
+    return Result{name, ns / static_cast<double>(ops),
+                  static_cast<double>(ops * bytes_per_op) * 1e3 / ns,
+                  static_cast<double>(allocations - allocs_before) / static_cast<double>(ops)};
+}
+
+void MakeSocketPair(UniqueFD& left, UniqueFD& right) {
+    int fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == -1) {
+        throw std::runtime_error("socketpair(): " + std::string(strerror(errno)));
+    }
+
+    left = UniqueFD(fds[0]);
+    right = UniqueFD(fds[1]);
+
+    for (int fd : fds) {
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &SOCKET_BUFFER, sizeof(SOCKET_BUFFER));
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &SOCKET_BUFFER, sizeof(SOCKET_BUFFER));
+    }
+}
+
+void WriteAll(int fd, const std::string& data) {
+    ssize_t n{write(fd, data.data(), data.size())};
+
+    // Пачка меньше буфера сокета: неполная запись означает, что получатель не вычитал прошлую.
+    if (n != static_cast<ssize_t>(data.size())) {
+        throw std::runtime_error("WriteAll(): short write");
+    }
+}
+
+void ReadAll(int fd, std::vector<char>& buffer, size_t size) {
+    while (size > 0) {
+        ssize_t n{read(fd, buffer.data(), std::min(size, buffer.size()))};
+
+        if (n <= 0) {
+            throw std::runtime_error("ReadAll(): data is missing");
+        }
+
+        size -= n;
+    }
+}
+
+void AppendUInt32(std::string& out, uint32_t value) {
+    uint32_t net{htonl(value)};
+    out.append(reinterpret_cast<const char*>(&net), sizeof(net));
+}
+
+/**
+ * @brief Пачка из depth сообщений type по size байт (вместе с заголовком).
+ */
+std::string MakeBatch(char type, size_t size, size_t depth) {
+    std::string batch;
+
+    for (size_t i{}; i < depth; ++i) {
+        batch.push_back(type);
+        AppendUInt32(batch, static_cast<uint32_t>(size - 1));
+        batch.append(size - 6, 'x');
+        batch.push_back('\0');
+    }
+
+    return batch;
+}
+
+std::string MakeStartup() {
+    std::string body;
+    AppendUInt32(body, FrameParser::PROTOCOL_VERSION_3);
+    body.append("user").push_back('\0');
+    body.append("bench").push_back('\0');
+    body.push_back('\0');
+
+    std::string startup;
+    AppendUInt32(startup, static_cast<uint32_t>(body.size() + 4));
+
+    return startup + body;
+}
+
+/**
+ * @brief Сессия между двумя socketpair: client_peer — клиент, pgsql_peer — PostgreSQL.
+ */
+struct SessionPair {
+    UniqueFD client_peer;
+    UniqueFD pgsql_peer;
+    std::unique_ptr<Session> session;
+    int client_fd{-1};
+    int pgsql_fd{-1};
+    size_t messages{};
+
+    SessionPair() {
+        UniqueFD client_end;
+        UniqueFD pgsql_end;
+        MakeSocketPair(client_peer, client_end);
+        MakeSocketPair(pgsql_peer, pgsql_end);
+
+        client_fd = client_end;
+        pgsql_fd = pgsql_end;
+
+        session = std::make_unique<Session>(std::make_unique<Backend>(std::move(pgsql_end)), std::move(client_end),
+                                            [](int, uint32_t) {});
+        session->SetMessageCallback([this](const FrontendMessage&) { ++messages; });
+
+        if (!session->FinishConnect()) {
+            throw std::runtime_error("Session::FinishConnect() failed");
+        }
+
+        // Этап запуска проходит заранее: дальше разборщик видит только обычные сообщения.
+        std::string startup{MakeStartup()};
+        std::vector<char> buffer(startup.size());
+        Forward(client_peer, client_fd, pgsql_fd, pgsql_peer, startup, buffer);
+    }
+
+    void Forward(int source_peer, int source_fd, int target_fd, int target_peer, const std::string& batch,
+                 std::vector<char>& buffer) {
+        WriteAll(source_peer, batch);
+
+        if (!session->RecvAll(source_fd) || !session->TrySend(target_fd)) {
+            throw std::runtime_error("Session: connection failed");
+        }
+
+        ReadAll(target_peer, buffer, batch.size());
+    }
+};
+
+void BenchSession(std::vector<Result>& results) {
+    std::vector<char> buffer(size_t{1} << 16);
+    std::vector<char> relay(size_t{1} << 16);
+
+    for (size_t size : MESSAGE_SIZES) {
+        for (size_t depth : QUEUE_DEPTHS) {
+            std::string suffix{"/" + std::to_string(size) + "x" + std::to_string(depth)};
+            std::string queries{MakeBatch('Q', size, depth)};
+            std::string rows{MakeBatch('D', size, depth)};
+            SessionPair pair;
+
+            results.push_back(Measure("session_client_to_pgsql" + suffix, depth, size, [&] {
+                pair.Forward(pair.client_peer, pair.client_fd, pair.pgsql_fd, pair.pgsql_peer, queries, buffer);
+            }));
+
+            results.push_back(Measure("session_pgsql_to_client" + suffix, depth, size, [&] {
+                pair.Forward(pair.pgsql_peer, pair.pgsql_fd, pair.client_fd, pair.client_peer, rows, buffer);
+            }));
+
+            UniqueFD source_peer;
+            UniqueFD source;
+            UniqueFD target;
+            UniqueFD target_peer;
+            MakeSocketPair(source_peer, source);
+            MakeSocketPair(target, target_peer);
+
+            results.push_back(Measure("copy_reference" + suffix, depth, size, [&] {
+                WriteAll(source_peer, rows);
+
+                ssize_t n;
+
+                while ((n = recv(source, relay.data(), relay.size(), 0)) > 0) {
+                    send(target, relay.data(), n, MSG_NOSIGNAL);
+                }
+
+                ReadAll(target_peer, buffer, rows.size());
+            }));
+        }
+    }
+}
+
+void BenchLogger(std::vector<Result>& results) {
+    Endpoint endpoint{"127.0.0.1", 40000, 0x0100007f, 1};
+    std::filesystem::path directory{std::filesystem::temp_directory_path() /
+                                    ("component_bench." + std::to_string(getpid()))};
+    std::filesystem::create_directories(directory);
+
+    for (size_t size : QUERY_SIZES) {
+        std::string query(size, 'x');
+        QueryText text{query, {}, -1, 'Q'};
+
+        for (LogFormat format : {LogFormat::K_TEXT, LogFormat::K_BINARY}) {
+            bool binary{format == LogFormat::K_BINARY};
+            LogOptions options;
+            options.format = format;
+            // Оба приемника пишут в файлы одного каталога, иначе текстовый выигрывает за счет /dev/null.
+            options.path = (directory / (binary ? "requests.bin" : "requests.log")).string();
+            options.segment_size = size_t{16} << 20;
+
+            Logger logger(options);
+            TimestampCache time;
+            time.Update();
+
+            results.push_back(Measure(std::string(binary ? "logger_binary/" : "logger_text/") + std::to_string(size),
+                                      1024, size, [&] {
+                for (size_t i{}; i < 1024; ++i) {
+                    logger.SaveLogs(endpoint, text, time.GetNanoseconds());
+                }
+            }));
+        }
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+void BenchTimestamp(std::vector<Result>& results) {
+    TimestampCache time;
+    char stamp[64];
+    size_t length{};
+
+    results.push_back(Measure("timestamp_update_format", 1024, 0, [&] {
+        for (size_t i{}; i < 1024; ++i) {
+            time.Update();
+            length += time.Format(stamp, TimePrecision::K_MICROSECONDS);
+        }
+    }));
+
+    results.push_back(Measure("timestamp_cached_format", 1024, 0, [&] {
+        for (size_t i{}; i < 1024; ++i) {
+            length += time.Format(stamp, TimePrecision::K_MICROSECONDS);
+        }
+    }));
+
+    if (length == 0) {
+        std::printf("(empty timestamps)\n");
+    }
+}
+
+void BenchPoller(std::vector<Result>& results) {
+    std::vector<std::string> names;
+
+    for (IoEngine engine : {IoEngine::K_EPOLL, IoEngine::K_IO_URING}) {
+        std::unique_ptr<Poller> poller{Poller::Create(engine)};
+
+        // io_uring недоступен: Create() вернул epoll, который уже измерен.
+        if (std::find(names.begin(), names.end(), poller->GetName()) != names.end()) {
+            continue;
+        }
+
+        names.push_back(poller->GetName());
+
+        UniqueFD writer;
+        UniqueFD reader;
+        MakeSocketPair(writer, reader);
+
+        if (!poller->Add(reader, EPOLLIN, 1)) {
+            throw std::runtime_error("Poller::Add(): " + std::string(strerror(errno)));
+        }
+
+        Poller::Event events[16];
+        char byte{'x'};
+
+        results.push_back(Measure("poller_wakeup/" + poller->GetName(), 1, 1, [&] {
+            if (write(writer, &byte, 1) != 1 || poller->Wait(events, 16, -1) < 1 || read(reader, &byte, 1) != 1) {
+                throw std::runtime_error("Poller: wakeup failed");
+            }
+        }));
+
+        poller->Remove(reader);
+    }
+}
+
+std::unordered_map<std::string, double> LoadBaseline(const std::string& path) {
+    std::unordered_map<std::string, double> baseline;
+    std::ifstream input(path);
+
+    if (!input) {
+        throw std::runtime_error("LoadBaseline(): " + path + ": " + strerror(errno));
+    }
+
+    std::string line;
+
+    while (std::getline(input, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        std::string name;
+        double ns_per_op{};
+
+        if (fields >> name >> ns_per_op) {
+            baseline[name] = ns_per_op;
+        }
+    }
+
+    return baseline;
+}
+
+void SaveBaseline(const std::string& path, const std::vector<Result>& results) {
+    std::ofstream output(path);
+
+    if (!output) {
+        throw std::runtime_error("SaveBaseline(): " + path + ": " + strerror(errno));
+    }
+
+    output << "# name ns/op MB/s allocs/op (make bench_baseline)\n";
+
+    for (const Result& result : results) {
+        char line[160];
+        std::snprintf(line, sizeof(line), "%s %.1f %.1f %.2f\n", result.name.c_str(), result.ns_per_op,
+                      result.mb_per_s, result.allocs_per_op);
+        output << line;
+    }
+}
+
+std::string GetUsage(const char* program) {
+    return std::string("Usage: ") + program + " [--baseline PATH] [--save PATH]\n";
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    ++allocations;
+
+    if (void* ptr{std::malloc(size == 0 ? 1 : size)}) {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+int main(int argc, char* argv[]) {
+    std::string baseline_path;
+    std::string save_path;
+
+    for (int i{1}; i < argc; ++i) {
+        std::string arg{argv[i]};
+
+        if ((arg == "--baseline" || arg == "--save") && i + 1 < argc) {
+            (arg == "--baseline" ? baseline_path : save_path) = argv[++i];
+        } else {
+            std::cerr << GetUsage(argv[0]);
+
+            return 1;
+        }
+    }
+
+    try {
+        std::unordered_map<std::string, double> baseline;
+
+        if (!baseline_path.empty()) {
+            baseline = LoadBaseline(baseline_path);
+        }
+
+        std::vector<Result> results;
+        BenchSession(results);
+        BenchLogger(results);
+        BenchTimestamp(results);
+        BenchPoller(results);
+
+        std::printf("%-34s %10s %10s %10s %12s %8s\n", "case", "ns/op", "MB/s", "allocs/op", "baseline ns", "change");
+
+        for (const Result& result : results) {
+            std::printf("%-34s %10.1f %10.1f %10.2f", result.name.c_str(), result.ns_per_op, result.mb_per_s,
+                        result.allocs_per_op);
+
+            auto it{baseline.find(result.name)};
+
+            if (it != baseline.end() && it->second > 0) {
+                double change{(result.ns_per_op / it->second - 1.0) * 100.0};
+                std::printf(" %12.1f %+7.1f%%%s", it->second, change, change > REGRESSION_PERCENT ? " !" : "");
+            }
+
+            std::printf("\n");
+        }
+
+        if (!save_path.empty()) {
+            SaveBaseline(save_path, results);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+
+        return 1;
+    }
+
+    return 0;
+}
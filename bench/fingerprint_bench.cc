@@ -0,0 +1,354 @@
+/**
+ * @file fingerprint_bench.cc
+ * @brief Фаззинг и бенчмарк нормализатора запросов FingerprintQuery.
+ *
+ * Сверяет результат FingerprintQuery с побайтовой эталонной реализацией (та же грамматика без SSE2)
+ * на случайных запросах из фрагментов SQL и на случайном мусоре, проверяет, что одинаковый
+ * нормализованный текст дает одинаковый отпечаток, затем измеряет скорость нормализации
+ * (нс на запрос и МБ/с) на запросах в духе sysbench: oltp_insert с длинными строковыми литералами,
+ * point select и запрос с комментарием и IN-списком. Для сравнения печатается скорость эталона.
+ */
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+#include "../src/server/protocol/fingerprint.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool IsIdentChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || IsDigit(c) || c == '_' || c == '$' ||
+           static_cast<unsigned char>(c) >= 0x80;
+}
+
+bool IsWordChar(char c) {
+    return IsIdentChar(c) || c == '?' || c == '"';
+}
+
+char ToLower(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+size_t SkipString(std::string_view query, size_t pos, bool backslash_escapes) {
+    size_t i{pos + 1};
+
+    while (i < query.size()) {
+        if (backslash_escapes && query[i] == '\\') {
+            i += 2;
+        } else if (query[i] == '\'') {
+            if (i + 1 < query.size() && query[i + 1] == '\'') {
+                i += 2;
+            } else {
+                return i + 1;
+            }
+        } else {
+            ++i;
+        }
+    }
+
+    return query.size();
+}
+
+size_t GetDollarTag(std::string_view query, size_t pos) {
+    size_t i{pos + 1};
+
+    while (i < query.size() && query[i] != '$') {
+        if (!IsIdentChar(query[i]) || (i == pos + 1 && IsDigit(query[i]))) {
+            return 0;
+        }
+
+        ++i;
+    }
+
+    return i < query.size() ? i - pos + 1 : 0;
+}
+
+size_t SkipNumber(std::string_view query, size_t pos) {
+    size_t i{pos};
+
+    while (i < query.size() && (IsDigit(query[i]) || query[i] == '.')) {
+        ++i;
+    }
+
+    if (i < query.size() && (query[i] == 'e' || query[i] == 'E')) {
+        size_t exponent{i + 1};
+
+        if (exponent < query.size() && (query[exponent] == '+' || query[exponent] == '-')) {
+            ++exponent;
+        }
+
+        if (exponent < query.size() && IsDigit(query[exponent])) {
+            i = exponent;
+
+            while (i < query.size() && IsDigit(query[i])) {
+                ++i;
+            }
+        }
+    }
+
+    return i;
+}
+
+// Эталон: посимвольная нормализация с той же грамматикой.
+void ReferenceNormalize(std::string_view query, std::string& normalized) {
+    normalized.clear();
+
+    bool space{false};
+    size_t i{};
+
+    auto emit{[&normalized, &space](char c) {
+        if (space && !normalized.empty() && IsWordChar(normalized.back()) && IsWordChar(c)) {
+            normalized.push_back(' ');
+        }
+
+        space = false;
+        normalized.push_back(c);
+    }};
+
+    while (i < query.size()) {
+        char c{query[i]};
+        bool after_ident{!normalized.empty() && !space && IsIdentChar(normalized.back())};
+
+        if (IsSpace(c)) {
+            space = true;
+            ++i;
+        } else if (c == '-' && i + 1 < query.size() && query[i + 1] == '-') {
+            size_t end{query.find('\n', i)};
+            i = end == std::string_view::npos ? query.size() : end;
+            space = true;
+        } else if (c == '/' && i + 1 < query.size() && query[i + 1] == '*') {
+            size_t end{query.find("*/", i + 2)};
+            i = end == std::string_view::npos ? query.size() : end + 2;
+            space = true;
+        } else if (c == '\'') {
+            i = SkipString(query, i, false);
+            emit('?');
+        } else if ((c == 'e' || c == 'E') && !after_ident && i + 1 < query.size() && query[i + 1] == '\'') {
+            i = SkipString(query, i + 1, true);
+            emit('?');
+        } else if (c == '"') {
+            size_t end{query.find('"', i + 1)};
+            end = end == std::string_view::npos ? query.size() : end + 1;
+
+            for (size_t j{i}; j < end; ++j) {
+                emit(query[j]);
+            }
+
+            i = end;
+        } else if (c == '$' && !after_ident && i + 1 < query.size() && IsDigit(query[i + 1])) {
+            i += 1;
+
+            while (i < query.size() && IsDigit(query[i])) {
+                ++i;
+            }
+
+            emit('?');
+        } else if (size_t tag{c == '$' && !after_ident ? GetDollarTag(query, i) : 0}; tag > 0) {
+            size_t end{query.find(query.substr(i, tag), i + tag)};
+            i = end == std::string_view::npos ? query.size() : end + tag;
+            emit('?');
+        } else if (!after_ident && (IsDigit(c) || (c == '.' && i + 1 < query.size() && IsDigit(query[i + 1])))) {
+            i = SkipNumber(query, i);
+            emit('?');
+        } else {
+            emit(ToLower(c));
+            ++i;
+        }
+    }
+}
+
+std::string MakeLiteral(std::mt19937_64& rng, size_t size) {
+    static const char ALPHABET[]{"0123456789-abcXYZ \\'"};
+
+    std::string literal(size, ' ');
+
+    for (auto& c : literal) {
+        c = ALPHABET[rng() % (sizeof(ALPHABET) - 1)];
+    }
+
+    return literal;
+}
+
+std::string MakeQuery(std::mt19937_64& rng) {
+    static const char* const FRAGMENTS[]{
+        "SELECT", "select", " ", "  ", "\n", "\t", "c", "pad", "Sbtest1", "very_long_identifier_name_0123456789",
+        "ÄÖ", "id", "=", "<>", "(", ")", ",", ";", "*", "'", "''", "E'", "e'", "\\", "\"", "\"Mixed Case\"", "$1", "$12",
+        "$$", "$tag$", "$a", "12", "3.5", ".5", "1e10", "2E-3", "x1", "--", "/*", "*/", "-- comment\n", "/* c */",
+        "IN", "VALUES", "::text", "a.b", "_", "0x1F", "ABCDEFGHIJKLMNOPQRSTUVWXYZ_abcdefghijklmnop",
+    };
+
+    std::string query;
+
+    for (size_t i{}, parts{1 + rng() % 40}; i < parts; ++i) {
+        if (rng() % 8 == 0) {
+            query += '\'' + MakeLiteral(rng, rng() % 80) + '\'';
+        } else {
+            query += FRAGMENTS[rng() % (sizeof(FRAGMENTS) / sizeof(FRAGMENTS[0]))];
+        }
+    }
+
+    return query;
+}
+
+bool Fuzz(std::mt19937_64& rng, size_t rounds) {
+    std::string expected;
+    std::string normalized;
+    std::unordered_map<std::string, uint64_t> fingerprints;
+
+    for (size_t round{}; round < rounds; ++round) {
+        std::string query{MakeQuery(rng)};
+
+        if (rng() % 16 == 0) {
+            query.assign(rng() % 300, '\0');
+
+            for (auto& c : query) {
+                c = static_cast<char>(rng());
+            }
+        }
+
+        ReferenceNormalize(query, expected);
+        uint64_t fingerprint{FingerprintQuery(query, normalized)};
+
+        if (normalized != expected) {
+            std::printf("fuzz: mismatch in round %zu\n  query:    %s\n  expected: %s\n  actual:   %s\n", round,
+                        query.c_str(), expected.c_str(), normalized.c_str());
+
+            return false;
+        }
+
+        auto [it, inserted]{fingerprints.emplace(normalized, fingerprint)};
+
+        if (!inserted && it->second != fingerprint) {
+            std::printf("fuzz: unstable fingerprint in round %zu\n", round);
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::vector<std::string> MakeWorkload(std::mt19937_64& rng, const std::string& name, size_t count) {
+    std::vector<std::string> queries;
+
+    auto number{[&rng](size_t digits) {
+        std::string value;
+
+        for (size_t i{}; i < digits; ++i) {
+            value += static_cast<char>('0' + rng() % 10);
+        }
+
+        return value;
+    }};
+
+    for (size_t i{}; i < count; ++i) {
+        if (name == "oltp_insert") {
+            std::string c;
+            std::string pad;
+
+            for (size_t group{}; group < 10; ++group) {
+                c += (group ? "-" : "") + number(11);
+            }
+
+            for (size_t group{}; group < 5; ++group) {
+                pad += (group ? "-" : "") + number(11);
+            }
+
+            queries.push_back("INSERT INTO sbtest1 (id, k, c, pad) VALUES (" + number(6) + ", " + number(6) + ", '" + c +
+                              "', '" + pad + "')");
+        } else if (name == "point_select") {
+            queries.push_back("SELECT c FROM sbtest1 WHERE id=" + number(6));
+        } else {
+            std::string list;
+
+            for (size_t item{}; item < 20; ++item) {
+                list += (item ? ", " : "") + number(5);
+            }
+
+            queries.push_back("/* app:orders */ SELECT o.id, o.status, c.Name FROM orders o JOIN customers c ON "
+                              "c.id = o.customer_id WHERE o.id IN (" + list + ") AND o.status <> 'cancelled'");
+        }
+    }
+
+    return queries;
+}
+
+template <typename Normalize>
+double Bench(const std::vector<std::string>& queries, Normalize normalize) {
+    constexpr size_t ITERATIONS{20};
+
+    uint64_t checksum{};
+    std::string normalized;
+
+    auto start{Clock::now()};
+
+    for (size_t i{}; i < ITERATIONS; ++i) {
+        for (const std::string& query : queries) {
+            checksum += normalize(query, normalized);
+        }
+    }
+
+    double seconds{std::chrono::duration<double>(Clock::now() - start).count()};
+
+    // Контрольная сумма не дает компилятору выбросить вызовы.
+    volatile uint64_t sink{checksum};
+    (void)sink;
+
+    return seconds * 1e9 / static_cast<double>(queries.size() * ITERATIONS);
+}
+
+} // namespace
+
+int main() {
+    std::mt19937_64 rng{20240715};
+
+    if (!Fuzz(rng, 200000)) {
+        return 1;
+    }
+
+    std::printf("fuzz: 200000 queries ok\n\n");
+    std::printf("%14s %10s %12s %12s %12s %12s\n", "workload", "bytes/q", "ns/q", "MB/sec", "ref ns/q", "ref MB/sec");
+
+    for (const char* name : {"oltp_insert", "point_select", "in_list"}) {
+        std::vector<std::string> queries{MakeWorkload(rng, name, 10000)};
+
+        size_t total{};
+
+        for (const std::string& query : queries) {
+            total += query.size();
+        }
+
+        double average{static_cast<double>(total) / static_cast<double>(queries.size())};
+
+        double fast{Bench(queries, [](const std::string& query, std::string& normalized) {
+            return FingerprintQuery(query, normalized);
+        })};
+
+        double reference{Bench(queries, [](const std::string& query, std::string& normalized) {
+            ReferenceNormalize(query, normalized);
+
+            return static_cast<uint64_t>(normalized.size());
+        })};
+
+        std::printf("%14s %10.0f %12.1f %12.1f %12.1f %12.1f\n", name, average, fast, average * 1e3 / fast, reference,
+                    average * 1e3 / reference);
+    }
+
+    return 0;
+}
@@ -0,0 +1,240 @@
+/**
+ * @file frame_parser_bench.cc
+ * @brief Фаззинг и бенчмарк разборщика сообщений FrameParser.
+ *
+ * Генерирует поток клиента (SSLRequest, StartupMessage и смесь Query/Parse/Bind/Execute/Sync/CopyData),
+ * затем:
+ *  - подает его разборщику порциями случайного размера и сверяет каждое переданное сообщение
+ *    с эталоном (тип, длина, тело, ровно один раз);
+ *  - подает случайный мусор и случайно испорченные потоки (разборщик не должен падать);
+ *  - измеряет скорость разбора (сообщений в секунду) для разных размеров порций.
+ */
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+
+#include <arpa/inet.h>
+
+#include "../src/server/protocol/frame_parser.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Expected {
+    char type;
+    std::string body;
+};
+
+void AppendUInt32(std::string& out, uint32_t value) {
+    uint32_t net{htonl(value)};
+    out.append(reinterpret_cast<const char*>(&net), sizeof(net));
+}
+
+void AppendMessage(std::string& out, std::vector<Expected>& expected, char type, const std::string& body) {
+    if (type != '\0') {
+        out.push_back(type);
+    }
+
+    AppendUInt32(out, static_cast<uint32_t>(body.size() + 4));
+    out += body;
+    expected.push_back(Expected{type, body});
+}
+
+std::string MakeText(std::mt19937_64& rng, size_t size) {
+    static const char ALPHABET[]{"SELECT abcdefghijklmnopqrstuvwxyz0123456789 =,*()'"};
+
+    std::string text(size, ' ');
+
+    for (auto& c : text) {
+        c = ALPHABET[rng() % (sizeof(ALPHABET) - 1)];
+    }
+
+    return text;
+}
+
+std::string MakeStream(std::mt19937_64& rng, size_t messages, std::vector<Expected>& expected) {
+    std::string stream;
+    std::string code;
+
+    AppendUInt32(code, FrameParser::SSL_REQUEST_CODE);
+    AppendMessage(stream, expected, '\0', code);
+
+    std::string startup;
+    AppendUInt32(startup, FrameParser::PROTOCOL_VERSION_3);
+    startup += std::string("user\0bench\0database\0bench\0\0", 27);
+    AppendMessage(stream, expected, '\0', startup);
+
+    for (size_t i{}; i < messages; ++i) {
+        switch (rng() % 8) {
+            case 0:
+            case 1:
+            case 2:
+                AppendMessage(stream, expected, 'Q', MakeText(rng, 16 + rng() % 200) + '\0');
+                break;
+            case 3:
+                AppendMessage(stream, expected, 'P', std::string("\0", 1) + MakeText(rng, 32 + rng() % 100) + std::string("\0\0\0", 3));
+                break;
+            case 4:
+                AppendMessage(stream, expected, 'B', std::string(14 + rng() % 40, '\0'));
+                break;
+            case 5:
+                AppendMessage(stream, expected, 'E', std::string(5, '\0'));
+                break;
+            case 6:
+                AppendMessage(stream, expected, 'S', "");
+                break;
+            default:
+                AppendMessage(stream, expected, 'd', MakeText(rng, rng() % 64 == 0 ? 100000 + rng() % 50000 : rng() % 2000));
+                break;
+        }
+    }
+
+    return stream;
+}
+
+bool Verify(const std::string& stream, const std::vector<Expected>& expected, std::mt19937_64& rng, size_t max_chunk,
+            size_t max_capture) {
+    FrameParser parser{max_capture};
+    size_t index{};
+    bool ok{true};
+
+    FrameParser::Callback on_message{[&](const FrontendMessage& message) {
+        if (index >= expected.size()) {
+            ok = false;
+
+            return;
+        }
+
+        const Expected& want{expected[index++]};
+        size_t captured{std::min(want.body.size(), parser.GetMaxCapture())};
+
+        if (message.type != want.type || message.length != want.body.size() + 4 ||
+            message.body != std::string_view(want.body).substr(0, message.truncated ? captured : std::string::npos)) {
+            ok = false;
+        }
+    }};
+
+    // SSLRequest (8 байт) приходит отдельным чтением: клиент ждет ответа сервера.
+    constexpr size_t first{8};
+    parser.Feed(std::string_view(stream).substr(0, first / 2), on_message);
+    parser.Feed(std::string_view(stream).substr(first / 2, first / 2), on_message);
+
+    for (size_t pos{first}; pos < stream.size();) {
+        size_t chunk{std::min(stream.size() - pos, size_t{1} + rng() % max_chunk)};
+
+        parser.Feed(std::string_view(stream).substr(pos, chunk), on_message);
+        pos += chunk;
+    }
+
+    return ok && index == expected.size() && parser.GetState() == FrameParser::State::K_MESSAGES;
+}
+
+bool Fuzz(std::mt19937_64& rng, size_t rounds) {
+    for (size_t round{}; round < rounds; ++round) {
+        std::vector<Expected> expected;
+        std::string stream{MakeStream(rng, 64 + rng() % 256, expected)};
+
+        size_t max_chunk{rng() % 4 == 0 ? 8 : 1 + rng() % 20000};
+        size_t max_capture{rng() % 2 == 0 ? size_t{1} << 20 : 64};
+
+        if (!Verify(stream, expected, rng, max_chunk, max_capture)) {
+            std::printf("fuzz: mismatch in round %zu (max chunk %zu)\n", round, max_chunk);
+
+            return false;
+        }
+
+        // Испорченный поток и случайный мусор: разборщик должен либо разобрать сообщения,
+        // либо перейти в непрозрачный режим, не выходя за границы данных.
+        for (size_t i{}, flips{1 + rng() % 8}; i < flips; ++i) {
+            stream[rng() % stream.size()] = static_cast<char>(rng());
+        }
+
+        std::string garbage(rng() % 4096, '\0');
+
+        for (auto& c : garbage) {
+            c = static_cast<char>(rng());
+        }
+
+        for (const std::string* input : {&stream, &garbage}) {
+            FrameParser parser;
+            size_t total{};
+
+            FrameParser::Callback on_message{[&](const FrontendMessage& message) {
+                total += message.body.size();
+            }};
+
+            for (size_t pos{}; pos < input->size();) {
+                size_t chunk{std::min(input->size() - pos, size_t{1} + rng() % 512)};
+
+                parser.Feed(std::string_view(*input).substr(pos, chunk), on_message);
+                pos += chunk;
+            }
+
+            if (total > input->size()) {
+                std::printf("fuzz: delivered more bytes than fed in round %zu\n", round);
+
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void Bench(const std::string& stream, size_t messages, size_t chunk) {
+    constexpr size_t ITERATIONS{20};
+
+    size_t delivered{};
+
+    FrameParser::Callback on_message{[&](const FrontendMessage&) {
+        ++delivered;
+    }};
+
+    auto start{Clock::now()};
+
+    for (size_t i{}; i < ITERATIONS; ++i) {
+        FrameParser parser;
+
+        for (size_t pos{}; pos < stream.size(); pos += chunk) {
+            parser.Feed(std::string_view(stream).substr(pos, chunk), on_message);
+        }
+    }
+
+    double seconds{std::chrono::duration<double>(Clock::now() - start).count()};
+    double bytes{static_cast<double>(stream.size()) * ITERATIONS};
+
+    std::printf("%10zu %16.0f %12.1f %12s\n", chunk, static_cast<double>(delivered) / seconds, bytes / seconds / 1e6,
+                delivered == (messages + 2) * ITERATIONS ? "ok" : "MISMATCH");
+}
+
+} // namespace
+
+int main() {
+    std::mt19937_64 rng{20240601};
+
+    if (!Fuzz(rng, 300)) {
+        return 1;
+    }
+
+    std::printf("fuzz: 300 rounds ok\n\n");
+
+    constexpr size_t MESSAGES{200000};
+
+    std::vector<Expected> expected;
+    std::string stream{MakeStream(rng, MESSAGES, expected)};
+
+    std::printf("stream: %zu messages, %zu bytes\n", expected.size(), stream.size());
+    std::printf("%10s %16s %12s %12s\n", "chunk", "msgs/sec", "MB/sec", "check");
+
+    for (size_t chunk : {size_t{1}, size_t{64}, size_t{1448}, size_t{16384}, size_t{1} << 20}) {
+        Bench(stream, MESSAGES, chunk);
+    }
+
+    return 0;
+}
@@ -0,0 +1,264 @@
+/**
+ * @file result_cache_bench.cc
+ * @brief Проверка разбора запросов и бенчмарк кэша результатов ResultCache.
+ *
+ * Сверяет ClassifyQuery() с ожидаемым доступом, таблицами и пригодностью для реплики на наборе запросов
+ * (чтения, изменения, DDL, изменчивые функции, литералы и комментарии), а ClassifyWrite() — с ClassifyQuery(),
+ * затем измеряет время разбора запроса (нс и МБ/с) для чтений (полного и короткого) и изменений,
+ * похожих на sysbench, и стоимость поиска в кэше
+ * для 1k–64k записей: попадание, попадание после изменения другой таблицы и промах после изменения
+ * своей (поиск, удаление и сохранение ответа).
+ */
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+
+#include "../src/server/cache/result_cache.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Case {
+    const char* query;
+    QueryAccess access;
+    std::vector<const char*> tables;
+    bool read_only;
+};
+
+const char* GetAccessName(QueryAccess access) {
+    switch (access) {
+        case QueryAccess::K_NONE: return "none";
+        case QueryAccess::K_READ: return "read";
+        case QueryAccess::K_WRITE: return "write";
+        case QueryAccess::K_WRITE_ALL: return "write_all";
+    }
+
+    return "?";
+}
+
+bool Check() {
+    const std::vector<Case> cases{
+        {"SELECT c FROM sbtest1 WHERE id=42", QueryAccess::K_READ, {"sbtest1"}, true},
+        {"select a from s.t1 x, t2 join t3 on true where x.a in (select 1 from t4)", QueryAccess::K_READ,
+         {"t1", "t2", "t3", "t4"}, true},
+        {"select count(*) from \"Orders\" -- total\n", QueryAccess::K_READ, {"Orders"}, true},
+        {"with x as (select * from a) select * from x", QueryAccess::K_READ, {"a", "x"}, true},
+        {"select now()", QueryAccess::K_NONE, {}, true},
+        {"select 1; select 2 from t", QueryAccess::K_NONE, {"t"}, true},
+        {"select pg_advisory_lock(1)", QueryAccess::K_NONE, {}, false},
+        {"select * into u from t", QueryAccess::K_NONE, {"t", "u"}, false},
+        {"select * from t for update", QueryAccess::K_NONE, {"t"}, false},
+        {"select * from pg_class", QueryAccess::K_NONE, {"pg_class"}, true},
+        {"select nextval('s')", QueryAccess::K_NONE, {}, false},
+        {"select 'a\\b' from t", QueryAccess::K_NONE, {"t"}, false},
+        {"begin; select 1 from t; commit", QueryAccess::K_NONE, {"t"}, false},
+        {"set search_path = s", QueryAccess::K_NONE, {}, false},
+        {"INSERT INTO sbtest1 (id, k, c, pad) VALUES (1, 2, 'x', 'y')", QueryAccess::K_WRITE, {"sbtest1"}, false},
+        {"update t set a = 1 where b in (select c from u)", QueryAccess::K_WRITE, {"t"}, false},
+        {"delete from only t using u, v where t.a = u.a", QueryAccess::K_WRITE, {"t"}, false},
+        {"UPDATE public.\"Orders\" SET a = 1;", QueryAccess::K_WRITE, {"Orders"}, false},
+        {"/* batch */ COPY s.t (a, b) FROM STDIN", QueryAccess::K_WRITE, {"t"}, false},
+        {"insert into t select set_config('search_path', 's', false)", QueryAccess::K_WRITE, {"t"}, false},
+        {"update t set a = 1; delete from u", QueryAccess::K_WRITE, {"t", "u"}, false},
+        {"copy (select * from t) to stdout", QueryAccess::K_WRITE, {"t"}, false},
+        {"COMMIT", QueryAccess::K_NONE, {}, false},
+        {"lock table t", QueryAccess::K_NONE, {}, false},
+        {"with x as (delete from a returning *) select * from x", QueryAccess::K_WRITE, {"a", "x"}, false},
+        {"create table z (a int)", QueryAccess::K_WRITE_ALL, {"z"}, false},
+        {"explain analyze select 1", QueryAccess::K_WRITE_ALL, {}, false},
+        {"insert into t values ('x; delete from u", QueryAccess::K_WRITE_ALL, {"t"}, false},
+    };
+
+    QueryClass result;
+
+    for (const Case& test : cases) {
+        ClassifyQuery(test.query, result);
+
+        std::vector<uint16_t> expected;
+
+        for (const char* table : test.tables) {
+            expected.push_back(TableVersions::GetSlot(table));
+        }
+
+        std::vector<uint16_t> actual{result.tables};
+        std::sort(expected.begin(), expected.end());
+        std::sort(actual.begin(), actual.end());
+
+        if (result.access != test.access || actual != expected || result.read_only != test.read_only) {
+            std::printf("mismatch: '%s': %s with %zu tables (read only %d), expected %s with %zu (read only %d)\n",
+                        test.query, GetAccessName(result.access), actual.size(), result.read_only,
+                        GetAccessName(test.access), expected.size(), test.read_only);
+
+            return false;
+        }
+
+        // Короткий разбор должен инвалидировать то же самое и так же отмечать состояние сеанса.
+        QueryClass write;
+        ClassifyWrite(test.query, write);
+
+        bool changes{result.access == QueryAccess::K_WRITE || result.access == QueryAccess::K_WRITE_ALL};
+        QueryAccess access{result.access == QueryAccess::K_READ ? QueryAccess::K_NONE : result.access};
+
+        if (write.access != access || (changes && write.tables != result.tables) ||
+            write.session_state != result.session_state || write.read_only) {
+            std::printf("write mismatch: '%s': %s with %zu tables, expected %s with %zu\n", test.query,
+                        GetAccessName(write.access), write.tables.size(), GetAccessName(access), result.tables.size());
+
+            return false;
+        }
+    }
+
+    ClassifyQuery("SELECT  c\n/* hint */ FROM T  WHERE id = 'A'", result);
+
+    if (result.normalized != "select c from t where id = 'A'") {
+        std::printf("normalized mismatch: '%s'\n", result.normalized.c_str());
+
+        return false;
+    }
+
+    std::printf("check: %zu queries ok\n\n", cases.size());
+
+    return true;
+}
+
+void BenchClassify(const char* name, void (*classify)(std::string_view, QueryClass&),
+                   const std::vector<std::string>& queries) {
+    constexpr size_t ROUNDS{200000};
+
+    QueryClass result;
+    size_t bytes{};
+    uint64_t checksum{};
+
+    auto start{Clock::now()};
+
+    for (size_t i{}; i < ROUNDS; ++i) {
+        const std::string& query{queries[i % queries.size()]};
+
+        classify(query, result);
+        bytes += query.size();
+        checksum += result.normalized.size() + result.tables.size();
+    }
+
+    double seconds{std::chrono::duration<double>(Clock::now() - start).count()};
+
+    volatile uint64_t sink{checksum};
+    (void)sink;
+
+    std::printf("classify %s: %.1f ns/query, %.1f MB/s\n", name, seconds * 1e9 / ROUNDS, bytes / seconds / 1e6);
+}
+
+void BenchCache(size_t entries) {
+    constexpr size_t LOOKUPS{1000000};
+    constexpr size_t RESPONSE_SIZE{256};
+
+    TableVersions versions;
+    TimestampCache time;
+    WorkerMetrics metrics;
+    ResultCache cache{entries * 1024, std::chrono::milliseconds(60000), versions, time, metrics};
+
+    std::vector<CachedQuery> queries(entries);
+    std::string response(RESPONSE_SIZE, 'D');
+
+    constexpr char STARTUP[]{"user\0app\0database\0app\0"};
+
+    for (size_t i{}; i < entries; ++i) {
+        queries[i].key = std::string(STARTUP, sizeof(STARTUP)) + "select c from sbtest1 where id=" + std::to_string(i);
+        queries[i].tables = {TableVersions::GetSlot("sbtest1")};
+        cache.Store(CachedQuery{queries[i]}, std::string(response));
+    }
+
+    auto run{[&](auto lookup) {
+        auto start{Clock::now()};
+        uint64_t checksum{};
+
+        for (size_t i{}; i < LOOKUPS; ++i) {
+            checksum += lookup(queries[(i * 7919) % entries]);
+        }
+
+        volatile uint64_t sink{checksum};
+        (void)sink;
+
+        return std::chrono::duration<double>(Clock::now() - start).count() * 1e9 / LOOKUPS;
+    }};
+
+    double hit{run([&](const CachedQuery& query) -> uint64_t {
+        const std::string* found{cache.Find(query)};
+
+        return found ? found->size() : 0;
+    })};
+
+    // Изменения другой таблицы: попадание проверяет слоты, но запись остается действительной.
+    std::vector<uint16_t> other{TableVersions::GetSlot("other")};
+
+    double invalidated{run([&](const CachedQuery& query) -> uint64_t {
+        cache.Invalidate(other, false);
+
+        const std::string* found{cache.Find(query)};
+
+        return found ? found->size() : 0;
+    })};
+
+    // Изменение своей таблицы: запись удаляется, ответ сервера сохраняется заново.
+    double miss{run([&](const CachedQuery& query) -> uint64_t {
+        cache.Invalidate(query.tables, false);
+
+        if (cache.Find(query)) {
+            return 1;
+        }
+
+        CachedQuery copy{query};
+        copy.sequence = cache.GetSequence();
+        cache.Store(std::move(copy), std::string(response));
+
+        return 0;
+    })};
+
+    std::printf("%8zu %10.1f %24.1f %22.1f %10llu\n", entries, hit, invalidated, miss,
+                static_cast<unsigned long long>(metrics.result_cache_misses.Get()));
+}
+
+} // namespace
+
+int main() {
+    if (!Check()) {
+        return 1;
+    }
+
+    const std::vector<std::string> reads{
+        "SELECT c FROM sbtest1 WHERE id=5021",
+        "SELECT c FROM sbtest1 WHERE id BETWEEN 5021 AND 5120 ORDER BY c",
+        "SELECT SUM(k) FROM sbtest1 WHERE id BETWEEN 5021 AND 5120",
+    };
+
+    // Полный разбор — только для Query, который может получить ответ из кэша или уйти на реплику.
+    BenchClassify("reads", ClassifyQuery, reads);
+
+    // Execute и Query в транзакции: чтение разбирается по первому слову.
+    BenchClassify("reads (not cacheable)", ClassifyWrite, reads);
+
+    // Изменения и управление транзакцией проходят по короткому пути: без нормализации и полного разбора.
+    BenchClassify("writes", ClassifyWrite, {
+        "UPDATE sbtest1 SET k=k+1 WHERE id=5021",
+        "INSERT INTO sbtest1 (id, k, c, pad) VALUES (5021, 4992, '" + std::string(119, '7') + "', '" +
+            std::string(59, '3') + "')",
+        "DELETE FROM sbtest1 WHERE id=5021",
+        "BEGIN",
+        "COMMIT",
+    });
+
+    std::printf("\n");
+
+    std::printf("%8s %10s %24s %22s %10s\n", "entries", "hit ns", "other table changed ns", "own table changed ns",
+                "misses");
+
+    for (size_t entries : {size_t{1} << 10, size_t{1} << 14, size_t{1} << 16}) {
+        BenchCache(entries);
+    }
+
+    return 0;
+}
@@ -0,0 +1,228 @@
+/**
+ * @file session_slab_bench.cc
+ * @brief Бенчмарк хранения сессий: SessionSlab против хеш-таблиц с std::shared_ptr.
+ *
+ * Сравниваются две схемы Worker'а:
+ *  - maps: make_shared<Session>, две записи fd -> shared_ptr (клиент и PostgreSQL) и запись fd -> Endpoint,
+ *    коллбэки с тремя захватами (как было до SessionSlab);
+ *  - slab: Reserve/Emplace/Release в SessionSlab, Endpoint внутри сессии, коллбэки с двумя захватами.
+ *
+ * Для цикла accept/close печатаются выделения памяти и время на цикл, для диспетчеризации события —
+ * время поиска сессии по данным события (хеш + копия shared_ptr против индекса + проверки поколения).
+ * Сокеты не создаются: измеряется только стоимость контейнеров.
+ */
+
+#include <new>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+
+#include "../src/server/session/session_slab.h"
+
+namespace {
+
+size_t allocations{};
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t CYCLES{200000};
+constexpr size_t LIVE_SESSIONS{10000};
+constexpr size_t EVENTS{2000000};
+
+struct Result {
+    double allocs_per_op;
+    double ns_per_op;
+};
+
+Endpoint MakeEndpoint(size_t i) {
+    Endpoint endpoint;
+    endpoint.ip = "127.0.0.1";
+    endpoint.port = static_cast<uint16_t>(i);
+    endpoint.address = 0x0100007f;
+
+    return endpoint;
+}
+
+class MapsWorker {
+public:
+    void Accept(int client_fd, int pgsql_fd) {
+        int* self{&_dummy};
+
+        auto session{std::make_shared<Session>(nullptr, UniqueFD(), [self, client_fd](int fd, uint32_t events) {
+            *self += fd + client_fd + static_cast<int>(events);
+        })};
+
+        StatementCache* statements{&session->GetStatementCache()};
+
+        session->SetMessageCallback([self, client_fd, statements](const FrontendMessage& message) {
+            *self += client_fd + message.type + static_cast<int>(statements != nullptr);
+        });
+
+        _sessions[client_fd] = session;
+        _sessions[pgsql_fd] = session;
+        _endpoints[client_fd] = MakeEndpoint(client_fd);
+    }
+
+    void Close(int client_fd, int pgsql_fd) {
+        _sessions.erase(pgsql_fd);
+        _sessions.erase(client_fd);
+        _endpoints.erase(client_fd);
+    }
+
+    bool Dispatch(int fd) {
+        auto it{_sessions.find(fd)};
+
+        if (it == _sessions.end()) {
+            return false;
+        }
+
+        auto session{it->second};
+
+        return session->IsClientFD(fd);
+    }
+
+private:
+    int _dummy{};
+    std::unordered_map<int, std::shared_ptr<Session>> _sessions;
+    std::unordered_map<int, Endpoint> _endpoints;
+};
+
+class SlabWorker {
+public:
+    SessionSlab::Handle Accept(size_t i) {
+        SessionSlab::Handle handle{_sessions.Reserve()};
+        int* self{&_dummy};
+
+        Session& session{_sessions.Emplace(handle, nullptr, UniqueFD(), [self, handle](int fd, uint32_t events) {
+            *self += fd + static_cast<int>(handle + events);
+        })};
+
+        session.SetMessageCallback([self, &session](const FrontendMessage& message) {
+            *self += message.type + session.GetClientFD();
+        });
+
+        session.SetEndpoint(MakeEndpoint(i));
+
+        return handle;
+    }
+
+    void Close(SessionSlab::Handle handle) {
+        _sessions.Release(handle);
+    }
+
+    bool Dispatch(uint64_t token) {
+        Session* session{_sessions.Get(SessionSlab::GetHandle(token))};
+
+        return session && SessionSlab::GetDirection(token) == SessionSlab::Direction::K_CLIENT;
+    }
+
+private:
+    int _dummy{};
+    SessionSlab _sessions;
+};
+
+template <typename Func>
+Result Measure(size_t ops, Func&& func) {
+    size_t allocs_before{allocations};
+    auto start{Clock::now()};
+
+    func();
+
+    auto elapsed{std::chrono::duration<double, std::nano>(Clock::now() - start).count()};
+
+    return Result{static_cast<double>(allocations - allocs_before) / static_cast<double>(ops),
+                  elapsed / static_cast<double>(ops)};
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    ++allocations;
+
+    if (void* ptr{std::malloc(size == 0 ? 1 : size)}) {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+int main() {
+    MapsWorker maps;
+    SlabWorker slab;
+
+    // Прогрев: таблицы и слоты выделены, в цикле остаются только выделения на соединение.
+    for (size_t i{}; i < LIVE_SESSIONS; ++i) {
+        maps.Accept(static_cast<int>(i), static_cast<int>(i + CYCLES * 2));
+        maps.Close(static_cast<int>(i), static_cast<int>(i + CYCLES * 2));
+        slab.Close(slab.Accept(i));
+    }
+
+    Result maps_churn{Measure(CYCLES, [&] {
+        for (size_t i{}; i < CYCLES; ++i) {
+            int client_fd{static_cast<int>(i % LIVE_SESSIONS)};
+
+            maps.Accept(client_fd, client_fd + static_cast<int>(CYCLES * 2));
+            maps.Close(client_fd, client_fd + static_cast<int>(CYCLES * 2));
+        }
+    })};
+
+    Result slab_churn{Measure(CYCLES, [&] {
+        for (size_t i{}; i < CYCLES; ++i) {
+            slab.Close(slab.Accept(i));
+        }
+    })};
+
+    std::vector<int> fds;
+    std::vector<uint64_t> tokens;
+
+    for (size_t i{}; i < LIVE_SESSIONS; ++i) {
+        maps.Accept(static_cast<int>(i), static_cast<int>(i + LIVE_SESSIONS));
+        fds.push_back(static_cast<int>(i));
+        fds.push_back(static_cast<int>(i + LIVE_SESSIONS));
+
+        SessionSlab::Handle handle{slab.Accept(i)};
+        tokens.push_back(SessionSlab::MakeToken(handle, SessionSlab::Direction::K_CLIENT));
+        tokens.push_back(SessionSlab::MakeToken(handle, SessionSlab::Direction::K_PGSQL));
+    }
+
+    std::mt19937 rng{42};
+    std::vector<size_t> order(EVENTS);
+
+    for (auto& index : order) {
+        index = rng() % fds.size();
+    }
+
+    size_t hits{};
+
+    Result maps_dispatch{Measure(EVENTS, [&] {
+        for (size_t index : order) {
+            hits += maps.Dispatch(fds[index]);
+        }
+    })};
+
+    Result slab_dispatch{Measure(EVENTS, [&] {
+        for (size_t index : order) {
+            hits += slab.Dispatch(tokens[index]);
+        }
+    })};
+
+    std::printf("%-22s %14s %14s\n", "", "maps", "slab");
+    std::printf("%-22s %14.2f %14.2f\n", "accept/close allocs", maps_churn.allocs_per_op, slab_churn.allocs_per_op);
+    std::printf("%-22s %14.1f %14.1f\n", "accept/close ns", maps_churn.ns_per_op, slab_churn.ns_per_op);
+    std::printf("%-22s %14.2f %14.2f\n", "dispatch ns/event", maps_dispatch.ns_per_op, slab_dispatch.ns_per_op);
+    std::printf("(%zu client events)\n", hits);
+
+    return 0;
+}
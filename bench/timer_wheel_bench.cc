@@ -0,0 +1,260 @@
+/**
+ * @file timer_wheel_bench.cc
+ * @brief Проверка и бенчмарк колеса таймеров TimerWheel.
+ *
+ * Сверяет TimerWheel с эталоном (сроки в std::map) на случайной последовательности постановок,
+ * отмен и продвижений времени, в том числе на скачках в часы: каждый таймер истекает ровно один раз,
+ * не раньше срока и при первом Advance() после него, а GetNextExpiry() не позже ближайшего срока.
+ * Затем измеряет стоимость операций (нс) при 1 тыс. — 1 млн взведенных таймеров для колеса
+ * и для std::multimap со сроками (упорядоченный контейнер с выделением узла на каждую постановку):
+ * перестановка таймера (как при каждом запросе сессии), отмена с повторной постановкой и истечение
+ * (время продвигается до ближайшего срока, как в цикле событий).
+ */
+
+#include <map>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+#include "../src/server/timer/timer_wheel.h"
+
+namespace {
+
+using Clock = TimerWheel::Clock;
+using Milliseconds = std::chrono::milliseconds;
+
+uint64_t RandomDelay(std::mt19937_64& rng) {
+    switch (rng() % 4) {
+        case 0:
+            return rng() % 64;
+        case 1:
+            return rng() % 5000;
+        case 2:
+            return rng() % (uint64_t{1} << 22);
+        default:
+            // Дальше охвата колеса (2^24 мс).
+            return rng() % (uint64_t{1} << 26);
+    }
+}
+
+bool Check(std::mt19937_64& rng, size_t steps) {
+    constexpr size_t TIMERS{2000};
+
+    Clock::time_point start{};
+    TimerWheel wheel(start);
+    std::unique_ptr<TimerWheel::Timer[]> timers{std::make_unique<TimerWheel::Timer[]>(TIMERS)};
+    std::map<size_t, uint64_t> deadlines;
+    uint64_t now{};
+
+    for (size_t i{}; i < TIMERS; ++i) {
+        timers[i].SetData(i);
+    }
+
+    for (size_t step{}; step < steps; ++step) {
+        size_t id{static_cast<size_t>(rng() % TIMERS)};
+        uint64_t action{rng() % 10};
+
+        if (action < 5) {
+            uint64_t deadline{now + RandomDelay(rng)};
+
+            wheel.Schedule(timers[id], start + Milliseconds(deadline));
+            deadlines[id] = deadline;
+
+            continue;
+        }
+
+        if (action < 7) {
+            timers[id].Cancel();
+            deadlines.erase(id);
+
+            continue;
+        }
+
+        // Обычно короткий шаг, изредка скачок на часы (долгий сон цикла событий).
+        now += rng() % 100 == 0 ? rng() % (uint64_t{1} << 25) : rng() % 50;
+        wheel.Advance(start + Milliseconds(now));
+
+        while (TimerWheel::Timer* timer{wheel.PopExpired()}) {
+            auto it{deadlines.find(static_cast<size_t>(timer->GetData()))};
+
+            if (it == deadlines.end() || it->second > now) {
+                std::printf("timer %llu expired at %llu, deadline %lld\n",
+                            static_cast<unsigned long long>(timer->GetData()), static_cast<unsigned long long>(now),
+                            it == deadlines.end() ? -1LL : static_cast<long long>(it->second));
+
+                return false;
+            }
+
+            deadlines.erase(it);
+        }
+
+        uint64_t earliest{UINT64_MAX};
+
+        for (const auto& [timer, deadline] : deadlines) {
+            if (deadline <= now) {
+                std::printf("timer %zu missed: deadline %llu, now %llu\n", timer,
+                            static_cast<unsigned long long>(deadline), static_cast<unsigned long long>(now));
+
+                return false;
+            }
+
+            earliest = std::min(earliest, deadline);
+        }
+
+        Clock::time_point next{wheel.GetNextExpiry()};
+
+        if (earliest != UINT64_MAX && next > start + Milliseconds(earliest)) {
+            std::printf("next expiry after the earliest deadline %llu\n", static_cast<unsigned long long>(earliest));
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+struct Result {
+    double rearm_ns; ///< Перестановка взведенного таймера на новый срок.
+    double cancel_ns; ///< Отмена и повторная постановка.
+    double expire_ns; ///< Истечение (на таймер, включая продвижение времени и поиск ближайшего срока).
+};
+
+double Elapsed(Clock::time_point start, size_t operations) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(operations);
+}
+
+Result BenchWheel(size_t count, size_t operations, std::mt19937_64& rng) {
+    Clock::time_point start{};
+    TimerWheel wheel(start);
+    std::unique_ptr<TimerWheel::Timer[]> timers{std::make_unique<TimerWheel::Timer[]>(count)};
+    std::vector<uint32_t> ids(operations);
+    std::vector<uint32_t> delays(operations);
+
+    for (size_t i{}; i < operations; ++i) {
+        ids[i] = static_cast<uint32_t>(rng() % count);
+        delays[i] = static_cast<uint32_t>(1000 + rng() % 60000);
+    }
+
+    for (size_t i{}; i < count; ++i) {
+        wheel.Schedule(timers[i], start + Milliseconds(1000 + rng() % 60000));
+    }
+
+    Result result{};
+
+    auto begin{Clock::now()};
+
+    for (size_t i{}; i < operations; ++i) {
+        wheel.Schedule(timers[ids[i]], start + Milliseconds(delays[i]));
+    }
+
+    result.rearm_ns = Elapsed(begin, operations);
+
+    begin = Clock::now();
+
+    for (size_t i{}; i < operations; ++i) {
+        timers[ids[i]].Cancel();
+        wheel.Schedule(timers[ids[i]], start + Milliseconds(delays[i]));
+    }
+
+    result.cancel_ns = Elapsed(begin, operations);
+
+    // Время идет скачками до ближайшего срока, как цикл событий, который спит до GetNextExpiry().
+    size_t expired{};
+    begin = Clock::now();
+
+    while (expired < count) {
+        wheel.Advance(wheel.GetNextExpiry());
+
+        while (wheel.PopExpired()) {
+            ++expired;
+        }
+    }
+
+    result.expire_ns = Elapsed(begin, expired);
+
+    return result;
+}
+
+Result BenchMultimap(size_t count, size_t operations, std::mt19937_64& rng) {
+    using Map = std::multimap<uint64_t, size_t>;
+
+    Map deadlines;
+    std::vector<Map::iterator> timers(count);
+    std::vector<uint32_t> ids(operations);
+    std::vector<uint32_t> delays(operations);
+
+    for (size_t i{}; i < operations; ++i) {
+        ids[i] = static_cast<uint32_t>(rng() % count);
+        delays[i] = static_cast<uint32_t>(1000 + rng() % 60000);
+    }
+
+    for (size_t i{}; i < count; ++i) {
+        timers[i] = deadlines.emplace(1000 + rng() % 60000, i);
+    }
+
+    Result result{};
+
+    auto begin{Clock::now()};
+
+    for (size_t i{}; i < operations; ++i) {
+        auto node{deadlines.extract(timers[ids[i]])};
+        node.key() = delays[i];
+        timers[ids[i]] = deadlines.insert(std::move(node));
+    }
+
+    result.rearm_ns = Elapsed(begin, operations);
+
+    begin = Clock::now();
+
+    for (size_t i{}; i < operations; ++i) {
+        deadlines.erase(timers[ids[i]]);
+        timers[ids[i]] = deadlines.emplace(delays[i], ids[i]);
+    }
+
+    result.cancel_ns = Elapsed(begin, operations);
+
+    size_t expired{};
+    begin = Clock::now();
+
+    while (!deadlines.empty()) {
+        uint64_t now{deadlines.begin()->first};
+
+        while (!deadlines.empty() && deadlines.begin()->first <= now) {
+            deadlines.erase(deadlines.begin());
+            ++expired;
+        }
+    }
+
+    result.expire_ns = Elapsed(begin, expired);
+
+    return result;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937_64 rng{20241017};
+
+    if (!Check(rng, 2000000)) {
+        return 1;
+    }
+
+    std::printf("check: 2000000 operations ok\n\n");
+    std::printf("%9s %12s %12s %12s %12s %12s %12s\n", "timers", "wheel rearm", "wheel cancel", "wheel expire",
+                "map rearm", "map cancel", "map expire");
+
+    constexpr size_t OPERATIONS{2000000};
+
+    for (size_t count : {size_t{1000}, size_t{10000}, size_t{100000}, size_t{1000000}}) {
+        Result wheel{BenchWheel(count, OPERATIONS, rng)};
+        Result map{BenchMultimap(count, OPERATIONS, rng)};
+
+        std::printf("%9zu %12.1f %12.1f %12.1f %12.1f %12.1f %12.1f\n", count, wheel.rearm_ns, wheel.cancel_ns,
+                    wheel.expire_ns, map.rearm_ns, map.cancel_ns, map.expire_ns);
+    }
+
+    return 0;
+}
@@ -0,0 +1,192 @@
+/**
+ * @file timestamp_bench.cc
+ * @brief Проверка и бенчмарк кэша меток времени TimestampCache.
+ *
+ * Сверяет метки TimestampCache::Format() (секунды, миллисекунды, микросекунды) с strftime и snprintf
+ * на случайных моментах времени, затем измеряет стоимость метки (нс на вызов) в одном и нескольких
+ * потоках для прежнего способа (system_clock::now(), localtime_r и put_time через ostringstream),
+ * для чтения часов и форматирования на каждый вызов (Update() + Format()) и для копирования
+ * метки из кэша, обновляемого раз в пробуждение цикла событий (Format() на 64 вызова — одно Update()).
+ */
+
+#include <ctime>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+
+#include "../src/server/clock/timestamp_cache.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t CALLS_PER_WAKEUP{64};
+
+// Прежний Logger::GetCurrentTimestamp().
+std::string GetCurrentTimestamp() {
+    auto now{std::chrono::system_clock::now()};
+    std::time_t now_time{std::chrono::system_clock::to_time_t(now)};
+    std::tm local_time{};
+    localtime_r(&now_time, &local_time);
+
+    std::ostringstream oss;
+    oss << std::put_time(&local_time, "%Y-%m-%d %H:%M:%S");
+
+    return oss.str();
+}
+
+bool Check(std::mt19937_64& rng, size_t count) {
+    TimestampCache cache;
+
+    for (size_t i{}; i < count; ++i) {
+        // Случайный момент между 2000-01-01 и 2100-01-01.
+        int64_t ns{static_cast<int64_t>(946684800ULL * 1000000000ULL + rng() % (3155760000ULL * 1000000000ULL))};
+        cache.Set(ns);
+
+        std::time_t time{static_cast<std::time_t>(ns / 1000000000)};
+        std::tm local_time{};
+        localtime_r(&time, &local_time);
+
+        char expected[64];
+        size_t length{std::strftime(expected, sizeof(expected), "%Y-%m-%d %H:%M:%S", &local_time)};
+        long fraction{static_cast<long>(ns % 1000000000)};
+
+        char actual[TimestampCache::MAX_SIZE];
+        std::string reference[3]{
+            std::string(expected, length),
+            std::string(expected, length),
+            std::string(expected, length),
+        };
+
+        char suffix[16];
+        std::snprintf(suffix, sizeof(suffix), ".%03ld", fraction / 1000000);
+        reference[1] += suffix;
+        std::snprintf(suffix, sizeof(suffix), ".%06ld", fraction / 1000);
+        reference[2] += suffix;
+
+        TimePrecision precisions[3]{TimePrecision::K_SECONDS, TimePrecision::K_MILLISECONDS,
+                                    TimePrecision::K_MICROSECONDS};
+
+        for (size_t p{}; p < 3; ++p) {
+            size_t size{cache.Format(actual, precisions[p])};
+
+            if (std::string(actual, size) != reference[p]) {
+                std::printf("mismatch at %lld: '%s' vs '%s'\n", static_cast<long long>(ns),
+                            std::string(actual, size).c_str(), reference[p].c_str());
+
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+template <typename Stamp>
+double Bench(size_t threads, size_t calls, Stamp stamp) {
+    std::vector<std::thread> workers;
+    std::vector<uint64_t> checksums(threads);
+
+    auto start{Clock::now()};
+
+    for (size_t t{}; t < threads; ++t) {
+        workers.emplace_back([&stamp, &checksums, calls, t]() {
+            TimestampCache cache;
+            uint64_t checksum{};
+
+            for (size_t i{}; i < calls; ++i) {
+                checksum += stamp(cache, i);
+            }
+
+            checksums[t] = checksum;
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    double seconds{std::chrono::duration<double>(Clock::now() - start).count()};
+
+    // Контрольная сумма не дает компилятору выбросить вызовы.
+    volatile uint64_t sink{};
+
+    for (uint64_t checksum : checksums) {
+        sink = sink + checksum;
+    }
+
+    return seconds * 1e9 / static_cast<double>(calls);
+}
+
+} // namespace
+
+int main() {
+    std::mt19937_64 rng{20240801};
+
+    if (!Check(rng, 200000)) {
+        return 1;
+    }
+
+    std::printf("check: 200000 timestamps ok\n\n");
+    std::printf("%8s %14s %14s %14s %14s %14s\n", "threads", "put_time ns", "update ns", "cached s ns", "cached ms ns",
+                "cached us ns");
+
+    constexpr size_t CALLS{1000000};
+
+    unsigned cores{std::thread::hardware_concurrency()};
+    std::vector<size_t> thread_counts{1};
+
+    // Потоков не больше, чем ядер: иначе время на вызов растет из-за разделения процессора, а не из-за блокировок.
+    if (cores >= 4) {
+        thread_counts.push_back(4);
+    }
+
+    if (cores > 4) {
+        thread_counts.push_back(cores);
+    }
+
+    for (size_t threads : thread_counts) {
+        double old_way{Bench(threads, CALLS / 4, [](TimestampCache&, size_t) {
+            return static_cast<uint64_t>(GetCurrentTimestamp().size());
+        })};
+
+        double update{Bench(threads, CALLS, [](TimestampCache& cache, size_t) {
+            char out[TimestampCache::MAX_SIZE];
+            cache.Update();
+
+            return static_cast<uint64_t>(cache.Format(out, TimePrecision::K_SECONDS) + out[18]);
+        })};
+
+        double cached[3]{};
+        TimePrecision precisions[3]{TimePrecision::K_SECONDS, TimePrecision::K_MILLISECONDS,
+                                    TimePrecision::K_MICROSECONDS};
+
+        for (size_t p{}; p < 3; ++p) {
+            TimePrecision precision{precisions[p]};
+
+            cached[p] = Bench(threads, CALLS, [precision](TimestampCache& cache, size_t i) {
+                char out[TimestampCache::MAX_SIZE];
+
+                if (i % CALLS_PER_WAKEUP == 0) {
+                    cache.Update();
+                }
+
+                size_t size{cache.Format(out, precision)};
+
+                return static_cast<uint64_t>(size + out[size - 1]);
+            });
+        }
+
+        std::printf("%8zu %14.1f %14.1f %14.1f %14.1f %14.1f\n", threads, old_way, update, cached[0], cached[1],
+                    cached[2]);
+    }
+
+    return 0;
+}
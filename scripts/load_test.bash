@@ -0,0 +1,45 @@
+#!/bin/bash
+
+# Load test without PostgreSQL: mock_backend answers with canned results and load_generator
+# measures it directly and through the proxy. Each run appends two JSON lines (direct, proxy)
+# to REPORT. Any variable below can be overridden from the environment.
+
+MOCK_PORT="${MOCK_PORT:-6432}"
+PROXY_PORT="${PROXY_PORT:-6433}"
+
+ROWS="${ROWS:-1}"
+ROW_SIZE="${ROW_SIZE:-16}"
+DELAY_US="${DELAY_US:-0}"
+
+THREADS="${THREADS:-16}"
+DURATION="${DURATION:-10}"
+WARMUP="${WARMUP:-1}"
+QUERY="${QUERY:-SELECT 1}"
+
+PROXY_ARGS="${PROXY_ARGS:-}"
+PROXY_LOG="${PROXY_LOG:-load_test.log}"
+REPORT="${REPORT:-load_test_report.jsonl}"
+TAG="${TAG:-$(git rev-parse --short HEAD 2>/dev/null)}"
+
+./mock_backend $MOCK_PORT --rows $ROWS --row-size $ROW_SIZE --delay-us $DELAY_US &
+MOCK_PID=$!
+
+./server $PROXY_PORT 127.0.0.1 $MOCK_PORT $PROXY_LOG $PROXY_ARGS > /dev/null &
+PROXY_PID=$!
+
+trap 'kill $MOCK_PID $PROXY_PID 2> /dev/null; wait; rm -f $PROXY_LOG' EXIT
+
+sleep 1
+
+for TARGET in "direct $MOCK_PORT" "proxy $PROXY_PORT"; do
+    set -- $TARGET
+
+    ./load_generator 127.0.0.1 $2 \
+        --label $1 \
+        --tag "$TAG" \
+        --threads $THREADS \
+        --duration $DURATION \
+        --warmup $WARMUP \
+        --query "$QUERY" \
+        --report $REPORT || exit 1
+done
@@ -25,7 +25,7 @@ sysbench $TEST_FILE \
     --pgsql-db=$DB \
 	--pgsql-user=$USER \
 	--pgsql-password=$PASS \
-    --db-ps-mode=disable \
+    --db-ps-mode=auto \
     --time=$TIME_SEC \
     --threads=$NUM_THREADS \
     --tables=$NUM_TABLE \
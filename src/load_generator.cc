@@ -0,0 +1,458 @@
+#include <ctime>
+#include <chrono>
+#include <string>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <string_view>
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "server/latency/histogram.h"
+#include "server/protocol/frame_parser.h"
+#include "server/unique_fd/unique_fd.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t READ_SIZE{64 * 1024};
+constexpr uint32_t MAX_MESSAGE{1 << 30};
+constexpr double QUANTILES[]{0.5, 0.99, 0.999};
+
+/**
+ * @brief Параметры нагрузки.
+ */
+struct LoadOptions {
+    std::string host; ///< IPv4-адрес сервера (прокси или PostgreSQL).
+    int port{}; ///< Порт сервера.
+    size_t threads{8}; ///< Потоков, у каждого свое соединение.
+    size_t duration_s{10}; ///< Длительность измерения в секундах.
+    size_t warmup_s{1}; ///< Прогрев перед измерением в секундах.
+    std::string query{"SELECT 1"}; ///< Запрос (простой протокол).
+    std::string user{"postgres"}; ///< Пользователь.
+    std::string database; ///< База данных (пусто — как пользователь).
+    std::string label; ///< Название прогона в отчете (пусто — host:port).
+    std::string tag; ///< Произвольная метка отчета (например, коммит).
+    std::string report; ///< Файл отчета в формате JSON Lines (пусто — без отчета).
+};
+
+/**
+ * @brief Результаты одного потока за время измерения.
+ */
+struct ClientResult {
+    uint64_t queries{}; ///< Запросы, получившие ReadyForQuery без ошибки.
+    uint64_t errors{}; ///< ErrorResponse и разрывы соединения.
+    uint64_t bytes{}; ///< Байты ответов.
+    uint64_t max_us{}; ///< Наибольшая задержка.
+    LatencyHistogram latency; ///< Задержки запросов в микросекундах.
+};
+
+/**
+ * @brief Буфер чтения ответов сервера.
+ */
+struct Reader {
+    std::vector<char> data = std::vector<char>(READ_SIZE); ///< Буфер (растет под длинное сообщение).
+    size_t begin{}; ///< Начало неразобранных данных.
+    size_t end{}; ///< Конец прочитанных данных.
+};
+
+std::string GetUsage(const std::string& program) {
+    return "Usage: " + program + " [options] <host> <port>\n"
+           "Closed-loop load generator: every thread keeps one connection (trust auth only) and sends\n"
+           "the next simple Query as soon as the previous one completes.\n"
+           "Options:\n"
+           "  --threads N       client threads and connections (default: 8)\n"
+           "  --duration S      measure for S seconds (default: 10)\n"
+           "  --warmup S        run for S seconds before measuring (default: 1)\n"
+           "  --query TEXT      query to send (default: SELECT 1)\n"
+           "  --user NAME       user of the startup message (default: postgres)\n"
+           "  --database NAME   database of the startup message (default: the user)\n"
+           "  --label NAME      run name in the report (default: host:port)\n"
+           "  --tag TEXT        free-form tag in the report, such as a commit\n"
+           "  --report PATH     append the result to PATH as one JSON line\n";
+}
+
+size_t ParseCount(const std::string& name, const std::string& value) {
+    if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos) {
+        throw std::invalid_argument("Invalid value for " + name + ": " + value);
+    }
+
+    return std::stoull(value);
+}
+
+void AppendUInt32(std::string& out, uint32_t value) {
+    uint32_t net{htonl(value)};
+    out.append(reinterpret_cast<const char*>(&net), sizeof(net));
+}
+
+uint32_t ReadUInt32(const char* data) {
+    uint32_t value{};
+    std::memcpy(&value, data, sizeof(value));
+
+    return ntohl(value);
+}
+
+bool WriteFull(int fd, const std::string& data) {
+    size_t sent{};
+
+    while (sent < data.size()) {
+        ssize_t n{send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL)};
+
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+        } else if (n == -1 && errno != EINTR) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Читает следующее сообщение сервера.
+ * @param type Байт типа.
+ * @param body Тело сообщения (действительно до следующего вызова).
+ * @param bytes Счетчик прочитанных байт.
+ * @return true Если сообщение прочитано, false — при разрыве соединения.
+ */
+bool ReadMessage(int fd, Reader& reader, char& type, std::string_view& body, uint64_t& bytes) {
+    while (true) {
+        size_t available{reader.end - reader.begin};
+        size_t needed{5};
+
+        if (available >= needed) {
+            uint32_t length{ReadUInt32(reader.data.data() + reader.begin + 1)};
+
+            if (length < sizeof(uint32_t) || length > MAX_MESSAGE) {
+                return false;
+            }
+
+            needed = length + size_t{1};
+
+            if (available >= needed) {
+                type = reader.data[reader.begin];
+                body = std::string_view(reader.data.data() + reader.begin + 5, length - sizeof(uint32_t));
+                reader.begin += needed;
+
+                return true;
+            }
+        }
+
+        // Неразобранный хвост переносится в начало буфера; буфер растет только под длинное сообщение.
+        if (reader.begin > 0) {
+            std::memmove(reader.data.data(), reader.data.data() + reader.begin, available);
+            reader.begin = 0;
+            reader.end = available;
+        }
+
+        if (needed > reader.data.size()) {
+            reader.data.resize(needed);
+        }
+
+        ssize_t n{recv(fd, reader.data.data() + reader.end, reader.data.size() - reader.end, 0)};
+
+        if (n > 0) {
+            reader.end += static_cast<size_t>(n);
+            bytes += static_cast<uint64_t>(n);
+        } else if (n == 0 || errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+/**
+ * @brief Читает ответы до ReadyForQuery.
+ * @return int 1 — успех, 0 — сервер ответил ошибкой, -1 — соединение разорвано.
+ */
+int ReadUntilReady(int fd, Reader& reader, uint64_t& bytes) {
+    bool failed{false};
+    char type{};
+    std::string_view body;
+
+    while (ReadMessage(fd, reader, type, body, bytes)) {
+        if (type == 'E') {
+            failed = true;
+        } else if (type == 'R' && (body.size() < 4 || ReadUInt32(body.data()) != 0)) {
+            // Нагрузка рассчитана на trust: пароль не отправляется.
+            return -1;
+        } else if (type == 'Z') {
+            return failed ? 0 : 1;
+        }
+    }
+
+    return -1;
+}
+
+UniqueFD Connect(const LoadOptions& options, Reader& reader) {
+    UniqueFD fd(socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+
+    if (!fd.Valid()) {
+        return fd;
+    }
+
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(options.port));
+    inet_pton(AF_INET, options.host.c_str(), &address.sin_addr);
+
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1) {
+        return UniqueFD();
+    }
+
+    int opt{1};
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    std::string body;
+    AppendUInt32(body, FrameParser::PROTOCOL_VERSION_3);
+    body.append("user").push_back('\0');
+    body.append(options.user).push_back('\0');
+    body.append("database").push_back('\0');
+    body.append(options.database).push_back('\0');
+    body.push_back('\0');
+
+    std::string startup;
+    AppendUInt32(startup, static_cast<uint32_t>(body.size() + sizeof(uint32_t)));
+    startup += body;
+
+    uint64_t bytes{};
+    reader.begin = 0;
+    reader.end = 0;
+
+    if (!WriteFull(fd, startup) || ReadUntilReady(fd, reader, bytes) != 1) {
+        return UniqueFD();
+    }
+
+    return fd;
+}
+
+void RunClient(const LoadOptions& options, Clock::time_point start, Clock::time_point end, ClientResult& result) {
+    std::string query{"Q"};
+    AppendUInt32(query, static_cast<uint32_t>(options.query.size() + 1 + sizeof(uint32_t)));
+    query.append(options.query).push_back('\0');
+
+    Reader reader;
+    UniqueFD fd;
+
+    while (Clock::now() < end) {
+        if (!fd.Valid()) {
+            fd = Connect(options, reader);
+
+            if (!fd.Valid()) {
+                ++result.errors;
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+                continue;
+            }
+        }
+
+        auto sent{Clock::now()};
+        uint64_t bytes{};
+        int status{WriteFull(fd, query) ? ReadUntilReady(fd, reader, bytes) : -1};
+        auto done{Clock::now()};
+
+        // Запросы прогрева не учитываются.
+        if (sent < start) {
+            if (status == -1) {
+                fd.Close();
+            }
+
+            continue;
+        }
+
+        result.bytes += bytes;
+
+        if (status != 1) {
+            ++result.errors;
+
+            if (status == -1) {
+                fd.Close();
+            }
+
+            continue;
+        }
+
+        auto latency_us{static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(done - sent).count())};
+
+        ++result.queries;
+        result.max_us = std::max(result.max_us, latency_us);
+        result.latency.Record(latency_us);
+    }
+}
+
+std::string EscapeJson(std::string_view text) {
+    std::string escaped;
+
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        } else {
+            escaped += c;
+        }
+    }
+
+    return escaped;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    LoadOptions options;
+    std::vector<std::string> positional;
+
+    try {
+        for (int i{1}; i < argc; ++i) {
+            std::string name{argv[i]};
+
+            if (name.rfind("--", 0) != 0) {
+                positional.push_back(name);
+
+                continue;
+            }
+
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + name);
+            }
+
+            std::string value{argv[++i]};
+
+            if (name == "--threads") {
+                options.threads = ParseCount(name, value);
+            } else if (name == "--duration") {
+                options.duration_s = ParseCount(name, value);
+            } else if (name == "--warmup") {
+                options.warmup_s = ParseCount(name, value);
+            } else if (name == "--query") {
+                options.query = value;
+            } else if (name == "--user") {
+                options.user = value;
+            } else if (name == "--database") {
+                options.database = value;
+            } else if (name == "--label") {
+                options.label = value;
+            } else if (name == "--tag") {
+                options.tag = value;
+            } else if (name == "--report") {
+                options.report = value;
+            } else {
+                throw std::invalid_argument("Unknown option: " + name);
+            }
+        }
+
+        if (positional.size() != 2 || options.threads == 0 || options.duration_s == 0) {
+            std::cerr << GetUsage(argv[0]);
+
+            return 1;
+        }
+
+        options.host = positional[0];
+        options.port = static_cast<int>(ParseCount("port", positional[1]));
+
+        in_addr address{};
+
+        if (inet_pton(AF_INET, options.host.c_str(), &address) != 1 || options.port <= 0 || options.port > 65535) {
+            throw std::invalid_argument("Invalid address: " + options.host + ":" + positional[1]);
+        }
+
+        if (options.database.empty()) {
+            options.database = options.user;
+        }
+
+        if (options.label.empty()) {
+            options.label = options.host + ":" + std::to_string(options.port);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+
+        return 1;
+    }
+
+    auto start{Clock::now() + std::chrono::seconds(options.warmup_s)};
+    auto end{start + std::chrono::seconds(options.duration_s)};
+
+    std::vector<std::unique_ptr<ClientResult>> results;
+    std::vector<std::thread> threads;
+
+    for (size_t i{}; i < options.threads; ++i) {
+        results.push_back(std::make_unique<ClientResult>());
+        threads.emplace_back(RunClient, std::cref(options), start, end, std::ref(*results.back()));
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    uint64_t queries{};
+    uint64_t errors{};
+    uint64_t bytes{};
+    uint64_t max_us{};
+    uint64_t sum_us{};
+    LatencyHistogram::Snapshot snapshot;
+
+    for (const auto& result : results) {
+        queries += result->queries;
+        errors += result->errors;
+        bytes += result->bytes;
+        max_us = std::max(max_us, result->max_us);
+        sum_us += result->latency.GetSum();
+        result->latency.AddTo(snapshot);
+    }
+
+    double seconds{static_cast<double>(options.duration_s)};
+    double qps{static_cast<double>(queries) / seconds};
+    double mean_us{queries > 0 ? static_cast<double>(sum_us) / static_cast<double>(queries) : 0.0};
+    uint64_t p50{LatencyHistogram::GetQuantile(snapshot, QUANTILES[0])};
+    uint64_t p99{LatencyHistogram::GetQuantile(snapshot, QUANTILES[1])};
+    uint64_t p999{LatencyHistogram::GetQuantile(snapshot, QUANTILES[2])};
+
+    char line[256];
+    std::snprintf(line, sizeof(line), "%s: %.0f queries/s, %.1f MB/s, latency mean %.1f us, p50 %llu us, p99 %llu us, "
+                  "p999 %llu us, max %llu us, %llu errors\n", options.label.c_str(), qps,
+                  static_cast<double>(bytes) / seconds / 1e6, mean_us, static_cast<unsigned long long>(p50),
+                  static_cast<unsigned long long>(p99), static_cast<unsigned long long>(p999),
+                  static_cast<unsigned long long>(max_us), static_cast<unsigned long long>(errors));
+    std::cout << line;
+
+    if (options.report.empty()) {
+        return 0;
+    }
+
+    char numbers[512];
+    std::snprintf(numbers, sizeof(numbers), "\"threads\":%zu,\"duration_s\":%zu,\"queries\":%llu,\"errors\":%llu,"
+                  "\"qps\":%.1f,\"bytes_per_s\":%.0f,\"latency_us\":{\"mean\":%.1f,\"p50\":%llu,\"p99\":%llu,"
+                  "\"p999\":%llu,\"max\":%llu}", options.threads, options.duration_s,
+                  static_cast<unsigned long long>(queries), static_cast<unsigned long long>(errors), qps,
+                  static_cast<double>(bytes) / seconds, mean_us, static_cast<unsigned long long>(p50),
+                  static_cast<unsigned long long>(p99), static_cast<unsigned long long>(p999),
+                  static_cast<unsigned long long>(max_us));
+
+    std::ofstream report(options.report, std::ios::app);
+    report << "{\"time\":" << std::time(nullptr) << ",\"label\":\"" << EscapeJson(options.label) << "\",\"tag\":\""
+           << EscapeJson(options.tag) << "\",\"target\":\"" << options.host << ':' << options.port << "\",\"query\":\""
+           << EscapeJson(options.query) << "\"," << numbers << "}\n";
+
+    if (!report) {
+        std::cerr << options.report << ": " << strerror(errno) << '\n';
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,307 @@
+#include <ctime>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+
+#include <zlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+
+#include "server/logger/binary_log.h"
+#include "server/unique_fd/unique_fd.h"
+
+namespace {
+
+constexpr int64_t NS_PER_SECOND{1000000000};
+
+/**
+ * @brief Условия отбора записей.
+ */
+struct Filter {
+    int64_t from_ns{INT64_MIN}; ///< Начало интервала (включительно).
+    int64_t to_ns{INT64_MAX}; ///< Конец интервала (не включительно).
+    bool by_client{false}; ///< Отбирать записи одного клиента.
+    uint32_t address{}; ///< IPv4-адрес клиента в сетевом порядке байт.
+    uint16_t port{}; ///< Порт клиента (0 — любой).
+};
+
+/**
+ * @brief Метка времени, отформатированная для последней встреченной секунды.
+ */
+struct Timestamp {
+    int64_t second{-1}; ///< Секунда (от эпохи).
+    char text[32]{}; ///< Метка в формате YYYY-MM-DD HH:MM:SS.
+};
+
+std::string GetUsage(const std::string& program) {
+    return "Usage: " + program + " [options] <segment>...\n"
+           "Converts binary query log segments (--log-format binary, plain or .gz) to the text log format.\n"
+           "Options:\n"
+           "  --from TIME        skip records before TIME (\"YYYY-MM-DD HH:MM:SS\" local time or Unix seconds)\n"
+           "  --to TIME          skip records at or after TIME\n"
+           "  --client IP[:PORT] only records of this client (summaries are skipped)\n";
+}
+
+int64_t ParseTime(const std::string& value) {
+    if (!value.empty() && value.find_first_not_of("0123456789") == std::string::npos) {
+        return std::stoll(value) * NS_PER_SECOND;
+    }
+
+    std::tm local_time{};
+    const char* end{strptime(value.c_str(), "%Y-%m-%d %H:%M:%S", &local_time)};
+
+    if (!end || *end != '\0') {
+        throw std::invalid_argument("Invalid time: " + value);
+    }
+
+    local_time.tm_isdst = -1;
+
+    return static_cast<int64_t>(mktime(&local_time)) * NS_PER_SECOND;
+}
+
+void ParseClient(const std::string& value, Filter& filter) {
+    std::string ip{value};
+    size_t colon{value.find(':')};
+
+    if (colon != std::string::npos) {
+        ip = value.substr(0, colon);
+        filter.port = static_cast<uint16_t>(std::stoi(value.substr(colon + 1)));
+    }
+
+    if (inet_pton(AF_INET, ip.c_str(), &filter.address) != 1) {
+        throw std::invalid_argument("Invalid client: " + value);
+    }
+
+    filter.by_client = true;
+}
+
+bool Matches(const BinaryLog::RecordHeader& record, const Filter& filter) {
+    if (record.timestamp_ns < filter.from_ns || record.timestamp_ns >= filter.to_ns) {
+        return false;
+    }
+
+    if (!filter.by_client) {
+        return true;
+    }
+
+    return record.type != BinaryLog::TYPE_SUMMARY && record.address == filter.address &&
+           (filter.port == 0 || record.port == filter.port);
+}
+
+// Пишет запись в текстовом формате логгера.
+void PrintRecord(const BinaryLog::RecordHeader& record, std::string_view text, Timestamp& timestamp, std::string& out) {
+    if (record.type == BinaryLog::TYPE_SUMMARY) {
+        out += text;
+
+        if (!text.empty() && text.back() != '\n') {
+            out += '\n';
+        }
+
+        return;
+    }
+
+    int64_t second{record.timestamp_ns / NS_PER_SECOND};
+
+    if (second != timestamp.second) {
+        std::time_t time{static_cast<std::time_t>(second)};
+        std::tm local_time{};
+        localtime_r(&time, &local_time);
+        std::strftime(timestamp.text, sizeof(timestamp.text), "%Y-%m-%d %H:%M:%S", &local_time);
+
+        timestamp.second = second;
+    }
+
+    char ip[INET_ADDRSTRLEN]{};
+    inet_ntop(AF_INET, &record.address, ip, sizeof(ip));
+
+    char prefix[96];
+    int length{std::snprintf(prefix, sizeof(prefix), "[%s] [client: %s:%u] ", timestamp.text, ip, record.port)};
+
+    out.append(prefix, static_cast<size_t>(length));
+    out += text;
+
+    if (record.flags & BinaryLog::FLAG_TRUNCATED) {
+        out += " [truncated]";
+    }
+
+    out += '\n';
+}
+
+void PrintSegment(const std::string& path, const char* data, size_t size, const Filter& filter) {
+    if (size < sizeof(BinaryLog::SegmentHeader)) {
+        throw std::runtime_error(path + ": not a query log segment");
+    }
+
+    BinaryLog::SegmentHeader header{};
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, BinaryLog::MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != BinaryLog::VERSION || header.byte_order != BinaryLog::BYTE_ORDER_MARK) {
+        throw std::runtime_error(path + ": not a query log segment of this version and byte order");
+    }
+
+    Timestamp timestamp;
+    std::string out;
+    out.reserve(1 << 20);
+
+    size_t offset{sizeof(header)};
+
+    while (offset + sizeof(BinaryLog::RecordHeader) <= size) {
+        BinaryLog::RecordHeader record{};
+        std::memcpy(&record, data + offset, sizeof(record));
+
+        // Нулевой размер — предвыделенный хвост сегмента, не закрытого при аварийном завершении.
+        if (record.size == 0) {
+            break;
+        }
+
+        if (record.size < sizeof(record) + record.text_size || record.size > size - offset) {
+            std::cerr << path << ": corrupted record at offset " << offset << '\n';
+
+            break;
+        }
+
+        if (Matches(record, filter)) {
+            PrintRecord(record, std::string_view(data + offset + sizeof(record), record.text_size), timestamp, out);
+        }
+
+        if (out.size() >= (1 << 20)) {
+            std::fwrite(out.data(), 1, out.size(), stdout);
+            out.clear();
+        }
+
+        offset += record.size;
+    }
+
+    std::fwrite(out.data(), 1, out.size(), stdout);
+}
+
+// Сжатый сегмент (--log-compress) распаковывается в память целиком.
+void ReadCompressedSegment(const std::string& path, const Filter& filter) {
+    gzFile gz{gzopen(path.c_str(), "rb")};
+
+    if (!gz) {
+        throw std::runtime_error(path + ": " + strerror(errno));
+    }
+
+    std::string data;
+    char chunk[1 << 16];
+    int n{};
+
+    while ((n = gzread(gz, chunk, sizeof(chunk))) > 0) {
+        data.append(chunk, static_cast<size_t>(n));
+    }
+
+    int error{};
+    std::string message{n < 0 ? gzerror(gz, &error) : ""};
+    gzclose(gz);
+
+    if (n < 0) {
+        throw std::runtime_error(path + ": " + message);
+    }
+
+    PrintSegment(path, data.data(), data.size(), filter);
+}
+
+void ReadSegment(const std::string& path, const Filter& filter) {
+    if (path.size() > 3 && path.compare(path.size() - 3, 3, ".gz") == 0) {
+        ReadCompressedSegment(path, filter);
+
+        return;
+    }
+
+    UniqueFD fd(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+
+    if (!fd.Valid()) {
+        throw std::runtime_error(path + ": " + strerror(errno));
+    }
+
+    struct stat info{};
+
+    if (fstat(fd, &info) == -1) {
+        throw std::runtime_error(path + ": " + strerror(errno));
+    }
+
+    auto size{static_cast<size_t>(info.st_size)};
+
+    if (size < sizeof(BinaryLog::SegmentHeader)) {
+        throw std::runtime_error(path + ": not a query log segment");
+    }
+
+    void* mapped{mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)};
+
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error(path + ": " + strerror(errno));
+    }
+
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    try {
+        PrintSegment(path, static_cast<const char*>(mapped), size, filter);
+    } catch (...) {
+        munmap(mapped, size);
+
+        throw;
+    }
+
+    munmap(mapped, size);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Filter filter;
+    std::vector<std::string> segments;
+
+    try {
+        for (int i{1}; i < argc; ++i) {
+            std::string name{argv[i]};
+
+            if (name.rfind("--", 0) != 0) {
+                segments.push_back(name);
+
+                continue;
+            }
+
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + name);
+            }
+
+            std::string value{argv[++i]};
+
+            if (name == "--from") {
+                filter.from_ns = ParseTime(value);
+            } else if (name == "--to") {
+                filter.to_ns = ParseTime(value);
+            } else if (name == "--client") {
+                ParseClient(value, filter);
+            } else {
+                throw std::invalid_argument("Unknown option: " + name);
+            }
+        }
+
+        if (segments.empty()) {
+            std::cerr << GetUsage(argv[0]);
+
+            return 1;
+        }
+
+        for (const std::string& path : segments) {
+            ReadSegment(path, filter);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+
+        return 1;
+    }
+
+    return 0;
+}
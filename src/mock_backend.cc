@@ -0,0 +1,451 @@
+#include <string>
+#include <thread>
+#include <cctype>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "server/protocol/frame_parser.h"
+#include "server/unique_fd/unique_fd.h"
+
+namespace {
+
+// Сообщения, длиннее которых клиент не присылает: защита от мусора вместо длины.
+constexpr uint32_t MAX_MESSAGE{1 << 24};
+
+/**
+ * @brief Параметры сервера-заглушки.
+ */
+struct MockOptions {
+    int port{}; ///< Порт для прослушивания.
+    size_t rows{1}; ///< Строк в ответе на читающий запрос.
+    size_t row_size{16}; ///< Размер значения в строке в байтах.
+    size_t delay_us{}; ///< Задержка перед ответом на запрос в микросекундах.
+};
+
+std::string GetUsage(const std::string& program) {
+    return "Usage: " + program + " [options] <port>\n"
+           "Mock PostgreSQL server for load tests: accepts any user without a password (trust) and answers\n"
+           "every SELECT, VALUES, TABLE or WITH query with the same canned result set.\n"
+           "Options:\n"
+           "  --rows N        rows per result set (default: 1)\n"
+           "  --row-size N    bytes in the single text column of a row (default: 16)\n"
+           "  --delay-us US   wait this long before answering a query (default: 0)\n";
+}
+
+size_t ParseCount(const std::string& name, const std::string& value) {
+    if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos) {
+        throw std::invalid_argument("Invalid value for " + name + ": " + value);
+    }
+
+    return std::stoull(value);
+}
+
+void AppendUInt16(std::string& out, uint16_t value) {
+    uint16_t net{htons(value)};
+    out.append(reinterpret_cast<const char*>(&net), sizeof(net));
+}
+
+void AppendUInt32(std::string& out, uint32_t value) {
+    uint32_t net{htonl(value)};
+    out.append(reinterpret_cast<const char*>(&net), sizeof(net));
+}
+
+void AppendMessage(std::string& out, char type, std::string_view body) {
+    out.push_back(type);
+    AppendUInt32(out, static_cast<uint32_t>(body.size() + sizeof(uint32_t)));
+    out.append(body);
+}
+
+void AppendCommandComplete(std::string& out, const std::string& tag) {
+    AppendMessage(out, 'C', std::string_view(tag.c_str(), tag.size() + 1));
+}
+
+uint32_t ReadUInt32(const char* data) {
+    uint32_t value{};
+    std::memcpy(&value, data, sizeof(value));
+
+    return ntohl(value);
+}
+
+bool ReadFull(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n{recv(fd, data, size, 0)};
+
+        if (n > 0) {
+            data += n;
+            size -= static_cast<size_t>(n);
+        } else if (n == 0 || errno != EINTR) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool WriteFull(int fd, const std::string& data) {
+    size_t sent{};
+
+    while (sent < data.size()) {
+        ssize_t n{send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL)};
+
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+        } else if (n == -1 && errno != EINTR) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Ответы на запросы, собранные один раз при запуске.
+ */
+struct CannedResult {
+    std::string row_description; ///< RowDescription: одна текстовая колонка.
+    std::string rows; ///< DataRow и CommandComplete.
+};
+
+CannedResult MakeResult(const MockOptions& options) {
+    CannedResult result;
+    std::string body;
+
+    AppendUInt16(body, 1);
+    body.append("value").push_back('\0');
+    AppendUInt32(body, 0); // OID таблицы
+    AppendUInt16(body, 0); // Номер колонки
+    AppendUInt32(body, 25); // OID типа text
+    AppendUInt16(body, static_cast<uint16_t>(-1));
+    AppendUInt32(body, static_cast<uint32_t>(-1));
+    AppendUInt16(body, 0); // Текстовый формат
+    AppendMessage(result.row_description, 'T', body);
+
+    body.clear();
+    AppendUInt16(body, 1);
+    AppendUInt32(body, static_cast<uint32_t>(options.row_size));
+    body.append(options.row_size, 'x');
+
+    for (size_t i{}; i < options.rows; ++i) {
+        AppendMessage(result.rows, 'D', body);
+    }
+
+    AppendCommandComplete(result.rows, "SELECT " + std::to_string(options.rows));
+
+    return result;
+}
+
+std::string GetCommand(std::string_view query) {
+    size_t begin{query.find_first_not_of(" \t\r\n(")};
+
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+
+    size_t end{begin};
+
+    while (end < query.size() && std::isalpha(static_cast<unsigned char>(query[end]))) {
+        ++end;
+    }
+
+    std::string command{query.substr(begin, end - begin)};
+
+    for (char& c : command) {
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+
+    return command;
+}
+
+/**
+ * @brief Отвечает на запрос: набор строк для читающего, CommandComplete для остальных.
+ * @param out Ответы, накопленные до отправки.
+ * @param result Набор строк.
+ * @param query Текст запроса.
+ * @param describe Добавить RowDescription (простой протокол).
+ * @param status Статус транзакции, обновляется по BEGIN/COMMIT/ROLLBACK.
+ */
+void AppendResult(std::string& out, const CannedResult& result, std::string_view query, bool describe, char& status) {
+    std::string command{GetCommand(query)};
+
+    if (command == "SELECT" || command == "VALUES" || command == "TABLE" || command == "WITH") {
+        if (describe) {
+            out += result.row_description;
+        }
+
+        out += result.rows;
+
+        return;
+    }
+
+    if (command == "BEGIN" || command == "START") {
+        status = 'T';
+    } else if (command == "COMMIT" || command == "END" || command == "ROLLBACK" || command == "ABORT") {
+        status = 'I';
+    }
+
+    if (command.empty()) {
+        AppendMessage(out, 'I', {});
+    } else if (command == "INSERT") {
+        AppendCommandComplete(out, "INSERT 0 1");
+    } else if (command == "UPDATE" || command == "DELETE") {
+        AppendCommandComplete(out, command + " 1");
+    } else {
+        AppendCommandComplete(out, command);
+    }
+}
+
+/**
+ * @brief Этап запуска: отказ в SSL и GSSAPI, затем AuthenticationOk без пароля.
+ * @return true Если клиент прислал StartupMessage версии 3.
+ */
+bool Startup(int fd) {
+    while (true) {
+        char header[8];
+
+        if (!ReadFull(fd, header, sizeof(header))) {
+            return false;
+        }
+
+        uint32_t length{ReadUInt32(header)};
+        uint32_t code{ReadUInt32(header + 4)};
+
+        if (length < sizeof(header) || length > MAX_MESSAGE) {
+            return false;
+        }
+
+        std::string body(length - sizeof(header), '\0');
+
+        if (!ReadFull(fd, body.data(), body.size())) {
+            return false;
+        }
+
+        if (code == FrameParser::SSL_REQUEST_CODE || code == FrameParser::GSSENC_REQUEST_CODE) {
+            if (!WriteFull(fd, "N")) {
+                return false;
+            }
+
+            continue;
+        }
+
+        if (code != FrameParser::PROTOCOL_VERSION_3) {
+            return false;
+        }
+
+        std::string out;
+        std::string key;
+
+        AppendUInt32(key, static_cast<uint32_t>(getpid()));
+        AppendUInt32(key, static_cast<uint32_t>(fd));
+
+        AppendMessage(out, 'R', std::string(4, '\0'));
+        AppendMessage(out, 'S', std::string_view("server_version\0" "16.0\0", 20));
+        AppendMessage(out, 'S', std::string_view("client_encoding\0" "UTF8\0", 21));
+        AppendMessage(out, 'S', std::string_view("standard_conforming_strings\0" "on\0", 31));
+        AppendMessage(out, 'K', key);
+        AppendMessage(out, 'Z', "I");
+
+        return WriteFull(fd, out);
+    }
+}
+
+void ServeClient(UniqueFD fd, const MockOptions& options, const CannedResult& result) {
+    int opt{1};
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    if (!Startup(fd)) {
+        return;
+    }
+
+    char status{'I'};
+    std::string out;
+    std::string body;
+    std::string statement;
+
+    while (true) {
+        char header[5];
+
+        if (!ReadFull(fd, header, sizeof(header))) {
+            return;
+        }
+
+        uint32_t length{ReadUInt32(header + 1)};
+
+        if (length < sizeof(uint32_t) || length > MAX_MESSAGE) {
+            return;
+        }
+
+        body.resize(length - sizeof(uint32_t));
+
+        if (!ReadFull(fd, body.data(), body.size())) {
+            return;
+        }
+
+        bool flush{false};
+
+        switch (header[0]) {
+            case 'Q':
+                if (options.delay_us > 0) {
+                    usleep(static_cast<useconds_t>(options.delay_us));
+                }
+
+                AppendResult(out, result, std::string_view(body.c_str()), true, status);
+                AppendMessage(out, 'Z', std::string_view(&status, 1));
+                flush = true;
+
+                break;
+            case 'P': {
+                // Имя оператора, затем текст: Execute отвечает по последнему разобранному тексту.
+                size_t name_end{body.find('\0')};
+
+                statement = name_end == std::string::npos ? "" : body.c_str() + name_end + 1;
+                AppendMessage(out, '1', {});
+
+                break;
+            }
+            case 'B':
+                AppendMessage(out, '2', {});
+
+                break;
+            case 'D':
+                if (!body.empty() && body[0] == 'S') {
+                    AppendMessage(out, 't', std::string(2, '\0'));
+                }
+
+                if (GetCommand(statement) == "SELECT") {
+                    out += result.row_description;
+                } else {
+                    AppendMessage(out, 'n', {});
+                }
+
+                break;
+            case 'E':
+                if (options.delay_us > 0) {
+                    usleep(static_cast<useconds_t>(options.delay_us));
+                }
+
+                AppendResult(out, result, statement, false, status);
+
+                break;
+            case 'C':
+                AppendMessage(out, '3', {});
+
+                break;
+            case 'S':
+                AppendMessage(out, 'Z', std::string_view(&status, 1));
+                flush = true;
+
+                break;
+            case 'H':
+                flush = true;
+
+                break;
+            case 'X':
+                return;
+            default:
+                break;
+        }
+
+        if (flush) {
+            if (!WriteFull(fd, out)) {
+                return;
+            }
+
+            out.clear();
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    MockOptions options;
+
+    try {
+        for (int i{1}; i < argc; ++i) {
+            std::string name{argv[i]};
+
+            if (name.rfind("--", 0) != 0) {
+                options.port = static_cast<int>(ParseCount("port", name));
+
+                continue;
+            }
+
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + name);
+            }
+
+            std::string value{argv[++i]};
+
+            if (name == "--rows") {
+                options.rows = ParseCount(name, value);
+            } else if (name == "--row-size") {
+                options.row_size = ParseCount(name, value);
+            } else if (name == "--delay-us") {
+                options.delay_us = ParseCount(name, value);
+            } else {
+                throw std::invalid_argument("Unknown option: " + name);
+            }
+        }
+
+        if (options.port <= 0 || options.port > 65535) {
+            std::cerr << GetUsage(argv[0]);
+
+            return 1;
+        }
+
+        UniqueFD listener(socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+
+        if (!listener.Valid()) {
+            throw std::runtime_error("socket(): " + std::string(strerror(errno)));
+        }
+
+        int opt{1};
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+        struct sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(static_cast<uint16_t>(options.port));
+
+        if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1 ||
+            listen(listener, SOMAXCONN) == -1) {
+            throw std::runtime_error("bind(): " + std::string(strerror(errno)));
+        }
+
+        CannedResult result{MakeResult(options)};
+
+        std::cout << "Mock PostgreSQL on 127.0.0.1:" << options.port << ": " << options.rows << " rows of "
+                  << options.row_size << " bytes, delay " << options.delay_us << " us\n";
+
+        // Клиент на каждое соединение — свой поток: задержка одного ответа не держит остальные.
+        while (true) {
+            UniqueFD client(accept4(listener, nullptr, nullptr, SOCK_CLOEXEC));
+
+            if (!client.Valid()) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+
+                throw std::runtime_error("accept(): " + std::string(strerror(errno)));
+            }
+
+            std::thread(ServeClient, std::move(client), std::cref(options), std::cref(result)).detach();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+
+        return 1;
+    }
+
+    return 0;
+}
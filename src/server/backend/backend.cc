@@ -0,0 +1,298 @@
+#include <cstring>
+#include <iostream>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "backend.h"
+
+namespace {
+
+// SSLRequest: длина 8 и код 80877103 (FrameParser::SSL_REQUEST_CODE).
+constexpr char SSL_REQUEST[]{0, 0, 0, 8, 0x04, static_cast<char>(0xd2), 0x16, 0x2f};
+
+void AppendUInt32(std::string& out, uint32_t value) {
+    uint32_t net{htonl(value)};
+    out.append(reinterpret_cast<const char*>(&net), sizeof(net));
+}
+
+uint32_t ReadUInt32(std::string_view data) {
+    uint32_t value{};
+    std::memcpy(&value, data.data(), sizeof(value));
+
+    return ntohl(value);
+}
+
+} // namespace
+
+Backend::Backend(UniqueFD&& fd) :
+    _fd(std::move(fd))
+{}
+
+int Backend::GetFD() const noexcept {
+    return _fd;
+}
+
+bool Backend::IsConnecting() const noexcept {
+    return _state == State::K_CONNECTING || _state == State::K_TLS;
+}
+
+bool Backend::IsNegotiating() const noexcept {
+    return _state == State::K_TLS;
+}
+
+void Backend::EnableTls(const TlsContext* context) noexcept {
+    _tls_context = context;
+}
+
+TlsStream* Backend::GetTls() const noexcept {
+    return _tls.get();
+}
+
+bool Backend::IsReady() const noexcept {
+    return _state == State::K_READY;
+}
+
+uint32_t Backend::GetEvents() const noexcept {
+    return _events;
+}
+
+void Backend::SetEvents(uint32_t events) noexcept {
+    _events = events;
+}
+
+const std::string& Backend::GetKey() const noexcept {
+    return _key;
+}
+
+size_t Backend::GetNode() const noexcept {
+    return _node;
+}
+
+void Backend::SetNode(size_t node) noexcept {
+    _node = node;
+}
+
+std::string_view Backend::GetParameters() const noexcept {
+    return _parameters;
+}
+
+Backend::Clock::time_point Backend::GetSince() const noexcept {
+    return _since;
+}
+
+void Backend::SetSince(Clock::time_point since) noexcept {
+    _since = since;
+}
+
+void Backend::Restore(const std::string& key, std::string_view parameters) {
+    _key = key;
+    _parameters = std::string(parameters);
+    _startup_done = true;
+    _state = State::K_READY;
+}
+
+UniqueFD Backend::ReleaseFD() noexcept {
+    return std::move(_fd);
+}
+
+void Backend::SetStartup(const std::string& key, std::string_view user, std::string_view database) {
+    _key = key;
+
+    std::string body;
+    AppendUInt32(body, FrameParser::PROTOCOL_VERSION_3);
+    body.append("user").push_back('\0');
+    body.append(user).push_back('\0');
+    body.append("database").push_back('\0');
+    body.append(database).push_back('\0');
+    body.push_back('\0');
+
+    _startup.clear();
+    AppendUInt32(_startup, static_cast<uint32_t>(body.size() + 4));
+    _startup += body;
+}
+
+bool Backend::FinishConnect() {
+    int error{};
+    socklen_t error_len{sizeof(error)};
+
+    if (getsockopt(_fd, SOL_SOCKET, SO_ERROR, &error, &error_len) == -1) {
+        error = errno;
+    }
+
+    if (error != 0) {
+        std::cerr << "connect() error to PostgreSQL: " << strerror(error) << '\n';
+
+        return false;
+    }
+
+    if (_tls_context) {
+        _state = State::K_TLS;
+    } else {
+        _state = _startup.empty() ? State::K_READY : State::K_STARTUP;
+    }
+
+    return true;
+}
+
+ssize_t Backend::Receive(char* data, size_t size) {
+    return _tls ? _tls->Read(data, size) : recv(_fd, data, size, 0);
+}
+
+ssize_t Backend::Send(const char* data, size_t size) {
+    return _tls ? _tls->Write(data, size) : send(_fd, data, size, MSG_NOSIGNAL);
+}
+
+int Backend::ContinueTls() {
+    while (_tls_request_sent < sizeof(SSL_REQUEST)) {
+        ssize_t n{send(_fd, SSL_REQUEST + _tls_request_sent, sizeof(SSL_REQUEST) - _tls_request_sent, MSG_NOSIGNAL)};
+
+        if (n > 0) {
+            _tls_request_sent += n;
+        } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else {
+            std::cerr << "send() error to PostgreSQL: " << strerror(errno) << '\n';
+
+            return -1;
+        }
+    }
+
+    // Ответ на SSLRequest — один байт: 'S' — сервер начинает рукопожатие, 'N' — шифрование не поддерживается.
+    while (!_tls) {
+        char answer{};
+        ssize_t n{recv(_fd, &answer, 1, 0)};
+
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n == -1) {
+            std::cerr << "recv() error from PostgreSQL: " << strerror(errno) << '\n';
+
+            return -1;
+        } else if (n == 0 || answer != 'S') {
+            std::cerr << "PostgreSQL TLS negotiation failed: " <<
+                         (n == 0 ? "connection closed" : "server does not accept SSL connections") << '\n';
+
+            return -1;
+        }
+
+        try {
+            _tls = _tls_context->ConnectBackend(_fd);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+
+            return -1;
+        }
+    }
+
+    int result{_tls->Handshake()};
+
+    if (result != 1) {
+        return result;
+    }
+
+    _state = _startup.empty() ? State::K_READY : State::K_STARTUP;
+
+    return 1;
+}
+
+void Backend::OnStartupMessage(const FrontendMessage& message) {
+    switch (message.type) {
+        case 'R':
+            if (message.body.size() < 4 || ReadUInt32(message.body) != 0) {
+                _error = "authentication required (pooling mode supports trust authentication only)";
+            }
+            break;
+        case 'S':
+            _parameters.push_back('S');
+            AppendUInt32(_parameters, message.length);
+            _parameters.append(message.body);
+            break;
+        case 'E': {
+            // Поле 'M' ErrorResponse содержит основной текст ошибки.
+            std::string_view fields{message.body};
+            _error = "error response";
+
+            while (!fields.empty() && fields[0] != '\0') {
+                size_t end{fields.find('\0')};
+
+                if (end == std::string_view::npos) {
+                    break;
+                }
+
+                if (fields[0] == 'M') {
+                    _error = std::string(fields.substr(1, end - 1));
+                }
+
+                fields.remove_prefix(end + 1);
+            }
+            break;
+        }
+        case 'Z':
+            _startup_done = true;
+            break;
+        default:
+            break;
+    }
+}
+
+int Backend::ContinueStartup() {
+    if (_state == State::K_TLS) {
+        int result{ContinueTls()};
+
+        if (result != 1) {
+            return result;
+        }
+    }
+
+    while (_startup_sent < _startup.size()) {
+        ssize_t n{Send(_startup.data() + _startup_sent, _startup.size() - _startup_sent)};
+
+        if (n > 0) {
+            _startup_sent += n;
+        } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else {
+            std::cerr << "send() error to PostgreSQL: " << strerror(errno) << '\n';
+
+            return -1;
+        }
+    }
+
+    FrameParser::Callback on_message{[this](const FrontendMessage& message) {
+        OnStartupMessage(message);
+    }};
+
+    char data[4096];
+
+    while (!_startup_done && _error.empty()) {
+        ssize_t n{Receive(data, sizeof(data))};
+
+        if (n > 0) {
+            _parser.Feed(std::string_view(data, n), on_message);
+        } else if (n == 0) {
+            _error = "connection closed during startup";
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        } else if (errno != EINTR) {
+            _error = strerror(errno);
+        }
+    }
+
+    if (!_error.empty()) {
+        std::cerr << "PostgreSQL startup failed: " << _error << '\n';
+
+        return -1;
+    }
+
+    _state = State::K_READY;
+    _startup.clear();
+
+    return 1;
+}
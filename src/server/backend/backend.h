@@ -0,0 +1,216 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_BACKEND_BACKEND_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_BACKEND_BACKEND_H
+
+#include <chrono>
+#include <string>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include <sys/epoll.h>
+
+#include "../tls/tls_context.h"
+#include "../unique_fd/unique_fd.h"
+#include "../protocol/frame_parser.h"
+
+/**
+ * @brief Соединение с PostgreSQL.
+ *
+ * Владеет сокетом PostgreSQL и отслеживает неблокирующее подключение. Без пула соединение
+ * принадлежит одной сессии на все время ее жизни и этап запуска проходит сам клиент.
+ * В режиме пула соединение открывает прокси: после подключения Backend сам отправляет
+ * StartupMessage (user, database), принимает AuthenticationOk, ParameterStatus и ReadyForQuery
+ * и запоминает ParameterStatus для воспроизведения клиентам, которым соединение будет выдано.
+ *
+ * С шифрованием (EnableTls()) после подключения Backend отправляет SSLRequest и проходит рукопожатие TLS
+ * до этапа запуска; до его завершения соединение считается подключающимся (IsConnecting()).
+ */
+class Backend {
+public:
+    /// Монотонные часы для отсчета таймаутов пула.
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Состояние соединения.
+     */
+    enum class State {
+        K_CONNECTING, ///< Неблокирующий connect() еще не завершен
+        K_TLS, ///< Согласование TLS: SSLRequest и рукопожатие
+        K_STARTUP, ///< Этап запуска, который выполняет прокси (режим пула)
+        K_READY ///< Соединение готово к передаче запросов
+    };
+
+public:
+    /**
+     * @brief Конструктор соединения.
+     * @param fd Сокет PostgreSQL (неблокирующий, connect() уже вызван).
+     */
+    explicit Backend(UniqueFD&& fd);
+
+    /**
+     * @brief Получить дескриптор сокета PostgreSQL.
+     */
+    int GetFD() const noexcept;
+
+    /**
+     * @brief Проверяет, ожидает ли соединение завершения connect() или согласования TLS.
+     */
+    bool IsConnecting() const noexcept;
+
+    /**
+     * @brief Проверяет, идет ли согласование TLS (connect() уже завершен).
+     */
+    bool IsNegotiating() const noexcept;
+
+    /**
+     * @brief Включает шифрование соединения: после connect() будет отправлен SSLRequest.
+     * @param context Контексты TLS (должны жить дольше соединения).
+     */
+    void EnableTls(const TlsContext* context) noexcept;
+
+    /**
+     * @brief TLS-соединение с PostgreSQL.
+     * @return TlsStream* Соединение или nullptr, если соединение не шифруется или рукопожатие не начато.
+     */
+    TlsStream* GetTls() const noexcept;
+
+    /**
+     * @brief Проверяет, готово ли соединение к передаче запросов.
+     */
+    bool IsReady() const noexcept;
+
+    /**
+     * @brief Текущая маска событий сокета в Poller.
+     */
+    uint32_t GetEvents() const noexcept;
+
+    /**
+     * @brief Запоминает маску событий, установленную в Poller.
+     * @param events Маска событий.
+     */
+    void SetEvents(uint32_t events) noexcept;
+
+    /**
+     * @brief Включает этап запуска на стороне прокси (режим пула).
+     * @param key Ключ пула.
+     * @param user Имя пользователя.
+     * @param database Имя базы данных.
+     */
+    void SetStartup(const std::string& key, std::string_view user, std::string_view database);
+
+    /**
+     * @brief Восстанавливает готовое соединение пула, полученное от предыдущего процесса при обновлении.
+     * @param key Ключ пула.
+     * @param parameters Сообщения ParameterStatus этапа запуска.
+     */
+    void Restore(const std::string& key, std::string_view parameters);
+
+    /**
+     * @brief Забирает сокет у соединения (для передачи другому процессу).
+     * @return UniqueFD Сокет PostgreSQL; соединение после вызова недействительно.
+     */
+    UniqueFD ReleaseFD() noexcept;
+
+    /**
+     * @brief Ключ пула, к которому относится соединение (пусто без пула).
+     */
+    const std::string& GetKey() const noexcept;
+
+    /**
+     * @brief Номер сервера PostgreSQL (UpstreamRegistry), к которому открыто соединение.
+     */
+    size_t GetNode() const noexcept;
+
+    /**
+     * @brief Запоминает номер сервера PostgreSQL.
+     * @param node Номер сервера.
+     */
+    void SetNode(size_t node) noexcept;
+
+    /**
+     * @brief Сообщения ParameterStatus, полученные на этапе запуска, в исходном виде.
+     */
+    std::string_view GetParameters() const noexcept;
+
+    /**
+     * @brief Время последнего изменения состояния в пуле.
+     */
+    Clock::time_point GetSince() const noexcept;
+
+    /**
+     * @brief Запоминает время помещения в пул.
+     * @param since Время.
+     */
+    void SetSince(Clock::time_point since) noexcept;
+
+    /**
+     * @brief Завершает неблокирующее подключение.
+     *
+     * Проверяет SO_ERROR. С шифрованием переходит в K_TLS, иначе, если включен этап запуска, —
+     * в K_STARTUP, иначе — в K_READY.
+     *
+     * @return true Если подключение установлено.
+     * @return false Если подключиться не удалось.
+     */
+    bool FinishConnect();
+
+    /**
+     * @brief Продолжает согласование TLS: отправляет SSLRequest, принимает ответ и проходит рукопожатие.
+     *
+     * По завершении переходит в K_STARTUP или K_READY, как FinishConnect() без шифрования.
+     *
+     * @return int 1 — шифрование установлено, 0 — ожидается сокет, -1 — ошибка.
+     */
+    int ContinueTls();
+
+    /**
+     * @brief Продолжает этап запуска: отправляет StartupMessage и разбирает ответ сервера.
+     *
+     * Если согласование TLS не завершено, сначала продолжает его.
+     *
+     * @return int 1 — соединение готово, 0 — ожидаются данные, -1 — ошибка.
+     */
+    int ContinueStartup();
+
+private:
+    /**
+     * @brief Читает из сокета (через TLS, если рукопожатие пройдено).
+     * @return ssize_t Результат в соглашениях recv().
+     */
+    ssize_t Receive(char* data, size_t size);
+
+    /**
+     * @brief Пишет в сокет (через TLS, если рукопожатие пройдено).
+     * @return ssize_t Результат в соглашениях send().
+     */
+    ssize_t Send(const char* data, size_t size);
+
+    /**
+     * @brief Обрабатывает сообщение сервера на этапе запуска.
+     * @param message Сообщение.
+     */
+    void OnStartupMessage(const FrontendMessage& message);
+
+private:
+    UniqueFD _fd; ///< Сокет PostgreSQL.
+    std::unique_ptr<TlsStream> _tls; ///< TLS поверх сокета (закрывается раньше него).
+    const TlsContext* _tls_context{nullptr}; ///< Контексты TLS (nullptr — без шифрования).
+    size_t _tls_request_sent{}; ///< Отправлено байт SSLRequest.
+    State _state{State::K_CONNECTING}; ///< Состояние соединения.
+    uint32_t _events{EPOLLIN | EPOLLOUT | EPOLLET}; ///< Текущая маска событий.
+    size_t _node{}; ///< Номер сервера PostgreSQL.
+
+    std::string _key; ///< Ключ пула.
+    std::string _startup; ///< StartupMessage для отправки.
+    size_t _startup_sent{}; ///< Отправлено байт StartupMessage.
+    std::string _parameters; ///< Сообщения ParameterStatus.
+    std::string _error; ///< Ошибка этапа запуска.
+    bool _startup_done{false}; ///< Получен ReadyForQuery.
+
+    FrameParser _parser{8192, FrameParser::State::K_MESSAGES}; ///< Разборщик ответов сервера на этапе запуска.
+
+    Clock::time_point _since{Clock::now()}; ///< Время открытия или помещения в пул.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_BACKEND_BACKEND_H
@@ -0,0 +1,186 @@
+#include <atomic>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#include "buffer.h"
+
+namespace {
+
+constexpr size_t MAX_POOLED_SEGMENTS{256};
+constexpr size_t MIN_WRITE_SPACE{1024};
+
+thread_local std::vector<std::unique_ptr<char[]>> segment_pool;
+
+std::atomic<long long> allocated_bytes{};
+thread_local long long pending_bytes{};
+
+// Общий счетчик обновляется пачками, чтобы потоки не делили одну кеш-линию на каждом сегменте.
+void Account(long long delta) noexcept {
+    pending_bytes += delta;
+
+    if (pending_bytes >= static_cast<long long>(Buffer::ACCOUNTING_BATCH) ||
+        pending_bytes <= -static_cast<long long>(Buffer::ACCOUNTING_BATCH)) {
+        allocated_bytes.fetch_add(pending_bytes, std::memory_order_relaxed);
+        pending_bytes = 0;
+    }
+}
+
+} // namespace
+
+Buffer::~Buffer() {
+    Clear();
+}
+
+std::unique_ptr<char[]> Buffer::AcquireSegment() {
+    Account(SEGMENT_SIZE);
+
+    if (segment_pool.empty()) {
+        return std::unique_ptr<char[]>(new char[SEGMENT_SIZE]);
+    }
+
+    auto data{std::move(segment_pool.back())};
+    segment_pool.pop_back();
+
+    return data;
+}
+
+void Buffer::ReleaseSegment(std::unique_ptr<char[]> data) {
+    Account(-static_cast<long long>(SEGMENT_SIZE));
+
+    if (segment_pool.size() < MAX_POOLED_SEGMENTS) {
+        segment_pool.push_back(std::move(data));
+    }
+}
+
+bool Buffer::Empty() const noexcept {
+    return _size == 0;
+}
+
+size_t Buffer::Size() const noexcept {
+    return _size;
+}
+
+void Buffer::Append(const char* data, size_t size) {
+    while (size > 0) {
+        auto [dst, space]{PrepareWrite()};
+        size_t n{std::min(space, size)};
+
+        std::memcpy(dst, data, n);
+        CommitWrite(n);
+
+        data += n;
+        size -= n;
+    }
+}
+
+std::pair<char*, size_t> Buffer::PrepareWrite() {
+    if (_segments.empty() || SEGMENT_SIZE - _segments.back().end < MIN_WRITE_SPACE) {
+        _segments.push_back(Segment{AcquireSegment(), 0, 0});
+    }
+
+    auto& tail{_segments.back()};
+
+    return {tail.data.get() + tail.end, SEGMENT_SIZE - tail.end};
+}
+
+void Buffer::CommitWrite(size_t n) noexcept {
+    _segments.back().end += n;
+    _size += n;
+}
+
+void Buffer::ReleaseUnused() {
+    if (!_segments.empty() && _segments.back().begin == _segments.back().end) {
+        ReleaseSegment(std::move(_segments.back().data));
+        _segments.pop_back();
+    }
+}
+
+void Buffer::AdoptSegment(std::unique_ptr<char[]>& data, size_t size) {
+    auto spare{AcquireSegment()};
+    spare.swap(data);
+
+    // Пустой хвост, оставшийся после PrepareWrite(), оказался бы посреди очереди.
+    ReleaseUnused();
+
+    _segments.push_back(Segment{std::move(spare), 0, size});
+    _size += size;
+}
+
+size_t Buffer::FillIovecs(iovec* iov, size_t max) const noexcept {
+    size_t count{};
+
+    for (auto it{_segments.begin()}; it != _segments.end() && count < max; ++it) {
+        if (it->begin == it->end) {
+            continue;
+        }
+
+        iov[count].iov_base = it->data.get() + it->begin;
+        iov[count].iov_len = it->end - it->begin;
+        ++count;
+    }
+
+    return count;
+}
+
+void Buffer::Consume(size_t n) {
+    n = std::min(n, _size);
+    _size -= n;
+
+    while (n > 0) {
+        auto& head{_segments.front()};
+        size_t available{head.end - head.begin};
+
+        if (n < available) {
+            head.begin += n;
+
+            return;
+        }
+
+        n -= available;
+
+        ReleaseSegment(std::move(head.data));
+        _segments.pop_front();
+    }
+
+    if (_size == 0 && !_segments.empty() && _segments.front().begin == _segments.front().end) {
+        _segments.front().begin = 0;
+        _segments.front().end = 0;
+    }
+}
+
+void Buffer::DropBack(size_t n) {
+    n = std::min(n, _size);
+    _size -= n;
+
+    while (n > 0) {
+        auto& tail{_segments.back()};
+        size_t available{tail.end - tail.begin};
+
+        if (n < available) {
+            tail.end -= n;
+
+            return;
+        }
+
+        n -= available;
+
+        ReleaseSegment(std::move(tail.data));
+        _segments.pop_back();
+    }
+}
+
+void Buffer::Clear() {
+    for (auto& segment : _segments) {
+        ReleaseSegment(std::move(segment.data));
+    }
+
+    _segments.clear();
+    _size = 0;
+}
+
+size_t Buffer::GetAllocatedBytes() noexcept {
+    long long bytes{allocated_bytes.load(std::memory_order_relaxed)};
+
+    return bytes > 0 ? static_cast<size_t>(bytes) : 0;
+}
@@ -0,0 +1,164 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_BUFFER_BUFFER_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_BUFFER_BUFFER_H
+
+#include <deque>
+#include <memory>
+#include <utility>
+#include <cstddef>
+
+#include <sys/uio.h>
+
+/**
+ * @brief Очередь байт из цепочки сегментов фиксированного размера.
+ *
+ * Добавление в конец и удаление из начала выполняются за O(1) без сдвига данных.
+ * Освободившиеся сегменты возвращаются в пул текущего потока и переиспользуются.
+ * Память сегментов, занятых буферами всех потоков, учитывается глобально (GetAllocatedBytes()).
+ * Данные можно читать напрямую в хвостовой сегмент (PrepareWrite/CommitWrite)
+ * и отправлять через iovec без копирования (FillIovecs/Consume).
+ */
+class Buffer {
+public:
+    static constexpr size_t SEGMENT_SIZE{16384}; ///< Размер одного сегмента в байтах.
+    static constexpr size_t ACCOUNTING_BATCH{16 * SEGMENT_SIZE}; ///< Порог сброса изменений в общий счетчик памяти.
+
+public:
+    /**
+     * @brief Конструктор пустого буфера.
+     */
+    Buffer() = default;
+
+    /**
+     * @brief Удаленный конструктор копирования.
+     */
+    Buffer(const Buffer&) = delete;
+
+    /**
+     * @brief Конструктор перемещения.
+     */
+    Buffer(Buffer&&) noexcept = default;
+
+    /**
+     * @brief Деструктор. Возвращает сегменты в пул потока.
+     */
+    ~Buffer();
+
+    /**
+     * @brief Удаленный оператор копирования-присвоения.
+     */
+    Buffer& operator=(const Buffer&) = delete;
+
+    /**
+     * @brief Оператор перемещения-присвоения.
+     */
+    Buffer& operator=(Buffer&&) noexcept = default;
+
+public:
+    /**
+     * @brief Проверяет, пуст ли буфер.
+     */
+    bool Empty() const noexcept;
+
+    /**
+     * @brief Возвращает количество байт в буфере.
+     */
+    size_t Size() const noexcept;
+
+    /**
+     * @brief Копирует данные в конец буфера.
+     * @param data Указатель на данные.
+     * @param size Размер данных.
+     */
+    void Append(const char* data, size_t size);
+
+    /**
+     * @brief Возвращает свободное место в хвостовом сегменте для чтения в него.
+     *
+     * При необходимости добавляет новый сегмент. После записи нужно вызвать CommitWrite().
+     *
+     * @return std::pair<char*, size_t> Указатель на свободное место и его размер.
+     */
+    std::pair<char*, size_t> PrepareWrite();
+
+    /**
+     * @brief Фиксирует n байт, записанных в область, полученную из PrepareWrite().
+     * @param n Количество записанных байт.
+     */
+    void CommitWrite(size_t n) noexcept;
+
+    /**
+     * @brief Возвращает в пул пустой хвостовой сегмент, оставшийся после PrepareWrite().
+     */
+    void ReleaseUnused();
+
+    /**
+     * @brief Добавляет в конец буфера чужой блок с данными, отдавая взамен свободный сегмент из пула.
+     *
+     * Данные, прочитанные в блок размера сегмента, встают в очередь без копирования.
+     *
+     * @param data Блок SEGMENT_SIZE байт (new char[]) с данными в начале; получает свободный сегмент.
+     * @param size Количество байт данных.
+     */
+    void AdoptSegment(std::unique_ptr<char[]>& data, size_t size);
+
+    /**
+     * @brief Заполняет массив iovec сегментами с данными.
+     * @param iov Массив iovec.
+     * @param max Размер массива.
+     * @return size_t Количество заполненных элементов.
+     */
+    size_t FillIovecs(iovec* iov, size_t max) const noexcept;
+
+    /**
+     * @brief Удаляет n байт из начала буфера.
+     * @param n Количество байт.
+     */
+    void Consume(size_t n);
+
+    /**
+     * @brief Удаляет n байт из конца буфера.
+     * @param n Количество байт.
+     */
+    void DropBack(size_t n);
+
+    /**
+     * @brief Удаляет все данные из буфера.
+     */
+    void Clear();
+
+    /**
+     * @brief Память сегментов, занятых буферами всех потоков.
+     *
+     * Потоки сообщают изменения пачками, поэтому значение может отставать от точного
+     * на ACCOUNTING_BATCH байт на поток.
+     *
+     * @return size_t Количество байт.
+     */
+    static size_t GetAllocatedBytes() noexcept;
+
+private:
+    /**
+     * @brief Сегмент буфера.
+     */
+    struct Segment {
+        std::unique_ptr<char[]> data; ///< Память сегмента (SEGMENT_SIZE байт).
+        size_t begin{}; ///< Смещение первого непрочитанного байта.
+        size_t end{}; ///< Смещение за последним записанным байтом.
+    };
+
+    /**
+     * @brief Берет сегмент из пула потока или выделяет новый.
+     */
+    static std::unique_ptr<char[]> AcquireSegment();
+
+    /**
+     * @brief Возвращает сегмент в пул потока.
+     */
+    static void ReleaseSegment(std::unique_ptr<char[]> data);
+
+private:
+    std::deque<Segment> _segments; ///< Цепочка сегментов.
+    size_t _size{}; ///< Количество байт в буфере.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_BUFFER_BUFFER_H
@@ -0,0 +1,841 @@
+#include <iterator>
+#include <algorithm>
+
+#include "query_classifier.h"
+#include "table_versions.h"
+
+namespace {
+
+// Больше таблиц в запросе не отслеживается: такое чтение не кэшируется, а изменение инвалидирует все.
+constexpr size_t MAX_TABLES{32};
+
+// Глубина скобок, до которой отслеживаются списки FROM.
+constexpr size_t MAX_DEPTH{64};
+
+// Списки упорядочены: поиск в них — std::binary_search().
+
+// Команды, которые только читают данные (WITH — если в нем нет изменяющих подзапросов).
+constexpr std::string_view READ_COMMANDS[]{"select", "table", "values", "with"};
+
+// Команды, изменяющие названные в них таблицы.
+constexpr std::string_view WRITE_COMMANDS[]{"copy", "delete", "insert", "merge", "update"};
+
+// Команды, не изменяющие данных таблиц.
+constexpr std::string_view NEUTRAL_COMMANDS[]{
+    "abort", "analyse", "analyze", "begin", "checkpoint", "close", "commit", "deallocate", "declare", "end", "fetch",
+    "listen", "lock", "move", "notify", "prepare", "release", "rollback", "savepoint", "show", "start", "unlisten",
+    "vacuum",
+};
+
+// Команды, меняющие состояние сеанса.
+constexpr std::string_view SESSION_COMMANDS[]{"discard", "load", "reset", "set"};
+
+// Слова, за которыми идет имя таблицы.
+constexpr std::string_view RELATION_KEYWORDS[]{"copy", "from", "into", "join", "table", "update", "using"};
+
+// Слова, которые в позиции таблицы пропускаются.
+constexpr std::string_view RELATION_PREFIXES[]{"lateral", "only"};
+
+// Слова, завершающие список FROM.
+constexpr std::string_view FROM_LIST_END[]{
+    "except", "fetch", "for", "group", "having", "intersect", "limit", "offset", "order", "returning", "set", "union",
+    "where", "window",
+};
+
+// Значения, зависящие от времени или сеанса: с ними результат SELECT не кэшируется.
+constexpr std::string_view VOLATILE_WORDS[]{
+    "current_catalog", "current_date", "current_role", "current_schema", "current_time", "current_timestamp",
+    "current_user", "localtime", "localtimestamp", "session_user", "user",
+};
+
+// Блокировки и изменения (FOR UPDATE/SHARE, SELECT INTO): такой SELECT выполняется только на основном сервере.
+constexpr std::string_view LOCKING_WORDS[]{"delete", "insert", "into", "merge", "share", "update"};
+
+// Слова, с которыми WITH изменяет данные.
+constexpr std::string_view DATA_MODIFYING_WORDS[]{"delete", "insert", "merge", "update"};
+
+// Начала слов, с которыми чтение разбирается полностью даже без кэша: WITH может изменять данные,
+// а временная таблица (SELECT INTO TEMP) меняет состояние сеанса.
+constexpr std::string_view READ_PARSE_PREFIXES[]{"delete", "insert", "merge", "temp", "update"};
+
+// Ключевые слова, за которыми может идти скобка: это не вызов функции.
+constexpr std::string_view PAREN_KEYWORDS[]{
+    "all", "and", "any", "array", "as", "between", "bit", "by", "case", "cast", "char", "character", "cube",
+    "decimal", "distinct", "else", "except", "exists", "extract", "filter", "float", "from", "group", "grouping",
+    "in", "intersect", "interval", "is", "join", "lateral", "like", "limit", "not", "numeric", "offset", "on", "or",
+    "over", "overlay", "rollup", "row", "select", "sets", "some", "then", "time", "timestamp", "union", "using",
+    "values", "varchar", "varying", "when", "where", "with", "within",
+};
+
+// Встроенные функции, результат которых зависит только от аргументов и данных таблиц.
+constexpr std::string_view SAFE_FUNCTIONS[]{
+    "abs", "array_agg", "array_length", "avg", "bit_and", "bit_or", "bool_and", "bool_or", "btrim", "cardinality",
+    "ceil", "ceiling", "char_length", "coalesce", "concat", "concat_ws", "count", "cume_dist", "date_part",
+    "date_trunc", "dense_rank", "every", "exp", "first_value", "floor", "format", "generate_series", "greatest",
+    "initcap", "json_agg", "json_build_object", "json_object_agg", "jsonb_agg", "jsonb_build_object",
+    "jsonb_object_agg", "lag", "last_value", "lead", "least", "left", "length", "ln", "log", "lower", "lpad", "ltrim",
+    "max", "md5", "min", "mod", "nth_value", "ntile", "nullif", "octet_length", "percent_rank", "position", "power",
+    "rank", "repeat", "replace", "reverse", "right", "round", "row_number", "row_to_json", "rpad", "rtrim", "sign",
+    "split_part", "sqrt", "stddev", "string_agg", "strpos", "substr", "substring", "sum", "to_char", "to_date",
+    "to_json", "to_jsonb", "to_number", "to_timestamp", "trim", "trunc", "unnest", "upper", "variance",
+};
+
+// Функции без побочных эффектов, результат которых зависит от времени или сервера: запрос с ними
+// не кэшируется, но может выполняться на реплике.
+constexpr std::string_view STABLE_FUNCTIONS[]{
+    "clock_timestamp", "current_setting", "gen_random_uuid", "now", "random", "statement_timestamp", "timeofday",
+    "transaction_timestamp", "version",
+};
+
+bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool IsWordStart(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || static_cast<unsigned char>(c) >= 0x80;
+}
+
+bool IsWordChar(char c) {
+    return IsWordStart(c) || IsDigit(c) || c == '$';
+}
+
+char ToLower(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+template <size_t N>
+bool Contains(const std::string_view (&list)[N], std::string_view word) {
+    return std::binary_search(std::begin(list), std::end(list), word);
+}
+
+// Возвращает позицию за комментарием или pos, если комментария нет. Блочные комментарии вкладываются.
+size_t SkipComment(std::string_view query, size_t pos) noexcept {
+    if (pos + 1 >= query.size()) {
+        return pos;
+    }
+
+    if (query[pos] == '-' && query[pos + 1] == '-') {
+        size_t end{query.find('\n', pos)};
+
+        return end == std::string_view::npos ? query.size() : end;
+    }
+
+    if (query[pos] != '/' || query[pos + 1] != '*') {
+        return pos;
+    }
+
+    size_t depth{1};
+    size_t i{pos + 2};
+
+    while (i + 1 < query.size()) {
+        if (query[i] == '/' && query[i + 1] == '*') {
+            ++depth;
+            i += 2;
+        } else if (query[i] == '*' && query[i + 1] == '/') {
+            i += 2;
+
+            if (--depth == 0) {
+                return i;
+            }
+        } else {
+            ++i;
+        }
+    }
+
+    return query.size();
+}
+
+// Позиция первой значимой лексемы начиная с pos.
+size_t SkipBlank(std::string_view query, size_t pos) noexcept {
+    while (pos < query.size()) {
+        if (IsSpace(query[pos])) {
+            ++pos;
+
+            continue;
+        }
+
+        size_t end{SkipComment(query, pos)};
+
+        if (end == pos) {
+            break;
+        }
+
+        pos = end;
+    }
+
+    return pos;
+}
+
+// Слово без кавычек с позиции pos в нижнем регистре (пусто, если там не слово или оно длиннее буфера).
+template <size_t N>
+std::string_view ReadWord(std::string_view query, size_t& pos, char (&buffer)[N]) noexcept {
+    if (pos >= query.size() || !IsWordStart(query[pos])) {
+        return {};
+    }
+
+    size_t length{};
+
+    while (pos < query.size() && IsWordChar(query[pos])) {
+        if (length == N) {
+            return {};
+        }
+
+        buffer[length++] = ToLower(query[pos++]);
+    }
+
+    return std::string_view(buffer, length);
+}
+
+// Имя таблицы с позиции pos: слово или идентификатор в кавычках, схема отбрасывается.
+// Пусто, если имя не удалось прочитать так же, как его прочитал бы полный разбор.
+template <size_t N>
+std::string_view ReadTableName(std::string_view query, size_t pos, char (&buffer)[N]) noexcept {
+    while (true) {
+        std::string_view name;
+        pos = SkipBlank(query, pos);
+
+        if (pos < query.size() && query[pos] == '"') {
+            size_t close{query.find('"', pos + 1)};
+
+            // Удвоенная кавычка внутри имени: его разбирает полный путь.
+            if (close == std::string_view::npos || (close + 1 < query.size() && query[close + 1] == '"')) {
+                return {};
+            }
+
+            name = query.substr(pos + 1, close - pos - 1);
+            pos = close + 1;
+        } else {
+            name = ReadWord(query, pos, buffer);
+
+            if (name.empty()) {
+                return {};
+            }
+        }
+
+        pos = SkipBlank(query, pos);
+
+        if (pos >= query.size() || query[pos] != '.') {
+            return name;
+        }
+
+        ++pos;
+    }
+}
+
+// Вызов set_config() меняет состояние сеанса в любой команде.
+bool HasSetConfig(std::string_view query) noexcept {
+    constexpr std::string_view NAME{"set_config"};
+
+    for (size_t pos{query.find('_')}; pos != std::string_view::npos; pos = query.find('_', pos + 1)) {
+        if (pos < 3 || pos - 3 + NAME.size() > query.size()) {
+            continue;
+        }
+
+        size_t i{};
+
+        while (i < NAME.size() && ToLower(query[pos - 3 + i]) == NAME[i]) {
+            ++i;
+        }
+
+        if (i == NAME.size()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Есть ли в запросе слово, начинающееся с одного из prefixes, без учета регистра. Литералы и комментарии
+// не пропускаются: совпадение в них только отправляет запрос на полный разбор.
+template <size_t N>
+bool HasWordPrefix(std::string_view query, const std::string_view (&prefixes)[N]) noexcept {
+    bool boundary{true};
+
+    for (size_t pos{}; pos < query.size(); ++pos) {
+        bool word{IsWordChar(query[pos])};
+
+        if (word && boundary) {
+            for (std::string_view prefix : prefixes) {
+                size_t i{};
+
+                while (i < prefix.size() && pos + i < query.size() && ToLower(query[pos + i]) == prefix[i]) {
+                    ++i;
+                }
+
+                if (i == prefix.size()) {
+                    return true;
+                }
+            }
+        }
+
+        boundary = !word;
+    }
+
+    return false;
+}
+
+/**
+ * Короткий путь для одной команды, которая не может быть ни кэширована, ни выполнена на реплике:
+ * управление транзакцией и другие нейтральные команды, SET/RESET и INSERT/UPDATE/DELETE/MERGE/COPY
+ * с таблицей сразу за ключевым словом. Результат для них не требует нормализованного текста и
+ * разбора всего запроса: изменению нужна только целевая таблица (остальные таблицы оно лишь читает).
+ * С reads так же разбирается и чтение, которое не пойдет ни в кэш, ни на реплику: оно ничего
+ * не инвалидирует (K_NONE), если в нем нет слов из READ_PARSE_PREFIXES.
+ * Возвращает false, если запрос нужно разобрать полностью: чтения (без reads), DDL, несколько команд
+ * (';' — в том числе внутри литерала) и все, что не удалось прочитать.
+ */
+bool ClassifyCommand(std::string_view query, bool reads, QueryClass& result) {
+    size_t separator{query.find(';')};
+
+    if (separator != std::string_view::npos && SkipBlank(query, separator + 1) != query.size()) {
+        return false;
+    }
+
+    char buffer[64];
+    size_t pos{SkipBlank(query, 0)};
+    std::string_view command{ReadWord(query, pos, buffer)};
+
+    if (command.empty() || HasSetConfig(query)) {
+        return false;
+    }
+
+    if (Contains(READ_COMMANDS, command)) {
+        return reads && !HasWordPrefix(query, READ_PARSE_PREFIXES);
+    }
+
+    if (Contains(NEUTRAL_COMMANDS, command)) {
+        return true;
+    }
+
+    if (Contains(SESSION_COMMANDS, command)) {
+        result.session_state = true;
+
+        return true;
+    }
+
+    if (!Contains(WRITE_COMMANDS, command)) {
+        return false;
+    }
+
+    // INSERT INTO, DELETE FROM, MERGE INTO; UPDATE и COPY — сразу таблица. ONLY пропускается.
+    std::string_view expected{command == "insert" || command == "merge" ? "into" : command == "delete" ? "from" : ""};
+    pos = SkipBlank(query, pos);
+
+    if (!expected.empty() && ReadWord(query, pos, buffer) != expected) {
+        return false;
+    }
+
+    size_t name_pos{SkipBlank(query, pos)};
+
+    if (size_t after{name_pos}; ReadWord(query, after, buffer) == "only") {
+        name_pos = after;
+    }
+
+    std::string_view table{ReadTableName(query, name_pos, buffer)};
+
+    if (table.empty()) {
+        return false;
+    }
+
+    result.access = QueryAccess::K_WRITE;
+    result.tables.push_back(TableVersions::GetSlot(table));
+
+    return true;
+}
+
+// Однопроходный разбор запроса: нормализованный текст пишется по ходу, слова классифицируются сразу.
+class Classifier {
+public:
+    Classifier(std::string_view query, QueryClass& result) noexcept :
+        _query(query),
+        _result(result)
+    {}
+
+    void Run() {
+        size_t pos{};
+
+        while (pos < _query.size()) {
+            char c{_query[pos]};
+
+            if (IsSpace(c)) {
+                _space = true;
+                ++pos;
+            } else if (size_t end{SkipComment(_query, pos)}; end != pos) {
+                _space = true;
+                pos = end;
+            } else if (c == '\'') {
+                BeginToken();
+                pos = CopyQuoted(pos, false);
+                _relation = false;
+            } else if (c == '"') {
+                BeginToken();
+                pos = CopyIdentifier(pos);
+            } else if (size_t tag{c == '$' ? GetDollarTag(pos) : 0}; tag > 0) {
+                BeginToken();
+                pos = CopyDollarQuoted(pos, tag);
+                _relation = false;
+            } else if (IsWordStart(c)) {
+                BeginToken();
+                pos = CopyWord(pos);
+            } else if (IsDigit(c)) {
+                BeginToken();
+
+                while (pos < _query.size() && (IsWordChar(_query[pos]) || _query[pos] == '.')) {
+                    _result.normalized.push_back(ToLower(_query[pos++]));
+                }
+
+                _relation = false;
+            } else {
+                BeginToken();
+                _result.normalized.push_back(c);
+                ++pos;
+
+                OnPunctuation(c);
+            }
+        }
+
+        EndStatement();
+        Finish();
+    }
+
+private:
+    enum class Command : uint8_t {
+        K_NONE, // Команда еще не началась
+        K_READ,
+        K_WITH,
+        K_WRITE,
+        K_EXPLAIN,
+        K_NEUTRAL,
+        K_SESSION,
+        K_OTHER
+    };
+
+    void BeginToken() {
+        if (_space && !_result.normalized.empty()) {
+            _result.normalized.push_back(' ');
+        }
+
+        _space = false;
+    }
+
+    // Следующий значимый символ после pos ('\0' в конце запроса).
+    char PeekToken(size_t pos) const noexcept {
+        while (pos < _query.size()) {
+            if (IsSpace(_query[pos])) {
+                ++pos;
+
+                continue;
+            }
+
+            size_t end{SkipComment(_query, pos)};
+
+            if (end == pos) {
+                return _query[pos];
+            }
+
+            pos = end;
+        }
+
+        return '\0';
+    }
+
+    // Копирует строковый литерал или идентификатор в кавычках как есть.
+    size_t CopyQuoted(size_t pos, bool escapes) {
+        char quote{_query[pos]};
+        size_t end{pos + 1};
+
+        while (end < _query.size()) {
+            char c{_query[end]};
+
+            if (c == '\\' && quote == '\'') {
+                if (escapes) {
+                    end += 2;
+
+                    continue;
+                }
+
+                // Без префикса E смысл обратной косой черты задает standard_conforming_strings сервера.
+                _backslash = true;
+            }
+
+            if (c == quote) {
+                if (end + 1 < _query.size() && _query[end + 1] == quote) {
+                    end += 2;
+
+                    continue;
+                }
+
+                ++end;
+                _result.normalized.append(_query.data() + pos, end - pos);
+
+                return end;
+            }
+
+            ++end;
+        }
+
+        _unterminated = true;
+        _result.normalized.append(_query.data() + pos, _query.size() - pos);
+
+        return _query.size();
+    }
+
+    size_t CopyIdentifier(size_t pos) {
+        size_t end{CopyQuoted(pos, false)};
+        std::string_view name{_query.substr(pos + 1, end - pos >= 2 ? end - pos - 2 : 0)};
+
+        OnWord(name, true, PeekToken(end));
+
+        return end;
+    }
+
+    // Длина открывающего тега $tag$ или $$ с позиции pos (0 — не тег).
+    size_t GetDollarTag(size_t pos) const noexcept {
+        size_t end{pos + 1};
+
+        if (end < _query.size() && IsDigit(_query[end])) {
+            return 0;
+        }
+
+        while (end < _query.size() && _query[end] != '$') {
+            if (!IsWordStart(_query[end]) && !IsDigit(_query[end])) {
+                return 0;
+            }
+
+            ++end;
+        }
+
+        return end < _query.size() ? end - pos + 1 : 0;
+    }
+
+    size_t CopyDollarQuoted(size_t pos, size_t tag) {
+        size_t close{_query.find(_query.substr(pos, tag), pos + tag)};
+        size_t end{close == std::string_view::npos ? _query.size() : close + tag};
+
+        if (close == std::string_view::npos) {
+            _unterminated = true;
+        }
+
+        _result.normalized.append(_query.data() + pos, end - pos);
+
+        return end;
+    }
+
+    size_t CopyWord(size_t pos) {
+        size_t start{_result.normalized.size()};
+        size_t end{pos};
+
+        while (end < _query.size() && IsWordChar(_query[end])) {
+            _result.normalized.push_back(ToLower(_query[end++]));
+        }
+
+        std::string_view word{std::string_view(_result.normalized).substr(start)};
+
+        // Префикс литерала: E'...' (с escape-последовательностями), B'...', X'...', N'...'.
+        if (end < _query.size() && _query[end] == '\'' && word.size() == 1 &&
+            (word[0] == 'e' || word[0] == 'b' || word[0] == 'x' || word[0] == 'n')) {
+            _relation = false;
+
+            return CopyQuoted(end, word[0] == 'e');
+        }
+
+        OnWord(word, false, PeekToken(end));
+
+        return end;
+    }
+
+    void StartCommand(std::string_view word, bool quoted) {
+        if (quoted) {
+            _command = Command::K_OTHER;
+        } else if (Contains(READ_COMMANDS, word)) {
+            _command = word == "with" ? Command::K_WITH : Command::K_READ;
+        } else if (Contains(WRITE_COMMANDS, word)) {
+            _command = Command::K_WRITE;
+        } else if (word == "explain") {
+            _command = Command::K_EXPLAIN;
+        } else if (Contains(NEUTRAL_COMMANDS, word)) {
+            _command = Command::K_NEUTRAL;
+        } else if (Contains(SESSION_COMMANDS, word)) {
+            _command = Command::K_SESSION;
+            _result.session_state = true;
+        } else {
+            _command = Command::K_OTHER;
+        }
+    }
+
+    void OnWord(std::string_view word, bool quoted, char next) {
+        if (_command == Command::K_NONE) {
+            StartCommand(word, quoted);
+        }
+
+        // Схема или псевдоним перед точкой: имя таблицы (или столбца) идет за ней.
+        if (next == '.') {
+            return;
+        }
+
+        bool call{next == '('};
+
+        if (quoted) {
+            if (call) {
+                _read_unsafe = true;
+                _replica_unsafe = true;
+            }
+
+            if (_relation) {
+                _relation = false;
+                AddTable(word);
+            }
+
+            return;
+        }
+
+        // Системные каталоги и функции: состояние сервера, а не данные таблиц.
+        if (word.substr(0, 3) == "pg_") {
+            _read_unsafe = true;
+        }
+
+        if (_relation) {
+            if (Contains(RELATION_PREFIXES, word)) {
+                return;
+            }
+
+            // Функция в FROM тоже попадает в таблицы: после INTO так выглядит список столбцов.
+            _relation = false;
+            AddTable(word);
+
+            if (call && !Contains(SAFE_FUNCTIONS, word)) {
+                OnUnsafeCall(word);
+            }
+
+            return;
+        }
+
+        if (call && !Contains(PAREN_KEYWORDS, word) && !Contains(SAFE_FUNCTIONS, word)) {
+            OnUnsafeCall(word);
+        }
+
+        if (Contains(VOLATILE_WORDS, word)) {
+            _read_unsafe = true;
+        } else if (Contains(LOCKING_WORDS, word)) {
+            _read_unsafe = true;
+            _replica_unsafe = true;
+        }
+
+        if (Contains(DATA_MODIFYING_WORDS, word)) {
+            _modifying = true;
+        }
+
+        if (word == "temp" || word == "temporary" || word == "set_config") {
+            _result.session_state = true;
+        } else if (word == "analyze" || word == "analyse") {
+            _analyze = true;
+        }
+
+        if (Contains(RELATION_KEYWORDS, word)) {
+            _relation = true;
+
+            if ((word == "from" || word == "using") && _depth < MAX_DEPTH) {
+                _from_lists |= uint64_t{1} << _depth;
+            }
+        } else if (Contains(FROM_LIST_END, word) && _depth < MAX_DEPTH) {
+            _from_lists &= ~(uint64_t{1} << _depth);
+        }
+    }
+
+    // Функция вне белого списка: результат не кэшируется, а неизвестная функция может изменять данные.
+    void OnUnsafeCall(std::string_view name) {
+        _read_unsafe = true;
+
+        if (!Contains(STABLE_FUNCTIONS, name)) {
+            _replica_unsafe = true;
+        }
+    }
+
+    void OnPunctuation(char c) {
+        switch (c) {
+            case '(':
+                ++_depth;
+                _relation = false;
+
+                if (_depth < MAX_DEPTH) {
+                    _from_lists &= ~(uint64_t{1} << _depth);
+                }
+
+                break;
+            case ')':
+                if (_depth < MAX_DEPTH) {
+                    _from_lists &= ~(uint64_t{1} << _depth);
+                }
+
+                _depth = _depth > 0 ? _depth - 1 : 0;
+                _relation = false;
+                break;
+            case ',':
+                _relation = _depth < MAX_DEPTH && (_from_lists & (uint64_t{1} << _depth)) != 0;
+                break;
+            case ';':
+                EndStatement();
+                break;
+            case '.':
+                break;
+            default:
+                _relation = false;
+                break;
+        }
+    }
+
+    void AddTable(std::string_view name) {
+        uint16_t slot{TableVersions::GetSlot(name)};
+        auto& tables{_result.tables};
+
+        if (std::find(tables.begin(), tables.end(), slot) != tables.end()) {
+            return;
+        }
+
+        if (tables.size() == MAX_TABLES) {
+            _overflow = true;
+
+            return;
+        }
+
+        tables.push_back(slot);
+    }
+
+    void EndStatement() {
+        Command command{_command};
+        bool read_unsafe{_read_unsafe};
+        bool replica_unsafe{_replica_unsafe};
+
+        _command = Command::K_NONE;
+        _relation = false;
+        _from_lists = 0;
+        _depth = 0;
+        _read_unsafe = false;
+        _replica_unsafe = false;
+
+        bool modifying{_modifying};
+        bool analyze{_analyze};
+
+        _modifying = false;
+        _analyze = false;
+
+        switch (command) {
+            case Command::K_NONE:
+                return;
+            case Command::K_READ:
+                ++_reads;
+                _uncacheable = _uncacheable || read_unsafe;
+                _primary_only = _primary_only || replica_unsafe;
+                break;
+            case Command::K_WITH:
+                if (modifying) {
+                    ++_writes;
+                } else {
+                    ++_reads;
+                    _uncacheable = _uncacheable || read_unsafe;
+                    _primary_only = _primary_only || replica_unsafe;
+                }
+
+                break;
+            case Command::K_WRITE:
+                ++_writes;
+                break;
+            case Command::K_EXPLAIN:
+                // EXPLAIN ANALYZE выполняет запрос.
+                _write_all = _write_all || analyze;
+                break;
+            case Command::K_OTHER:
+                _write_all = true;
+                break;
+            default:
+                break;
+        }
+
+        ++_statements;
+    }
+
+    void Finish() {
+        // Изменение, таблицы которого не найдены или видны не все, затрагивает все таблицы.
+        bool unknown{_overflow || _unterminated || _result.tables.empty()};
+
+        if (_write_all || (_writes > 0 && unknown)) {
+            _result.access = QueryAccess::K_WRITE_ALL;
+        } else if (_writes > 0) {
+            _result.access = QueryAccess::K_WRITE;
+        } else if (_statements == 1 && _reads == 1 && !_uncacheable && !_overflow && !_backslash && !_unterminated) {
+            _result.access = QueryAccess::K_READ;
+        } else {
+            _result.access = QueryAccess::K_NONE;
+        }
+
+        // Границы литералов с обратной косой чертой зависят от настроек сервера: за ними может скрываться изменение.
+        _result.read_only = _statements > 0 && _reads == _statements && !_primary_only && !_backslash &&
+                            !_unterminated;
+    }
+
+private:
+    std::string_view _query;
+    QueryClass& _result;
+
+    bool _space{false}; // Перед следующей лексемой был пробел или комментарий.
+
+    // Состояние текущей команды.
+    Command _command{Command::K_NONE};
+    bool _relation{false}; // Следующее имя — таблица.
+    uint64_t _from_lists{}; // Уровни скобок, на которых идет список FROM (запятая предваряет таблицу).
+    size_t _depth{};
+    bool _read_unsafe{false};
+    bool _replica_unsafe{false};
+    bool _modifying{false};
+    bool _analyze{false};
+
+    // Итоги по всем командам запроса.
+    size_t _statements{};
+    size_t _reads{};
+    size_t _writes{};
+    bool _write_all{false};
+    bool _uncacheable{false};
+    bool _primary_only{false};
+    bool _overflow{false};
+    bool _backslash{false};
+    bool _unterminated{false};
+};
+
+} // namespace
+
+void ClassifyQuery(std::string_view query, QueryClass& result) {
+    result.access = QueryAccess::K_NONE;
+    result.session_state = false;
+    result.read_only = false;
+    result.tables.clear();
+    result.normalized.clear();
+
+    if (!ClassifyCommand(query, false, result)) {
+        Classifier(query, result).Run();
+    }
+}
+
+void ClassifyWrite(std::string_view query, QueryClass& result) {
+    result.access = QueryAccess::K_NONE;
+    result.session_state = false;
+    result.read_only = false;
+    result.tables.clear();
+    result.normalized.clear();
+
+    if (ClassifyCommand(query, true, result)) {
+        return;
+    }
+
+    Classifier(query, result).Run();
+
+    // Полный разбор понадобился ради изменений и состояния сеанса: пригодность чтения не нужна.
+    if (result.access == QueryAccess::K_READ) {
+        result.access = QueryAccess::K_NONE;
+    }
+
+    result.read_only = false;
+}
@@ -0,0 +1,74 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_CACHE_QUERY_CLASSIFIER_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_CACHE_QUERY_CLASSIFIER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @brief Доступ запроса к данным с точки зрения кэша результатов.
+ */
+enum class QueryAccess : uint8_t {
+    K_NONE, ///< Не кэшируется и ничего не инвалидирует (управление транзакцией, SHOW, SELECT с изменчивыми функциями)
+    K_READ, ///< Одиночный SELECT без изменчивых функций: результат можно кэшировать
+    K_WRITE, ///< Изменяет таблицы из tables
+    K_WRITE_ALL ///< DDL, неизвестная команда или запрос, таблицы которого не определить: инвалидируется все
+};
+
+/**
+ * @brief Результат разбора запроса для кэша результатов.
+ */
+struct QueryClass {
+    QueryAccess access{QueryAccess::K_NONE}; ///< Доступ к данным.
+    bool session_state{false}; ///< Меняет состояние сеанса (SET, RESET, временные таблицы).
+    bool read_only{false}; ///< Только читает данные и не берет блокировок: запрос можно выполнить на реплике.
+    std::vector<uint16_t> tables; ///< Слоты таблиц запроса (TableVersions::GetSlot()) без повторов.
+    std::string normalized; ///< Нормализованный текст — ключ кэша для K_READ.
+};
+
+/**
+ * @brief Определяет, читает или изменяет запрос данные, и какие таблицы он затрагивает.
+ *
+ * Разбор лексический, без грамматики SQL. Таблицами считаются имена после FROM, JOIN, INTO, UPDATE,
+ * USING, COPY и TABLE и после запятых списка FROM (схема отбрасывается), поэтому в список могут попасть
+ * и лишние имена — это приводит только к лишней инвалидации. Таблицы, которые запрос читает через
+ * представления и функции, не видны.
+ *
+ * Кэшировать можно один SELECT (VALUES, TABLE, WITH без изменяющих подзапросов), в котором вызываются
+ * только встроенные функции из белого списка и нет FOR UPDATE/SHARE, INTO, значений времени и
+ * пользователя сеанса и таблиц pg_*. Строковые литералы с обратной косой чертой без префикса E запрещают
+ * кэширование (их границы зависят от standard_conforming_strings), а изменения разбираются по значению
+ * сервера по умолчанию. Изменение с незакрытым литералом или без найденных таблиц инвалидирует все.
+ *
+ * Для реплики (read_only) правила мягче: допускаются несколько читающих команд, значения времени и
+ * сеанса, таблицы pg_* и функции без побочных эффектов вроде now() и random(), но не FOR UPDATE/SHARE,
+ * INTO, вызовы неизвестных функций (nextval(), pg_advisory_lock()) и литералы с обратной косой чертой.
+ *
+ * Одна команда, которую нельзя ни кэшировать, ни выполнить на реплике (BEGIN, COMMIT, SET, INSERT, UPDATE,
+ * DELETE, MERGE, COPY), разбирается по первому слову без нормализации: для изменения в tables попадает
+ * только целевая таблица, прочитанные им таблицы не инвалидируются.
+ *
+ * Нормализованный текст отличается от исходного только там, где это не меняет смысла: комментарии и
+ * пробельные символы сворачиваются в один пробел, а слова вне кавычек приводятся к нижнему регистру.
+ * Литералы и идентификаторы в кавычках сохраняются как есть.
+ *
+ * @param query Текст запроса (одна или несколько команд через ';').
+ * @param result Результат (перезаписывается; память переиспользуется между вызовами).
+ */
+void ClassifyQuery(std::string_view query, QueryClass& result);
+
+/**
+ * @brief Определяет только то, что запрос меняет: изменяемые таблицы и состояние сеанса.
+ *
+ * Для запроса, который не может ни получить ответ из кэша, ни уйти на реплику (Execute, Query внутри
+ * транзакции или за другими запросами). Результат тот же, что у ClassifyQuery(), но access никогда
+ * не бывает K_READ, read_only всегда false, а normalized не заполняется. Одиночное чтение без слов,
+ * с которых начинаются INSERT, UPDATE, DELETE, MERGE и TEMP, разбирается по первому слову (K_NONE).
+ *
+ * @param query Текст запроса.
+ * @param result Результат (перезаписывается; память переиспользуется между вызовами).
+ */
+void ClassifyWrite(std::string_view query, QueryClass& result);
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_CACHE_QUERY_CLASSIFIER_H
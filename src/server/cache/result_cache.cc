@@ -0,0 +1,98 @@
+#include <iterator>
+
+#include "result_cache.h"
+
+namespace {
+
+// Учитываемые накладные расходы записи: узел списка, узел индекса и заголовки строк.
+constexpr size_t ENTRY_OVERHEAD{128};
+
+// Доля объема кэша, которую может занять один ответ.
+constexpr size_t MAX_ENTRY_SHARE{8};
+
+} // namespace
+
+ResultCache::ResultCache(size_t max_bytes, std::chrono::milliseconds ttl, TableVersions& versions,
+                         const TimestampCache& time, WorkerMetrics& metrics) :
+    _max_bytes(max_bytes),
+    _ttl(ttl),
+    _versions(versions),
+    _time(time),
+    _metrics(metrics)
+{}
+
+void ResultCache::Invalidate(const std::vector<uint16_t>& tables, bool all) {
+    _versions.Invalidate(tables, all);
+    _metrics.result_cache_invalidations.Add();
+}
+
+uint64_t ResultCache::GetSequence() const noexcept {
+    return _versions.GetSequence();
+}
+
+size_t ResultCache::GetMaxEntry() const noexcept {
+    return _max_bytes / MAX_ENTRY_SHARE;
+}
+
+size_t ResultCache::GetBytes() const noexcept {
+    return _bytes;
+}
+
+const std::string* ResultCache::Find(const CachedQuery& query) {
+    auto found{_index.find(query.key)};
+
+    if (found == _index.end()) {
+        _metrics.result_cache_misses.Add();
+
+        return nullptr;
+    }
+
+    auto it{found->second};
+
+    if (_time.GetSteady() >= it->expires || !_versions.IsUnchanged(it->query.tables, it->query.sequence)) {
+        Erase(it);
+        _metrics.result_cache_misses.Add();
+
+        return nullptr;
+    }
+
+    _entries.splice(_entries.begin(), _entries, it);
+    _metrics.result_cache_hits.Add();
+
+    return &it->response;
+}
+
+void ResultCache::Store(CachedQuery&& query, std::string&& response) {
+    size_t size{ENTRY_OVERHEAD + query.key.size() + response.size() + query.tables.size() * sizeof(uint16_t)};
+
+    // Изменение таблиц после отправки запроса: ответ мог его застать, а мог и нет.
+    if (size > GetMaxEntry() || !_versions.IsUnchanged(query.tables, query.sequence)) {
+        return;
+    }
+
+    if (auto found{_index.find(query.key)}; found != _index.end()) {
+        Erase(found->second);
+    }
+
+    while (_bytes + size > _max_bytes && !_entries.empty()) {
+        Erase(std::prev(_entries.end()));
+        _metrics.result_cache_evictions.Add();
+    }
+
+    auto expires{_time.GetSteady() + _ttl};
+
+    _entries.push_front(Entry{std::move(query), std::move(response), expires, size});
+    _index.emplace(_entries.front().query.key, _entries.begin());
+
+    _bytes += size;
+    _metrics.result_cache_stored_bytes.Add(size);
+}
+
+void ResultCache::Erase(std::list<Entry>::iterator it) {
+    _index.erase(it->query.key);
+
+    _bytes -= it->size;
+    _metrics.result_cache_released_bytes.Add(it->size);
+
+    _entries.erase(it);
+}
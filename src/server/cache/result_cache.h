@@ -0,0 +1,131 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_CACHE_RESULT_CACHE_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_CACHE_RESULT_CACHE_H
+
+#include <list>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+#include "table_versions.h"
+#include "query_classifier.h"
+#include "../clock/timestamp_cache.h"
+#include "../metrics/metrics.h"
+
+/**
+ * @brief Параметры кэша результатов запросов.
+ */
+struct CacheOptions {
+    size_t max_bytes{}; ///< Общий объем кэша всех рабочих потоков (0 — кэш выключен).
+    size_t ttl_ms{1000}; ///< Время жизни результата в миллисекундах.
+};
+
+/**
+ * @brief Кэшируемый запрос: ключ и таблицы, от которых зависит результат.
+ */
+struct CachedQuery {
+    std::string key; ///< Параметры этапа запуска сессии и нормализованный текст запроса.
+    std::vector<uint16_t> tables; ///< Слоты таблиц запроса.
+    uint64_t sequence{}; ///< Номер последнего изменения (TableVersions) на момент отправки запроса.
+};
+
+/**
+ * @class ResultCache
+ * @brief Кэш ответов PostgreSQL на читающие запросы простого протокола (один на рабочий поток).
+ *
+ * Значение — байты ответа сервера от RowDescription до ReadyForQuery включительно, которые отдаются
+ * клиенту без обращения к PostgreSQL. Результат действителен, пока не истек TTL и ни одна из его
+ * таблиц не менялась после отправки запроса (TableVersions, общие для всех рабочих потоков): номер
+ * изменения берется до отправки, поэтому ответ, который мог застать изменение, в кэш не попадает.
+ *
+ * Изменения, которых прокси не видит (другие клиенты PostgreSQL, триггеры, функции, представления),
+ * кэш не инвалидируют: их устаревание ограничено только TTL.
+ *
+ * Записи вытесняются по LRU при превышении объема; ответ больше 1/8 объема не сохраняется.
+ * Объект не потокобезопасен: у каждого рабочего потока свой кэш.
+ */
+class ResultCache {
+public:
+    /**
+     * @brief Конструктор.
+     * @param max_bytes Объем кэша рабочего потока.
+     * @param ttl Время жизни результата.
+     * @param versions Общие номера изменений таблиц (должны жить дольше кэша).
+     * @param time Время текущего пробуждения цикла событий.
+     * @param metrics Счетчики рабочего потока.
+     */
+    ResultCache(size_t max_bytes, std::chrono::milliseconds ttl, TableVersions& versions, const TimestampCache& time,
+                WorkerMetrics& metrics);
+
+    /**
+     * @brief Отмечает изменение таблиц для кэшей всех рабочих потоков.
+     * @param tables Слоты измененных таблиц.
+     * @param all Изменены все таблицы.
+     */
+    void Invalidate(const std::vector<uint16_t>& tables, bool all);
+
+    /**
+     * @brief Номер последнего изменения таблиц (запоминается до отправки запроса).
+     */
+    uint64_t GetSequence() const noexcept;
+
+    /**
+     * @brief Максимальный размер сохраняемого ответа.
+     */
+    size_t GetMaxEntry() const noexcept;
+
+    /**
+     * @brief Ищет действительный результат запроса.
+     *
+     * Устаревшая запись удаляется, найденная становится самой свежей в LRU.
+     *
+     * @param query Запрос.
+     * @return const std::string* Ответ сервера или nullptr; действителен до следующего изменения кэша.
+     */
+    const std::string* Find(const CachedQuery& query);
+
+    /**
+     * @brief Сохраняет ответ, если его таблицы не менялись после отправки запроса.
+     * @param query Запрос.
+     * @param response Ответ сервера (RowDescription ... ReadyForQuery).
+     */
+    void Store(CachedQuery&& query, std::string&& response);
+
+    /**
+     * @brief Объем записей в байтах.
+     */
+    size_t GetBytes() const noexcept;
+
+private:
+    /**
+     * @brief Запись кэша.
+     */
+    struct Entry {
+        CachedQuery query; ///< Запрос (ключ индекса указывает на query.key).
+        std::string response; ///< Ответ сервера.
+        TimestampCache::Clock::time_point expires; ///< Срок действия.
+        size_t size{}; ///< Учитываемый объем записи.
+    };
+
+    /**
+     * @brief Удаляет запись.
+     * @param it Запись.
+     */
+    void Erase(std::list<Entry>::iterator it);
+
+private:
+    size_t _max_bytes; ///< Объем кэша.
+    std::chrono::milliseconds _ttl; ///< Время жизни результата.
+    TableVersions& _versions; ///< Общие номера изменений таблиц.
+    const TimestampCache& _time; ///< Время пробуждения цикла событий.
+    WorkerMetrics& _metrics; ///< Счетчики рабочего потока.
+
+    std::list<Entry> _entries; ///< Записи от самой свежей к самой старой.
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> _index; ///< Записи по ключу.
+    size_t _bytes{}; ///< Объем записей.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_CACHE_RESULT_CACHE_H
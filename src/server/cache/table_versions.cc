@@ -0,0 +1,59 @@
+#include "table_versions.h"
+
+namespace {
+
+constexpr uint64_t FNV_OFFSET{0xcbf29ce484222325ULL};
+constexpr uint64_t FNV_PRIME{0x100000001b3ULL};
+
+} // namespace
+
+TableVersions::TableVersions() :
+    _tables(std::make_unique<std::atomic<uint64_t>[]>(SLOTS))
+{}
+
+uint16_t TableVersions::GetSlot(std::string_view table) noexcept {
+    uint64_t hash{FNV_OFFSET};
+
+    for (char c : table) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * FNV_PRIME;
+    }
+
+    return static_cast<uint16_t>((hash ^ (hash >> 32)) & (SLOTS - 1));
+}
+
+uint64_t TableVersions::GetSequence() const noexcept {
+    return _sequence.load();
+}
+
+void TableVersions::Raise(std::atomic<uint64_t>& slot, uint64_t sequence) noexcept {
+    uint64_t current{slot.load()};
+
+    while (current < sequence && !slot.compare_exchange_weak(current, sequence)) {
+    }
+}
+
+void TableVersions::Invalidate(const std::vector<uint16_t>& tables, bool all) noexcept {
+    uint64_t sequence{_sequence.fetch_add(1) + 1};
+
+    if (all) {
+        Raise(_all, sequence);
+    }
+
+    for (uint16_t table : tables) {
+        Raise(_tables[table], sequence);
+    }
+}
+
+bool TableVersions::IsUnchanged(const std::vector<uint16_t>& tables, uint64_t sequence) const noexcept {
+    if (_all.load() > sequence) {
+        return false;
+    }
+
+    for (uint16_t table : tables) {
+        if (_tables[table].load() > sequence) {
+            return false;
+        }
+    }
+
+    return true;
+}
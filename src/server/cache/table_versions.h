@@ -0,0 +1,73 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_CACHE_TABLE_VERSIONS_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_CACHE_TABLE_VERSIONS_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @brief Общие для всех рабочих потоков номера последних изменений таблиц.
+ *
+ * Каждое изменение получает номер из общего счетчика, и этот номер записывается в слоты измененных таблиц.
+ * Таблица попадает в слот по хешу имени: совпадение слотов разных таблиц приводит лишь к лишней
+ * инвалидации. Результат запроса, прочитанный после изменения с номером N, остается верным, пока
+ * номера его слотов не превышают N (IsUnchanged()). Отдельный слот отмечает изменения, затрагивающие
+ * все таблицы (DDL).
+ *
+ * Слоты — атомарные переменные без блокировок: кэш результатов каждого рабочего потока проверяет их
+ * при каждом попадании, а сессии любого потока обновляют при изменениях.
+ */
+class TableVersions {
+public:
+    /// Количество слотов таблиц (степень двойки).
+    static constexpr size_t SLOTS{4096};
+
+public:
+    /**
+     * @brief Конструктор. Все слоты — без изменений.
+     */
+    TableVersions();
+
+    /**
+     * @brief Слот таблицы.
+     * @param table Имя таблицы (без схемы; имя без кавычек — в нижнем регистре).
+     */
+    static uint16_t GetSlot(std::string_view table) noexcept;
+
+    /**
+     * @brief Номер последнего изменения (запоминается перед отправкой читающего запроса).
+     */
+    uint64_t GetSequence() const noexcept;
+
+    /**
+     * @brief Отмечает изменение таблиц.
+     * @param tables Слоты измененных таблиц.
+     * @param all Изменение затрагивает все таблицы.
+     */
+    void Invalidate(const std::vector<uint16_t>& tables, bool all) noexcept;
+
+    /**
+     * @brief Проверяет, что таблицы не менялись после изменения с номером sequence.
+     * @param tables Слоты таблиц.
+     * @param sequence Номер, полученный GetSequence() до чтения.
+     */
+    bool IsUnchanged(const std::vector<uint16_t>& tables, uint64_t sequence) const noexcept;
+
+private:
+    /**
+     * @brief Записывает номер в слот, если он больше текущего (изменения разных потоков не откатывают друг друга).
+     * @param slot Слот.
+     * @param sequence Номер изменения.
+     */
+    static void Raise(std::atomic<uint64_t>& slot, uint64_t sequence) noexcept;
+
+private:
+    std::atomic<uint64_t> _sequence{}; ///< Номер последнего изменения.
+    std::atomic<uint64_t> _all{}; ///< Номер последнего изменения всех таблиц.
+    std::unique_ptr<std::atomic<uint64_t>[]> _tables; ///< Номера последних изменений по слотам.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_CACHE_TABLE_VERSIONS_H
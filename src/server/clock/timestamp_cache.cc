@@ -0,0 +1,79 @@
+#include <ctime>
+#include <cstring>
+
+#include "timestamp_cache.h"
+
+namespace {
+
+constexpr int64_t NS_PER_SECOND{1000000000};
+
+// Пишет value ровно width цифрами (с ведущими нулями), от младшей к старшей.
+void WriteDigits(char* out, uint32_t value, size_t width) noexcept {
+    for (size_t i{width}; i > 0; --i) {
+        out[i - 1] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+}
+
+} // namespace
+
+TimestampCache::TimestampCache() {
+    Update();
+}
+
+void TimestampCache::Update() {
+    auto now{std::chrono::system_clock::now().time_since_epoch()};
+
+    _steady = Clock::now();
+    Set(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+void TimestampCache::Set(int64_t system_ns) {
+    _system_ns = system_ns;
+
+    int64_t second{system_ns / NS_PER_SECOND};
+
+    if (second == _second) {
+        return;
+    }
+
+    std::time_t time{static_cast<std::time_t>(second)};
+    std::tm local_time{};
+    localtime_r(&time, &local_time);
+    std::strftime(_text, sizeof(_text), "%Y-%m-%d %H:%M:%S", &local_time);
+
+    _second = second;
+}
+
+int64_t TimestampCache::GetNanoseconds() const noexcept {
+    return _system_ns;
+}
+
+TimestampCache::Clock::time_point TimestampCache::GetSteady() const noexcept {
+    return _steady;
+}
+
+std::string_view TimestampCache::GetText() const noexcept {
+    return std::string_view(_text, SECONDS_SIZE);
+}
+
+size_t TimestampCache::Format(char* out, TimePrecision precision) const noexcept {
+    std::memcpy(out, _text, SECONDS_SIZE);
+
+    auto fraction{static_cast<uint32_t>(_system_ns % NS_PER_SECOND)};
+
+    switch (precision) {
+        case TimePrecision::K_MILLISECONDS:
+            out[SECONDS_SIZE] = '.';
+            WriteDigits(out + SECONDS_SIZE + 1, fraction / 1000000, 3);
+
+            return SECONDS_SIZE + 4;
+        case TimePrecision::K_MICROSECONDS:
+            out[SECONDS_SIZE] = '.';
+            WriteDigits(out + SECONDS_SIZE + 1, fraction / 1000, 6);
+
+            return SECONDS_SIZE + 7;
+        default:
+            return SECONDS_SIZE;
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_CLOCK_TIMESTAMP_CACHE_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_CLOCK_TIMESTAMP_CACHE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @brief Точность метки времени.
+ */
+enum class TimePrecision {
+    K_SECONDS, ///< YYYY-MM-DD HH:MM:SS
+    K_MILLISECONDS, ///< YYYY-MM-DD HH:MM:SS.mmm
+    K_MICROSECONDS ///< YYYY-MM-DD HH:MM:SS.uuuuuu
+};
+
+/**
+ * @brief Кэш текущего времени и отформатированной метки времени.
+ *
+ * Время читается один раз за такт (Update() после возврата из Poller::Wait()), и все, кому в этом
+ * такте нужно время, берут его из кэша. Метка "YYYY-MM-DD HH:MM:SS" форматируется через localtime_r
+ * только при смене секунды; Format() копирует ее и дописывает доли секунды целочисленным
+ * форматированием, без strftime и потоков.
+ *
+ * Объект не потокобезопасен: у каждого потока свой кэш.
+ */
+class TimestampCache {
+public:
+    /// Монотонные часы для отсчета таймаутов.
+    using Clock = std::chrono::steady_clock;
+
+    /// Максимальная длина метки Format() (без завершающего нуля).
+    static constexpr size_t MAX_SIZE{26};
+
+    /// Длина метки с точностью до секунды.
+    static constexpr size_t SECONDS_SIZE{19};
+
+public:
+    /**
+     * @brief Конструктор. Сразу читает текущее время.
+     */
+    TimestampCache();
+
+    /**
+     * @brief Читает текущее время (system_clock и steady_clock).
+     */
+    void Update();
+
+    /**
+     * @brief Устанавливает время вместо текущего (например, время события из записи лога).
+     * @param system_ns Время (system_clock, наносекунды с эпохи).
+     */
+    void Set(int64_t system_ns);
+
+    /**
+     * @brief Возвращает время последнего обновления (system_clock, наносекунды с эпохи).
+     */
+    int64_t GetNanoseconds() const noexcept;
+
+    /**
+     * @brief Возвращает монотонное время последнего Update().
+     */
+    Clock::time_point GetSteady() const noexcept;
+
+    /**
+     * @brief Возвращает метку "YYYY-MM-DD HH:MM:SS" (местное время).
+     */
+    std::string_view GetText() const noexcept;
+
+    /**
+     * @brief Копирует метку с долями секунды в буфер.
+     * @param out Буфер не меньше MAX_SIZE байт (завершающий ноль не пишется).
+     * @param precision Точность.
+     * @return size_t Длина метки.
+     */
+    size_t Format(char* out, TimePrecision precision) const noexcept;
+
+private:
+    int64_t _system_ns{}; ///< Время последнего обновления (наносекунды с эпохи).
+    Clock::time_point _steady{}; ///< Монотонное время последнего Update().
+
+    int64_t _second{-1}; ///< Секунда, для которой сформирована метка.
+    char _text[SECONDS_SIZE + 1]{}; ///< Метка "YYYY-MM-DD HH:MM:SS".
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_CLOCK_TIMESTAMP_CACHE_H
@@ -18,6 +18,8 @@ enum class ConnectionStatus : bool {
 struct Endpoint {
     std::string ip; ///< IP-адрес
     uint16_t port; ///< Порт
+    uint32_t address{}; ///< IPv4-адрес в сетевом порядке байт
+    uint64_t session_id{}; ///< Идентификатор сессии (номер рабочего потока в старших 16 битах)
 };
 
 #endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_CONNECTION_CONNECTION_H
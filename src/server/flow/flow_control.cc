@@ -0,0 +1,34 @@
+#include "flow_control.h"
+#include "../buffer/buffer.h"
+
+FlowControl::FlowControl(const FlowOptions& options) :
+    _options(options)
+{}
+
+size_t FlowControl::GetHighWatermark() const noexcept {
+    return _options.high_watermark;
+}
+
+size_t FlowControl::GetLowWatermark() const noexcept {
+    return _options.low_watermark;
+}
+
+bool FlowControl::IsOverBudget() const noexcept {
+    return Buffer::GetAllocatedBytes() >= _options.memory_budget;
+}
+
+bool FlowControl::HasHeadroom() const noexcept {
+    return Buffer::GetAllocatedBytes() < _options.memory_budget - _options.memory_budget / 8;
+}
+
+void FlowControl::OnThrottled() noexcept {
+    _throttled.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FlowControl::OnResumed() noexcept {
+    _throttled.fetch_sub(1, std::memory_order_relaxed);
+}
+
+size_t FlowControl::GetThrottled() const noexcept {
+    return _throttled.load(std::memory_order_relaxed);
+}
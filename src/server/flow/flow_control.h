@@ -0,0 +1,75 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_FLOW_FLOW_CONTROL_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_FLOW_FLOW_CONTROL_H
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * @brief Параметры управления потоком данных.
+ */
+struct FlowOptions {
+    size_t high_watermark{size_t{1} << 20}; ///< Очередь, при которой прекращается чтение источника.
+    size_t low_watermark{size_t{256} << 10}; ///< Очередь, при которой чтение возобновляется.
+    size_t memory_budget{size_t{256} << 20}; ///< Общий лимит памяти буферов всех сессий.
+};
+
+/**
+ * @brief Общие для всех рабочих потоков границы буферизации.
+ *
+ * Сессия перестает читать сокет-источник (снимает EPOLLIN), когда очередь к получателю достигает
+ * high_watermark или память буферов всех сессий (Buffer::GetAllocatedBytes()) достигает memory_budget,
+ * и возобновляет чтение, когда очередь опускается до low_watermark, а общая память — ниже 7/8 бюджета.
+ * Так медленный клиент держит в прокси не больше high_watermark байт на направление, а общий объем
+ * буферов ограничен независимо от количества сессий.
+ *
+ * Счетчик сессий с приостановленным чтением обновляется атомарно и читается для статистики.
+ */
+class FlowControl {
+public:
+    /**
+     * @brief Конструктор.
+     * @param options Параметры управления потоком.
+     */
+    explicit FlowControl(const FlowOptions& options);
+
+    /**
+     * @brief Верхняя граница очереди направления.
+     */
+    size_t GetHighWatermark() const noexcept;
+
+    /**
+     * @brief Нижняя граница очереди направления.
+     */
+    size_t GetLowWatermark() const noexcept;
+
+    /**
+     * @brief Проверяет, исчерпан ли общий бюджет памяти буферов.
+     */
+    bool IsOverBudget() const noexcept;
+
+    /**
+     * @brief Проверяет, достаточно ли свободного бюджета, чтобы возобновить чтение.
+     */
+    bool HasHeadroom() const noexcept;
+
+    /**
+     * @brief Учитывает сессию, у которой приостановлено чтение.
+     */
+    void OnThrottled() noexcept;
+
+    /**
+     * @brief Учитывает возобновление чтения сессии.
+     */
+    void OnResumed() noexcept;
+
+    /**
+     * @brief Количество сессий с приостановленным чтением.
+     */
+    size_t GetThrottled() const noexcept;
+
+private:
+    FlowOptions _options; ///< Параметры управления потоком.
+    std::atomic<size_t> _throttled{}; ///< Сессии с приостановленным чтением.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_FLOW_FLOW_CONTROL_H
@@ -0,0 +1,81 @@
+#include <cmath>
+#include <algorithm>
+
+#include "histogram.h"
+
+size_t LatencyHistogram::GetBucket(uint64_t value) noexcept {
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+
+    value = std::min(value, MAX_VALUE);
+
+    // Старший бит определяет интервал [2^k, 2^(k+1)), следующие SUB_BUCKET_BITS бит — корзину в нем.
+    size_t exponent{63 - static_cast<size_t>(__builtin_clzll(value))};
+    size_t sub{static_cast<size_t>(value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1)};
+
+    return SUB_BUCKETS + (exponent - SUB_BUCKET_BITS) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::GetLowerBound(size_t bucket) noexcept {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+
+    size_t exponent{(bucket - SUB_BUCKETS) / SUB_BUCKETS + SUB_BUCKET_BITS};
+    size_t sub{(bucket - SUB_BUCKETS) % SUB_BUCKETS};
+
+    return (uint64_t{1} << exponent) + (static_cast<uint64_t>(sub) << (exponent - SUB_BUCKET_BITS));
+}
+
+void LatencyHistogram::Record(uint64_t value) noexcept {
+    _buckets[GetBucket(value)].Add();
+    _count.Add();
+    _sum.Add(value);
+}
+
+uint64_t LatencyHistogram::GetCount() const noexcept {
+    return _count.Get();
+}
+
+uint64_t LatencyHistogram::GetSum() const noexcept {
+    return _sum.Get();
+}
+
+void LatencyHistogram::AddTo(Snapshot& snapshot) const {
+    snapshot.resize(BUCKETS);
+
+    for (size_t i{}; i < BUCKETS; ++i) {
+        snapshot[i] += _buckets[i].Get();
+    }
+}
+
+uint64_t LatencyHistogram::GetQuantile(const Snapshot& snapshot, double quantile) noexcept {
+    uint64_t total{};
+
+    for (uint64_t count : snapshot) {
+        total += count;
+    }
+
+    if (total == 0) {
+        return 0;
+    }
+
+    auto rank{static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(total)))};
+    rank = std::clamp<uint64_t>(rank, 1, total);
+
+    uint64_t seen{};
+
+    for (size_t bucket{}; bucket < snapshot.size(); ++bucket) {
+        seen += snapshot[bucket];
+
+        if (seen >= rank) {
+            uint64_t lower{GetLowerBound(bucket)};
+            uint64_t upper{bucket + 1 < BUCKETS ? GetLowerBound(bucket + 1) : MAX_VALUE + 1};
+
+            return lower + (upper - lower - 1) / 2;
+        }
+    }
+
+    return MAX_VALUE;
+}
@@ -0,0 +1,82 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LATENCY_HISTOGRAM_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "../metrics/counter.h"
+
+/**
+ * @brief Гистограмма задержек с логарифмическими корзинами (в духе HdrHistogram).
+ *
+ * Значения (микросекунды) меньше SUB_BUCKETS хранятся точно, остальные — в корзинах, которые делят
+ * каждый интервал [2^k, 2^(k+1)) на SUB_BUCKETS равных частей: относительная ошибка не больше
+ * 1/SUB_BUCKETS при постоянном объеме памяти. Значения больше MAX_VALUE попадают в последнюю корзину.
+ *
+ * Записывает один поток (счетчики с единственным писателем), читать можно из любого потока.
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t SUB_BUCKET_BITS{4}; ///< log2 количества корзин на степень двойки.
+    static constexpr size_t SUB_BUCKETS{size_t{1} << SUB_BUCKET_BITS}; ///< Корзин на степень двойки.
+    static constexpr size_t MAX_EXPONENT{35}; ///< Старшая степень двойки (2^35 мкс — около 9.5 часов).
+    static constexpr uint64_t MAX_VALUE{(uint64_t{1} << (MAX_EXPONENT + 1)) - 1}; ///< Наибольшее различимое значение.
+
+    /// Количество корзин.
+    static constexpr size_t BUCKETS{SUB_BUCKETS + (MAX_EXPONENT + 1 - SUB_BUCKET_BITS) * SUB_BUCKETS};
+
+    /// Копия счетчиков корзин для вычислений на стороне читателя.
+    using Snapshot = std::vector<uint64_t>;
+
+public:
+    /**
+     * @brief Добавляет значение.
+     * @param value Задержка в микросекундах.
+     */
+    void Record(uint64_t value) noexcept;
+
+    /**
+     * @brief Количество значений.
+     */
+    uint64_t GetCount() const noexcept;
+
+    /**
+     * @brief Сумма значений в микросекундах.
+     */
+    uint64_t GetSum() const noexcept;
+
+    /**
+     * @brief Прибавляет счетчики корзин к снимку.
+     * @param snapshot Снимок размером BUCKETS (расширяется при необходимости).
+     */
+    void AddTo(Snapshot& snapshot) const;
+
+    /**
+     * @brief Вычисляет квантиль по снимку.
+     * @param snapshot Снимок счетчиков корзин.
+     * @param quantile Квантиль в диапазоне (0, 1].
+     * @return uint64_t Середина корзины, в которую попал квантиль (мкс), или 0 для пустого снимка.
+     */
+    static uint64_t GetQuantile(const Snapshot& snapshot, double quantile) noexcept;
+
+    /**
+     * @brief Номер корзины для значения.
+     * @param value Значение в микросекундах.
+     */
+    static size_t GetBucket(uint64_t value) noexcept;
+
+    /**
+     * @brief Нижняя граница корзины.
+     * @param bucket Номер корзины.
+     */
+    static uint64_t GetLowerBound(size_t bucket) noexcept;
+
+private:
+    std::array<Counter, BUCKETS> _buckets; ///< Счетчики корзин.
+    Counter _count; ///< Количество значений.
+    Counter _sum; ///< Сумма значений.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LATENCY_HISTOGRAM_H
@@ -0,0 +1,44 @@
+#include "latency_stats.h"
+
+LatencyStats::Entry* LatencyStats::Intern(uint64_t fingerprint, std::string_view normalized) {
+    auto it{_entries.find(fingerprint)};
+
+    if (it != _entries.end()) {
+        return it->second.get();
+    }
+
+    if (_entries.size() >= MAX_FINGERPRINTS) {
+        return nullptr;
+    }
+
+    auto entry{std::make_unique<Entry>()};
+    entry->fingerprint = fingerprint;
+    entry->text = normalized;
+
+    Entry* result{entry.get()};
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _entries.emplace(fingerprint, std::move(entry));
+
+    return result;
+}
+
+void LatencyStats::Record(Entry* entry, uint64_t latency_us) noexcept {
+    _overall.Record(latency_us);
+
+    if (entry) {
+        entry->histogram.Record(latency_us);
+    }
+}
+
+const LatencyHistogram& LatencyStats::GetOverall() const noexcept {
+    return _overall;
+}
+
+void LatencyStats::ForEach(const Visitor& visitor) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (const auto& [fingerprint, entry] : _entries) {
+        visitor(*entry);
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LATENCY_LATENCY_STATS_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LATENCY_LATENCY_STATS_H
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+
+#include "histogram.h"
+
+/**
+ * @brief Статистика задержек запросов рабочего потока: общая и по отпечаткам запросов.
+ *
+ * Рабочий поток находит (или создает) запись отпечатка в начале запроса (Intern()) и записывает
+ * задержку в ее гистограмму по завершении. Записи не удаляются, поэтому указатель на запись
+ * действителен все время жизни статистики. Количество отпечатков ограничено: запросы сверх
+ * лимита учитываются только в общей гистограмме.
+ *
+ * Таблица отпечатков изменяется только рабочим потоком, поэтому он ищет в ней без блокировки;
+ * мьютекс берется при вставке и при обходе из потока admin-сервера (ForEach()).
+ */
+class LatencyStats {
+public:
+    /// Максимальное количество отпечатков в рабочем потоке.
+    static constexpr size_t MAX_FINGERPRINTS{512};
+
+    /**
+     * @brief Запись отпечатка запроса.
+     */
+    struct Entry {
+        uint64_t fingerprint{}; ///< Отпечаток нормализованного текста.
+        std::string text; ///< Нормализованный текст.
+        LatencyHistogram histogram; ///< Задержки запросов с этим отпечатком.
+    };
+
+    /// Обработчик записи при обходе.
+    using Visitor = std::function<void(const Entry& entry)>;
+
+public:
+    /**
+     * @brief Находит или создает запись отпечатка запроса.
+     * @param fingerprint Отпечаток (FingerprintQuery()).
+     * @param normalized Нормализованный текст запроса.
+     * @return Entry* Запись или nullptr, если лимит отпечатков исчерпан.
+     */
+    Entry* Intern(uint64_t fingerprint, std::string_view normalized);
+
+    /**
+     * @brief Учитывает завершенный запрос.
+     * @param entry Запись отпечатка (может быть nullptr).
+     * @param latency_us Задержка в микросекундах.
+     */
+    void Record(Entry* entry, uint64_t latency_us) noexcept;
+
+    /**
+     * @brief Общая гистограмма рабочего потока.
+     */
+    const LatencyHistogram& GetOverall() const noexcept;
+
+    /**
+     * @brief Обходит записи отпечатков под мьютексом.
+     * @param visitor Обработчик записи.
+     */
+    void ForEach(const Visitor& visitor) const;
+
+private:
+    LatencyHistogram _overall; ///< Задержки всех запросов.
+
+    std::unordered_map<uint64_t, std::unique_ptr<Entry>> _entries; ///< Записи по отпечатку.
+    mutable std::mutex _mutex; ///< Защищает структуру _entries от обхода во время вставки.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LATENCY_LATENCY_STATS_H
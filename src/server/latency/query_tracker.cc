@@ -0,0 +1,144 @@
+#include "query_tracker.h"
+
+void QueryTracker::Enable(LatencyStats* stats) noexcept {
+    _stats = stats;
+}
+
+void QueryTracker::Disable() noexcept {
+    _stats = nullptr;
+    _head = 0;
+    _size = 0;
+}
+
+bool QueryTracker::IsEnabled() const noexcept {
+    return _stats != nullptr;
+}
+
+QueryTracker::Pending& QueryTracker::Push() {
+    if (_size == _ring.size()) {
+        // Элементы переносятся по порядку, чтобы голова снова оказалась в начале.
+        std::vector<Pending> ring(_ring.empty() ? 8 : _ring.size() * 2);
+
+        for (size_t i{}; i < _size; ++i) {
+            ring[i] = std::move(_ring[(_head + i) % _ring.size()]);
+        }
+
+        _ring.swap(ring);
+        _head = 0;
+    }
+
+    Pending& pending{_ring[(_head + _size) % _ring.size()]};
+    ++_size;
+
+    pending.entry = nullptr;
+    pending.log = false;
+    pending.query.clear();
+    pending.params.clear();
+
+    return pending;
+}
+
+void QueryTracker::OnQuery(char type, const QueryText& text, LatencyStats::Entry* entry, bool log) {
+    if (!_stats) {
+        return;
+    }
+
+    if (_size >= MAX_PENDING) {
+        Disable();
+
+        return;
+    }
+
+    Pending& pending{Push()};
+    pending.kind = type == 'Q' ? Kind::K_QUERY : Kind::K_EXECUTE;
+    pending.entry = entry;
+    pending.log = log;
+
+    if (log) {
+        pending.query.assign(text.query);
+        pending.params.assign(text.params);
+    }
+
+    pending.start = Clock::now();
+}
+
+void QueryTracker::OnSync() {
+    if (!_stats) {
+        return;
+    }
+
+    // Sync без запросов (например, после одного Parse) тоже получает ReadyForQuery.
+    if (_size >= MAX_PENDING) {
+        Disable();
+
+        return;
+    }
+
+    Push().kind = Kind::K_SYNC;
+}
+
+void QueryTracker::Complete(Clock::time_point now, const Callback& on_done) {
+    Pending& pending{_ring[_head]};
+
+    _head = (_head + 1) % _ring.size();
+    --_size;
+
+    if (pending.kind == Kind::K_SYNC) {
+        return;
+    }
+
+    auto latency{std::chrono::duration_cast<std::chrono::microseconds>(now - pending.start).count()};
+    _stats->Record(pending.entry, static_cast<uint64_t>(latency));
+
+    if (pending.log && on_done) {
+        on_done(QueryText{pending.query, pending.params, latency, pending.kind == Kind::K_QUERY ? 'Q' : 'E'});
+    }
+}
+
+void QueryTracker::OnBackendMessage(char type, const Callback& on_done) {
+    if (!_stats || _size == 0) {
+        return;
+    }
+
+    switch (type) {
+        case 'C':
+        case 'I':
+        case 's':
+        case 'E':
+            if (_ring[_head].kind == Kind::K_EXECUTE) {
+                Complete(Clock::now(), on_done);
+            }
+
+            break;
+        case 'Z': {
+            auto now{Clock::now()};
+
+            while (_size > 0) {
+                Kind kind{_ring[_head].kind};
+
+                Complete(now, on_done);
+
+                if (kind != Kind::K_EXECUTE) {
+                    break;
+                }
+            }
+
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void QueryTracker::Flush(const Callback& on_done) {
+    while (_stats && _size > 0) {
+        Pending& pending{_ring[_head]};
+
+        _head = (_head + 1) % _ring.size();
+        --_size;
+
+        if (pending.kind != Kind::K_SYNC && pending.log && on_done) {
+            on_done(QueryText{pending.query, pending.params, -1, pending.kind == Kind::K_QUERY ? 'Q' : 'E'});
+        }
+    }
+}
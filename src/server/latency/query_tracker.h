@@ -0,0 +1,124 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LATENCY_QUERY_TRACKER_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LATENCY_QUERY_TRACKER_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <functional>
+
+#include "latency_stats.h"
+#include "../protocol/statement_cache.h"
+
+/**
+ * @brief Сопоставляет запросы клиента с ответами PostgreSQL и измеряет их задержку.
+ *
+ * Запрос (Query или Execute) получает метку монотонного времени при разборе и попадает в очередь
+ * вместе с маркерами Sync. Ответы сервера завершают запросы по порядку:
+ *  - CommandComplete, EmptyQueryResponse, PortalSuspended и ErrorResponse завершают первый Execute;
+ *  - ReadyForQuery завершает Query и все Execute до ближайшего Sync (после ошибки сервер пропускает
+ *    оставшиеся Execute до Sync, их задержка считается до ReadyForQuery).
+ * ReadyForQuery без ожидающих запросов (этап запуска) игнорируется.
+ *
+ * Очередь — кольцевой буфер с переиспользуемыми строками: в установившемся режиме память не выделяется.
+ * Если ответы перестали разбираться и очередь превысила MAX_PENDING, отслеживание сессии выключается.
+ */
+class QueryTracker {
+public:
+    /// Монотонные часы для меток времени.
+    using Clock = std::chrono::steady_clock;
+
+    /// Обработчик завершенного запроса, отмеченного для лога.
+    using Callback = std::function<void(const QueryText& text)>;
+
+    /// Максимальное количество ожидающих запросов сессии.
+    static constexpr size_t MAX_PENDING{4096};
+
+public:
+    /**
+     * @brief Включает отслеживание.
+     * @param stats Статистика рабочего потока (должна жить дольше трекера).
+     */
+    void Enable(LatencyStats* stats) noexcept;
+
+    /**
+     * @brief Выключает отслеживание и очищает очередь.
+     */
+    void Disable() noexcept;
+
+    /**
+     * @brief Проверяет, включено ли отслеживание.
+     */
+    bool IsEnabled() const noexcept;
+
+    /**
+     * @brief Учитывает запрос клиента.
+     * @param type Тип сообщения ('Q' или 'E').
+     * @param text Текст запроса.
+     * @param entry Запись отпечатка (может быть nullptr).
+     * @param log Сохранить текст и передать запрос обработчику завершения.
+     */
+    void OnQuery(char type, const QueryText& text, LatencyStats::Entry* entry, bool log);
+
+    /**
+     * @brief Учитывает Sync клиента.
+     */
+    void OnSync();
+
+    /**
+     * @brief Учитывает сообщение сервера и завершает соответствующие запросы.
+     * @param type Тип сообщения сервера.
+     * @param on_done Обработчик завершенных запросов (может быть пустым).
+     */
+    void OnBackendMessage(char type, const Callback& on_done);
+
+    /**
+     * @brief Передает обработчику незавершенные запросы без задержки и очищает очередь.
+     * @param on_done Обработчик.
+     */
+    void Flush(const Callback& on_done);
+
+private:
+    /**
+     * @brief Вид элемента очереди.
+     */
+    enum class Kind {
+        K_QUERY, ///< Простой запрос (завершается ReadyForQuery)
+        K_EXECUTE, ///< Execute расширенного протокола
+        K_SYNC ///< Маркер Sync
+    };
+
+    /**
+     * @brief Элемент очереди.
+     */
+    struct Pending {
+        Kind kind{Kind::K_SYNC}; ///< Вид элемента.
+        Clock::time_point start{}; ///< Время разбора запроса.
+        LatencyStats::Entry* entry{nullptr}; ///< Запись отпечатка.
+        bool log{false}; ///< Передать обработчику завершения.
+        std::string query; ///< Текст запроса (если сохраняется).
+        std::string params; ///< Параметры (если сохраняются).
+    };
+
+    /**
+     * @brief Добавляет элемент в конец очереди.
+     * @return Pending& Элемент (строки очищены, память сохранена).
+     */
+    Pending& Push();
+
+    /**
+     * @brief Удаляет первый элемент; для запроса записывает задержку и вызывает обработчик.
+     * @param now Время завершения.
+     * @param on_done Обработчик.
+     */
+    void Complete(Clock::time_point now, const Callback& on_done);
+
+private:
+    LatencyStats* _stats{nullptr}; ///< Статистика рабочего потока (nullptr — отслеживание выключено).
+
+    std::vector<Pending> _ring; ///< Кольцевой буфер очереди.
+    size_t _head{}; ///< Индекс первого элемента.
+    size_t _size{}; ///< Количество элементов.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LATENCY_QUERY_TRACKER_H
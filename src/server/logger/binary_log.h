@@ -0,0 +1,64 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LOGGER_BINARY_LOG_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LOGGER_BINARY_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Формат сегмента двоичного лога запросов.
+ *
+ * Сегмент — файл фиксированного максимального размера: заголовок SegmentHeader и записи подряд.
+ * Каждая запись — RecordHeader и текст, выровненные на RECORD_ALIGN байт. Числа записываются
+ * в порядке байт машины (поле byte_order заголовка позволяет читателю это проверить).
+ * Запись с нулевым size (или конец файла) означает конец сегмента: сегмент, не закрытый
+ * из-за аварийного завершения, заканчивается нулями предвыделенного места.
+ */
+struct BinaryLog {
+    /// Сигнатура файла сегмента.
+    static constexpr char MAGIC[8]{'P', 'G', 'P', 'X', 'L', 'O', 'G', '\0'};
+
+    /// Версия формата.
+    static constexpr uint32_t VERSION{1};
+
+    /// Значение поля byte_order, записанное в порядке байт писателя.
+    static constexpr uint32_t BYTE_ORDER_MARK{0x01020304};
+
+    /// Выравнивание записей.
+    static constexpr size_t RECORD_ALIGN{8};
+
+    /// Тип записи со сводкой запросов (текст — строки сводки целиком).
+    static constexpr char TYPE_SUMMARY{'S'};
+
+    /// Флаг записи: текст обрезан, чтобы поместиться в сегмент.
+    static constexpr uint8_t FLAG_TRUNCATED{1};
+
+    /**
+     * @brief Заголовок сегмента.
+     */
+    struct SegmentHeader {
+        char magic[8]; ///< Сигнатура MAGIC.
+        uint32_t version; ///< Версия формата.
+        uint32_t byte_order; ///< BYTE_ORDER_MARK.
+        int64_t created_ns; ///< Время создания сегмента (system_clock, наносекунды с эпохи).
+        uint64_t reserved; ///< Зарезервировано (0).
+    };
+
+    /**
+     * @brief Заголовок записи.
+     */
+    struct RecordHeader {
+        uint32_t size; ///< Размер записи вместе с заголовком и выравниванием.
+        uint32_t text_size; ///< Длина текста.
+        int64_t timestamp_ns; ///< Время события (system_clock, наносекунды с эпохи).
+        uint64_t session_id; ///< Идентификатор сессии.
+        uint32_t address; ///< IPv4-адрес клиента в сетевом порядке байт.
+        uint16_t port; ///< Порт клиента.
+        char type; ///< Тип сообщения ('Q', 'E') или TYPE_SUMMARY.
+        uint8_t flags; ///< Флаги записи (FLAG_TRUNCATED).
+    };
+};
+
+static_assert(sizeof(BinaryLog::SegmentHeader) % BinaryLog::RECORD_ALIGN == 0, "segment header must keep records aligned");
+static_assert(sizeof(BinaryLog::RecordHeader) == 32, "record header layout is part of the file format");
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LOGGER_BINARY_LOG_H
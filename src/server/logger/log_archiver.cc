@@ -0,0 +1,243 @@
+#include <set>
+#include <vector>
+#include <cstring>
+#include <iostream>
+
+#include <glob.h>
+#include <fcntl.h>
+#include <zlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+#include "log_archiver.h"
+#include "../unique_fd/unique_fd.h"
+
+namespace {
+
+constexpr size_t COMPRESS_CHUNK{size_t{256} << 10};
+constexpr int ARCHIVER_NICE{10};
+
+const std::string GZ_SUFFIX{".gz"};
+
+// Имена вида <prefix>.NNNNNN и <prefix>.NNNNNN.gz; для сжатых возвращается имя без суффикса.
+void Find(const std::string& pattern, bool compressed, std::set<std::string>& paths) {
+    glob_t result{};
+
+    if (glob(pattern.c_str(), 0, nullptr, &result) == 0) {
+        for (size_t i{}; i < result.gl_pathc; ++i) {
+            std::string path{result.gl_pathv[i]};
+
+            if (compressed) {
+                path.resize(path.size() - GZ_SUFFIX.size());
+            }
+
+            paths.insert(path);
+        }
+    }
+
+    globfree(&result);
+}
+
+// Номера в именах одной ширины, поэтому порядок имен — порядок создания.
+std::set<std::string> FindAll(const std::string& prefix) {
+    const std::string pattern{prefix + ".[0-9][0-9][0-9][0-9][0-9][0-9]"};
+
+    std::set<std::string> paths;
+    Find(pattern, false, paths);
+    Find(pattern + GZ_SUFFIX, true, paths);
+
+    return paths;
+}
+
+} // namespace
+
+LogArchiver::LogArchiver(const std::string& prefix, bool compress, size_t max_files) :
+    _compress(compress),
+    _max_files(max_files)
+{
+    std::set<std::string> paths{FindAll(prefix)};
+    _pending.assign(paths.begin(), paths.end());
+
+    _thread = std::thread(&LogArchiver::Run, this);
+}
+
+LogArchiver::~LogArchiver() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop.store(true, std::memory_order_relaxed);
+    }
+
+    _cv.notify_one();
+
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+size_t LogArchiver::GetNextIndex(const std::string& prefix) {
+    std::set<std::string> paths{FindAll(prefix)};
+
+    if (paths.empty()) {
+        return 0;
+    }
+
+    return std::stoul(paths.rbegin()->substr(prefix.size() + 1)) + 1;
+}
+
+bool LogArchiver::Exists(const std::string& path) {
+    return access(path.c_str(), F_OK) == 0 || access((path + GZ_SUFFIX).c_str(), F_OK) == 0;
+}
+
+void LogArchiver::Add(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pending.push_back(path);
+    }
+
+    _cv.notify_one();
+}
+
+void LogArchiver::Run() {
+    // Сжатие конкурирует за процессор с рабочими потоками: поток архивации уступает им.
+    setpriority(PRIO_PROCESS, static_cast<id_t>(gettid()), ARCHIVER_NICE);
+
+    while (true) {
+        std::string path;
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv.wait(lock, [this]() { return _stop.load(std::memory_order_relaxed) || !_pending.empty(); });
+
+            if (_stop.load(std::memory_order_relaxed)) {
+                return;
+            }
+
+            path = std::move(_pending.front());
+            _pending.pop_front();
+        }
+
+        _closed.push_back(path);
+        Prune();
+
+        // Файлы прошлых запусков могут быть уже сжаты.
+        if (_compress && access(path.c_str(), F_OK) == 0) {
+            Compress(path);
+        }
+    }
+}
+
+bool LogArchiver::Compress(const std::string& path) {
+    UniqueFD input(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+
+    if (!input.Valid()) {
+        std::cerr << "open() error for log file " << path << ": " << strerror(errno) << '\n';
+
+        return false;
+    }
+
+    // Сжатый файл появляется под своим именем только целиком: прерванное сжатие оставляет .tmp.
+    const std::string compressed{path + GZ_SUFFIX};
+    const std::string temporary{compressed + ".tmp"};
+
+    int output{open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+
+    if (output == -1) {
+        std::cerr << "open() error for log file " << temporary << ": " << strerror(errno) << '\n';
+
+        return false;
+    }
+
+    gzFile gz{gzdopen(output, "wb6")};
+
+    if (!gz) {
+        std::cerr << "gzdopen() error for log file " << temporary << '\n';
+
+        close(output);
+        unlink(temporary.c_str());
+
+        return false;
+    }
+
+    std::vector<char> chunk(COMPRESS_CHUNK);
+    off_t done{};
+    bool ok{true};
+
+    while (ok) {
+        if (_stop.load(std::memory_order_relaxed)) {
+            ok = false;
+
+            break;
+        }
+
+        ssize_t n{read(input, chunk.data(), chunk.size())};
+
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+
+        if (n == -1) {
+            std::cerr << "read() error for log file " << path << ": " << strerror(errno) << '\n';
+
+            ok = false;
+
+            break;
+        }
+
+        if (n == 0) {
+            break;
+        }
+
+        if (gzwrite(gz, chunk.data(), static_cast<unsigned>(n)) != static_cast<int>(n)) {
+            std::cerr << "gzwrite() error for log file " << temporary << '\n';
+
+            ok = false;
+
+            break;
+        }
+
+        // Прочитанный файл в кэше страниц больше не нужен и не должен вытеснять рабочие данные.
+        posix_fadvise(input, done, n, POSIX_FADV_DONTNEED);
+        done += n;
+    }
+
+    if (gzclose(gz) != Z_OK && ok) {
+        std::cerr << "gzclose() error for log file " << temporary << '\n';
+
+        ok = false;
+    }
+
+    if (!ok) {
+        unlink(temporary.c_str());
+
+        return false;
+    }
+
+    if (rename(temporary.c_str(), compressed.c_str()) == -1) {
+        std::cerr << "rename() error for log file " << temporary << ": " << strerror(errno) << '\n';
+
+        unlink(temporary.c_str());
+
+        return false;
+    }
+
+    unlink(path.c_str());
+
+    return true;
+}
+
+void LogArchiver::Prune() {
+    if (_max_files == 0) {
+        return;
+    }
+
+    while (_closed.size() > _max_files) {
+        const std::string& path{_closed.front()};
+
+        unlink(path.c_str());
+        unlink((path + GZ_SUFFIX).c_str());
+        unlink((path + GZ_SUFFIX + ".tmp").c_str());
+
+        _closed.pop_front();
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LOGGER_LOG_ARCHIVER_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LOGGER_LOG_ARCHIVER_H
+
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <string>
+#include <thread>
+#include <cstddef>
+#include <condition_variable>
+
+/**
+ * @brief Сжимает закрытые файлы лога и удаляет старые в фоновом потоке.
+ *
+ * Закрытые файлы лога называются <prefix>.NNNNNN (ротированные текстовые файлы и сегменты двоичного
+ * лога). Поток записи логгера только передает имя закрытого файла через Add(), а сжатие (gzip,
+ * <prefix>.NNNNNN.gz) и удаление выполняются здесь, с пониженным приоритетом: обработка файла
+ * не задерживает ни поток записи, ни рабочие потоки.
+ *
+ * При создании учитываются файлы, оставшиеся от прошлых запусков: несжатые сжимаются,
+ * а лишние сверх max_files удаляются, начиная с самых старых.
+ */
+class LogArchiver {
+public:
+    /**
+     * @brief Конструктор. Находит закрытые файлы прошлых запусков и запускает поток.
+     * @param prefix Путь к файлам лога без номера.
+     * @param compress Сжимать закрытые файлы.
+     * @param max_files Сколько закрытых файлов хранить (0 — без ограничения).
+     */
+    LogArchiver(const std::string& prefix, bool compress, size_t max_files);
+
+    /**
+     * @brief Деструктор. Останавливает поток; необработанные файлы будут подобраны при следующем запуске.
+     */
+    ~LogArchiver();
+
+    LogArchiver(const LogArchiver&) = delete;
+    LogArchiver& operator=(const LogArchiver&) = delete;
+
+    /**
+     * @brief Передает закрытый файл на сжатие и учет в ограничении количества.
+     * @param path Путь к закрытому файлу (<prefix>.NNNNNN).
+     */
+    void Add(const std::string& path);
+
+    /**
+     * @brief Возвращает номер, следующий за наибольшим номером существующих файлов лога (сжатых или нет).
+     *
+     * Новые файлы нумеруются после существующих, даже если младшие номера освободились после удаления:
+     * порядок имен остается порядком создания.
+     *
+     * @param prefix Путь к файлам лога без номера.
+     */
+    static size_t GetNextIndex(const std::string& prefix);
+
+    /**
+     * @brief Проверяет, занято ли имя закрытого файла (существует сам файл или его сжатая копия).
+     * @param path Путь к файлу без суффикса .gz.
+     */
+    static bool Exists(const std::string& path);
+
+private:
+    /**
+     * @brief Цикл потока: обрабатывает переданные файлы по порядку.
+     */
+    void Run();
+
+    /**
+     * @brief Сжимает файл в <path>.gz и удаляет исходный.
+     * @param path Путь к файлу.
+     * @return true Если файл сжат.
+     */
+    bool Compress(const std::string& path);
+
+    /**
+     * @brief Удаляет самые старые закрытые файлы сверх ограничения.
+     */
+    void Prune();
+
+private:
+    bool _compress; ///< Сжимать закрытые файлы.
+    size_t _max_files; ///< Сколько закрытых файлов хранить (0 — без ограничения).
+
+    std::mutex _mutex; ///< Защищает _pending.
+    std::condition_variable _cv; ///< Сигнал о новом файле или остановке.
+    std::deque<std::string> _pending; ///< Файлы, ожидающие обработки.
+    std::atomic<bool> _stop{false}; ///< Флаг остановки потока (прерывает и сжатие).
+
+    std::deque<std::string> _closed; ///< Хранимые закрытые файлы от старых к новым (поток архивации).
+
+    std::thread _thread; ///< Поток архивации.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LOGGER_LOG_ARCHIVER_H
@@ -0,0 +1,101 @@
+#include <cstring>
+#include <algorithm>
+
+#include "log_queue.h"
+
+void LogRecord::SetText(std::initializer_list<std::string_view> parts) {
+    size_t total{};
+
+    for (auto part : parts) {
+        total += part.size();
+    }
+
+    size = static_cast<uint32_t>(total);
+    in_large = total > PAYLOAD_CAPACITY;
+
+    // Буфер больше LARGE_KEEP_CAPACITY освобождается первой же записью поменьше: редкий огромный запрос
+    // не должен держать память в каждой ячейке, через которую прошел.
+    if (large_capacity > LARGE_KEEP_CAPACITY && total <= LARGE_KEEP_CAPACITY) {
+        large.reset();
+        large_capacity = 0;
+    }
+
+    if (in_large && total > large_capacity) {
+        large_capacity = std::max(total, std::min(large_capacity * 2, LARGE_KEEP_CAPACITY));
+        large.reset(new char[large_capacity]);
+    }
+
+    char* out{in_large ? large.get() : payload};
+
+    for (auto part : parts) {
+        std::memcpy(out, part.data(), part.size());
+        out += part.size();
+    }
+}
+
+std::string_view LogRecord::GetText() const noexcept {
+    return std::string_view(in_large ? large.get() : payload, size);
+}
+
+LogQueue::LogQueue(size_t capacity) {
+    size_t size{1};
+
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    _cells = std::vector<Cell>(size);
+    _mask = size - 1;
+
+    for (size_t i{}; i < size; ++i) {
+        _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool LogQueue::TryAcquire(size_t& pos) noexcept {
+    pos = _enqueue_pos.load(std::memory_order_relaxed);
+
+    while (true) {
+        Cell& cell{_cells[pos & _mask]};
+        size_t sequence{cell.sequence.load(std::memory_order_acquire)};
+        auto diff{static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos)};
+
+        if (diff == 0) {
+            if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = _enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+LogRecord& LogQueue::GetRecord(size_t pos) noexcept {
+    return _cells[pos & _mask].record;
+}
+
+void LogQueue::Publish(size_t pos) noexcept {
+    _cells[pos & _mask].sequence.store(pos + 1, std::memory_order_release);
+}
+
+const LogRecord* LogQueue::Peek(size_t offset) const noexcept {
+    size_t pos{_dequeue_pos + offset};
+    const Cell& cell{_cells[pos & _mask]};
+
+    if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+        return nullptr;
+    }
+
+    return &cell.record;
+}
+
+void LogQueue::Pop(size_t count) noexcept {
+    for (size_t i{}; i < count; ++i) {
+        Cell& cell{_cells[(_dequeue_pos + i) & _mask]};
+        cell.sequence.store(_dequeue_pos + i + _mask + 1, std::memory_order_release);
+    }
+
+    _dequeue_pos += count;
+}
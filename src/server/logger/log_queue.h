@@ -0,0 +1,110 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LOGGER_LOG_QUEUE_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LOGGER_LOG_QUEUE_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <initializer_list>
+
+/**
+ * @brief Запись лога фиксированного размера.
+ *
+ * Текст запроса копируется во встроенный буфер записи; длинные запросы — в дополнительный буфер
+ * ячейки, который переиспользуется следующими записями этой ячейки.
+ */
+struct LogRecord {
+    static constexpr size_t PAYLOAD_CAPACITY{448}; ///< Размер встроенного буфера текста.
+    static constexpr size_t LARGE_KEEP_CAPACITY{size_t{16} << 10}; ///< Больший дополнительный буфер не хранится.
+
+    int64_t timestamp_ns{}; ///< Время события (system_clock, наносекунды с эпохи).
+    uint64_t session_id{}; ///< Идентификатор сессии.
+    uint32_t address{}; ///< IPv4-адрес клиента в сетевом порядке байт.
+    uint16_t port{}; ///< Порт клиента.
+    char type{}; ///< Тип сообщения ('Q' или 'E').
+    uint32_t size{}; ///< Длина текста.
+    char payload[PAYLOAD_CAPACITY]; ///< Встроенный буфер текста.
+    std::unique_ptr<char[]> large; ///< Буфер текста, не поместившегося во встроенный.
+    size_t large_capacity{}; ///< Размер буфера large.
+    bool in_large{}; ///< Текст записи лежит в large.
+
+    /**
+     * @brief Копирует текст в запись.
+     * @param parts Части текста, записываемые подряд.
+     */
+    void SetText(std::initializer_list<std::string_view> parts);
+
+    /**
+     * @brief Возвращает текст записи.
+     */
+    std::string_view GetText() const noexcept;
+};
+
+/**
+ * @brief Ограниченная lock-free очередь записей лога (много производителей, один потребитель).
+ *
+ * Ячейки выделяются один раз при создании. Производители (рабочие потоки) занимают ячейку
+ * через CAS позиции записи, потребитель (поток записи) читает ячейки по порядку и освобождает
+ * их пачкой после записи в файл.
+ */
+class LogQueue {
+public:
+    /**
+     * @brief Конструктор очереди.
+     * @param capacity Количество ячеек (округляется вверх до степени двойки).
+     */
+    explicit LogQueue(size_t capacity);
+
+    /**
+     * @brief Занимает ячейку для записи.
+     * @param pos Позиция занятой ячейки.
+     * @return true Если ячейка занята.
+     * @return false Если очередь заполнена.
+     */
+    bool TryAcquire(size_t& pos) noexcept;
+
+    /**
+     * @brief Возвращает запись занятой ячейки.
+     * @param pos Позиция, полученная из TryAcquire().
+     */
+    LogRecord& GetRecord(size_t pos) noexcept;
+
+    /**
+     * @brief Публикует заполненную ячейку для потребителя.
+     * @param pos Позиция, полученная из TryAcquire().
+     */
+    void Publish(size_t pos) noexcept;
+
+    /**
+     * @brief Возвращает опубликованную запись со смещением offset от головы очереди.
+     * @param offset Смещение от головы.
+     * @return const LogRecord* Запись или nullptr, если она еще не опубликована.
+     */
+    const LogRecord* Peek(size_t offset) const noexcept;
+
+    /**
+     * @brief Освобождает count записей с головы очереди.
+     * @param count Количество записей.
+     */
+    void Pop(size_t count) noexcept;
+
+private:
+    /**
+     * @brief Ячейка очереди.
+     */
+    struct alignas(64) Cell {
+        std::atomic<size_t> sequence{}; ///< Номер последовательности ячейки.
+        LogRecord record; ///< Запись.
+    };
+
+private:
+    std::vector<Cell> _cells; ///< Ячейки очереди.
+    size_t _mask{}; ///< Маска индекса.
+
+    alignas(64) std::atomic<size_t> _enqueue_pos{}; ///< Позиция записи (производители).
+    alignas(64) size_t _dequeue_pos{}; ///< Позиция чтения (потребитель).
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LOGGER_LOG_QUEUE_H
@@ -1,63 +1,449 @@
-#include <iostream>
-#include <sstream>
-#include <iomanip>
-#include <chrono>
 #include <ctime>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <iostream>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
 
 #include "logger.h"
 
-Logger::Logger(const std::string& db_host, int db_port, const std::string& path) :
-    _pgsql_host(db_host),
-    _pgsql_port(std::to_string(db_port))
+namespace {
+
+constexpr size_t BATCH_SIZE{256};
+constexpr size_t PREFIX_SIZE{64};
+
+constexpr size_t MAX_SUMMARY_LINES{100};
+
+void FormatLocalTime(int64_t seconds, const char* format, char* out, size_t size) {
+    std::time_t time{static_cast<std::time_t>(seconds)};
+    std::tm local_time{};
+    localtime_r(&time, &local_time);
+    std::strftime(out, size, format, &local_time);
+}
+
+} // namespace
+
+Logger::Logger(const LogOptions& options) :
+    _overflow(options.overflow),
+    _queue(options.queue_size),
+    _precision(options.time_precision),
+    _prefixes(BATCH_SIZE * PREFIX_SIZE),
+    _summary_interval(options.summary_interval_s),
+    _path(options.path),
+    _rotate_size(options.format == LogFormat::K_TEXT ? options.rotate_size : 0),
+    _rotate_interval(options.rotate_interval_s),
+    _rotate_index(LogArchiver::GetNextIndex(options.path)),
+    _file_opened(std::chrono::steady_clock::now())
 {
-    _log_file.open(path, std::ios::app);
+    // Архиватор находит файлы прошлых запусков до того, как будет создан новый сегмент.
+    if (options.compress || options.max_files > 0) {
+        _archiver = std::make_unique<LogArchiver>(options.path, options.compress, options.max_files);
+    }
+
+    if (options.format == LogFormat::K_BINARY) {
+        SegmentWriter::SealCallback on_sealed;
+
+        if (_archiver) {
+            on_sealed = [this](const std::string& path) { _archiver->Add(path); };
+        }
+
+        _segments = std::make_unique<SegmentWriter>(options.path, options.segment_size, std::move(on_sealed));
+    } else if (!OpenFile()) {
+        throw std::invalid_argument("Invalid file: " + options.path);
+    }
+
+    _writer = std::thread(&Logger::WriterLoop, this);
+}
+
+Logger::~Logger() {
+    _stop.store(true, std::memory_order_release);
 
-    if (!_log_file.is_open()) {
-        throw std::invalid_argument("Invalid file: " + path);
+    if (_writer.joinable()) {
+        _writer.join();
     }
+
+    // Последний сегмент закрывается до остановки архиватора; сжат он будет при следующем запуске.
+    _segments.reset();
+    _archiver.reset();
+}
+
+uint64_t Logger::GetDroppedCount() const noexcept {
+    return _dropped.load(std::memory_order_relaxed);
+}
+
+void Logger::Reopen() noexcept {
+    _reopen.store(true, std::memory_order_relaxed);
+}
+
+void Logger::SaveLogs(const Endpoint& client_ep, const QueryText& text, int64_t timestamp_ns) {
+    Enqueue(client_ep, text, timestamp_ns);
 }
 
-bool Logger::IsSQLRequest(std::string_view request) const {
-    return !request.empty() && request[0] == 'Q';
+void Logger::SubmitDigest(QueryDigest&& digest) {
+    std::lock_guard<std::mutex> lock(_digest_mutex);
+    _submitted.push_back(std::move(digest));
 }
 
-std::string_view Logger::GetSQLRequest(std::string_view request) const {
-    if (request.back() == '\0') {
-        request.remove_suffix(1);
+void Logger::Enqueue(const Endpoint& client_ep, const QueryText& text, int64_t timestamp_ns) {
+    size_t pos{};
+
+    while (!_queue.TryAcquire(pos)) {
+        if (_overflow == OverflowPolicy::K_DROP) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+
+            return;
+        }
+
+        std::this_thread::yield();
+    }
+
+    LogRecord& record{_queue.GetRecord(pos)};
+    record.timestamp_ns = timestamp_ns;
+    record.session_id = client_ep.session_id;
+    record.address = client_ep.address;
+    record.port = client_ep.port;
+    record.type = text.type;
+
+    char latency[48]{};
+    int latency_length{};
+
+    if (text.latency_us >= 0) {
+        latency_length = std::snprintf(latency, sizeof(latency), " [latency: %lld.%03lld ms]",
+                                       static_cast<long long>(text.latency_us / 1000),
+                                       static_cast<long long>(text.latency_us % 1000));
     }
 
-    return request.substr(5);
+    std::string_view latency_text{latency, static_cast<size_t>(std::clamp(latency_length, 0, 47))};
+
+    if (text.params.empty()) {
+        record.SetText({text.query, latency_text});
+    } else {
+        record.SetText({text.query, " [parameters: ", text.params, "]", latency_text});
+    }
+
+    _queue.Publish(pos);
 }
 
-std::string Logger::GetCurrentTimestamp() {
-    auto now{std::chrono::system_clock::now()};
-    std::time_t now_time{std::chrono::system_clock::to_time_t(now)};
-    std::tm* local_time{std::localtime(&now_time)};
+void Logger::WriterLoop() {
+    constexpr auto MIN_IDLE{std::chrono::microseconds(100)};
+    constexpr auto MAX_IDLE{std::chrono::microseconds(10000)};
+
+    auto idle{MIN_IDLE};
+    uint64_t reported_dropped{};
+    auto last_report{std::chrono::steady_clock::now()};
+    auto last_summary{last_report};
+
+    while (true) {
+        // Флаг читается до проверки очереди: записи, опубликованные до остановки, будут дописаны.
+        bool stop{_stop.load(std::memory_order_acquire)};
+        size_t count{};
+
+        while (count < BATCH_SIZE && _queue.Peek(count)) {
+            ++count;
+        }
+
+        if (count > 0 && _segments) {
+            WriteSegments(count);
+            _queue.Pop(count);
+
+            idle = MIN_IDLE;
+        } else if (count > 0) {
+            WriteBatch(count);
+            _queue.Pop(count);
+
+            idle = MIN_IDLE;
+        }
+
+        uint64_t dropped{GetDroppedCount()};
+        auto now{std::chrono::steady_clock::now()};
+        bool drained{count == 0};
 
-    std::ostringstream oss;
-    oss << std::put_time(local_time, "%Y-%m-%d %H:%M:%S");
+        if (dropped != reported_dropped && ((stop && drained) || now - last_report >= std::chrono::seconds(1))) {
+            std::cerr << "Logger: " << dropped - reported_dropped << " records dropped (queue full)\n";
 
-    return oss.str();
+            reported_dropped = dropped;
+            last_report = now;
+        }
+
+        // При остановке сводка пишется после того, как очередь дописана.
+        if ((stop && drained) || now - last_summary >= _summary_interval) {
+            WriteSummary();
+
+            last_summary = now;
+        }
+
+        if (!stop) {
+            CheckRotation(now);
+        }
+
+        if (!drained) {
+            continue;
+        }
+
+        if (stop) {
+            break;
+        }
+
+        std::this_thread::sleep_for(idle);
+        idle = std::min(idle * 2, MAX_IDLE);
+    }
 }
 
-void Logger::SaveLogs(const Endpoint& clinet_ep, std::string_view request) {
-    if (!IsSQLRequest(request)) {
+void Logger::WriteBatch(size_t count) {
+    static const char NEWLINE{'\n'};
+
+    iovec iov[BATCH_SIZE * 3];
+    size_t iov_count{};
+
+    for (size_t i{}; i < count; ++i) {
+        const LogRecord& record{*_queue.Peek(i)};
+
+        _record_time.Set(record.timestamp_ns);
+
+        char ip[INET_ADDRSTRLEN]{};
+        inet_ntop(AF_INET, &record.address, ip, sizeof(ip));
+
+        char* prefix{_prefixes.data() + i * PREFIX_SIZE};
+        prefix[0] = '[';
+
+        size_t length{1 + _record_time.Format(prefix + 1, _precision)};
+        int client{std::snprintf(prefix + length, PREFIX_SIZE - length, "] [client: %s:%u] ", ip, record.port)};
+
+        length += static_cast<size_t>(std::clamp(client, 0, static_cast<int>(PREFIX_SIZE - length) - 1));
+
+        std::string_view text{record.GetText()};
+
+        iov[iov_count++] = iovec{prefix, length};
+        iov[iov_count++] = iovec{const_cast<char*>(text.data()), text.size()};
+        iov[iov_count++] = iovec{const_cast<char*>(&NEWLINE), 1};
+    }
+
+    WriteAll(iov, iov_count);
+}
+
+void Logger::WriteSegments(size_t count) {
+    for (size_t i{}; i < count; ++i) {
+        const LogRecord& record{*_queue.Peek(i)};
+
+        BinaryLog::RecordHeader header{};
+        header.timestamp_ns = record.timestamp_ns;
+        header.session_id = record.session_id;
+        header.address = record.address;
+        header.port = record.port;
+        header.type = record.type;
+
+        if (!_segments->Append(header, record.GetText())) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void Logger::WriteSummary() {
+    std::vector<QueryDigest> submitted;
+
+    {
+        std::lock_guard<std::mutex> lock(_digest_mutex);
+        submitted.swap(_submitted);
+    }
+
+    for (QueryDigest& digest : submitted) {
+        _summary.Merge(std::move(digest));
+    }
+
+    if (_summary.Empty()) {
+        return;
+    }
+
+    auto now{std::chrono::system_clock::now().time_since_epoch()};
+
+    char timestamp[32]{};
+    FormatLocalTime(std::chrono::duration_cast<std::chrono::seconds>(now).count(), "%Y-%m-%d %H:%M:%S",
+                    timestamp, sizeof(timestamp));
+
+    std::vector<QueryDigest::Item> top{_summary.GetTop(MAX_SUMMARY_LINES)};
+
+    std::string out;
+    char line[160];
+
+    std::snprintf(line, sizeof(line), "[%s] [summary] queries=%llu fingerprints=%zu\n", timestamp,
+                  static_cast<unsigned long long>(_summary.GetCount()), _summary.GetSize());
+    out += line;
+
+    uint64_t reported_count{};
+    uint64_t reported_bytes{};
+
+    for (const auto& [fingerprint, entry] : top) {
+        char first[16]{};
+        char last[16]{};
+        FormatLocalTime(entry->first_seen_ns / 1000000000, "%H:%M:%S", first, sizeof(first));
+        FormatLocalTime(entry->last_seen_ns / 1000000000, "%H:%M:%S", last, sizeof(last));
+
+        std::snprintf(line, sizeof(line), "[%s] [summary] fingerprint=%016llx count=%llu bytes=%llu first=%s last=%s query=",
+                      timestamp, static_cast<unsigned long long>(fingerprint), static_cast<unsigned long long>(entry->count),
+                      static_cast<unsigned long long>(entry->bytes), first, last);
+        out += line;
+        out += entry->text;
+        out += '\n';
+
+        reported_count += entry->count;
+        reported_bytes += entry->bytes;
+    }
+
+    if (top.size() < _summary.GetSize()) {
+        std::snprintf(line, sizeof(line), "[%s] [summary] others fingerprints=%zu count=%llu bytes=%llu\n", timestamp,
+                      _summary.GetSize() - top.size(),
+                      static_cast<unsigned long long>(_summary.GetCount() - reported_count),
+                      static_cast<unsigned long long>(_summary.GetBytes() - reported_bytes));
+        out += line;
+    }
+
+    if (_segments) {
+        BinaryLog::RecordHeader header{};
+        header.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+        header.type = BinaryLog::TYPE_SUMMARY;
+
+        _segments->Append(header, out);
+    } else {
+        iovec iov{out.data(), out.size()};
+        WriteAll(&iov, 1);
+    }
+
+    _summary.Clear();
+}
+
+bool Logger::OpenFile() {
+    UniqueFD fd(open(_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644));
+
+    if (!fd.Valid()) {
+        std::cerr << "open() error for log file " << _path << ": " << strerror(errno) << '\n';
+
+        return false;
+    }
+
+    struct stat info{};
+    _file_size = fstat(fd, &info) == 0 ? static_cast<size_t>(info.st_size) : 0;
+    _file_opened = std::chrono::steady_clock::now();
+    _log_fd = std::move(fd);
+
+    return true;
+}
+
+void Logger::CheckRotation(std::chrono::steady_clock::time_point now) {
+    if (_reopen.exchange(false, std::memory_order_relaxed)) {
+        if (_segments) {
+            _segments->Rotate();
+            _file_opened = now;
+        } else {
+            OpenFile();
+        }
+
+        return;
+    }
+
+    if (now < _rotate_retry_at) {
+        return;
+    }
+
+    bool by_time{_rotate_interval.count() > 0 && now - _file_opened >= _rotate_interval};
+
+    if (_segments) {
+        if (by_time) {
+            _segments->Rotate();
+            _file_opened = now;
+        }
+
         return;
     }
 
-    std::string current_time{"[" + GetCurrentTimestamp() + "] "};
-    std::string client_info{"[client: " + clinet_ep.ip + ":" + std::to_string(clinet_ep.port) + "] "};
-    std::string sql_req(GetSQLRequest(request));
-    std::string result_str{current_time + client_info + sql_req};
+    bool by_size{_rotate_size > 0 && _file_size >= _rotate_size};
 
-    _log_file << result_str << '\n';
+    if ((by_size || by_time) && _file_size > 0 && !RotateFile()) {
+        _rotate_retry_at = now + std::chrono::seconds(1);
+    }
 }
 
-void Logger::PrintInTerminal(const Endpoint& clinet_ep, ConnectionStatus status) {
-    std::string current_time{"[" + GetCurrentTimestamp() + "] "};
-    std::string connection_status{status == ConnectionStatus::K_OPEN ? "Connection open: " : "Connection closed: "};
-    std::string ip_info{"client " + clinet_ep.ip + ":" + std::to_string(clinet_ep.port) + " -> pgsql server " + _pgsql_host + ":" + _pgsql_port};
-    std::string result_str{current_time + connection_status + ip_info};
+bool Logger::RotateFile() {
+    char suffix[16];
+    std::string target;
+
+    do {
+        std::snprintf(suffix, sizeof(suffix), ".%06zu", _rotate_index++);
+        target = _path + suffix;
+    } while (LogArchiver::Exists(target));
+
+    if (rename(_path.c_str(), target.c_str()) == -1) {
+        std::cerr << "rename() error for log file " << _path << ": " << strerror(errno) << '\n';
+
+        return false;
+    }
+
+    // Если новый файл не открылся, старому возвращается прежнее имя и запись продолжается в него.
+    if (!OpenFile()) {
+        rename(target.c_str(), _path.c_str());
+
+        return false;
+    }
+
+    if (_archiver) {
+        _archiver->Add(target);
+    }
+
+    return true;
+}
+
+void Logger::WriteAll(iovec* iov, size_t count) {
+    while (count > 0) {
+        ssize_t n{writev(_log_fd, iov, static_cast<int>(count))};
+
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            std::cerr << "writev() error to log file: " << strerror(errno) << '\n';
+
+            return;
+        }
+
+        auto written{static_cast<size_t>(n)};
+        _file_size += written;
+
+        while (count > 0 && written >= iov->iov_len) {
+            written -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
+    }
+}
+
+void Logger::PrintInTerminal(const Endpoint& client_ep, std::string_view server, ConnectionStatus status,
+                             const TimestampCache& time) {
+    char timestamp[TimestampCache::MAX_SIZE];
+    size_t length{time.Format(timestamp, _precision)};
+
+    std::string result_str;
+    result_str.reserve(128);
+
+    result_str += '[';
+    result_str.append(timestamp, length);
+    result_str += status == ConnectionStatus::K_OPEN ? "] Connection open: client " : "] Connection closed: client ";
+    result_str += client_ep.ip;
+    result_str += ':';
+    result_str += std::to_string(client_ep.port);
+    result_str += " -> pgsql server ";
+    result_str += server;
 
+    std::lock_guard<std::mutex> lock(_terminal_mutex);
     std::cout << result_str << std::endl;
 }
@@ -1,84 +1,242 @@
 #ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LOGGER_LOGGER_H
 #define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LOGGER_LOGGER_H
 
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
 #include <string>
-#include <fstream>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <string_view>
 
+#include <sys/uio.h>
+
+#include "log_queue.h"
+#include "query_digest.h"
+#include "log_archiver.h"
+#include "segment_writer.h"
+#include "../unique_fd/unique_fd.h"
+#include "../clock/timestamp_cache.h"
+#include "../protocol/statement_cache.h"
 #include "../connection/connection.h"
 
+/**
+ * @brief Поведение при переполнении очереди лога.
+ */
+enum class OverflowPolicy {
+    K_DROP, ///< Отбросить запись и увеличить счетчик потерь
+    K_BLOCK ///< Ждать, пока поток записи освободит место
+};
+
+/**
+ * @brief Формат лога запросов.
+ */
+enum class LogFormat {
+    K_TEXT, ///< Строки "[время] [client: ip:port] запрос" в одном файле
+    K_BINARY ///< Двоичные записи в отображенных в память сегментах (SegmentWriter)
+};
+
+/**
+ * @brief Что пишется в лог запросов.
+ */
+enum class LogMode {
+    K_RAW, ///< Каждый запрос целиком
+    K_SUMMARY, ///< Только периодические сводки по отпечаткам запросов
+    K_SAMPLE ///< Сводки и каждый N-й запрос целиком
+};
+
+/**
+ * @brief Параметры логирования запросов.
+ */
+struct LogOptions {
+    std::string path; ///< Путь к файлу логов (для двоичного формата — префикс сегментов).
+    LogFormat format{LogFormat::K_TEXT}; ///< Формат лога.
+    size_t segment_size{size_t{64} << 20}; ///< Размер сегмента двоичного лога.
+    size_t queue_size{16384}; ///< Количество записей в очереди лога.
+    OverflowPolicy overflow{OverflowPolicy::K_BLOCK}; ///< Поведение при переполнении очереди.
+    LogMode mode{LogMode::K_RAW}; ///< Что пишется в лог.
+    size_t sample_rate{100}; ///< В режиме K_SAMPLE пишется каждый sample_rate-й запрос рабочего потока.
+    size_t summary_interval_s{60}; ///< Период записи сводки в секундах.
+    size_t rotate_size{}; ///< Размер текстового файла, при котором он ротируется (0 — без ротации по размеру).
+    size_t rotate_interval_s{}; ///< Период ротации в секундах (0 — без ротации по времени).
+    bool compress{false}; ///< Сжимать закрытые файлы (gzip).
+    size_t max_files{}; ///< Сколько закрытых файлов хранить (0 — без ограничения).
+    TimePrecision time_precision{TimePrecision::K_SECONDS}; ///< Точность меток времени в логе и терминале.
+};
+
 /**
  * @brief Класс для логирования SQL-запросов клиентов и состояния соединений.
- * 
+ *
  * Logger сохраняет SQL-запросы клиентов в файл и выводит информацию о соединениях в терминал.
+ * Методы потокобезопасны: один Logger разделяется всеми рабочими потоками.
+ *
+ * SaveLogs() не выполняет форматирование и запись: он копирует запрос в запись фиксированного
+ * размера в lock-free очереди. Отдельный поток записи форматирует записи и сбрасывает их
+ * в файл пачками через writev().
+ *
+ * В двоичном формате (K_BINARY) записи копируются в сегменты SegmentWriter без форматирования;
+ * текст из них восстанавливает утилита log_reader.
+ *
+ * В режимах K_SUMMARY и K_SAMPLE рабочие потоки периодически передают сводки запросов по отпечаткам
+ * (SubmitDigest()); поток записи объединяет их и раз в summary_interval_s пишет самые частые отпечатки.
+ *
+ * Ротацию выполняет поток записи между пачками: текстовый файл переименовывается в <path>.NNNNNN
+ * и открывается заново, в двоичном формате закрывается текущий сегмент. Закрытые файлы сжимает
+ * и удаляет LogArchiver в своем потоке. Рабочие потоки в ротации не участвуют: пока она идет,
+ * записи накапливаются в очереди. Reopen() (SIGHUP) лишь выставляет флаг для потока записи.
  */
 class Logger {
 public:
     /**
      * @brief Конструктор Logger.
-     * 
-     * Открывает лог-файл для записи и инициализирует адрес PostgreSQL сервера.
-     * 
-     * @param db_host Хост PostgreSQL сервера.
-     * @param db_port Порт PostgreSQL сервера.
-     * @param path Путь к файлу логов.
-     * @throws std::invalid_argument Если файл не может быть открыт.
+     *
+     * Открывает лог-файл для записи и запускает поток записи.
+     *
+     * @param options Параметры логирования.
+     * @throws std::invalid_argument Если файл (или первый сегмент) не может быть открыт.
      */
-    Logger(const std::string& db_host, int db_port, const std::string& path);
-    
+    explicit Logger(const LogOptions& options);
+
     /**
-     * @brief Деструктор Logger.
+     * @brief Деструктор Logger. Дописывает оставшиеся записи и останавливает поток записи.
      */
-    ~Logger() = default;
+    ~Logger();
 
 public:
     /**
      * @brief Сохраняет SQL-запрос клиента в лог-файл.
-     * 
-     * Игнорирует запросы, которые не являются SQL-запросами (например, контрольные пакеты).
-     * 
+     *
+     * Параметры (если собраны) дописываются после запроса в виде " [parameters: $1='a']",
+     * время выполнения (если измерено) — в виде " [latency: 1.234 ms]".
+     *
      * @param client_ep Информация о клиенте (IP и порт).
-     * @param request SQL-запрос клиента в виде строки.
+     * @param text Текст выполняемого запроса (Query или Execute).
+     * @param timestamp_ns Время события (system_clock, наносекунды с эпохи; обычно из TimestampCache рабочего потока).
+     */
+    void SaveLogs(const Endpoint& client_ep, const QueryText& text, int64_t timestamp_ns);
+
+    /**
+     * @brief Передает сводку запросов рабочего потока для записи в ближайшую сводку лога.
+     * @param digest Сводка (перемещается).
      */
-    void SaveLogs(const Endpoint& client_ep, std::string_view request);
+    void SubmitDigest(QueryDigest&& digest);
 
     /**
      * @brief Выводит информацию о соединении в терминал.
-     * 
+     *
      * @param client_ep Информация о клиенте (IP и порт).
+     * @param server Сервер сессии: "host:port" выбранного узла или пул соединений.
      * @param status Статус соединения (открыто/закрыто).
+     * @param time Кэш времени вызывающего потока.
+     */
+    void PrintInTerminal(const Endpoint& client_ep, std::string_view server, ConnectionStatus status,
+                         const TimestampCache& time);
+
+    /**
+     * @brief Возвращает количество записей, отброшенных из-за переполнения очереди.
+     */
+    uint64_t GetDroppedCount() const noexcept;
+
+    /**
+     * @brief Запрашивает повторное открытие файла лога (после внешней ротации, по SIGHUP).
+     *
+     * Текстовый файл открывается заново по исходному пути, в двоичном формате начинается новый сегмент.
+     * Только выставляет флаг для потока записи, поэтому безопасен в обработчике сигнала.
      */
-    void PrintInTerminal(const Endpoint& client_ep, ConnectionStatus status);
+    void Reopen() noexcept;
 
 private:
     /**
-     * @brief Получает текущую дату и время в виде строки.
-     * 
-     * @return std::string Текущее время в формате YYYY-MM-DD HH:MM:SS.
+     * @brief Помещает запись в очередь с учетом политики переполнения.
+     *
+     * @param client_ep Информация о клиенте.
+     * @param text Текст запроса.
+     * @param timestamp_ns Время события.
      */
-    std::string GetCurrentTimestamp();
+    void Enqueue(const Endpoint& client_ep, const QueryText& text, int64_t timestamp_ns);
 
     /**
-     * @brief Проверяет, является ли запрос SQL-запросом.
-     * 
-     * @param request Запрос клиента.
-     * @return true Если это SQL-запрос.
-     * @return false В противном случае.
+     * @brief Цикл потока записи: забирает записи из очереди пачками и пишет их в файл.
      */
-    bool IsSQLRequest(std::string_view request) const;
+    void WriterLoop();
 
     /**
-     * @brief Извлекает SQL-запрос из пакета клиента.
-     * 
-     * @param request Пакет клиента.
-     * @return std::string_view SQL-запрос без служебных байтов.
+     * @brief Форматирует и записывает в файл до count опубликованных записей.
+     * @param count Количество записей.
      */
-    std::string_view GetSQLRequest(std::string_view request) const;
+    void WriteBatch(size_t count);
+
+    /**
+     * @brief Копирует count опубликованных записей в сегменты двоичного лога.
+     * @param count Количество записей.
+     */
+    void WriteSegments(size_t count);
+
+    /**
+     * @brief Объединяет переданные сводки и пишет в файл самые частые отпечатки.
+     */
+    void WriteSummary();
+
+    /**
+     * @brief Открывает текстовый файл лога по исходному пути (O_APPEND) вместо текущего.
+     * @return true Если файл открыт.
+     */
+    bool OpenFile();
+
+    /**
+     * @brief Ротирует лог, если истек период ротации или текстовый файл достиг rotate_size.
+     * @param now Текущее время.
+     */
+    void CheckRotation(std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Переименовывает текстовый файл в <path>.NNNNNN, открывает новый и передает старый архиватору.
+     * @return true Если файл переименован.
+     */
+    bool RotateFile();
+
+    /**
+     * @brief Записывает массив iovec целиком, повторяя writev() при частичной записи.
+     * @param iov Массив iovec.
+     * @param count Количество элементов.
+     */
+    void WriteAll(iovec* iov, size_t count);
 
 public:
-    std::string _pgsql_host; ///< Хост PostgreSQL сервера.
-    std::string _pgsql_port; ///< Порт PostgreSQL сервера.
-    
-    std::ofstream _log_file; ///< Поток для записи логов в файл.
+    UniqueFD _log_fd; ///< Дескриптор файла логов (O_APPEND, текстовый формат).
+    std::unique_ptr<LogArchiver> _archiver; ///< Сжатие и удаление закрытых файлов (nullptr — не нужно).
+    std::unique_ptr<SegmentWriter> _segments; ///< Сегменты лога (двоичный формат).
+
+    std::mutex _terminal_mutex; ///< Мьютекс для вывода в терминал.
+
+private:
+    OverflowPolicy _overflow; ///< Поведение при переполнении очереди.
+    LogQueue _queue; ///< Очередь записей лога.
+
+    std::atomic<uint64_t> _dropped{}; ///< Количество отброшенных записей.
+    std::atomic<bool> _stop{false}; ///< Флаг остановки потока записи.
+
+    TimePrecision _precision; ///< Точность меток времени.
+    TimestampCache _record_time; ///< Метка времени записей пачки (поток записи).
+    std::vector<char> _prefixes; ///< Буфер префиксов записей пачки (поток записи).
+
+    std::mutex _digest_mutex; ///< Защищает _submitted.
+    std::vector<QueryDigest> _submitted; ///< Сводки, переданные рабочими потоками.
+    QueryDigest _summary; ///< Сводка текущего интервала (поток записи).
+    std::chrono::seconds _summary_interval; ///< Период записи сводки.
+
+    std::string _path; ///< Путь к файлу логов.
+    size_t _rotate_size; ///< Размер текстового файла для ротации (0 — без ротации по размеру).
+    std::chrono::seconds _rotate_interval; ///< Период ротации (0 — без ротации по времени).
+    std::atomic<bool> _reopen{false}; ///< Запрос повторного открытия файла.
+    size_t _file_size{}; ///< Размер текущего текстового файла (поток записи).
+    size_t _rotate_index; ///< Номер следующего ротированного файла (поток записи).
+    std::chrono::steady_clock::time_point _file_opened; ///< Время открытия текущего файла (поток записи).
+    std::chrono::steady_clock::time_point _rotate_retry_at{}; ///< Время повторной попытки после ошибки ротации.
+
+    std::thread _writer; ///< Поток записи.
 };
 
 #endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LOGGER_LOGGER_H
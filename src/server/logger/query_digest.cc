@@ -0,0 +1,111 @@
+#include <algorithm>
+
+#include "query_digest.h"
+
+namespace {
+
+constexpr char OTHER_TEXT[]{"<other>"};
+
+} // namespace
+
+void QueryDigest::Update(uint64_t fingerprint, std::string_view text, uint64_t count, uint64_t bytes,
+                         int64_t first_ns, int64_t last_ns) {
+    auto it{_entries.find(fingerprint)};
+
+    if (it == _entries.end()) {
+        if (_entries.size() >= MAX_ENTRIES && fingerprint != OTHER_FINGERPRINT) {
+            fingerprint = OTHER_FINGERPRINT;
+            text = OTHER_TEXT;
+            it = _entries.find(fingerprint);
+        }
+
+        if (it == _entries.end()) {
+            it = _entries.emplace(fingerprint, Entry{std::string(text), 0, 0, first_ns, last_ns}).first;
+        }
+    }
+
+    Entry& entry{it->second};
+
+    entry.count += count;
+    entry.bytes += bytes;
+    entry.first_seen_ns = std::min(entry.first_seen_ns, first_ns);
+    entry.last_seen_ns = std::max(entry.last_seen_ns, last_ns);
+
+    _count += count;
+    _bytes += bytes;
+}
+
+void QueryDigest::Add(uint64_t fingerprint, std::string_view normalized, size_t bytes, int64_t now_ns) {
+    // Отпечаток общей записи зарезервирован.
+    if (fingerprint == OTHER_FINGERPRINT) {
+        fingerprint = 1;
+    }
+
+    Update(fingerprint, normalized, 1, bytes, now_ns, now_ns);
+}
+
+void QueryDigest::Merge(QueryDigest&& other) {
+    if (_entries.empty()) {
+        _entries.swap(other._entries);
+        _count = other._count;
+        _bytes = other._bytes;
+    } else {
+        for (const auto& [fingerprint, entry] : other._entries) {
+            Update(fingerprint, entry.text, entry.count, entry.bytes, entry.first_seen_ns, entry.last_seen_ns);
+        }
+    }
+
+    other.Clear();
+}
+
+QueryDigest QueryDigest::Take() {
+    QueryDigest digest;
+    digest._entries.swap(_entries);
+    digest._count = _count;
+    digest._bytes = _bytes;
+
+    Clear();
+
+    return digest;
+}
+
+bool QueryDigest::Empty() const noexcept {
+    return _entries.empty();
+}
+
+void QueryDigest::Clear() noexcept {
+    _entries.clear();
+    _count = 0;
+    _bytes = 0;
+}
+
+uint64_t QueryDigest::GetCount() const noexcept {
+    return _count;
+}
+
+uint64_t QueryDigest::GetBytes() const noexcept {
+    return _bytes;
+}
+
+size_t QueryDigest::GetSize() const noexcept {
+    return _entries.size();
+}
+
+std::vector<QueryDigest::Item> QueryDigest::GetTop(size_t limit) const {
+    std::vector<Item> top;
+    top.reserve(_entries.size());
+
+    for (const auto& [fingerprint, entry] : _entries) {
+        top.emplace_back(fingerprint, &entry);
+    }
+
+    size_t reported{std::min(top.size(), limit)};
+
+    std::partial_sort(top.begin(), top.begin() + reported, top.end(), [](const Item& lhs, const Item& rhs) {
+        return lhs.second->count > rhs.second->count;
+    });
+
+    top.resize(reported);
+
+    return top;
+}
@@ -0,0 +1,114 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LOGGER_QUERY_DIGEST_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LOGGER_QUERY_DIGEST_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * @brief Сводка запросов по отпечаткам: количество, объем и время первого/последнего появления.
+ *
+ * Рабочий поток накапливает свою сводку без блокировок и периодически передает ее логгеру
+ * (Take() и Logger::SubmitDigest()), который объединяет сводки потоков (Merge()) и пишет
+ * в лог самые частые отпечатки (GetTop()). Количество отпечатков ограничено MAX_ENTRIES:
+ * запросы новых отпечатков сверх лимита учитываются в общей записи OTHER_FINGERPRINT.
+ */
+class QueryDigest {
+public:
+    /// Максимальное количество отпечатков в сводке.
+    static constexpr size_t MAX_ENTRIES{10000};
+
+    /// Отпечаток общей записи для запросов сверх лимита.
+    static constexpr uint64_t OTHER_FINGERPRINT{0};
+
+    /**
+     * @brief Запись отпечатка.
+     */
+    struct Entry {
+        std::string text; ///< Нормализованный текст.
+        uint64_t count{}; ///< Количество запросов.
+        uint64_t bytes{}; ///< Суммарная длина исходных запросов.
+        int64_t first_seen_ns{}; ///< Время первого запроса (наносекунды от эпохи).
+        int64_t last_seen_ns{}; ///< Время последнего запроса (наносекунды от эпохи).
+    };
+
+    /// Запись вместе с отпечатком (результат GetTop()).
+    using Item = std::pair<uint64_t, const Entry*>;
+
+public:
+    /**
+     * @brief Учитывает запрос.
+     * @param fingerprint Отпечаток запроса.
+     * @param normalized Нормализованный текст (копируется только для нового отпечатка).
+     * @param bytes Длина исходного запроса.
+     * @param now_ns Текущее время (наносекунды от эпохи).
+     */
+    void Add(uint64_t fingerprint, std::string_view normalized, size_t bytes, int64_t now_ns);
+
+    /**
+     * @brief Прибавляет записи другой сводки.
+     * @param other Сводка (опустошается).
+     */
+    void Merge(QueryDigest&& other);
+
+    /**
+     * @brief Забирает накопленную сводку, оставляя текущую пустой.
+     */
+    QueryDigest Take();
+
+    /**
+     * @brief Проверяет, пуста ли сводка.
+     */
+    bool Empty() const noexcept;
+
+    /**
+     * @brief Очищает сводку.
+     */
+    void Clear() noexcept;
+
+    /**
+     * @brief Количество запросов в сводке.
+     */
+    uint64_t GetCount() const noexcept;
+
+    /**
+     * @brief Суммарная длина запросов в сводке.
+     */
+    uint64_t GetBytes() const noexcept;
+
+    /**
+     * @brief Количество отпечатков в сводке.
+     */
+    size_t GetSize() const noexcept;
+
+    /**
+     * @brief Записи с наибольшим количеством запросов.
+     * @param limit Максимальное количество записей.
+     * @return std::vector<Item> Записи по убыванию количества (действительны до изменения сводки).
+     */
+    std::vector<Item> GetTop(size_t limit) const;
+
+private:
+    /**
+     * @brief Прибавляет к записи отпечатка (создает ее при необходимости) значения другой записи.
+     * @param fingerprint Отпечаток.
+     * @param text Нормализованный текст.
+     * @param count Количество запросов.
+     * @param bytes Суммарная длина запросов.
+     * @param first_ns Время первого запроса.
+     * @param last_ns Время последнего запроса.
+     */
+    void Update(uint64_t fingerprint, std::string_view text, uint64_t count, uint64_t bytes,
+                int64_t first_ns, int64_t last_ns);
+
+private:
+    std::unordered_map<uint64_t, Entry> _entries; ///< Записи по отпечатку.
+    uint64_t _count{}; ///< Количество запросов.
+    uint64_t _bytes{}; ///< Суммарная длина запросов.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LOGGER_QUERY_DIGEST_H
@@ -0,0 +1,298 @@
+#include <mutex>
+#include <chrono>
+#include <cstdio>
+#include <utility>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "segment_writer.h"
+#include "log_archiver.h"
+
+namespace {
+
+constexpr size_t MAX_SEGMENT_INDEX{999999};
+
+size_t AlignRecord(size_t size) {
+    return (size + BinaryLog::RECORD_ALIGN - 1) & ~(BinaryLog::RECORD_ALIGN - 1);
+}
+
+void Prefault(char* data, size_t size) {
+    // Ядра без MADV_POPULATE_WRITE (до 5.14) вернут EINVAL: страницы заполнятся при первой записи, как раньше.
+#ifdef MADV_POPULATE_WRITE
+    madvise(data, size, MADV_POPULATE_WRITE);
+#else
+    (void)data;
+    (void)size;
+#endif
+}
+
+void WriteHeader(char* data) {
+    auto now{std::chrono::system_clock::now().time_since_epoch()};
+
+    BinaryLog::SegmentHeader header{};
+    std::memcpy(header.magic, BinaryLog::MAGIC, sizeof(header.magic));
+    header.version = BinaryLog::VERSION;
+    header.byte_order = BinaryLog::BYTE_ORDER_MARK;
+    header.created_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+
+    std::memcpy(data, &header, sizeof(header));
+}
+
+} // namespace
+
+SegmentWriter::SegmentWriter(const std::string& prefix, size_t segment_size, SealCallback on_sealed) :
+    _prefix(prefix),
+    _segment_size(AlignRecord(std::clamp(segment_size, MIN_SEGMENT_SIZE, MAX_SEGMENT_SIZE))),
+    _index(LogArchiver::GetNextIndex(prefix)),
+    _on_sealed(std::move(on_sealed))
+{
+    if (!Open()) {
+        throw std::invalid_argument("Invalid file: " + prefix);
+    }
+
+    // Open() уже запросил подготовку следующего сегмента: поток начнет с нее.
+    _thread = std::thread(&SegmentWriter::Run, this);
+}
+
+SegmentWriter::~SegmentWriter() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+
+    _cv.notify_all();
+
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+
+    Seal();
+
+    // Подготовленный сегмент пуст.
+    if (_next.data) {
+        munmap(_next.data, _segment_size);
+        unlink(_next.path.c_str());
+        _next.data = nullptr;
+    }
+}
+
+bool SegmentWriter::Open() {
+    Mapping next;
+
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cv.wait(lock, [this]() { return !_preparing; });
+
+        next = std::move(_next);
+        _next.data = nullptr;
+    }
+
+    if (next.data) {
+        // Время создания — момент, когда сегмент стал текущим.
+        WriteHeader(next.data);
+        _prefaulted = _segment_size;
+    } else if (Create(next, PREFAULT_SIZE)) {
+        _prefaulted = std::min(PREFAULT_SIZE, _segment_size);
+    } else {
+        return false;
+    }
+
+    _path = std::move(next.path);
+    _fd = std::move(next.fd);
+    _data = next.data;
+    _offset = sizeof(BinaryLog::SegmentHeader);
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _preparing = true;
+    }
+
+    _cv.notify_all();
+
+    return true;
+}
+
+bool SegmentWriter::Create(Mapping& mapping, size_t prefault) {
+    char suffix[16];
+    std::string& path{mapping.path};
+    UniqueFD& fd{mapping.fd};
+
+    // O_EXCL и проверка сжатой копии — на случай, если файлы с большими номерами появились после запуска.
+    while (true) {
+        if (_index > MAX_SEGMENT_INDEX) {
+            std::cerr << "SegmentWriter: no free segment number for " << _prefix << '\n';
+
+            return false;
+        }
+
+        std::snprintf(suffix, sizeof(suffix), ".%06zu", _index++);
+        path = _prefix + suffix;
+
+        if (LogArchiver::Exists(path)) {
+            continue;
+        }
+
+        fd = UniqueFD(open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644));
+
+        if (fd.Valid()) {
+            break;
+        }
+
+        if (errno != EEXIST) {
+            std::cerr << "open() error for log segment " << path << ": " << strerror(errno) << '\n';
+
+            return false;
+        }
+    }
+
+    // Место выделяется заранее: запись в отображение не упрется в ENOSPC посреди сегмента (SIGBUS).
+    int error{posix_fallocate(fd, 0, static_cast<off_t>(_segment_size))};
+
+    if (error != 0) {
+        std::cerr << "posix_fallocate() error for log segment " << path << ": " << strerror(error) << '\n';
+
+        fd.Close();
+        unlink(path.c_str());
+
+        return false;
+    }
+
+    void* data{mmap(nullptr, _segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)};
+
+    if (data == MAP_FAILED) {
+        std::cerr << "mmap() error for log segment " << path << ": " << strerror(errno) << '\n';
+
+        fd.Close();
+        unlink(path.c_str());
+
+        return false;
+    }
+
+    mapping.data = static_cast<char*>(data);
+
+    Prefault(mapping.data, std::min(prefault, _segment_size));
+    WriteHeader(mapping.data);
+
+    return true;
+}
+
+void SegmentWriter::Seal() {
+    if (!_data) {
+        return;
+    }
+
+    munmap(_data, _segment_size);
+    _data = nullptr;
+
+    // Сегмент без записей не нужен.
+    if (_offset == sizeof(BinaryLog::SegmentHeader)) {
+        unlink(_path.c_str());
+        _fd.Close();
+
+        return;
+    }
+
+    if (ftruncate(_fd, static_cast<off_t>(_offset)) == -1) {
+        std::cerr << "ftruncate() error for log segment: " << strerror(errno) << '\n';
+    }
+
+    _fd.Close();
+
+    if (_on_sealed) {
+        _on_sealed(_path);
+    }
+}
+
+void SegmentWriter::Rotate() {
+    if (_data && _offset > sizeof(BinaryLog::SegmentHeader)) {
+        Seal();
+    }
+}
+
+bool SegmentWriter::Append(BinaryLog::RecordHeader header, std::string_view text) {
+    constexpr size_t HEADER_SIZE{sizeof(BinaryLog::RecordHeader)};
+
+    size_t capacity{_segment_size - sizeof(BinaryLog::SegmentHeader) - HEADER_SIZE};
+
+    header.flags = 0;
+
+    if (text.size() > capacity) {
+        text = text.substr(0, capacity);
+        header.flags |= BinaryLog::FLAG_TRUNCATED;
+    }
+
+    size_t size{AlignRecord(HEADER_SIZE + text.size())};
+
+    if (_data && _offset + size > _segment_size) {
+        Seal();
+    }
+
+    if (!_data) {
+        auto now{std::chrono::steady_clock::now()};
+
+        if (now < _retry_at) {
+            return false;
+        }
+
+        if (!Open()) {
+            _retry_at = now + std::chrono::seconds(1);
+
+            return false;
+        }
+    }
+
+    header.size = static_cast<uint32_t>(size);
+    header.text_size = static_cast<uint32_t>(text.size());
+
+    // Хвост выравнивания не заполняется: предвыделенное место уже заполнено нулями.
+    std::memcpy(_data + _offset, &header, HEADER_SIZE);
+    std::memcpy(_data + _offset + HEADER_SIZE, text.data(), text.size());
+    _offset += size;
+
+    if (_prefaulted < _segment_size && _offset + PREFAULT_SIZE / 2 > _prefaulted) {
+        PrefaultAhead();
+    }
+
+    return true;
+}
+
+void SegmentWriter::PrefaultAhead() {
+    size_t size{std::min(PREFAULT_SIZE, _segment_size - _prefaulted)};
+
+    Prefault(_data + _prefaulted, size);
+    _prefaulted += size;
+}
+
+void SegmentWriter::Run() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv.wait(lock, [this]() { return _stop || _preparing; });
+
+            if (_stop) {
+                _preparing = false;
+
+                return;
+            }
+        }
+
+        // Пока _preparing, Open() не создает сегменты сам: _index меняет только этот поток.
+        Mapping next;
+        Create(next, _segment_size);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _next = std::move(next);
+            next.data = nullptr;
+            _preparing = false;
+        }
+
+        _cv.notify_all();
+    }
+}
@@ -0,0 +1,142 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LOGGER_SEGMENT_WRITER_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LOGGER_SEGMENT_WRITER_H
+
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <condition_variable>
+
+#include "binary_log.h"
+#include "../unique_fd/unique_fd.h"
+
+/**
+ * @brief Пишет записи двоичного лога в отображенные в память сегменты.
+ *
+ * Сегменты называются <prefix>.NNNNNN и нумеруются подряд после уже существующих (LogArchiver::GetNextIndex()).
+ * Файл сегмента создается сразу полного размера (posix_fallocate) и отображается через mmap,
+ * поэтому запись — это копирование заголовка и текста в память без системных вызовов.
+ *
+ * Выделение страниц кэша под отображение стоит дороже самого копирования, поэтому следующий сегмент
+ * создается и заполняется целиком (MADV_POPULATE_WRITE) отдельным потоком, пока пишется текущий.
+ * Сегмент, созданный на месте (первый или после ошибки), заполняется блоками PREFAULT_SIZE впереди позиции записи.
+ * Когда очередная запись не помещается, сегмент обрезается до занятого размера и закрывается,
+ * и его место занимает подготовленный. Append() и Rotate() вызываются одним потоком (потоком записи логгера).
+ */
+class SegmentWriter {
+public:
+    /// Тип коллбэка, получающего путь закрытого сегмента.
+    using SealCallback = std::function<void(const std::string&)>;
+
+public:
+    /// Минимальный размер сегмента.
+    static constexpr size_t MIN_SEGMENT_SIZE{size_t{64} << 10};
+
+    /// Максимальный размер сегмента (размер записи хранится в 32 битах).
+    static constexpr size_t MAX_SEGMENT_SIZE{size_t{1} << 30};
+
+    /// Размер блока страниц, заполняемого заранее в сегменте, созданном на месте.
+    static constexpr size_t PREFAULT_SIZE{size_t{1} << 20};
+
+public:
+    /**
+     * @brief Конструктор. Открывает первый сегмент и запускает подготовку следующего.
+     * @param prefix Путь к сегментам без номера.
+     * @param segment_size Размер сегмента (приводится к диапазону [MIN_SEGMENT_SIZE, MAX_SEGMENT_SIZE]).
+     * @param on_sealed Вызывается с путем каждого закрытого сегмента (может быть пустым).
+     * @throws std::invalid_argument Если сегмент не удалось создать.
+     */
+    SegmentWriter(const std::string& prefix, size_t segment_size, SealCallback on_sealed = {});
+
+    /**
+     * @brief Деструктор. Обрезает и закрывает текущий сегмент, удаляет подготовленный.
+     */
+    ~SegmentWriter();
+
+    SegmentWriter(const SegmentWriter&) = delete;
+    SegmentWriter& operator=(const SegmentWriter&) = delete;
+
+    /**
+     * @brief Дописывает запись.
+     *
+     * Текст, не помещающийся даже в пустой сегмент, обрезается (флаг FLAG_TRUNCATED).
+     *
+     * @param header Поля записи (size, text_size и flags заполняются здесь).
+     * @param text Текст записи.
+     * @return true Если запись добавлена.
+     * @return false Если не удалось открыть следующий сегмент (повторная попытка — не чаще раза в секунду).
+     */
+    bool Append(BinaryLog::RecordHeader header, std::string_view text);
+
+    /**
+     * @brief Закрывает текущий сегмент, если в нем есть записи; следующая запись откроет новый.
+     */
+    void Rotate();
+
+private:
+    /**
+     * @brief Созданный и отображенный файл сегмента.
+     */
+    struct Mapping {
+        std::string path; ///< Путь к сегменту.
+        UniqueFD fd; ///< Дескриптор сегмента.
+        char* data{nullptr}; ///< Отображение сегмента (nullptr — сегмента нет).
+    };
+
+private:
+    /**
+     * @brief Делает текущим подготовленный сегмент (или создает новый) и запускает подготовку следующего.
+     * @return true Если сегмент открыт.
+     */
+    bool Open();
+
+    /**
+     * @brief Создает файл сегмента со следующим свободным номером, отображает его и заполняет первые страницы.
+     * @param mapping Созданный сегмент.
+     * @param prefault Сколько байт от начала заполнить заранее.
+     * @return true Если сегмент создан.
+     */
+    bool Create(Mapping& mapping, size_t prefault);
+
+    /**
+     * @brief Заполняет следующий блок страниц текущего сегмента.
+     */
+    void PrefaultAhead();
+
+    /**
+     * @brief Обрезает текущий сегмент до занятого размера, снимает отображение и закрывает файл (пустой — удаляет).
+     */
+    void Seal();
+
+    /**
+     * @brief Цикл потока подготовки: по запросу создает и заполняет следующий сегмент.
+     */
+    void Run();
+
+private:
+    std::string _prefix; ///< Путь к сегментам без номера.
+    size_t _segment_size; ///< Размер сегмента.
+    size_t _index{}; ///< Номер следующего сегмента (Create() вызывается не более чем одним потоком за раз).
+    SealCallback _on_sealed; ///< Коллбэк закрытия сегмента.
+
+    std::string _path; ///< Путь к текущему сегменту.
+    UniqueFD _fd; ///< Дескриптор текущего сегмента.
+    char* _data{nullptr}; ///< Отображение текущего сегмента (nullptr — сегмент не открыт).
+    size_t _offset{}; ///< Занятый размер текущего сегмента.
+    size_t _prefaulted{}; ///< Граница заранее заполненных страниц текущего сегмента.
+    std::chrono::steady_clock::time_point _retry_at{}; ///< Время следующей попытки открыть сегмент после ошибки.
+
+    std::mutex _mutex; ///< Защищает _next, _preparing и _stop.
+    std::condition_variable _cv; ///< Сигнал о запросе подготовки, ее завершении или остановке.
+    Mapping _next; ///< Подготовленный следующий сегмент (data == nullptr — не готов или не удалось создать).
+    bool _preparing{}; ///< Поток подготовки создает следующий сегмент.
+    bool _stop{}; ///< Флаг остановки потока подготовки.
+
+    std::thread _thread; ///< Поток подготовки сегментов.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_LOGGER_SEGMENT_WRITER_H
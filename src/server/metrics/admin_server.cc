@@ -0,0 +1,167 @@
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "admin_server.h"
+
+namespace {
+
+constexpr size_t MAX_REQUEST_SIZE{4096};
+
+std::string MakeHttp(const char* status, const char* content_type, const std::string& body) {
+    std::string response{"HTTP/1.0 "};
+    response += status;
+    response += "\r\nContent-Type: ";
+    response += content_type;
+    response += "\r\nContent-Length: " + std::to_string(body.size());
+    response += "\r\nConnection: close\r\n\r\n";
+    response += body;
+
+    return response;
+}
+
+} // namespace
+
+AdminServer::AdminServer(int port, const Metrics& metrics, const FlowControl& flow, const Logger& logger,
+                         const UpstreamRegistry& upstreams, int wakeup_fd, StopCallback is_stopped) :
+    _metrics(metrics),
+    _flow(flow),
+    _logger(logger),
+    _upstreams(upstreams),
+    _wakeup_fd(wakeup_fd),
+    _is_stopped(std::move(is_stopped))
+{
+    SetupSocket(port);
+}
+
+void AdminServer::SetupSocket(int port) {
+    _listen_fd = UniqueFD(socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+
+    if (!_listen_fd.Valid()) {
+        throw std::runtime_error("AdminServer::SetupSocket(): " + std::string(strerror(errno)));
+    }
+
+    int opt{1};
+
+    if (setsockopt(_listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1) {
+        throw std::runtime_error("AdminServer::SetupSocket(): " + std::string(strerror(errno)));
+    }
+
+    // При обновлении новый процесс занимает порт, пока старый еще завершает сессии.
+    if (setsockopt(_listen_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == -1) {
+        throw std::runtime_error("AdminServer::SetupSocket(): " + std::string(strerror(errno)));
+    }
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+
+    if (bind(_listen_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1) {
+        throw std::runtime_error("AdminServer::SetupSocket(): " + std::string(strerror(errno)));
+    }
+
+    if (listen(_listen_fd, 16) == -1) {
+        throw std::runtime_error("AdminServer::SetupSocket(): " + std::string(strerror(errno)));
+    }
+}
+
+void AdminServer::Run() {
+    while (!_is_stopped()) {
+        struct pollfd fds[2] = {{_listen_fd, POLLIN, 0}, {_wakeup_fd, POLLIN, 0}};
+
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            std::cerr << "AdminServer poll(): " << strerror(errno) << '\n';
+
+            return;
+        }
+
+        if (!(fds[0].revents & POLLIN)) {
+            continue;
+        }
+
+        UniqueFD client_fd(accept4(_listen_fd, nullptr, nullptr, SOCK_CLOEXEC));
+
+        if (!client_fd.Valid()) {
+            continue;
+        }
+
+        HandleClient(client_fd);
+    }
+
+    // Сокет закрывается сразу, не дожидаясь конца остановки: иначе запросы попадали бы в его очередь.
+    _listen_fd.Close();
+}
+
+void AdminServer::HandleClient(int client_fd) {
+    struct timeval timeout = {1, 0};
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char chunk[1024];
+
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_SIZE) {
+        ssize_t n{recv(client_fd, chunk, sizeof(chunk), 0)};
+
+        if (n > 0) {
+            request.append(chunk, n);
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else {
+            break;
+        }
+    }
+
+    if (request.empty()) {
+        return;
+    }
+
+    std::string response{MakeResponse(request)};
+    size_t sent{};
+
+    while (sent < response.size()) {
+        ssize_t n{send(client_fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL)};
+
+        if (n > 0) {
+            sent += n;
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else {
+            break;
+        }
+    }
+}
+
+std::string AdminServer::MakeResponse(const std::string& request) const {
+    // Строка запроса: "<метод> <путь>[?запрос] HTTP/x.y".
+    size_t method_end{request.find(' ')};
+    size_t path_end{method_end == std::string::npos ? method_end : request.find_first_of(" ?\r", method_end + 1)};
+
+    if (path_end == std::string::npos) {
+        return MakeHttp("400 Bad Request", "text/plain", "Bad Request\n");
+    }
+
+    std::string method{request.substr(0, method_end)};
+    std::string path{request.substr(method_end + 1, path_end - method_end - 1)};
+
+    if (path != "/metrics") {
+        return MakeHttp("404 Not Found", "text/plain", "Not Found\n");
+    }
+
+    if (method != "GET") {
+        return MakeHttp("405 Method Not Allowed", "text/plain", "Method Not Allowed\n");
+    }
+
+    return MakeHttp("200 OK", "text/plain; version=0.0.4", _metrics.Render(_flow, _logger, _upstreams));
+}
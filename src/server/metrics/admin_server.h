@@ -0,0 +1,76 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_METRICS_ADMIN_SERVER_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_METRICS_ADMIN_SERVER_H
+
+#include <string>
+#include <functional>
+
+#include "metrics.h"
+#include "../unique_fd/unique_fd.h"
+
+/**
+ * @class AdminServer
+ * @brief HTTP-сервер метрик на отдельном порту.
+ *
+ * Работает в собственном потоке с блокирующим вводом-выводом: принимает соединение, читает запрос
+ * и отвечает текстом Metrics::Render() на `GET /metrics` (404 на остальные пути), после чего закрывает
+ * соединение. Рабочие потоки в обслуживании запроса не участвуют: счетчики читаются без блокировок.
+ * Медленный клиент задерживает только сам admin-сервер (таймаут чтения и записи — 1 секунда).
+ */
+class AdminServer {
+public:
+    /// Тип коллбэка для проверки запроса на остановку.
+    using StopCallback = std::function<bool()>;
+
+public:
+    /**
+     * @brief Конструктор. Создает слушающий сокет.
+     * @param port Порт admin-сервера.
+     * @param metrics Метрики.
+     * @param flow Границы буферизации (для метрик).
+     * @param logger Логгер (для метрик).
+     * @param upstreams Серверы PostgreSQL (для метрик).
+     * @param wakeup_fd Дескриптор, по которому поток пробуждается для проверки остановки.
+     * @param is_stopped Коллбэк, возвращающий true, если работу нужно завершить.
+     * @throw std::runtime_error Если не удалось создать, настроить или привязать сокет.
+     */
+    AdminServer(int port, const Metrics& metrics, const FlowControl& flow, const Logger& logger,
+                const UpstreamRegistry& upstreams, int wakeup_fd, StopCallback is_stopped);
+
+    /**
+     * @brief Обслуживает запросы до запроса на остановку, затем закрывает слушающий сокет.
+     */
+    void Run();
+
+private:
+    /**
+     * @brief Настраивает слушающий сокет.
+     * @param port Порт.
+     * @throw std::runtime_error Если не удалось создать, настроить или привязать сокет.
+     */
+    void SetupSocket(int port);
+
+    /**
+     * @brief Читает запрос клиента и отправляет ответ.
+     * @param client_fd Дескриптор клиента.
+     */
+    void HandleClient(int client_fd);
+
+    /**
+     * @brief Формирует HTTP-ответ на запрос.
+     * @param request Начало запроса (до конца заголовков).
+     * @return std::string HTTP-ответ.
+     */
+    std::string MakeResponse(const std::string& request) const;
+
+private:
+    const Metrics& _metrics; ///< Метрики.
+    const FlowControl& _flow; ///< Границы буферизации.
+    const Logger& _logger; ///< Логгер.
+    const UpstreamRegistry& _upstreams; ///< Серверы PostgreSQL.
+    int _wakeup_fd; ///< Дескриптор пробуждения (принадлежит Server).
+    StopCallback _is_stopped; ///< Коллбэк проверки остановки.
+
+    UniqueFD _listen_fd{}; ///< Слушающий сокет.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_METRICS_ADMIN_SERVER_H
@@ -0,0 +1,45 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_METRICS_COUNTER_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_METRICS_COUNTER_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Счетчик с единственным писателем.
+ *
+ * Счетчик изменяет только рабочий поток-владелец, поэтому обновление — обычные чтение и запись
+ * без lock-префикса, а атомарность нужна только для чтения из потока admin-сервера.
+ * Методы определены в заголовке: они вызываются на каждом recv/send.
+ */
+class Counter {
+public:
+    /**
+     * @brief Увеличивает счетчик.
+     * @param delta Приращение.
+     */
+    void Add(uint64_t delta = 1) noexcept {
+        _value.store(_value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Запоминает значение, если оно больше текущего (максимум).
+     * @param value Наблюдаемое значение.
+     */
+    void Max(uint64_t value) noexcept {
+        if (value > _value.load(std::memory_order_relaxed)) {
+            _value.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Текущее значение.
+     */
+    uint64_t Get() const noexcept {
+        return _value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> _value{}; ///< Значение счетчика.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_METRICS_COUNTER_H
@@ -0,0 +1,355 @@
+#include <cstdio>
+#include <algorithm>
+#include <unordered_map>
+
+#include "metrics.h"
+#include "../buffer/buffer.h"
+#include "../flow/flow_control.h"
+#include "../logger/logger.h"
+#include "../upstream/upstream_registry.h"
+
+namespace {
+
+constexpr char PREFIX[]{"pgproxy_"};
+
+constexpr size_t MAX_REPORTED_FINGERPRINTS{100};
+constexpr size_t MAX_LABEL_TEXT{256};
+constexpr double QUANTILES[]{0.5, 0.99, 0.999};
+
+void AppendHeader(std::string& out, const char* name, const char* type, const char* help) {
+    out += "# HELP ";
+    out += PREFIX;
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += PREFIX;
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void AppendSample(std::string& out, const char* name, const std::string& labels, uint64_t value) {
+    out += PREFIX;
+    out += name;
+
+    if (!labels.empty()) {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+
+    out += ' ';
+    out += std::to_string(value);
+    out += '\n';
+}
+
+void AppendSeconds(std::string& out, const char* name, const std::string& labels, uint64_t value_us) {
+    char value[32];
+    std::snprintf(value, sizeof(value), "%.6f", static_cast<double>(value_us) / 1e6);
+
+    out += PREFIX;
+    out += name;
+
+    if (!labels.empty()) {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+
+    out += ' ';
+    out += value;
+    out += '\n';
+}
+
+void AppendSummary(std::string& out, const char* name, const std::string& labels,
+                   const LatencyHistogram::Snapshot& snapshot, uint64_t count, uint64_t sum_us) {
+    std::string separator{labels.empty() ? "" : ","};
+    std::string sum_name{std::string(name) + "_sum"};
+    std::string count_name{std::string(name) + "_count"};
+
+    for (double quantile : QUANTILES) {
+        char label[32];
+        std::snprintf(label, sizeof(label), "quantile=\"%g\"", quantile);
+
+        AppendSeconds(out, name, labels + separator + label, LatencyHistogram::GetQuantile(snapshot, quantile));
+    }
+
+    AppendSeconds(out, sum_name.c_str(), labels, sum_us);
+    AppendSample(out, count_name.c_str(), labels, count);
+}
+
+std::string EscapeLabel(std::string_view text) {
+    std::string escaped;
+
+    for (char c : text.substr(0, MAX_LABEL_TEXT)) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+
+    return escaped;
+}
+
+std::string GetMessageLabel(size_t type) {
+    if (type == 0) {
+        return "startup";
+    }
+
+    if (type >= 0x20 && type < 0x7f && type != '"' && type != '\\') {
+        return std::string(1, static_cast<char>(type));
+    }
+
+    return std::to_string(type);
+}
+
+} // namespace
+
+Metrics::Metrics(size_t workers, bool latency) {
+    for (size_t id{}; id < workers; ++id) {
+        _workers.push_back(std::make_unique<WorkerMetrics>());
+
+        if (latency) {
+            _latency.push_back(std::make_unique<LatencyStats>());
+        }
+    }
+}
+
+WorkerMetrics& Metrics::GetWorker(size_t id) noexcept {
+    return *_workers[id];
+}
+
+LatencyStats* Metrics::GetLatency(size_t id) noexcept {
+    return id < _latency.size() ? _latency[id].get() : nullptr;
+}
+
+void Metrics::RenderLatency(std::string& out) const {
+    struct Merged {
+        std::string text;
+        LatencyHistogram::Snapshot snapshot;
+        uint64_t count{};
+        uint64_t sum{};
+    };
+
+    LatencyHistogram::Snapshot overall;
+    uint64_t count{};
+    uint64_t sum{};
+
+    std::unordered_map<uint64_t, Merged> merged;
+
+    for (const auto& stats : _latency) {
+        stats->GetOverall().AddTo(overall);
+        count += stats->GetOverall().GetCount();
+        sum += stats->GetOverall().GetSum();
+
+        stats->ForEach([&merged](const LatencyStats::Entry& entry) {
+            Merged& total{merged[entry.fingerprint]};
+
+            if (total.text.empty()) {
+                total.text = entry.text;
+            }
+
+            entry.histogram.AddTo(total.snapshot);
+            total.count += entry.histogram.GetCount();
+            total.sum += entry.histogram.GetSum();
+        });
+    }
+
+    AppendHeader(out, "query_latency_seconds", "summary", "Time from Query/Execute to its completion by the server.");
+    AppendSummary(out, "query_latency_seconds", "", overall, count, sum);
+
+    // Отпечатки с наибольшим суммарным временем: они и показывают, какие запросы нагружают базу.
+    std::vector<std::pair<uint64_t, const Merged*>> top;
+
+    for (const auto& [fingerprint, total] : merged) {
+        top.emplace_back(fingerprint, &total);
+    }
+
+    size_t reported{std::min(top.size(), MAX_REPORTED_FINGERPRINTS)};
+
+    std::partial_sort(top.begin(), top.begin() + reported, top.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.second->sum > rhs.second->sum;
+    });
+
+    top.resize(reported);
+
+    AppendHeader(out, "fingerprint_latency_seconds", "summary", "Query latency by normalized query fingerprint.");
+
+    for (const auto& [fingerprint, total] : top) {
+        char label[48];
+        std::snprintf(label, sizeof(label), "fingerprint=\"%016llx\"", static_cast<unsigned long long>(fingerprint));
+
+        AppendSummary(out, "fingerprint_latency_seconds", label, total->snapshot, total->count, total->sum);
+    }
+
+    AppendHeader(out, "fingerprint_info", "gauge", "Normalized query text of a fingerprint.");
+
+    for (const auto& [fingerprint, total] : top) {
+        char label[48];
+        std::snprintf(label, sizeof(label), "fingerprint=\"%016llx\"", static_cast<unsigned long long>(fingerprint));
+
+        AppendSample(out, "fingerprint_info", std::string(label) + ",query=\"" + EscapeLabel(total->text) + "\"", 1);
+    }
+}
+
+std::string Metrics::Render(const FlowControl& flow, const Logger& logger, const UpstreamRegistry& upstreams) const {
+    auto sum{[this](Counter WorkerMetrics::*counter) {
+        uint64_t total{};
+
+        for (const auto& worker : _workers) {
+            total += ((*worker).*counter).Get();
+        }
+
+        return total;
+    }};
+
+    auto max{[this](Counter WorkerMetrics::*counter) {
+        uint64_t peak{};
+
+        for (const auto& worker : _workers) {
+            peak = std::max(peak, ((*worker).*counter).Get());
+        }
+
+        return peak;
+    }};
+
+    std::string out;
+    out.reserve(4096);
+
+    uint64_t accepted{sum(&WorkerMetrics::connections_accepted)};
+    uint64_t closed{sum(&WorkerMetrics::connections_closed)};
+
+    AppendHeader(out, "connections_accepted_total", "counter", "Client connections accepted.");
+    AppendSample(out, "connections_accepted_total", "", accepted);
+
+    AppendHeader(out, "connections_closed_total", "counter", "Client sessions closed.");
+    AppendSample(out, "connections_closed_total", "", closed);
+
+    AppendHeader(out, "sessions_active", "gauge", "Open client sessions.");
+    AppendSample(out, "sessions_active", "", accepted >= closed ? accepted - closed : 0);
+
+    AppendHeader(out, "session_timeouts_total", "counter", "Client sessions closed by a timeout.");
+    AppendSample(out, "session_timeouts_total", "reason=\"connect\"", sum(&WorkerMetrics::connect_timeouts));
+    AppendSample(out, "session_timeouts_total", "reason=\"query\"", sum(&WorkerMetrics::query_timeouts));
+    AppendSample(out, "session_timeouts_total", "reason=\"idle\"", sum(&WorkerMetrics::idle_timeouts));
+
+    AppendHeader(out, "tls_handshakes_total", "counter", "Client TLS handshakes terminated by the proxy.");
+    AppendSample(out, "tls_handshakes_total", "result=\"ok\"", sum(&WorkerMetrics::tls_handshakes));
+    AppendSample(out, "tls_handshakes_total", "result=\"error\"", sum(&WorkerMetrics::tls_failures));
+
+    AppendHeader(out, "tls_kernel_send_total", "counter", "Client TLS sessions with kernel TLS (kTLS) send offload.");
+    AppendSample(out, "tls_kernel_send_total", "", sum(&WorkerMetrics::tls_kernel_send));
+
+    AppendHeader(out, "tls_kernel_recv_total", "counter",
+                 "Client TLS sessions with kernel TLS (kTLS) receive offload.");
+    AppendSample(out, "tls_kernel_recv_total", "", sum(&WorkerMetrics::tls_kernel_recv));
+
+    AppendHeader(out, "received_bytes_total", "counter", "Bytes read from sockets.");
+    AppendSample(out, "received_bytes_total", "peer=\"client\"", sum(&WorkerMetrics::bytes_from_client));
+    AppendSample(out, "received_bytes_total", "peer=\"pgsql\"", sum(&WorkerMetrics::bytes_from_pgsql));
+
+    AppendHeader(out, "sent_bytes_total", "counter", "Bytes written to sockets.");
+    AppendSample(out, "sent_bytes_total", "peer=\"client\"", sum(&WorkerMetrics::bytes_to_client));
+    AppendSample(out, "sent_bytes_total", "peer=\"pgsql\"", sum(&WorkerMetrics::bytes_to_pgsql));
+
+    AppendHeader(out, "eagain_total", "counter", "Socket operations that returned EAGAIN.");
+    AppendSample(out, "eagain_total", "op=\"recv\"", sum(&WorkerMetrics::recv_eagain));
+    AppendSample(out, "eagain_total", "op=\"send\"", sum(&WorkerMetrics::send_eagain));
+
+    AppendHeader(out, "queue_peak_bytes", "gauge", "Largest send queue of a session since start.");
+    AppendSample(out, "queue_peak_bytes", "peer=\"client\"", max(&WorkerMetrics::client_queue_peak));
+    AppendSample(out, "queue_peak_bytes", "peer=\"pgsql\"", max(&WorkerMetrics::pgsql_queue_peak));
+
+    AppendHeader(out, "buffer_allocated_bytes", "gauge", "Memory held by session buffers.");
+    AppendSample(out, "buffer_allocated_bytes", "", Buffer::GetAllocatedBytes());
+
+    AppendHeader(out, "sessions_throttled", "gauge", "Sessions with reading paused by backpressure.");
+    AppendSample(out, "sessions_throttled", "", flow.GetThrottled());
+
+    AppendHeader(out, "backend_assignments_total", "counter", "Pooled backend connections handed to sessions.");
+    AppendSample(out, "backend_assignments_total", "role=\"primary\"", sum(&WorkerMetrics::primary_assignments));
+    AppendSample(out, "backend_assignments_total", "role=\"replica\"", sum(&WorkerMetrics::replica_assignments));
+
+    AppendHeader(out, "upstream_healthy", "gauge", "Whether a PostgreSQL server is accepting new sessions.");
+
+    for (size_t node{}; node < upstreams.GetSize(); ++node) {
+        const char* role{upstreams.GetRole(node) == UpstreamRole::K_REPLICA ? "replica" : "primary"};
+
+        AppendSample(out, "upstream_healthy", "upstream=\"" + upstreams.GetName(node) + "\",role=\"" + role + "\"",
+                     upstreams.IsHealthy(node) ? 1 : 0);
+    }
+
+    AppendHeader(out, "upstream_failures_total", "counter", "Failed connections and health checks by server.");
+
+    for (size_t node{}; node < upstreams.GetSize(); ++node) {
+        AppendSample(out, "upstream_failures_total", "upstream=\"" + upstreams.GetName(node) + "\"",
+                     upstreams.GetFailures(node));
+    }
+
+    AppendHeader(out, "upstream_unavailable_total", "counter", "Sessions refused with no healthy server.");
+    AppendSample(out, "upstream_unavailable_total", "", sum(&WorkerMetrics::upstream_unavailable));
+
+    uint64_t cache_stored{sum(&WorkerMetrics::result_cache_stored_bytes)};
+    uint64_t cache_released{sum(&WorkerMetrics::result_cache_released_bytes)};
+
+    AppendHeader(out, "result_cache_requests_total", "counter", "Cacheable queries by result cache outcome.");
+    AppendSample(out, "result_cache_requests_total", "result=\"hit\"", sum(&WorkerMetrics::result_cache_hits));
+    AppendSample(out, "result_cache_requests_total", "result=\"miss\"", sum(&WorkerMetrics::result_cache_misses));
+
+    AppendHeader(out, "result_cache_evictions_total", "counter", "Result cache entries evicted to make room.");
+    AppendSample(out, "result_cache_evictions_total", "", sum(&WorkerMetrics::result_cache_evictions));
+
+    AppendHeader(out, "result_cache_invalidations_total", "counter", "Table writes that invalidated cached results.");
+    AppendSample(out, "result_cache_invalidations_total", "", sum(&WorkerMetrics::result_cache_invalidations));
+
+    AppendHeader(out, "result_cache_bytes", "gauge", "Memory held by result cache entries.");
+    AppendSample(out, "result_cache_bytes", "", cache_stored >= cache_released ? cache_stored - cache_released : 0);
+
+    AppendHeader(out, "client_messages_total", "counter", "Client protocol messages by type.");
+
+    for (size_t type{}; type < std::tuple_size<decltype(WorkerMetrics::client_messages)>::value; ++type) {
+        uint64_t count{};
+
+        for (const auto& worker : _workers) {
+            count += worker->client_messages[type].Get();
+        }
+
+        if (count > 0) {
+            AppendSample(out, "client_messages_total", "type=\"" + GetMessageLabel(type) + "\"", count);
+        }
+    }
+
+    AppendHeader(out, "poll_events_per_wakeup", "histogram", "Events returned by one event loop wakeup.");
+
+    uint64_t wakeups{};
+
+    for (size_t bucket{}; bucket < WorkerMetrics::WAKEUP_BUCKETS; ++bucket) {
+        for (const auto& worker : _workers) {
+            wakeups += worker->wakeups[bucket].Get();
+        }
+
+        // Последняя корзина открыта сверху.
+        std::string le{bucket + 1 == WorkerMetrics::WAKEUP_BUCKETS ? "+Inf"
+                       : std::to_string(bucket == 0 ? 0 : size_t{1} << (bucket - 1))};
+
+        AppendSample(out, "poll_events_per_wakeup_bucket", "le=\"" + le + "\"", wakeups);
+    }
+
+    AppendSample(out, "poll_events_per_wakeup_sum", "", sum(&WorkerMetrics::wakeup_events));
+    AppendSample(out, "poll_events_per_wakeup_count", "", wakeups);
+
+    AppendHeader(out, "log_dropped_total", "counter", "Query log records dropped on queue overflow.");
+    AppendSample(out, "log_dropped_total", "", logger.GetDroppedCount());
+
+    if (!_latency.empty()) {
+        RenderLatency(out);
+    }
+
+    return out;
+}
@@ -0,0 +1,141 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_METRICS_METRICS_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_METRICS_METRICS_H
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "counter.h"
+#include "../latency/latency_stats.h"
+
+class Logger;
+class FlowControl;
+class UpstreamRegistry;
+
+/// Размер кеш-линии, по которому выравниваются счетчики рабочих потоков.
+constexpr size_t METRICS_CACHE_LINE{64};
+
+/**
+ * @brief Счетчики одного рабочего потока.
+ *
+ * Структура выровнена по кеш-линии, поэтому счетчики разных рабочих потоков не разделяют линий
+ * и не вызывают ложного разделения.
+ */
+struct alignas(METRICS_CACHE_LINE) WorkerMetrics {
+    /// Корзины гистограммы событий за пробуждение: 0, 1, 2, 4, ..., 512 и +Inf.
+    static constexpr size_t WAKEUP_BUCKETS{12};
+
+    Counter connections_accepted; ///< Принятые клиентские соединения.
+    Counter connections_closed; ///< Закрытые сессии.
+
+    Counter connect_timeouts; ///< Сессии, закрытые по таймауту подключения к PostgreSQL.
+    Counter query_timeouts; ///< Сессии, закрытые по таймауту запроса.
+    Counter idle_timeouts; ///< Сессии, закрытые по таймауту простоя.
+
+    Counter tls_handshakes; ///< Завершенные рукопожатия TLS с клиентами.
+    Counter tls_failures; ///< Рукопожатия TLS с клиентами, завершившиеся ошибкой.
+    Counter tls_kernel_send; ///< Клиентские TLS-сессии, отправку которых шифрует ядро (kTLS).
+    Counter tls_kernel_recv; ///< Клиентские TLS-сессии, прием которых расшифровывает ядро (kTLS).
+
+    Counter bytes_from_client; ///< Байты, прочитанные у клиентов.
+    Counter bytes_to_client; ///< Байты, отправленные клиентам.
+    Counter bytes_from_pgsql; ///< Байты, прочитанные у PostgreSQL.
+    Counter bytes_to_pgsql; ///< Байты, отправленные в PostgreSQL.
+
+    Counter recv_eagain; ///< Чтения, завершившиеся EAGAIN.
+    Counter send_eagain; ///< Записи, завершившиеся EAGAIN (получатель не успевает).
+
+    Counter client_queue_peak; ///< Максимальная очередь к клиенту в байтах.
+    Counter pgsql_queue_peak; ///< Максимальная очередь к PostgreSQL в байтах.
+
+    Counter primary_assignments; ///< Соединения с основным сервером, выданные сессиям из пула.
+    Counter replica_assignments; ///< Соединения с репликами, выданные сессиям из пула.
+    Counter upstream_unavailable; ///< Сессии, закрытые из-за отсутствия исправных серверов PostgreSQL.
+
+    Counter result_cache_hits; ///< Запросы, на которые ответил кэш результатов.
+    Counter result_cache_misses; ///< Кэшируемые запросы, отправленные в PostgreSQL.
+    Counter result_cache_evictions; ///< Записи кэша, вытесненные по объему.
+    Counter result_cache_invalidations; ///< Изменения таблиц, отмеченные для кэша.
+    Counter result_cache_stored_bytes; ///< Объем сохраненных в кэш записей (нарастающий итог).
+    Counter result_cache_released_bytes; ///< Объем удаленных из кэша записей (нарастающий итог).
+
+    Counter wakeup_events; ///< Сумма событий по всем пробуждениям.
+    std::array<Counter, WAKEUP_BUCKETS> wakeups; ///< Пробуждения по количеству событий (корзины).
+
+    std::array<Counter, 128> client_messages; ///< Сообщения клиентов по типу (байт типа, '\0' — этап запуска).
+
+    /**
+     * @brief Учитывает пробуждение цикла событий.
+     * @param events Количество полученных событий.
+     */
+    void OnWakeup(size_t events) noexcept {
+        // Корзина i (i > 0) содержит пробуждения с событиями в (2^(i-2), 2^(i-1)].
+        size_t bucket{events == 0 ? 0 : events == 1 ? 1 : 65 - static_cast<size_t>(__builtin_clzll(events - 1))};
+
+        wakeups[bucket < WAKEUP_BUCKETS ? bucket : WAKEUP_BUCKETS - 1].Add();
+        wakeup_events.Add(events);
+    }
+
+    /**
+     * @brief Учитывает сообщение клиента.
+     * @param type Байт типа сообщения.
+     */
+    void OnClientMessage(char type) noexcept {
+        client_messages[static_cast<unsigned char>(type) & 0x7f].Add();
+    }
+};
+
+/**
+ * @brief Метрики прокси-сервера.
+ *
+ * Владеет счетчиками рабочих потоков и формирует из них текст в формате Prometheus.
+ * Рабочие потоки пишут только в свои WorkerMetrics и LatencyStats; Render() вызывается потоком
+ * admin-сервера, читает счетчики без блокировок и суммирует их по рабочим потокам.
+ */
+class Metrics {
+public:
+    /**
+     * @brief Конструктор.
+     * @param workers Количество рабочих потоков.
+     * @param latency Создать статистику задержек запросов для рабочих потоков.
+     */
+    Metrics(size_t workers, bool latency);
+
+    /**
+     * @brief Счетчики рабочего потока.
+     * @param id Порядковый номер рабочего потока.
+     */
+    WorkerMetrics& GetWorker(size_t id) noexcept;
+
+    /**
+     * @brief Статистика задержек рабочего потока.
+     * @param id Порядковый номер рабочего потока.
+     * @return LatencyStats* Статистика или nullptr, если задержки не измеряются.
+     */
+    LatencyStats* GetLatency(size_t id) noexcept;
+
+    /**
+     * @brief Формирует текст метрик в формате Prometheus (text exposition 0.0.4).
+     * @param flow Границы буферизации (количество приостановленных сессий).
+     * @param logger Логгер (количество отброшенных записей).
+     * @param upstreams Серверы PostgreSQL (исправность и ошибки подключения).
+     * @return std::string Текст метрик.
+     */
+    std::string Render(const FlowControl& flow, const Logger& logger, const UpstreamRegistry& upstreams) const;
+
+private:
+    /**
+     * @brief Добавляет к тексту метрик сводки задержек: общую и по отпечаткам запросов.
+     * @param out Текст метрик.
+     */
+    void RenderLatency(std::string& out) const;
+
+private:
+    std::vector<std::unique_ptr<WorkerMetrics>> _workers; ///< Счетчики рабочих потоков.
+    std::vector<std::unique_ptr<LatencyStats>> _latency; ///< Статистика задержек (пусто, если выключена).
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_METRICS_METRICS_H
@@ -0,0 +1,339 @@
+#include <thread>
+#include <cstdint>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+
+#include "options.h"
+
+namespace {
+
+size_t ParseCount(const std::string& name, const std::string& value) {
+    size_t pos{};
+    long long count{};
+
+    try {
+        count = std::stoll(value, &pos);
+    } catch (const std::exception&) {
+        pos = 0;
+    }
+
+    if (pos != value.size() || count <= 0) {
+        throw std::invalid_argument("Invalid value for " + name + ": " + value);
+    }
+
+    return static_cast<size_t>(count);
+}
+
+size_t ParseSize(const std::string& name, const std::string& value) {
+    // Суффиксы K, M, G — двоичные кратные (KiB, MiB, GiB).
+    std::string digits{value};
+    size_t multiplier{1};
+
+    if (!digits.empty()) {
+        switch (digits.back()) {
+            case 'K': case 'k': multiplier = size_t{1} << 10; break;
+            case 'M': case 'm': multiplier = size_t{1} << 20; break;
+            case 'G': case 'g': multiplier = size_t{1} << 30; break;
+            default: break;
+        }
+
+        if (multiplier > 1) {
+            digits.pop_back();
+        }
+    }
+
+    size_t count{ParseCount(name, digits.empty() ? value : digits)};
+
+    if (count > SIZE_MAX / multiplier) {
+        throw std::invalid_argument("Invalid value for " + name + ": " + value);
+    }
+
+    return count * multiplier;
+}
+
+int ParsePort(const std::string& name, const std::string& value) {
+    size_t port{ParseCount(name, value)};
+
+    if (port > 65535) {
+        throw std::invalid_argument("Invalid value for " + name + ": " + value);
+    }
+
+    return static_cast<int>(port);
+}
+
+IoEngine ParseIoEngine(const std::string& name, const std::string& value) {
+    if (value == "epoll") {
+        return IoEngine::K_EPOLL;
+    } else if (value == "io_uring") {
+        return IoEngine::K_IO_URING;
+    }
+
+    throw std::invalid_argument("Invalid value for " + name + ": " + value);
+}
+
+OverflowPolicy ParseOverflowPolicy(const std::string& name, const std::string& value) {
+    if (value == "drop") {
+        return OverflowPolicy::K_DROP;
+    } else if (value == "block") {
+        return OverflowPolicy::K_BLOCK;
+    }
+
+    throw std::invalid_argument("Invalid value for " + name + ": " + value);
+}
+
+LogFormat ParseLogFormat(const std::string& name, const std::string& value) {
+    if (value == "text") {
+        return LogFormat::K_TEXT;
+    } else if (value == "binary") {
+        return LogFormat::K_BINARY;
+    }
+
+    throw std::invalid_argument("Invalid value for " + name + ": " + value);
+}
+
+TimePrecision ParseTimePrecision(const std::string& name, const std::string& value) {
+    if (value == "s") {
+        return TimePrecision::K_SECONDS;
+    } else if (value == "ms") {
+        return TimePrecision::K_MILLISECONDS;
+    } else if (value == "us") {
+        return TimePrecision::K_MICROSECONDS;
+    }
+
+    throw std::invalid_argument("Invalid value for " + name + ": " + value);
+}
+
+LogMode ParseLogMode(const std::string& name, const std::string& value) {
+    if (value == "raw") {
+        return LogMode::K_RAW;
+    } else if (value == "summary") {
+        return LogMode::K_SUMMARY;
+    } else if (value == "sample") {
+        return LogMode::K_SAMPLE;
+    }
+
+    throw std::invalid_argument("Invalid value for " + name + ": " + value);
+}
+
+UpstreamAddress ParseAddress(const std::string& name, const std::string& value) {
+    size_t colon{value.rfind(':')};
+    in_addr address{};
+
+    if (colon == std::string::npos || inet_pton(AF_INET, value.substr(0, colon).c_str(), &address) <= 0) {
+        throw std::invalid_argument("Invalid value for " + name + ": " + value);
+    }
+
+    size_t port{ParseCount(name, value.substr(colon + 1))};
+
+    if (port > 65535) {
+        throw std::invalid_argument("Invalid value for " + name + ": " + value);
+    }
+
+    return UpstreamAddress{value.substr(0, colon), static_cast<int>(port)};
+}
+
+PoolMode ParsePoolMode(const std::string& name, const std::string& value) {
+    if (value == "none") {
+        return PoolMode::K_NONE;
+    } else if (value == "transaction") {
+        return PoolMode::K_TRANSACTION;
+    }
+
+    throw std::invalid_argument("Invalid value for " + name + ": " + value);
+}
+
+} // namespace
+
+Options ParseOptions(int argc, char* argv[]) {
+    if (argc < 5) {
+        throw std::invalid_argument(GetUsage(argc > 0 ? argv[0] : "server"));
+    }
+
+    Options options;
+    options.listen_port = std::stoi(argv[1]);
+    options.db_host = argv[2];
+    options.db_port = std::stoi(argv[3]);
+    options.log.path = argv[4];
+
+    unsigned cores{std::thread::hardware_concurrency()};
+    options.workers = cores > 0 ? cores : 1;
+
+    for (int i{5}; i < argc; ++i) {
+        std::string name{argv[i]};
+
+        if (name == "--splice") {
+            options.splice = true;
+
+            continue;
+        } else if (name == "--log-params") {
+            options.log_params = true;
+
+            continue;
+        } else if (name == "--latency") {
+            options.latency = true;
+
+            continue;
+        } else if (name == "--log-latency") {
+            options.latency = true;
+            options.log_latency = true;
+
+            continue;
+        } else if (name == "--log-compress") {
+            options.log.compress = true;
+
+            continue;
+        } else if (name == "--backend-tls") {
+            options.tls.backend = true;
+
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing value for " + name);
+        }
+
+        std::string value{argv[++i]};
+
+        if (name == "--workers") {
+            options.workers = ParseCount(name, value);
+        } else if (name == "--connect-timeout") {
+            options.connect_timeout_ms = ParseCount(name, value);
+        } else if (name == "--idle-timeout") {
+            options.idle_timeout_ms = ParseCount(name, value);
+        } else if (name == "--query-timeout") {
+            options.query_timeout_ms = ParseCount(name, value);
+        } else if (name == "--io-engine") {
+            options.io_engine = ParseIoEngine(name, value);
+        } else if (name == "--log-queue") {
+            options.log.queue_size = ParseCount(name, value);
+        } else if (name == "--log-overflow") {
+            options.log.overflow = ParseOverflowPolicy(name, value);
+        } else if (name == "--log-format") {
+            options.log.format = ParseLogFormat(name, value);
+        } else if (name == "--log-segment-size") {
+            options.log.segment_size = ParseSize(name, value);
+        } else if (name == "--log-rotate-size") {
+            options.log.rotate_size = ParseSize(name, value);
+        } else if (name == "--log-rotate-interval") {
+            options.log.rotate_interval_s = ParseCount(name, value);
+        } else if (name == "--log-max-files") {
+            options.log.max_files = ParseCount(name, value);
+        } else if (name == "--log-timestamp") {
+            options.log.time_precision = ParseTimePrecision(name, value);
+        } else if (name == "--log-mode") {
+            options.log.mode = ParseLogMode(name, value);
+        } else if (name == "--log-sample") {
+            options.log.sample_rate = ParseCount(name, value);
+        } else if (name == "--summary-interval") {
+            options.log.summary_interval_s = ParseCount(name, value);
+        } else if (name == "--pool-mode") {
+            options.pool_mode = ParsePoolMode(name, value);
+        } else if (name == "--pool-size") {
+            options.pool_size = ParseCount(name, value);
+        } else if (name == "--pool-idle-timeout") {
+            options.pool_idle_timeout_ms = ParseCount(name, value);
+        } else if (name == "--high-watermark") {
+            options.flow.high_watermark = ParseSize(name, value);
+        } else if (name == "--low-watermark") {
+            options.flow.low_watermark = ParseSize(name, value);
+        } else if (name == "--memory-budget") {
+            options.flow.memory_budget = ParseSize(name, value);
+        } else if (name == "--admin-port") {
+            options.admin_port = ParsePort(name, value);
+        } else if (name == "--drain-timeout") {
+            options.drain_timeout_ms = ParseCount(name, value);
+        } else if (name == "--upgrade-socket") {
+            options.upgrade_socket = value;
+        } else if (name == "--tls-cert") {
+            options.tls.cert_file = value;
+        } else if (name == "--tls-key") {
+            options.tls.key_file = value;
+        } else if (name == "--backend-tls-ca") {
+            options.tls.backend = true;
+            options.tls.backend_ca_file = value;
+        } else if (name == "--result-cache") {
+            options.cache.max_bytes = ParseSize(name, value);
+        } else if (name == "--result-cache-ttl") {
+            options.cache.ttl_ms = ParseCount(name, value);
+        } else if (name == "--upstream") {
+            options.upstreams.push_back(ParseAddress(name, value));
+        } else if (name == "--replica") {
+            options.replicas.push_back(ParseAddress(name, value));
+        } else if (name == "--health-interval") {
+            options.health.interval_ms = ParseCount(name, value);
+        } else if (name == "--health-user") {
+            options.health.user = value;
+        } else if (name == "--eject-failures") {
+            options.health.eject_failures = ParseCount(name, value);
+        } else {
+            throw std::invalid_argument("Unknown option: " + name);
+        }
+    }
+
+    if (options.flow.low_watermark >= options.flow.high_watermark) {
+        throw std::invalid_argument("--low-watermark must be less than --high-watermark");
+    }
+
+    if (options.tls.cert_file.empty() != options.tls.key_file.empty()) {
+        throw std::invalid_argument("--tls-cert and --tls-key must be given together");
+    }
+
+    // Без пула соединение выдается на всю сессию, и запросы одной сессии не разделить между серверами.
+    if (!options.replicas.empty() && options.pool_mode != PoolMode::K_TRANSACTION) {
+        throw std::invalid_argument("--replica requires --pool-mode transaction");
+    }
+
+    if (options.health.eject_failures == 0) {
+        throw std::invalid_argument("--eject-failures must be positive");
+    }
+
+    return options;
+}
+
+std::string GetUsage(const std::string& program) {
+    return "Usage: " + program + " <listen port> <database host> <database port> <log file> [options]\n"
+           "Options:\n"
+           "  --workers N             number of worker threads (default: number of cores)\n"
+           "  --connect-timeout MS    PostgreSQL connect timeout in milliseconds (default: 5000)\n"
+           "  --idle-timeout MS       close sessions idle (no traffic, no query running) for MS (default: off)\n"
+           "  --query-timeout MS      close sessions waiting longer than MS for a query to finish (default: off)\n"
+           "  --splice                forward PostgreSQL responses to clients with splice()\n"
+           "  --io-engine ENGINE      event loop engine: epoll or io_uring (default: epoll)\n"
+           "  --log-queue N           query log queue size in records (default: 16384)\n"
+           "  --log-overflow POLICY   when the log queue is full: block or drop (default: block)\n"
+           "  --log-format FORMAT     query log format: text or binary mmap'd segments (default: text)\n"
+           "  --log-segment-size SIZE size of a binary log segment file (default: 64M)\n"
+           "  --log-rotate-size SIZE  rotate the text log when it reaches SIZE (default: off)\n"
+           "  --log-rotate-interval S rotate the log every S seconds (default: off)\n"
+           "  --log-compress          gzip rotated log files in the background\n"
+           "  --log-max-files N       keep at most N rotated log files (default: unlimited)\n"
+           "  --log-timestamp UNIT    timestamp precision in the log and terminal: s, ms or us (default: s)\n"
+           "  --log-mode MODE         query log: raw, summary or sample (default: raw)\n"
+           "  --log-sample N          in sample mode, log every Nth query of a worker in full (default: 100)\n"
+           "  --summary-interval S    write query fingerprint summaries every S seconds (default: 60)\n"
+           "  --log-params            log bind parameters of prepared statements\n"
+           "  --latency               measure query latency (histograms on the metrics endpoint)\n"
+           "  --log-latency           log queries on completion with their latency (implies --latency)\n"
+           "  --pool-mode MODE        backend connection pooling: none or transaction (default: none)\n"
+           "  --pool-size N           pooled connections per user/database in each worker (default: 20)\n"
+           "  --pool-idle-timeout MS  close pooled connections idle for this long (default: 60000)\n"
+           "  --high-watermark SIZE   stop reading a socket when its peer's queue reaches SIZE (default: 1M)\n"
+           "  --low-watermark SIZE    resume reading when the queue drains to SIZE (default: 256K)\n"
+           "  --memory-budget SIZE    buffer memory limit across all sessions (default: 256M)\n"
+           "  --admin-port PORT       serve Prometheus metrics at http://<host>:PORT/metrics (default: off)\n"
+           "  --drain-timeout MS      on SIGINT/SIGTERM, wait this long for transactions to finish (default: 30000)\n"
+           "  --upgrade-socket PATH   hand listening sockets over to a new process started with the same PATH\n"
+           "  --tls-cert PATH         terminate client TLS (SSLRequest) with this PEM certificate chain\n"
+           "  --tls-key PATH          PEM private key of --tls-cert\n"
+           "  --backend-tls           connect to PostgreSQL over TLS (the server must accept SSLRequest)\n"
+           "  --backend-tls-ca PATH   verify the PostgreSQL certificate against PEM CAs (implies --backend-tls)\n"
+           "  --result-cache SIZE     cache results of read-only queries, SIZE split across workers (default: off)\n"
+           "  --result-cache-ttl MS   serve a cached result for at most MS milliseconds (default: 1000)\n"
+           "  --replica HOST:PORT     send read-only queries outside transactions to this replica (repeatable,\n"
+           "                          requires --pool-mode transaction)\n"
+           "  --upstream HOST:PORT    another primary server; sessions go to the least loaded one (repeatable)\n"
+           "  --health-interval MS    probe every server this often and eject failing ones (default: off)\n"
+           "  --health-user NAME      user and database of the probe startup message (default: postgres)\n"
+           "  --eject-failures N      eject a server after N consecutive failures (default: 3)\n";
+}
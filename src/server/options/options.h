@@ -0,0 +1,71 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_OPTIONS_OPTIONS_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_OPTIONS_OPTIONS_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "../pool/pool.h"
+#include "../flow/flow_control.h"
+#include "../poller/poller.h"
+#include "../logger/logger.h"
+#include "../tls/tls_context.h"
+#include "../cache/result_cache.h"
+#include "../upstream/health_checker.h"
+#include "../upstream/upstream_registry.h"
+
+/**
+ * @brief Параметры запуска прокси-сервера.
+ *
+ * Обязательные параметры задаются позиционно, дополнительные — флагами вида `--name value`
+ * или `--name` для логических параметров.
+ */
+struct Options {
+    int listen_port{}; ///< Порт для прослушивания клиентских соединений.
+    std::string db_host; ///< IP-адрес хоста PostgreSQL.
+    int db_port{}; ///< Порт PostgreSQL.
+    LogOptions log; ///< Параметры логирования запросов (путь к файлу, очередь).
+
+    size_t workers{}; ///< Количество рабочих потоков (по умолчанию — число ядер).
+    size_t connect_timeout_ms{5000}; ///< Таймаут подключения к PostgreSQL в миллисекундах.
+    size_t idle_timeout_ms{}; ///< Закрывать сессии, простаивающие дольше (0 — не закрывать).
+    size_t query_timeout_ms{}; ///< Закрывать сессии, запрос которых выполняется дольше (0 — не закрывать).
+    bool splice{false}; ///< Пересылать ответы PostgreSQL клиенту через splice().
+    bool log_params{false}; ///< Логировать параметры Bind вместе с запросом.
+    bool latency{false}; ///< Измерять задержки запросов (гистограммы в метриках).
+    bool log_latency{false}; ///< Логировать запрос по завершении вместе с задержкой.
+    PoolMode pool_mode{PoolMode::K_NONE}; ///< Режим пула соединений с PostgreSQL.
+    size_t pool_size{20}; ///< Максимум соединений на (user, database) в каждом рабочем потоке.
+    size_t pool_idle_timeout_ms{60000}; ///< Время простоя соединения в пуле до закрытия в миллисекундах.
+    IoEngine io_engine{IoEngine::K_EPOLL}; ///< Механизм ввода-вывода цикла событий.
+    FlowOptions flow; ///< Границы буферизации сессий.
+    int admin_port{}; ///< Порт HTTP-сервера метрик (0 — выключен).
+    size_t drain_timeout_ms{30000}; ///< Сколько ждать завершения транзакций при плавной остановке.
+    std::string upgrade_socket; ///< UNIX-сокет для передачи слушающих сокетов при обновлении (пусто — выключено).
+    TlsOptions tls; ///< Завершение TLS клиентов и шифрование соединений с PostgreSQL.
+    CacheOptions cache; ///< Кэш результатов читающих запросов.
+    std::vector<UpstreamAddress> upstreams; ///< Дополнительные основные серверы, между которыми делятся сессии.
+    std::vector<UpstreamAddress> replicas; ///< Реплики для читающих запросов (только в режиме пула).
+    HealthOptions health; ///< Проверка исправности серверов и исключение неисправных.
+};
+
+/**
+ * @brief Разбирает аргументы командной строки.
+ *
+ * Формат: `<listen port> <database host> <database port> <log file> [options]`.
+ *
+ * @param argc Количество аргументов.
+ * @param argv Массив аргументов.
+ * @return Options Заполненная структура параметров.
+ * @throw std::invalid_argument Если аргументы некорректны.
+ */
+Options ParseOptions(int argc, char* argv[]);
+
+/**
+ * @brief Возвращает строку с описанием использования программы.
+ * @param program Имя исполняемого файла.
+ * @return std::string Текст подсказки.
+ */
+std::string GetUsage(const std::string& program);
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_OPTIONS_OPTIONS_H
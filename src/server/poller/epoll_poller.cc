@@ -0,0 +1,55 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "epoll_poller.h"
+
+EpollPoller::EpollPoller() :
+    _epoll_fd(epoll_create1(EPOLL_CLOEXEC))
+{
+    if (!_epoll_fd.Valid()) {
+        throw std::runtime_error("EpollPoller(): " + std::string(strerror(errno)));
+    }
+}
+
+bool EpollPoller::Add(int fd, uint32_t events, uint64_t data) {
+    epoll_event event;
+    event.events = events;
+    event.data.u64 = data;
+
+    return epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+void EpollPoller::Modify(int fd, uint32_t events, uint64_t data) {
+    epoll_event event;
+    event.events = events;
+    event.data.u64 = data;
+
+    epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, fd, &event);
+}
+
+void EpollPoller::Remove(int fd) {
+    epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+int EpollPoller::Wait(Event* events, int max, int timeout_ms) {
+    if (_events.size() < static_cast<size_t>(max)) {
+        _events.resize(max);
+    }
+
+    int num_events{epoll_wait(_epoll_fd, _events.data(), max, timeout_ms)};
+
+    for (int i{}; i < num_events; ++i) {
+        events[i].data = _events[i].data.u64;
+        events[i].events = _events[i].events;
+        events[i].accepted = -1;
+        events[i].received = nullptr;
+        events[i].block = nullptr;
+        events[i].sent = false;
+    }
+
+    return num_events;
+}
+
+std::string EpollPoller::GetName() const {
+    return "epoll";
+}
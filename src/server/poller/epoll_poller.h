@@ -0,0 +1,33 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_POLLER_EPOLL_POLLER_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_POLLER_EPOLL_POLLER_H
+
+#include <vector>
+
+#include <sys/epoll.h>
+
+#include "poller.h"
+#include "../unique_fd/unique_fd.h"
+
+/**
+ * @brief Poller на основе epoll.
+ */
+class EpollPoller : public Poller {
+public:
+    /**
+     * @brief Создает epoll-дескриптор.
+     * @throw std::runtime_error Если epoll не удалось создать.
+     */
+    EpollPoller();
+
+    bool Add(int fd, uint32_t events, uint64_t data) override;
+    void Modify(int fd, uint32_t events, uint64_t data) override;
+    void Remove(int fd) override;
+    int Wait(Event* events, int max, int timeout_ms) override;
+    std::string GetName() const override;
+
+private:
+    UniqueFD _epoll_fd{}; ///< Файловый дескриптор epoll.
+    std::vector<epoll_event> _events; ///< Буфер для epoll_wait.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_POLLER_EPOLL_POLLER_H
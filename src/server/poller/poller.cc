@@ -0,0 +1,35 @@
+#include <cerrno>
+#include <iostream>
+#include <stdexcept>
+
+#include <sys/epoll.h>
+
+#include "poller.h"
+#include "epoll_poller.h"
+#include "uring_poller.h"
+
+std::unique_ptr<Poller> Poller::Create(IoEngine engine) {
+    if (engine == IoEngine::K_IO_URING) {
+        try {
+            return std::make_unique<UringPoller>();
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << ", falling back to epoll\n";
+        }
+    }
+
+    return std::make_unique<EpollPoller>();
+}
+
+bool Poller::AddListener(int fd, uint64_t data) {
+    return Add(fd, EPOLLIN | EPOLLET, data);
+}
+
+bool Poller::StartStream(int) {
+    return false;
+}
+
+bool Poller::Send(int, const iovec*, size_t) {
+    errno = ENOTSUP;
+
+    return false;
+}
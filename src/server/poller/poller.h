@@ -0,0 +1,149 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_POLLER_POLLER_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_POLLER_POLLER_H
+
+#include <memory>
+#include <string>
+#include <cstdint>
+
+#include <sys/uio.h>
+
+/**
+ * @brief Механизм ввода-вывода, на котором построен цикл событий.
+ */
+enum class IoEngine {
+    K_EPOLL, ///< epoll_wait + epoll_ctl
+    K_IO_URING ///< io_uring: чтение и отправка завершениями, ожидание готовности — multishot poll
+};
+
+/**
+ * @brief Абстракция ожидания готовности файловых дескрипторов.
+ *
+ * Маски событий задаются константами EPOLLIN, EPOLLOUT, EPOLLET и т.д. для любого механизма.
+ * К каждому дескриптору привязывается 64-битное значение data, которое возвращается в событиях.
+ *
+ * Механизм может сам выполнять ввод-вывод потоковых сокетов (StartStream()): тогда события несут
+ * прочитанные данные и завершения отправок, поставленных Send(), вместо готовности к чтению и записи.
+ */
+class Poller {
+public:
+    /**
+     * @brief Событие готовности дескриптора.
+     */
+    struct Event {
+        uint64_t data; ///< Значение, переданное при регистрации дескриптора.
+        uint32_t events; ///< Маска наступивших событий.
+        int accepted{-1}; ///< Подключение, принятое механизмом на слушающем сокете (-1 — только готовность).
+        char* received{nullptr}; ///< Данные, прочитанные механизмом (действительны до следующего Wait()).
+        size_t size{}; ///< Размер received или количество байт, отправленных по Send().
+        std::unique_ptr<char[]>* block{nullptr}; ///< Блок механизма, в начале которого лежит received: его можно
+                                                 ///< забрать, оставив взамен другой блок RECEIVE_BLOCK_SIZE байт.
+        bool sent{false}; ///< Завершение Send() (при ошибке в events выставлен EPOLLERR).
+    };
+
+public:
+    /// Размер блока, в который механизм читает данные потокового сокета (Event::block).
+    static constexpr size_t RECEIVE_BLOCK_SIZE{16384};
+
+public:
+    /**
+     * @brief Виртуальный деструктор.
+     */
+    virtual ~Poller() = default;
+
+    /**
+     * @brief Создает Poller для указанного механизма.
+     *
+     * Если io_uring недоступен (старое ядро, запрет в песочнице), возвращается epoll.
+     *
+     * @param engine Желаемый механизм.
+     * @return std::unique_ptr<Poller> Созданный Poller.
+     * @throw std::runtime_error Если не удалось создать даже epoll.
+     */
+    static std::unique_ptr<Poller> Create(IoEngine engine);
+
+    /**
+     * @brief Регистрирует дескриптор.
+     * @param fd Дескриптор.
+     * @param events Маска событий.
+     * @param data Значение, возвращаемое в событиях.
+     * @return true Если дескриптор зарегистрирован.
+     * @return false Если произошла ошибка (errno установлен).
+     */
+    virtual bool Add(int fd, uint32_t events, uint64_t data) = 0;
+
+    /**
+     * @brief Регистрирует слушающий сокет.
+     *
+     * По умолчанию это Add() с EPOLLIN | EPOLLET: Poller сообщает о готовности, и подключения принимает
+     * вызывающий. Механизм может принимать их сам: тогда каждое событие несет один принятый
+     * неблокирующий сокет в Event::accepted, а событие с accepted == -1 по-прежнему означает готовность.
+     *
+     * @param fd Слушающий неблокирующий сокет.
+     * @param data Значение, возвращаемое в событиях.
+     * @return true Если сокет зарегистрирован.
+     * @return false Если произошла ошибка (errno установлен).
+     */
+    virtual bool AddListener(int fd, uint64_t data);
+
+    /**
+     * @brief Изменяет маску событий дескриптора.
+     * @param fd Дескриптор.
+     * @param events Новая маска событий.
+     * @param data Значение, возвращаемое в событиях.
+     */
+    virtual void Modify(int fd, uint32_t events, uint64_t data) = 0;
+
+    /**
+     * @brief Переводит зарегистрированный потоковый сокет на ввод-вывод механизмом.
+     *
+     * Пока в маске есть EPOLLIN, механизм сам читает сокет, и каждое событие несет порцию данных
+     * в Event::received. EPOLLOUT в маске больше ничего не значит: данные отправляются через Send().
+     * Ошибка или конец потока по-прежнему сообщаются событием готовности без данных.
+     * По умолчанию механизм этого не умеет.
+     *
+     * @param fd Дескриптор.
+     * @return true Если сокет переведен.
+     * @return false Если механизм не поддерживает ввод-вывод (сокет остается на ожидании готовности).
+     */
+    virtual bool StartStream(int fd);
+
+    /**
+     * @brief Ставит в очередь отправку через сокет, переведенный StartStream().
+     *
+     * Данные отправляются целиком (или до ошибки), о чем сообщает событие с Event::sent.
+     * Память, на которую указывают iov, не должна меняться до этого события; следующая отправка
+     * того же сокета ставится только после него.
+     *
+     * @param fd Дескриптор.
+     * @param iov Сегменты данных.
+     * @param count Количество сегментов.
+     * @return true Если отправка поставлена в очередь.
+     * @return false Если произошла ошибка (errno установлен).
+     */
+    virtual bool Send(int fd, const iovec* iov, size_t count);
+
+    /**
+     * @brief Удаляет дескриптор. Вызывается до закрытия дескриптора.
+     *
+     * Незавершенные отправки Send() отменяются: после возврата их память можно освобождать.
+     *
+     * @param fd Дескриптор.
+     */
+    virtual void Remove(int fd) = 0;
+
+    /**
+     * @brief Ожидает события.
+     * @param events Массив для событий.
+     * @param max Размер массива.
+     * @param timeout_ms Таймаут в миллисекундах (-1 — бесконечно).
+     * @return int Количество событий или -1 при ошибке (errno установлен).
+     */
+    virtual int Wait(Event* events, int max, int timeout_ms) = 0;
+
+    /**
+     * @brief Возвращает название механизма.
+     */
+    virtual std::string GetName() const = 0;
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_POLLER_POLLER_H
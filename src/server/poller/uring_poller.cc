@@ -0,0 +1,749 @@
+#include <ctime>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include "uring_poller.h"
+
+namespace {
+
+constexpr uint64_t CONTROL_USER_DATA{~uint64_t{0}};
+constexpr unsigned KIND_SHIFT{30};
+constexpr uint64_t KIND_MASK{3};
+constexpr uint64_t FD_MASK{(uint64_t{1} << KIND_SHIFT) - 1};
+constexpr uint16_t BUFFER_GROUP{0};
+
+int SysSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int SysEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void* arg, size_t arg_size) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size));
+}
+
+int SysRegister(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+template <typename T>
+T* Offset(void* base, uint32_t offset) {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+} // namespace
+
+UringPoller::UringPoller(unsigned entries) {
+    io_uring_params params = {};
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+    params.cq_entries = entries * 4;
+
+    int ring_fd{SysSetup(entries, &params)};
+
+    if (ring_fd == -1 && errno == EINVAL) {
+        params = {};
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * 4;
+
+        ring_fd = SysSetup(entries, &params);
+    }
+
+    if (ring_fd == -1) {
+        throw std::runtime_error("io_uring_setup(): " + std::string(strerror(errno)));
+    }
+
+    _ring_fd = UniqueFD(ring_fd);
+
+    constexpr uint32_t REQUIRED{IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG};
+
+    if ((params.features & REQUIRED) != REQUIRED) {
+        throw std::runtime_error("io_uring: kernel lacks SINGLE_MMAP/NODROP/EXT_ARG");
+    }
+
+    size_t sq_size{params.sq_off.array + params.sq_entries * sizeof(unsigned)};
+    size_t cq_size{params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe)};
+    _ring_size = std::max(sq_size, cq_size);
+
+    void* ring{mmap(nullptr, _ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQ_RING)};
+
+    if (ring == MAP_FAILED) {
+        throw std::runtime_error("io_uring mmap(): " + std::string(strerror(errno)));
+    }
+
+    _ring_ptr = ring;
+
+    _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes{mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQES)};
+
+    if (sqes == MAP_FAILED) {
+        munmap(_ring_ptr, _ring_size);
+        _ring_ptr = nullptr;
+
+        throw std::runtime_error("io_uring mmap(): " + std::string(strerror(errno)));
+    }
+
+    _sqes = static_cast<io_uring_sqe*>(sqes);
+
+    _sq_head = Offset<unsigned>(_ring_ptr, params.sq_off.head);
+    _sq_tail = Offset<unsigned>(_ring_ptr, params.sq_off.tail);
+    _sq_array = Offset<unsigned>(_ring_ptr, params.sq_off.array);
+    _sq_mask = *Offset<unsigned>(_ring_ptr, params.sq_off.ring_mask);
+    _sq_entries = params.sq_entries;
+
+    _cq_head = Offset<unsigned>(_ring_ptr, params.cq_off.head);
+    _cq_tail = Offset<unsigned>(_ring_ptr, params.cq_off.tail);
+    _cq_mask = *Offset<unsigned>(_ring_ptr, params.cq_off.ring_mask);
+    _cqes = Offset<io_uring_cqe>(_ring_ptr, params.cq_off.cqes);
+
+    SetupBufferRing();
+}
+
+UringPoller::~UringPoller() {
+    if (_buf_ring) {
+        // Отмены снятых сокетов еще в очереди: без кольца ядро уже не выберет буфер для записи.
+        if (_to_submit > 0) {
+            Enter(0, 0);
+        }
+
+        io_uring_buf_reg reg = {};
+        reg.bgid = BUFFER_GROUP;
+        SysRegister(_ring_fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+
+        munmap(_buf_ring, _buf_ring_size);
+    }
+
+    if (_sqes) {
+        munmap(_sqes, _sqes_size);
+    }
+
+    if (_ring_ptr) {
+        munmap(_ring_ptr, _ring_size);
+    }
+}
+
+void UringPoller::SetupBufferRing() {
+    size_t ring_size{RECV_BUFFERS * sizeof(io_uring_buf)};
+
+    void* ring{mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0)};
+
+    if (ring == MAP_FAILED) {
+        return;
+    }
+
+    io_uring_buf_reg reg = {};
+    reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+    reg.ring_entries = RECV_BUFFERS;
+    reg.bgid = BUFFER_GROUP;
+
+    // Ядро до 5.19: сокеты остаются на ожидании готовности.
+    if (SysRegister(_ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) == -1) {
+        munmap(ring, ring_size);
+
+        return;
+    }
+
+    _buf_ring = ring;
+    _buf_ring_size = ring_size;
+    _buffers.resize(RECV_BUFFERS);
+
+    for (unsigned id{}; id < RECV_BUFFERS; ++id) {
+        _buffers[id].reset(new char[RECEIVE_BLOCK_SIZE]);
+        ProvideBuffer(static_cast<uint16_t>(id));
+    }
+
+    _streams = true;
+}
+
+void UringPoller::ProvideBuffer(uint16_t id) {
+    auto bufs{static_cast<io_uring_buf*>(_buf_ring)};
+    io_uring_buf& buf{bufs[_buf_tail & (RECV_BUFFERS - 1)]};
+
+    // Поля записываются по отдельности: resv первой записи — это хвост кольца.
+    buf.addr = reinterpret_cast<uint64_t>(_buffers[id].get());
+    buf.len = RECEIVE_BLOCK_SIZE;
+    buf.bid = id;
+
+    __atomic_store_n(&bufs[0].resv, ++_buf_tail, __ATOMIC_RELEASE);
+}
+
+uint64_t UringPoller::MakeUserData(int fd, uint32_t generation, Kind kind) {
+    return (uint64_t{generation} << 32) | (uint64_t{static_cast<uint32_t>(kind)} << KIND_SHIFT) |
+           static_cast<uint32_t>(fd);
+}
+
+io_uring_sqe* UringPoller::GetSQE() {
+    unsigned tail{*_sq_tail};
+    unsigned head{__atomic_load_n(_sq_head, __ATOMIC_ACQUIRE)};
+
+    if (tail - head >= _sq_entries) {
+        Enter(0, 0);
+
+        head = __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE);
+
+        if (tail - head >= _sq_entries) {
+            return nullptr;
+        }
+    }
+
+    unsigned index{tail & _sq_mask};
+    io_uring_sqe* sqe{&_sqes[index]};
+    std::memset(sqe, 0, sizeof(*sqe));
+
+    _sq_array[index] = index;
+    __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ++_to_submit;
+
+    return sqe;
+}
+
+bool UringPoller::Reserve(unsigned count) {
+    if (_sq_entries - (*_sq_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE)) >= count) {
+        return true;
+    }
+
+    Enter(0, 0);
+
+    return _sq_entries - (*_sq_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE)) >= count;
+}
+
+bool UringPoller::Sync(int fd, FdState& state) {
+    if (state.stream) {
+        return SyncStream(fd, state);
+    }
+
+    if (state.armed && (state.accept || state.armed_events == state.events)) {
+        return true;
+    }
+
+    io_uring_sqe* sqe{GetSQE()};
+
+    if (!sqe) {
+        return false;
+    }
+
+    uint64_t user_data{MakeUserData(fd, state.generation, state.accept ? Kind::K_ACCEPT : Kind::K_POLL)};
+
+    if (state.armed) {
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = user_data;
+        sqe->len = IORING_POLL_UPDATE_EVENTS | IORING_POLL_ADD_MULTI;
+        sqe->poll32_events = state.events;
+        sqe->user_data = CONTROL_USER_DATA;
+    } else if (state.accept) {
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK;
+        sqe->user_data = user_data;
+    } else {
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->poll32_events = state.events;
+        sqe->len = IORING_POLL_ADD_MULTI;
+        sqe->user_data = user_data;
+    }
+
+    state.armed = true;
+    state.armed_events = state.events;
+
+    return true;
+}
+
+bool UringPoller::SyncStream(int fd, FdState& state) {
+    bool wanted{(state.events & EPOLLIN) != 0};
+
+    if (wanted && !state.recv_armed) {
+        io_uring_sqe* sqe{GetSQE()};
+
+        if (!sqe) {
+            return false;
+        }
+
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = BUFFER_GROUP;
+        sqe->user_data = MakeUserData(fd, state.generation, Kind::K_RECV);
+
+        state.recv_sqe = *_sq_tail - 1;
+        state.recv_armed = true;
+        state.recv_cancelled = false;
+    } else if (!wanted && state.recv_armed && !state.recv_cancelled) {
+        // Данные, прочитанные до отмены, все равно придут событиями. Новый recv взводится только
+        // после завершения отмененного, иначе два запроса делили бы поток.
+        Cancel(MakeUserData(fd, state.generation, Kind::K_RECV));
+        state.recv_cancelled = true;
+    }
+
+    return true;
+}
+
+void UringPoller::Defer(int fd, FdState& state) {
+    if (!state.deferred) {
+        state.deferred = true;
+        _deferred.push_back(fd);
+    }
+}
+
+void UringPoller::Cancel(uint64_t user_data) {
+    io_uring_sqe* sqe{GetSQE()};
+
+    if (!sqe) {
+        _cancels.push_back(user_data);
+
+        return;
+    }
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = user_data;
+    sqe->user_data = CONTROL_USER_DATA;
+
+    // Все sendmsg цепочки Send() несут один user_data.
+    if (((user_data >> KIND_SHIFT) & KIND_MASK) == static_cast<uint64_t>(Kind::K_SEND)) {
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL;
+    }
+}
+
+void UringPoller::RetryDeferred() {
+    if (_deferred.empty() && _cancels.empty()) {
+        return;
+    }
+
+    std::vector<uint64_t> cancels;
+    cancels.swap(_cancels);
+
+    for (uint64_t user_data : cancels) {
+        Cancel(user_data);
+    }
+
+    std::vector<int> deferred;
+    deferred.swap(_deferred);
+
+    for (int fd : deferred) {
+        auto& state{_fds[fd]};
+        state.deferred = false;
+
+        if (state.registered && !Sync(fd, state)) {
+            Defer(fd, state);
+        }
+    }
+}
+
+bool UringPoller::Register(int fd, uint32_t events, uint64_t data, bool accept) {
+    if (fd < 0) {
+        errno = EBADF;
+
+        return false;
+    }
+
+    if (static_cast<size_t>(fd) >= _fds.size()) {
+        _fds.resize(static_cast<size_t>(fd) + 1);
+    }
+
+    auto& state{_fds[fd]};
+
+    if (state.registered) {
+        errno = EEXIST;
+
+        return false;
+    }
+
+    state.data = data;
+    state.events = events;
+    state.accept = accept;
+    state.armed = false;
+    state.stream = false;
+    state.recv_armed = false;
+    state.sends = 0;
+    ++state.generation;
+
+    // Регистрация без запроса в ядре молча теряла бы все события дескриптора.
+    if (!Sync(fd, state)) {
+        errno = EBUSY;
+
+        return false;
+    }
+
+    state.registered = true;
+
+    return true;
+}
+
+bool UringPoller::Add(int fd, uint32_t events, uint64_t data) {
+    return Register(fd, events, data, false);
+}
+
+bool UringPoller::AddListener(int fd, uint64_t data) {
+    return Register(fd, EPOLLIN, data, true);
+}
+
+void UringPoller::Modify(int fd, uint32_t events, uint64_t data) {
+    if (fd < 0 || static_cast<size_t>(fd) >= _fds.size() || !_fds[fd].registered) {
+        return;
+    }
+
+    auto& state{_fds[fd]};
+    state.data = data;
+    state.events = events;
+
+    if (!Sync(fd, state)) {
+        Defer(fd, state);
+    }
+}
+
+bool UringPoller::StartStream(int fd) {
+    if (!_streams || fd < 0 || static_cast<size_t>(fd) >= _fds.size() || !_fds[fd].registered || _fds[fd].accept) {
+        return false;
+    }
+
+    auto& state{_fds[fd]};
+
+    if (state.stream) {
+        return true;
+    }
+
+    // Готовность больше не нужна: события poll, пришедшие до отмены, отбрасываются.
+    if (state.armed) {
+        state.armed = false;
+        Cancel(MakeUserData(fd, state.generation, Kind::K_POLL));
+    }
+
+    state.stream = true;
+
+    if (!Sync(fd, state)) {
+        Defer(fd, state);
+    }
+
+    return true;
+}
+
+bool UringPoller::Send(int fd, const iovec* iov, size_t count) {
+    if (fd < 0 || static_cast<size_t>(fd) >= _fds.size() || !_fds[fd].registered) {
+        errno = EBADF;
+
+        return false;
+    }
+
+    auto& state{_fds[fd]};
+    size_t links{(count + SEND_IOVECS - 1) / SEND_IOVECS};
+
+    if (count == 0 || state.sends > 0) {
+        errno = EINVAL;
+
+        return false;
+    }
+
+    if (!Reserve(static_cast<unsigned>(links))) {
+        errno = EBUSY;
+
+        return false;
+    }
+
+    state.send_iov.assign(iov, iov + count);
+    state.send_msgs.assign(links, msghdr{});
+
+    uint64_t user_data{MakeUserData(fd, state.generation, Kind::K_SEND)};
+
+    for (size_t i{}; i < links; ++i) {
+        msghdr& msg{state.send_msgs[i]};
+        msg.msg_iov = state.send_iov.data() + i * SEND_IOVECS;
+        msg.msg_iovlen = std::min(SEND_IOVECS, count - i * SEND_IOVECS);
+
+        io_uring_sqe* sqe{GetSQE()};
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(&msg);
+        sqe->len = 1;
+        sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+        sqe->user_data = user_data;
+
+        // Следующая часть уходит только после предыдущей, а ошибка отменяет остаток цепочки.
+        if (i + 1 < links) {
+            sqe->flags = IOSQE_IO_LINK;
+        }
+    }
+
+    state.sends = static_cast<unsigned>(links);
+    state.sent = 0;
+    state.send_failed = false;
+
+    return true;
+}
+
+void UringPoller::Remove(int fd) {
+    if (fd < 0 || static_cast<size_t>(fd) >= _fds.size() || !_fds[fd].registered) {
+        return;
+    }
+
+    auto& state{_fds[fd]};
+    state.registered = false;
+
+    if (state.armed) {
+        state.armed = false;
+        Cancel(MakeUserData(fd, state.generation, state.accept ? Kind::K_ACCEPT : Kind::K_POLL));
+    }
+
+    if (state.recv_armed && *_sq_tail - state.recv_sqe <= _to_submit) {
+        // recv еще не ушел в ядро и получит номер дескриптора уже после close(): номер может достаться
+        // следующему сокету (в том числе от multishot accept), и запрос съел бы его данные.
+        io_uring_sqe* sqe{&_sqes[state.recv_sqe & _sq_mask]};
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_NOP;
+        sqe->user_data = CONTROL_USER_DATA;
+    } else if (state.recv_armed && !state.recv_cancelled) {
+        Cancel(MakeUserData(fd, state.generation, Kind::K_RECV));
+    }
+
+    state.recv_armed = false;
+
+    if (state.sends > 0) {
+        state.sends = 0;
+        Cancel(MakeUserData(fd, state.generation, Kind::K_SEND));
+
+        // Память отправки освобождается сразу после возврата. Очередь уходит в ядро сейчас: последние
+        // уведомления перед закрытием успевают в сокет, а заблокированный sendmsg отменяется. После
+        // shutdown() часть цепочки, которую ядро еще не начало, завершится ошибкой, не читая данных.
+        Enter(0, 0);
+        shutdown(fd, SHUT_RDWR);
+    }
+}
+
+int UringPoller::Enter(unsigned min_complete, int timeout_ms) {
+    unsigned flags{min_complete > 0 ? IORING_ENTER_GETEVENTS : 0u};
+
+    __kernel_timespec ts = {};
+    io_uring_getevents_arg arg = {};
+
+    if (min_complete > 0 && timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+        flags |= IORING_ENTER_EXT_ARG;
+    }
+
+    void* argp{(flags & IORING_ENTER_EXT_ARG) ? &arg : nullptr};
+    size_t arg_size{(flags & IORING_ENTER_EXT_ARG) ? sizeof(arg) : 0};
+
+    int ret{SysEnter(_ring_fd, _to_submit, min_complete, flags, argp, arg_size)};
+
+    if (ret >= 0) {
+        _to_submit -= std::min(_to_submit, static_cast<unsigned>(ret));
+    }
+
+    return ret;
+}
+
+bool UringPoller::OnPoll(int fd, FdState& state, const io_uring_cqe& cqe, Kind kind, Event& event) {
+    bool accept{kind == Kind::K_ACCEPT};
+
+    if (accept != state.accept) {
+        if (accept && cqe.res >= 0) {
+            close(cqe.res);
+        }
+
+        return false;
+    }
+
+    // poll, отмененный переходом на StartStream().
+    if (state.stream) {
+        return false;
+    }
+
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+        state.armed = false;
+
+        // Ядро без multishot accept: слушающий сокет переходит на ожидание готовности.
+        if (accept && cqe.res == -EINVAL) {
+            state.accept = false;
+        }
+
+        if (!Sync(fd, state)) {
+            Defer(fd, state);
+        }
+    }
+
+    if (cqe.res == -ECANCELED) {
+        return false;
+    }
+
+    if (accept) {
+        // Ошибка accept передается как готовность: accept4() вызывающего ее и покажет.
+        event.events = EPOLLIN;
+        event.accepted = cqe.res >= 0 ? cqe.res : -1;
+    } else if (cqe.res > 0) {
+        event.events = static_cast<uint32_t>(cqe.res);
+    } else if (cqe.res < 0) {
+        event.events = EPOLLERR;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+bool UringPoller::OnRecv(int fd, FdState& state, const io_uring_cqe& cqe, Event& event) {
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+        state.recv_armed = false;
+
+        // Ядро без multishot recv: этот и следующие сокеты читаются по готовности.
+        if (cqe.res == -EINVAL) {
+            _streams = false;
+            state.stream = false;
+        }
+
+        // Кольцо буферов опустело: recv взводится в следующем Wait(), когда буферы событий вернутся.
+        if (cqe.res == -ENOBUFS || !Sync(fd, state)) {
+            Defer(fd, state);
+        }
+    }
+
+    if (cqe.flags & IORING_CQE_F_BUFFER) {
+        auto id{static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT)};
+
+        if (cqe.res <= 0) {
+            ProvideBuffer(id);
+        } else {
+            _lent.push_back(id);
+
+            event.events = EPOLLIN;
+            event.received = _buffers[id].get();
+            event.size = static_cast<size_t>(cqe.res);
+            event.block = &_buffers[id];
+
+            return true;
+        }
+    }
+
+    if (cqe.res == -ECANCELED || cqe.res == -ENOBUFS) {
+        return false;
+    }
+
+    // Конец потока или ошибка: вызывающий узнает их обычным recv().
+    event.events = cqe.res == 0 ? EPOLLIN : EPOLLIN | EPOLLERR;
+
+    return true;
+}
+
+bool UringPoller::OnSend(FdState& state, const io_uring_cqe& cqe, Event& event) {
+    if (state.sends == 0) {
+        return false;
+    }
+
+    --state.sends;
+
+    if (cqe.res > 0) {
+        state.sent += static_cast<size_t>(cqe.res);
+    } else {
+        state.send_failed = true;
+    }
+
+    if (state.sends > 0) {
+        return false;
+    }
+
+    // Короткая отправка без ошибки возможна только в конце цепочки: остаток вызывающий отправит заново.
+    event.events = state.send_failed ? EPOLLERR : EPOLLOUT;
+    event.size = state.sent;
+    event.sent = true;
+
+    return true;
+}
+
+int UringPoller::Wait(Event* events, int max, int timeout_ms) {
+    // События прошлого Wait() обработаны: их буферы возвращаются в кольцо до повторного взвода recv.
+    for (uint16_t id : _lent) {
+        ProvideBuffer(id);
+    }
+
+    _lent.clear();
+    RetryDeferred();
+
+    unsigned head{*_cq_head};
+    unsigned tail{__atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE)};
+
+    if (head == tail) {
+        if (timeout_ms == 0) {
+            if (_to_submit > 0) {
+                Enter(0, 0);
+            }
+        } else if (Enter(1, timeout_ms) == -1 && errno != ETIME) {
+            return -1;
+        }
+
+        tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+    } else if (_to_submit > 0) {
+        Enter(0, 0);
+    }
+
+    int count{};
+
+    while (head != tail && count < max) {
+        const io_uring_cqe& cqe{_cqes[head & _cq_mask]};
+        ++head;
+
+        if (cqe.user_data == CONTROL_USER_DATA) {
+            continue;
+        }
+
+        int fd{static_cast<int>(cqe.user_data & FD_MASK)};
+        auto generation{static_cast<uint32_t>(cqe.user_data >> 32)};
+        auto kind{static_cast<Kind>((cqe.user_data >> KIND_SHIFT) & KIND_MASK)};
+
+        if (static_cast<size_t>(fd) >= _fds.size() || !_fds[fd].registered || _fds[fd].generation != generation) {
+            // Подключение, принятое до отмены multishot accept, больше некому передать.
+            if (kind == Kind::K_ACCEPT && cqe.res >= 0) {
+                close(cqe.res);
+            }
+
+            if (cqe.flags & IORING_CQE_F_BUFFER) {
+                ProvideBuffer(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+            }
+
+            continue;
+        }
+
+        auto& state{_fds[fd]};
+        Event& event{events[count]};
+        event.data = state.data;
+        event.accepted = -1;
+        event.received = nullptr;
+        event.size = 0;
+        event.block = nullptr;
+        event.sent = false;
+
+        bool filled{};
+
+        if (kind == Kind::K_RECV) {
+            filled = OnRecv(fd, state, cqe, event);
+        } else if (kind == Kind::K_SEND) {
+            filled = OnSend(state, cqe, event);
+        } else {
+            filled = OnPoll(fd, state, cqe, kind, event);
+        }
+
+        if (filled) {
+            ++count;
+        }
+    }
+
+    __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+
+    if (count == 0 && timeout_ms != 0 && _to_submit > 0) {
+        Enter(0, 0);
+    }
+
+    return count;
+}
+
+std::string UringPoller::GetName() const {
+    return "io_uring";
+}
@@ -0,0 +1,220 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_POLLER_URING_POLLER_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_POLLER_URING_POLLER_H
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <sys/socket.h>
+#include <linux/io_uring.h>
+
+#include "poller.h"
+#include "../unique_fd/unique_fd.h"
+
+/**
+ * @brief Poller на основе io_uring.
+ *
+ * Каждый дескриптор регистрируется одним multishot-запросом IORING_OP_POLL_ADD, а изменения маски
+ * выполняются запросом обновления poll. Регистрация, изменение и удаление только ставят SQE в очередь:
+ * все накопленные за итерацию цикла изменения отправляются в ядро вместе с ожиданием событий одним
+ * вызовом io_uring_enter(), вместо отдельного epoll_ctl() на каждое изменение.
+ *
+ * Слушающие сокеты (AddListener()) обслуживает multishot IORING_OP_ACCEPT: ядро само принимает
+ * подключения, и каждое событие несет готовый неблокирующий сокет, без accept4() и fcntl() в цикле
+ * событий. На ядрах без multishot accept (до 5.19) сокет переходит на обычное ожидание готовности.
+ *
+ * Потоковые сокеты (StartStream()) читает multishot IORING_OP_RECV с выбором буфера из кольца,
+ * зарегистрированного в ядре (IORING_REGISTER_PBUF_RING): данные приходят готовыми в событиях,
+ * без recv() на каждое сообщение. Буфер события возвращается в кольцо в начале следующего Wait();
+ * если вызывающий забрал блок буфера (Event::block), в кольцо уходит оставленный им взамен.
+ * Send() ставит IORING_OP_SENDMSG с MSG_WAITALL, связанные IOSQE_IO_LINK по SEND_IOVECS сегментов,
+ * и сообщает одним событием, когда завершилась вся цепочка. Так чтение, отправка и ожидание
+ * итерации цикла обходятся одним io_uring_enter(). Если ядро не поддерживает multishot recv
+ * (до 6.0), сокет читается по готовности, а отправки по-прежнему идут через кольцо.
+ *
+ * Если очередь отправки заполнена и после сброса в ядро, изменение не теряется: дескриптор
+ * запоминается, и его состояние в ядре приводится к нужному в начале следующего Wait().
+ */
+class UringPoller : public Poller {
+public:
+    /// Количество буферов кольца приема (степень двойки).
+    static constexpr unsigned RECV_BUFFERS{64};
+
+    /// Сегментов в одном IORING_OP_SENDMSG цепочки Send().
+    static constexpr size_t SEND_IOVECS{64};
+
+public:
+    /**
+     * @brief Создает кольца io_uring.
+     * @param entries Размер очереди отправки.
+     * @throw std::runtime_error Если io_uring недоступен или не поддерживает нужные возможности.
+     */
+    explicit UringPoller(unsigned entries = 4096);
+
+    /**
+     * @brief Деструктор. Снимает кольцо буферов приема и освобождает отображения колец.
+     */
+    ~UringPoller() override;
+
+    bool Add(int fd, uint32_t events, uint64_t data) override;
+    bool AddListener(int fd, uint64_t data) override;
+    void Modify(int fd, uint32_t events, uint64_t data) override;
+    bool StartStream(int fd) override;
+    bool Send(int fd, const iovec* iov, size_t count) override;
+    void Remove(int fd) override;
+    int Wait(Event* events, int max, int timeout_ms) override;
+    std::string GetName() const override;
+
+private:
+    /**
+     * @brief Вид запроса, закодированный в user_data.
+     */
+    enum class Kind : uint32_t {
+        K_POLL, ///< multishot poll
+        K_ACCEPT, ///< multishot accept
+        K_RECV, ///< multishot recv с выбором буфера
+        K_SEND ///< sendmsg из цепочки Send()
+    };
+
+    /**
+     * @brief Состояние зарегистрированного дескриптора.
+     */
+    struct FdState {
+        uint64_t data{}; ///< Значение пользователя.
+        uint32_t events{}; ///< Нужная маска событий.
+        uint32_t armed_events{}; ///< Маска, с которой в ядро отправлен poll.
+        uint32_t generation{}; ///< Поколение регистрации (отсекает события закрытых fd).
+        bool registered{false}; ///< Зарегистрирован ли дескриптор.
+        bool armed{false}; ///< Запрос (poll или accept) отправлен в ядро и не завершен.
+        bool accept{false}; ///< Слушающий сокет с multishot accept вместо poll.
+        bool deferred{false}; ///< Дескриптор ждет повторной синхронизации (_deferred).
+        bool stream{false}; ///< Сокет читается и пишется через кольцо (StartStream()).
+        bool recv_armed{false}; ///< Запрос recv отправлен в ядро и не завершен.
+        bool recv_cancelled{false}; ///< Для запроса recv уже отправлена отмена.
+        unsigned recv_sqe{}; ///< Позиция в очереди отправки SQE, взводящего recv.
+        unsigned sends{}; ///< Незавершенные sendmsg текущей цепочки.
+        size_t sent{}; ///< Отправлено байт текущей цепочкой.
+        bool send_failed{false}; ///< Один из sendmsg цепочки завершился ошибкой.
+        std::vector<iovec> send_iov; ///< Сегменты цепочки (живут до ее завершения).
+        std::vector<msghdr> send_msgs; ///< Заголовки sendmsg цепочки.
+    };
+
+    /**
+     * @brief Возвращает свободный SQE, при переполнении отправляет очередь в ядро.
+     * @return io_uring_sqe* SQE или nullptr, если очередь осталась заполненной.
+     */
+    io_uring_sqe* GetSQE();
+
+    /**
+     * @brief Проверяет, что в очереди отправки есть count свободных SQE, при нехватке отправляет ее в ядро.
+     *
+     * Цепочку IOSQE_IO_LINK нельзя разрывать сбросом очереди посередине: место под нее берется заранее.
+     */
+    bool Reserve(unsigned count);
+
+    /**
+     * @brief Регистрирует дескриптор (Add() и AddListener()).
+     */
+    bool Register(int fd, uint32_t events, uint64_t data, bool accept);
+
+    /**
+     * @brief Ставит в очередь запрос, приводящий состояние в ядре к state: multishot poll или accept,
+     * если запроса нет, или обновление маски poll.
+     * @return false Если SQE получить не удалось (состояние не изменено).
+     */
+    bool Sync(int fd, FdState& state);
+
+    /**
+     * @brief Sync() для потокового сокета: multishot recv, пока в маске есть EPOLLIN, иначе его отмена.
+     */
+    bool SyncStream(int fd, FdState& state);
+
+    /**
+     * @brief Откладывает синхронизацию дескриптора до следующего Wait().
+     */
+    void Defer(int fd, FdState& state);
+
+    /**
+     * @brief Ставит в очередь отмену запроса (при нехватке SQE — откладывает ее).
+     */
+    void Cancel(uint64_t user_data);
+
+    /**
+     * @brief Повторяет отложенные синхронизации и отмены.
+     */
+    void RetryDeferred();
+
+    /**
+     * @brief Регистрирует в ядре кольцо буферов приема. Без него потоковые сокеты не поддерживаются.
+     */
+    void SetupBufferRing();
+
+    /**
+     * @brief Возвращает буфер в кольцо приема.
+     */
+    void ProvideBuffer(uint16_t id);
+
+    /**
+     * @brief Обрабатывает CQE запроса poll или accept.
+     * @return true Если заполнено событие.
+     */
+    bool OnPoll(int fd, FdState& state, const io_uring_cqe& cqe, Kind kind, Event& event);
+
+    /**
+     * @brief Обрабатывает CQE запроса recv.
+     * @return true Если заполнено событие.
+     */
+    bool OnRecv(int fd, FdState& state, const io_uring_cqe& cqe, Event& event);
+
+    /**
+     * @brief Обрабатывает CQE sendmsg из цепочки Send().
+     * @return true Если цепочка завершена и заполнено событие.
+     */
+    bool OnSend(FdState& state, const io_uring_cqe& cqe, Event& event);
+
+    /**
+     * @brief Отправляет накопленные SQE и ожидает min_complete событий.
+     * @return int Результат io_uring_enter().
+     */
+    int Enter(unsigned min_complete, int timeout_ms);
+
+    /**
+     * @brief Формирует user_data запроса из fd, поколения и вида запроса.
+     */
+    static uint64_t MakeUserData(int fd, uint32_t generation, Kind kind);
+
+private:
+    UniqueFD _ring_fd{}; ///< Дескриптор io_uring.
+
+    void* _ring_ptr{}; ///< Общее отображение колец отправки и завершений.
+    size_t _ring_size{}; ///< Размер отображения колец.
+    io_uring_sqe* _sqes{}; ///< Массив SQE.
+    size_t _sqes_size{}; ///< Размер отображения массива SQE.
+
+    unsigned* _sq_head{}; ///< Голова кольца отправки (пишет ядро).
+    unsigned* _sq_tail{}; ///< Хвост кольца отправки.
+    unsigned* _sq_array{}; ///< Массив индексов SQE.
+    unsigned _sq_mask{}; ///< Маска кольца отправки.
+    unsigned _sq_entries{}; ///< Размер кольца отправки.
+
+    unsigned* _cq_head{}; ///< Голова кольца завершений.
+    unsigned* _cq_tail{}; ///< Хвост кольца завершений (пишет ядро).
+    unsigned _cq_mask{}; ///< Маска кольца завершений.
+    io_uring_cqe* _cqes{}; ///< Массив CQE.
+
+    unsigned _to_submit{}; ///< Количество SQE, еще не отправленных в ядро.
+
+    std::vector<FdState> _fds; ///< Состояние дескрипторов, индексированное по fd.
+    std::vector<int> _deferred; ///< Дескрипторы, которые не удалось синхронизировать.
+    std::vector<uint64_t> _cancels; ///< Отмены, для которых не хватило SQE.
+
+    bool _streams{false}; ///< Кольцо буферов приема зарегистрировано (StartStream() доступен).
+    void* _buf_ring{}; ///< Кольцо буферов приема (io_uring_buf, хвост наложен на bufs[0].resv).
+    size_t _buf_ring_size{}; ///< Размер отображения кольца буферов.
+    std::vector<std::unique_ptr<char[]>> _buffers; ///< Блоки буферов приема по номеру (RECEIVE_BLOCK_SIZE байт).
+    uint16_t _buf_tail{}; ///< Хвост кольца буферов.
+    std::vector<uint16_t> _lent; ///< Буферы, отданные в событиях последнего Wait().
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_POLLER_URING_POLLER_H
@@ -0,0 +1,187 @@
+#include <algorithm>
+
+#include "pool.h"
+
+BackendPool::BackendPool(size_t max_size, std::chrono::milliseconds idle_timeout, std::chrono::milliseconds connect_timeout) :
+    _max_size(max_size),
+    _idle_timeout(idle_timeout),
+    _connect_timeout(connect_timeout)
+{}
+
+std::string BackendPool::MakeKey(std::string_view user, std::string_view database) {
+    std::string key(user);
+    key.push_back('\0');
+    key.append(database);
+
+    return key;
+}
+
+void BackendPool::MakeNodeKey(std::string_view key, size_t node, std::string& out) {
+    out.assign(key);
+
+    if (node > 0) {
+        out.push_back('\0');
+        out.append(std::to_string(node));
+    }
+}
+
+size_t BackendPool::GetNode(std::string_view key) noexcept {
+    // Имена пользователя и базы не содержат '\0': номер сервера идет за вторым разделителем.
+    size_t user_end{key.find('\0')};
+    size_t database_end{user_end == std::string_view::npos ? user_end : key.find('\0', user_end + 1)};
+
+    if (database_end == std::string_view::npos) {
+        return 0;
+    }
+
+    size_t node{};
+
+    for (char c : key.substr(database_end + 1)) {
+        node = node * 10 + static_cast<size_t>(c - '0');
+    }
+
+    return node;
+}
+
+bool BackendPool::Empty() const noexcept {
+    return _backends.empty();
+}
+
+Backend* BackendPool::Find(int fd) const {
+    auto it{_backends.find(fd)};
+
+    return it != _backends.end() ? it->second.get() : nullptr;
+}
+
+bool BackendPool::CanOpen(const std::string& key) const {
+    auto it{_keys.find(key)};
+
+    return it == _keys.end() || it->second.total < _max_size;
+}
+
+void BackendPool::AddStarting(std::unique_ptr<Backend> backend) {
+    ++_keys[backend->GetKey()].total;
+
+    backend->SetSince(Clock::now());
+    _backends[backend->GetFD()] = std::move(backend);
+}
+
+std::unique_ptr<Backend> BackendPool::Take(int fd) {
+    auto it{_backends.find(fd)};
+
+    if (it == _backends.end()) {
+        return nullptr;
+    }
+
+    auto backend{std::move(it->second)};
+    _backends.erase(it);
+
+    auto& idle{_keys[backend->GetKey()].idle};
+    idle.erase(std::remove(idle.begin(), idle.end(), fd), idle.end());
+
+    return backend;
+}
+
+std::unique_ptr<Backend> BackendPool::TakeIdle(const std::string& key) {
+    auto it{_keys.find(key)};
+
+    if (it == _keys.end() || it->second.idle.empty()) {
+        return nullptr;
+    }
+
+    int fd{it->second.idle.back()};
+    it->second.idle.pop_back();
+
+    auto backend{std::move(_backends[fd])};
+    _backends.erase(fd);
+
+    return backend;
+}
+
+void BackendPool::PutIdle(std::unique_ptr<Backend> backend) {
+    int fd{backend->GetFD()};
+
+    _keys[backend->GetKey()].idle.push_back(fd);
+
+    backend->SetSince(Clock::now());
+    _backends[fd] = std::move(backend);
+}
+
+void BackendPool::AddIdle(std::unique_ptr<Backend> backend) {
+    ++_keys[backend->GetKey()].total;
+
+    SetParameters(backend->GetKey(), backend->GetParameters());
+    PutIdle(std::move(backend));
+}
+
+std::vector<std::unique_ptr<Backend>> BackendPool::TakeAllIdle() {
+    std::vector<std::unique_ptr<Backend>> result;
+
+    for (auto& [key, state] : _keys) {
+        while (auto backend{TakeIdle(key)}) {
+            result.push_back(std::move(backend));
+        }
+    }
+
+    return result;
+}
+
+void BackendPool::OnClosed(const std::string& key) {
+    auto it{_keys.find(key)};
+
+    if (it != _keys.end() && it->second.total > 0) {
+        --it->second.total;
+    }
+}
+
+void BackendPool::AddWaiter(const std::string& key, uint64_t session) {
+    _keys[key].waiters.push_back(session);
+}
+
+bool BackendPool::PopWaiter(const std::string& key, uint64_t& session) {
+    auto it{_keys.find(key)};
+
+    if (it == _keys.end() || it->second.waiters.empty()) {
+        return false;
+    }
+
+    session = it->second.waiters.front();
+    it->second.waiters.pop_front();
+
+    return true;
+}
+
+void BackendPool::SetParameters(const std::string& key, std::string_view parameters) {
+    auto& state{_keys[key]};
+
+    if (!state.has_parameters) {
+        state.parameters = std::string(parameters);
+        state.has_parameters = true;
+    }
+}
+
+const std::string* BackendPool::GetParameters(const std::string& key) const {
+    auto it{_keys.find(key)};
+
+    return it != _keys.end() && it->second.has_parameters ? &it->second.parameters : nullptr;
+}
+
+std::vector<std::unique_ptr<Backend>> BackendPool::TakeExpired(Clock::time_point now) {
+    std::vector<int> expired;
+
+    for (const auto& [fd, backend] : _backends) {
+        auto timeout{backend->IsReady() ? _idle_timeout : _connect_timeout};
+
+        if (now - backend->GetSince() >= timeout) {
+            expired.push_back(fd);
+        }
+    }
+
+    std::vector<std::unique_ptr<Backend>> result;
+
+    for (int fd : expired) {
+        result.push_back(Take(fd));
+    }
+
+    return result;
+}
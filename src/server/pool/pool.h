@@ -0,0 +1,193 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_POOL_POOL_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_POOL_POOL_H
+
+#include <deque>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+#include "../backend/backend.h"
+
+/**
+ * @brief Режим пула соединений с PostgreSQL.
+ */
+enum class PoolMode {
+    K_NONE, ///< Без пула: у каждого клиента свое соединение
+    K_TRANSACTION ///< Соединение выдается клиенту на время транзакции
+};
+
+/**
+ * @brief Пул соединений с PostgreSQL одного рабочего потока.
+ *
+ * Соединения группируются по ключу (user, database). Пул владеет соединениями, которые
+ * проходят этап запуска или простаивают; выданное сессии соединение принадлежит сессии,
+ * но продолжает учитываться в лимите своего ключа до закрытия (OnClosed()).
+ *
+ * Простаивающие соединения выдаются в порядке LIFO (самое "теплое" первым) и закрываются после
+ * idle_timeout. Сессии, которым не хватило соединения, ждут в очереди ключа; очередь хранит
+ * дескрипторы сессий (SessionSlab::Handle), живость которых проверяет вызывающий.
+ */
+class BackendPool {
+public:
+    /// Монотонные часы для отсчета таймаутов.
+    using Clock = Backend::Clock;
+
+public:
+    /**
+     * @brief Конструктор пула.
+     * @param max_size Максимальное количество соединений на ключ.
+     * @param idle_timeout Время простоя, после которого соединение закрывается.
+     * @param connect_timeout Время, за которое соединение должно пройти подключение и этап запуска.
+     */
+    BackendPool(size_t max_size, std::chrono::milliseconds idle_timeout, std::chrono::milliseconds connect_timeout);
+
+    /**
+     * @brief Формирует ключ пула.
+     * @param user Имя пользователя.
+     * @param database Имя базы данных.
+     */
+    static std::string MakeKey(std::string_view user, std::string_view database);
+
+    /**
+     * @brief Формирует ключ пула для сервера: соединения с основным сервером и репликами не смешиваются.
+     * @param key Ключ пула (MakeKey()).
+     * @param node Номер сервера (UpstreamSet); ключ основного сервера совпадает с key.
+     * @param out Ключ сервера (память переиспользуется).
+     */
+    static void MakeNodeKey(std::string_view key, size_t node, std::string& out);
+
+    /**
+     * @brief Возвращает номер сервера из ключа пула (MakeNodeKey()).
+     * @param key Ключ пула.
+     */
+    static size_t GetNode(std::string_view key) noexcept;
+
+    /**
+     * @brief Проверяет, владеет ли пул хотя бы одним соединением.
+     */
+    bool Empty() const noexcept;
+
+    /**
+     * @brief Ищет соединение пула (на этапе запуска или простаивающее) по дескриптору.
+     * @param fd Дескриптор.
+     * @return Backend* Соединение или nullptr.
+     */
+    Backend* Find(int fd) const;
+
+    /**
+     * @brief Проверяет, можно ли открыть еще одно соединение для ключа.
+     * @param key Ключ пула.
+     */
+    bool CanOpen(const std::string& key) const;
+
+    /**
+     * @brief Принимает новое соединение, проходящее этап запуска.
+     * @param backend Соединение (ключ задан через Backend::SetStartup()).
+     */
+    void AddStarting(std::unique_ptr<Backend> backend);
+
+    /**
+     * @brief Забирает соединение пула по дескриптору.
+     * @param fd Дескриптор.
+     * @return std::unique_ptr<Backend> Соединение (продолжает учитываться в лимите ключа).
+     */
+    std::unique_ptr<Backend> Take(int fd);
+
+    /**
+     * @brief Забирает простаивающее соединение для ключа.
+     * @param key Ключ пула.
+     * @return std::unique_ptr<Backend> Соединение или nullptr.
+     */
+    std::unique_ptr<Backend> TakeIdle(const std::string& key);
+
+    /**
+     * @brief Возвращает готовое соединение в пул простаивающих.
+     * @param backend Соединение.
+     */
+    void PutIdle(std::unique_ptr<Backend> backend);
+
+    /**
+     * @brief Принимает готовое соединение, открытое не этим пулом (передано при обновлении процесса).
+     *
+     * Соединение учитывается в лимите ключа, его ParameterStatus запоминаются, если ключ их еще не знает.
+     *
+     * @param backend Готовое соединение (ключ и параметры заданы через Backend::Restore()).
+     */
+    void AddIdle(std::unique_ptr<Backend> backend);
+
+    /**
+     * @brief Забирает все простаивающие соединения.
+     * @return std::vector<std::unique_ptr<Backend>> Соединения (продолжают учитываться в лимитах ключей).
+     */
+    std::vector<std::unique_ptr<Backend>> TakeAllIdle();
+
+    /**
+     * @brief Учитывает закрытие соединения ключа.
+     * @param key Ключ пула.
+     */
+    void OnClosed(const std::string& key);
+
+    /**
+     * @brief Ставит сессию в очередь ожидания соединения.
+     * @param key Ключ пула.
+     * @param session Дескриптор сессии.
+     */
+    void AddWaiter(const std::string& key, uint64_t session);
+
+    /**
+     * @brief Извлекает первую сессию из очереди ожидания.
+     * @param key Ключ пула.
+     * @param session Дескриптор сессии (сессия может быть уже закрыта).
+     * @return true Если очередь была не пуста.
+     * @return false Если ожидающих нет.
+     */
+    bool PopWaiter(const std::string& key, uint64_t& session);
+
+    /**
+     * @brief Запоминает ParameterStatus первого готового соединения ключа.
+     * @param key Ключ пула.
+     * @param parameters Сообщения ParameterStatus.
+     */
+    void SetParameters(const std::string& key, std::string_view parameters);
+
+    /**
+     * @brief Возвращает ParameterStatus ключа.
+     * @param key Ключ пула.
+     * @return const std::string* Сообщения или nullptr, если ни одно соединение еще не готово.
+     */
+    const std::string* GetParameters(const std::string& key) const;
+
+    /**
+     * @brief Забирает соединения, простаивающие дольше idle_timeout или не успевшие пройти этап запуска.
+     * @param now Текущее время.
+     * @return std::vector<std::unique_ptr<Backend>> Соединения для закрытия.
+     */
+    std::vector<std::unique_ptr<Backend>> TakeExpired(Clock::time_point now);
+
+private:
+    /**
+     * @brief Состояние ключа пула.
+     */
+    struct KeyState {
+        size_t total{}; ///< Открытые соединения ключа (включая выданные сессиям).
+        std::vector<int> idle; ///< Простаивающие соединения (стек).
+        std::deque<uint64_t> waiters; ///< Сессии, ожидающие соединения.
+        std::string parameters; ///< ParameterStatus для воспроизведения клиентам.
+        bool has_parameters{false}; ///< Получены ли ParameterStatus.
+    };
+
+private:
+    size_t _max_size; ///< Лимит соединений на ключ.
+    std::chrono::milliseconds _idle_timeout; ///< Таймаут простоя.
+    std::chrono::milliseconds _connect_timeout; ///< Таймаут подключения и этапа запуска.
+
+    std::unordered_map<int, std::unique_ptr<Backend>> _backends; ///< Соединения во владении пула.
+    std::unordered_map<std::string, KeyState> _keys; ///< Состояние ключей.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_POOL_POOL_H
@@ -0,0 +1,286 @@
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "fingerprint.h"
+
+namespace {
+
+constexpr size_t SIMD_WIDTH{16};
+
+constexpr uint64_t HASH_SEED{0x9e3779b97f4a7c15ULL};
+constexpr uint64_t HASH_MULTIPLIER{0xff51afd7ed558ccdULL};
+
+bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Символ слова в ASCII: то, что копирует CopyWord().
+bool IsWordByte(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || IsDigit(c) || c == '_';
+}
+
+bool IsIdentChar(char c) {
+    return IsWordByte(c) || c == '$' || static_cast<unsigned char>(c) >= 0x80;
+}
+
+bool IsWordChar(char c) {
+    return IsIdentChar(c) || c == '?' || c == '"';
+}
+
+char ToLower(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// Копирует последовательность [A-Za-z0-9_] с позиции pos в нижнем регистре и возвращает позицию за ней.
+// С SSE2 за шаг классифицируются и копируются 16 байт; out должен допускать запись 16 байт с запасом.
+size_t CopyWord(std::string_view query, size_t pos, char*& out) {
+#ifdef __SSE2__
+    const __m128i case_bit{_mm_set1_epi8(0x20)};
+
+    while (pos + SIMD_WIDTH <= query.size()) {
+        __m128i chunk{_mm_loadu_si128(reinterpret_cast<const __m128i*>(query.data() + pos))};
+        __m128i folded{_mm_or_si128(chunk, case_bit)};
+
+        // Байты >= 0x80 отрицательны при знаковом сравнении и в слово не попадают.
+        __m128i alpha{_mm_and_si128(_mm_cmpgt_epi8(folded, _mm_set1_epi8('a' - 1)),
+                                    _mm_cmplt_epi8(folded, _mm_set1_epi8('z' + 1)))};
+        __m128i digit{_mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('0' - 1)),
+                                    _mm_cmplt_epi8(chunk, _mm_set1_epi8('9' + 1)))};
+        __m128i word{_mm_or_si128(_mm_or_si128(alpha, digit), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_')))};
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_or_si128(chunk, _mm_and_si128(alpha, case_bit)));
+
+        auto mask{static_cast<unsigned>(_mm_movemask_epi8(word))};
+
+        if (mask != 0xffff) {
+            auto length{static_cast<size_t>(__builtin_ctz(~mask))};
+
+            out += length;
+
+            return pos + length;
+        }
+
+        out += SIMD_WIDTH;
+        pos += SIMD_WIDTH;
+    }
+#endif
+
+    while (pos < query.size() && IsWordByte(query[pos])) {
+        *out++ = ToLower(query[pos++]);
+    }
+
+    return pos;
+}
+
+// Позиция первой кавычки (или обратной косой черты, если она экранирует) начиная с pos.
+size_t FindQuote(std::string_view query, size_t pos, bool backslash_escapes) {
+#ifdef __SSE2__
+    const __m128i quote{_mm_set1_epi8('\'')};
+    const __m128i escape{_mm_set1_epi8(backslash_escapes ? '\\' : '\'')};
+
+    while (pos + SIMD_WIDTH <= query.size()) {
+        __m128i chunk{_mm_loadu_si128(reinterpret_cast<const __m128i*>(query.data() + pos))};
+        __m128i found{_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, escape))};
+
+        auto mask{static_cast<unsigned>(_mm_movemask_epi8(found))};
+
+        if (mask != 0) {
+            return pos + static_cast<size_t>(__builtin_ctz(mask));
+        }
+
+        pos += SIMD_WIDTH;
+    }
+#endif
+
+    while (pos < query.size() && query[pos] != '\'' && !(backslash_escapes && query[pos] == '\\')) {
+        ++pos;
+    }
+
+    return pos;
+}
+
+// Конец строкового литерала, начинающегося с кавычки в позиции pos ('' внутри — экранированная кавычка).
+size_t SkipString(std::string_view query, size_t pos, bool backslash_escapes) {
+    size_t i{pos + 1};
+
+    while (true) {
+        i = FindQuote(query, i, backslash_escapes);
+
+        if (i >= query.size()) {
+            return query.size();
+        }
+
+        if (query[i] == '\\' || (i + 1 < query.size() && query[i + 1] == '\'')) {
+            i += 2;
+
+            continue;
+        }
+
+        return i + 1;
+    }
+}
+
+// Длина открывающего разделителя $tag$ в позиции pos или 0, если это не разделитель.
+size_t GetDollarTag(std::string_view query, size_t pos) {
+    size_t i{pos + 1};
+
+    while (i < query.size() && query[i] != '$') {
+        char c{query[i]};
+
+        if (!IsIdentChar(c) || (i == pos + 1 && IsDigit(c))) {
+            return 0;
+        }
+
+        ++i;
+    }
+
+    return i < query.size() ? i - pos + 1 : 0;
+}
+
+size_t SkipNumber(std::string_view query, size_t pos) {
+    size_t i{pos};
+
+    while (i < query.size() && (IsDigit(query[i]) || query[i] == '.')) {
+        ++i;
+    }
+
+    if (i < query.size() && (query[i] == 'e' || query[i] == 'E')) {
+        size_t exponent{i + 1};
+
+        if (exponent < query.size() && (query[exponent] == '+' || query[exponent] == '-')) {
+            ++exponent;
+        }
+
+        if (exponent < query.size() && IsDigit(query[exponent])) {
+            i = exponent;
+
+            while (i < query.size() && IsDigit(query[i])) {
+                ++i;
+            }
+        }
+    }
+
+    return i;
+}
+
+uint64_t Mix(uint64_t value) {
+    value ^= value >> 33;
+    value *= HASH_MULTIPLIER;
+    value ^= value >> 33;
+
+    return value;
+}
+
+// Хеш по 8 байт за шаг.
+uint64_t Hash(const char* data, size_t size) {
+    uint64_t hash{HASH_SEED ^ (size * HASH_MULTIPLIER)};
+    size_t i{};
+
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word{};
+        std::memcpy(&word, data + i, sizeof(word));
+
+        hash = Mix(hash ^ word) * HASH_SEED;
+    }
+
+    if (i < size) {
+        uint64_t word{};
+        std::memcpy(&word, data + i, size - i);
+
+        hash = Mix(hash ^ word) * HASH_SEED;
+    }
+
+    return Mix(hash);
+}
+
+} // namespace
+
+uint64_t FingerprintQuery(std::string_view query, std::string& normalized) {
+    // Результат не длиннее запроса: '?' и пробел заменяют хотя бы один символ. Запас — для записи по 16 байт.
+    normalized.resize(query.size() + SIMD_WIDTH);
+
+    char* begin{normalized.data()};
+    char* out{begin};
+    bool space{false};
+
+    // Пробел сохраняется только между словами: "id = 1" и "id=1" нормализуются одинаково.
+    auto start{[begin, &out, &space](char c) {
+        if (space && out != begin && IsWordChar(out[-1]) && IsWordChar(c)) {
+            *out++ = ' ';
+        }
+
+        space = false;
+    }};
+
+    auto emit{[&start, &out](char c) {
+        start(c);
+        *out++ = c;
+    }};
+
+    size_t i{};
+
+    while (i < query.size()) {
+        char c{query[i]};
+        bool after_ident{out != begin && !space && IsIdentChar(out[-1])};
+
+        if (IsSpace(c)) {
+            space = true;
+            ++i;
+        } else if (c == '-' && i + 1 < query.size() && query[i + 1] == '-') {
+            size_t end{query.find('\n', i)};
+            i = end == std::string_view::npos ? query.size() : end;
+            space = true;
+        } else if (c == '/' && i + 1 < query.size() && query[i + 1] == '*') {
+            size_t end{query.find("*/", i + 2)};
+            i = end == std::string_view::npos ? query.size() : end + 2;
+            space = true;
+        } else if (c == '\'') {
+            i = SkipString(query, i, false);
+            emit('?');
+        } else if ((c == 'e' || c == 'E') && !after_ident && i + 1 < query.size() && query[i + 1] == '\'') {
+            i = SkipString(query, i + 1, true);
+            emit('?');
+        } else if (c == '"') {
+            // Идентификатор в кавычках сохраняется как есть.
+            size_t end{query.find('"', i + 1)};
+            end = end == std::string_view::npos ? query.size() : end + 1;
+
+            start(c);
+            std::memcpy(out, query.data() + i, end - i);
+            out += end - i;
+            i = end;
+        } else if (c == '$' && !after_ident && i + 1 < query.size() && IsDigit(query[i + 1])) {
+            i += 1;
+
+            while (i < query.size() && IsDigit(query[i])) {
+                ++i;
+            }
+
+            emit('?');
+        } else if (size_t tag{c == '$' && !after_ident ? GetDollarTag(query, i) : 0}; tag > 0) {
+            size_t end{query.find(query.substr(i, tag), i + tag)};
+            i = end == std::string_view::npos ? query.size() : end + tag;
+            emit('?');
+        } else if (!after_ident && (IsDigit(c) || (c == '.' && i + 1 < query.size() && IsDigit(query[i + 1])))) {
+            i = SkipNumber(query, i);
+            emit('?');
+        } else if (IsWordByte(c)) {
+            start(c);
+            i = CopyWord(query, i, out);
+        } else {
+            emit(ToLower(c));
+            ++i;
+        }
+    }
+
+    normalized.resize(static_cast<size_t>(out - begin));
+
+    return Hash(normalized.data(), normalized.size());
+}
@@ -0,0 +1,26 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_PROTOCOL_FINGERPRINT_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_PROTOCOL_FINGERPRINT_H
+
+#include <string>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @brief Нормализует текст запроса и вычисляет его отпечаток.
+ *
+ * Строковые (в том числе E'...' и $$...$$) и числовые литералы, а также параметры $N заменяются на '?',
+ * комментарии удаляются, пробельные символы между словами сворачиваются в один пробел, а вокруг
+ * знаков препинания и операторов удаляются, буквы вне идентификаторов в двойных кавычках приводятся
+ * к нижнему регистру. Запросы, отличающиеся только значениями и оформлением, получают одинаковый
+ * текст и отпечаток.
+ *
+ * Проход по запросу один; при наличии SSE2 слова и содержимое строковых литералов обрабатываются
+ * по 16 байт за шаг.
+ *
+ * @param query Текст запроса.
+ * @param normalized Нормализованный текст (перезаписывается; память переиспользуется между вызовами).
+ * @return uint64_t Отпечаток — хеш нормализованного текста (по 8 байт за шаг).
+ */
+uint64_t FingerprintQuery(std::string_view query, std::string& normalized);
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_PROTOCOL_FINGERPRINT_H
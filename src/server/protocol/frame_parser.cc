@@ -0,0 +1,160 @@
+#include <cstring>
+#include <algorithm>
+
+#include <arpa/inet.h>
+
+#include "frame_parser.h"
+
+namespace {
+
+constexpr uint32_t MAX_STARTUP_LENGTH{10000};
+constexpr uint32_t MAX_MESSAGE_LENGTH{0x3fffffff};
+
+uint32_t ReadUInt32(const char* data) {
+    uint32_t value{};
+    std::memcpy(&value, data, sizeof(value));
+
+    return ntohl(value);
+}
+
+} // namespace
+
+FrameParser::FrameParser(size_t max_capture, State initial) :
+    _state(initial),
+    _max_capture(max_capture)
+{}
+
+FrameParser::State FrameParser::GetState() const noexcept {
+    return _state;
+}
+
+size_t FrameParser::GetMaxCapture() const noexcept {
+    return _max_capture;
+}
+
+bool FrameParser::IsAtBoundary() const noexcept {
+    return _header_received == 0 && !_in_body;
+}
+
+size_t FrameParser::GetHeaderSize() const noexcept {
+    return _state == State::K_STARTUP ? 4 : 5;
+}
+
+bool FrameParser::ParseHeader(const char* header) {
+    if (_state == State::K_STARTUP) {
+        _type = '\0';
+        _length = ReadUInt32(header);
+
+        if (_length < 8 || _length > MAX_STARTUP_LENGTH) {
+            _state = State::K_OPAQUE;
+        }
+    } else {
+        _type = header[0];
+        _length = ReadUInt32(header + 1);
+
+        if (_length < 4 || _length > MAX_MESSAGE_LENGTH) {
+            _state = State::K_OPAQUE;
+        }
+    }
+
+    return _state != State::K_OPAQUE;
+}
+
+void FrameParser::Deliver(std::string_view body, bool truncated, const Callback& on_message) {
+    if (_state == State::K_STARTUP) {
+        uint32_t code{body.size() >= 4 ? ReadUInt32(body.data()) : 0};
+
+        if ((code >> 16) == (PROTOCOL_VERSION_3 >> 16)) {
+            _state = State::K_MESSAGES;
+        } else if (code == SSL_REQUEST_CODE || code == GSSENC_REQUEST_CODE) {
+            _state = State::K_NEGOTIATING;
+        } else if (code == CANCEL_REQUEST_CODE) {
+            _state = State::K_OPAQUE;
+        } else {
+            _state = State::K_OPAQUE;
+
+            return;
+        }
+    }
+
+    on_message(FrontendMessage{_type, _length, body, truncated});
+}
+
+void FrameParser::Feed(std::string_view data, const Callback& on_message) {
+    while (true) {
+        if (_state == State::K_NEGOTIATING && !data.empty()) {
+            // Ответ на SSLRequest/GSSENCRequest: повторный StartupMessage начинается со старшего
+            // (нулевого) байта длины, TLS ClientHello — с типа записи 0x16.
+            _state = data[0] == '\0' ? State::K_STARTUP : State::K_OPAQUE;
+        }
+
+        if (_state == State::K_OPAQUE || _state == State::K_NEGOTIATING) {
+            return;
+        }
+
+        if (!_in_body) {
+            if (data.empty()) {
+                return;
+            }
+
+            size_t header_size{GetHeaderSize()};
+
+            if (_header_received == 0 && data.size() >= header_size) {
+                if (!ParseHeader(data.data())) {
+                    return;
+                }
+
+                data.remove_prefix(header_size);
+            } else {
+                size_t n{std::min(header_size - _header_received, data.size())};
+
+                std::memcpy(_header + _header_received, data.data(), n);
+                _header_received += n;
+                data.remove_prefix(n);
+
+                if (_header_received < header_size) {
+                    return;
+                }
+
+                _header_received = 0;
+
+                if (!ParseHeader(_header)) {
+                    return;
+                }
+            }
+
+            _in_body = true;
+            _body_received = 0;
+            _partial.clear();
+        }
+
+        size_t body_size{_length - size_t{4}};
+        size_t remaining{body_size - _body_received};
+
+        if (_body_received == 0 && data.size() >= remaining) {
+            _in_body = false;
+            Deliver(data.substr(0, remaining), false, on_message);
+            data.remove_prefix(remaining);
+
+            continue;
+        }
+
+        if (data.empty()) {
+            return;
+        }
+
+        size_t n{std::min(remaining, data.size())};
+
+        if (_partial.size() < _max_capture) {
+            _partial.append(data.data(), std::min(n, _max_capture - _partial.size()));
+        }
+
+        _body_received += n;
+        data.remove_prefix(n);
+
+        if (_body_received == body_size) {
+            _in_body = false;
+            Deliver(_partial, _partial.size() < body_size, on_message);
+        }
+    }
+}
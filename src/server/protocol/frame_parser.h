@@ -0,0 +1,133 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_PROTOCOL_FRAME_PARSER_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_PROTOCOL_FRAME_PARSER_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+/**
+ * @brief Сообщение протокола PostgreSQL, отправленное клиентом.
+ */
+struct FrontendMessage {
+    char type{}; ///< Тип сообщения ('\0' для сообщений этапа запуска без байта типа).
+    uint32_t length{}; ///< Длина из заголовка (включает 4 байта самой длины).
+    std::string_view body; ///< Тело сообщения без типа и длины.
+    bool truncated{false}; ///< Тело усечено до FrameParser::GetMaxCapture() байт.
+};
+
+/**
+ * @brief Инкрементальный разборщик сообщений протокола PostgreSQL v3 (клиент -> сервер).
+ *
+ * Принимает данные порциями в том виде, в каком они прочитаны из сокета, и передает каждое
+ * полное сообщение обработчику ровно один раз. Заголовок (тип и длина) отслеживается между
+ * вызовами Feed(), поэтому сообщения, разбитые между чтениями, и несколько сообщений в одном
+ * чтении разбираются корректно, а уже разобранные байты повторно не просматриваются.
+ *
+ * Если сообщение целиком лежит в переданной порции, body указывает прямо в нее (без копирования).
+ * Тело сообщения, разбитого между чтениями, собирается во внутреннем буфере, но не больше
+ * max_capture байт: более длинное тело передается усеченным (truncated = true).
+ *
+ * Первое сообщение соединения не имеет байта типа (StartupMessage, SSLRequest, GSSENCRequest,
+ * CancelRequest). После SSLRequest/GSSENCRequest клиент либо повторяет этап запуска, либо
+ * начинает TLS/GSSAPI-сеанс: в последнем случае поток становится непрозрачным и разбор прекращается.
+ * Некорректная длина также переводит поток в непрозрачный режим.
+ *
+ * С начальным состоянием K_MESSAGES разборщик подходит и для ответов сервера (в них нет этапа запуска).
+ */
+class FrameParser {
+public:
+    /// Тип обработчика разобранных сообщений.
+    using Callback = std::function<void(const FrontendMessage& message)>;
+
+    /**
+     * @brief Состояние разборщика.
+     */
+    enum class State {
+        K_STARTUP, ///< Ожидается сообщение этапа запуска (без байта типа)
+        K_NEGOTIATING, ///< Отправлен SSLRequest/GSSENCRequest, ожидается ответ клиента
+        K_MESSAGES, ///< Обычные сообщения с байтом типа
+        K_OPAQUE ///< Поток не разбирается (шифрование, отмена или ошибка протокола)
+    };
+
+public:
+    /// Код протокола 3.0 в StartupMessage.
+    static constexpr uint32_t PROTOCOL_VERSION_3{196608};
+    /// Код CancelRequest.
+    static constexpr uint32_t CANCEL_REQUEST_CODE{80877102};
+    /// Код SSLRequest.
+    static constexpr uint32_t SSL_REQUEST_CODE{80877103};
+    /// Код GSSENCRequest.
+    static constexpr uint32_t GSSENC_REQUEST_CODE{80877104};
+
+    /**
+     * @brief Конструктор разборщика.
+     * @param max_capture Максимальный размер тела, собираемого из нескольких порций.
+     * @param initial Начальное состояние (K_MESSAGES — для потока без этапа запуска, например ответов сервера).
+     */
+    explicit FrameParser(size_t max_capture = size_t{1} << 20, State initial = State::K_STARTUP);
+
+    /**
+     * @brief Разбирает очередную порцию данных клиента.
+     *
+     * body переданных сообщений действителен только на время вызова обработчика.
+     *
+     * @param data Прочитанные данные.
+     * @param on_message Обработчик полных сообщений.
+     */
+    void Feed(std::string_view data, const Callback& on_message);
+
+    /**
+     * @brief Возвращает текущее состояние разборщика.
+     */
+    State GetState() const noexcept;
+
+    /**
+     * @brief Возвращает максимальный размер собираемого тела.
+     */
+    size_t GetMaxCapture() const noexcept;
+
+    /**
+     * @brief Проверяет, что переданные данные закончились на границе сообщения (нет начатого сообщения).
+     */
+    bool IsAtBoundary() const noexcept;
+
+private:
+    /**
+     * @brief Размер заголовка в текущем состоянии (4 — этап запуска, 5 — обычные сообщения).
+     */
+    size_t GetHeaderSize() const noexcept;
+
+    /**
+     * @brief Разбирает заголовок и проверяет длину.
+     * @param header Байты заголовка.
+     * @return true Если заголовок корректен.
+     * @return false Если поток переведен в непрозрачный режим.
+     */
+    bool ParseHeader(const char* header);
+
+    /**
+     * @brief Передает сообщение обработчику и обновляет состояние после этапа запуска.
+     * @param body Тело сообщения.
+     * @param truncated Усечено ли тело.
+     * @param on_message Обработчик.
+     */
+    void Deliver(std::string_view body, bool truncated, const Callback& on_message);
+
+private:
+    State _state; ///< Текущее состояние.
+    size_t _max_capture; ///< Максимальный размер собираемого тела.
+
+    char _header[5]{}; ///< Накопленные байты заголовка, разбитого между чтениями.
+    size_t _header_received{}; ///< Количество накопленных байт заголовка.
+
+    bool _in_body{false}; ///< Заголовок разобран, ожидается тело.
+    char _type{}; ///< Тип текущего сообщения.
+    uint32_t _length{}; ///< Длина текущего сообщения из заголовка.
+    size_t _body_received{}; ///< Количество полученных байт тела.
+
+    std::string _partial; ///< Тело, разбитое между чтениями.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_PROTOCOL_FRAME_PARSER_H
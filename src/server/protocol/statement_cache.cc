@@ -0,0 +1,359 @@
+#include <cstring>
+#include <algorithm>
+
+#include <arpa/inet.h>
+
+#include "statement_cache.h"
+
+namespace {
+
+constexpr size_t MAX_PARAM_VALUE{64};
+constexpr size_t MAX_PARAMS_TEXT{1024};
+
+bool ReadCString(std::string_view& body, std::string_view& value) {
+    size_t end{body.find('\0')};
+
+    if (end == std::string_view::npos) {
+        return false;
+    }
+
+    value = body.substr(0, end);
+    body.remove_prefix(end + 1);
+
+    return true;
+}
+
+bool ReadInt16(std::string_view& body, int16_t& value) {
+    if (body.size() < 2) {
+        return false;
+    }
+
+    uint16_t raw{};
+    std::memcpy(&raw, body.data(), sizeof(raw));
+    value = static_cast<int16_t>(ntohs(raw));
+    body.remove_prefix(2);
+
+    return true;
+}
+
+bool ReadInt32(std::string_view& body, int32_t& value) {
+    if (body.size() < 4) {
+        return false;
+    }
+
+    uint32_t raw{};
+    std::memcpy(&raw, body.data(), sizeof(raw));
+    value = static_cast<int32_t>(ntohl(raw));
+    body.remove_prefix(4);
+
+    return true;
+}
+
+} // namespace
+
+std::string_view StatementCache::Arena::Store(std::string_view text) {
+    char* data{Allocate(text.size())};
+
+    if (!text.empty()) {
+        std::memcpy(data, text.data(), text.size());
+    }
+
+    return std::string_view(data, text.size());
+}
+
+char* StatementCache::Arena::Allocate(size_t size) {
+    _used += size;
+
+    if (size > BLOCK_SIZE / 4) {
+        _blocks.emplace_back(new char[size]);
+        _block_used = BLOCK_SIZE;
+
+        return _blocks.back().get();
+    }
+
+    if (BLOCK_SIZE - _block_used < size) {
+        _blocks.emplace_back(new char[BLOCK_SIZE]);
+        _block_used = 0;
+    }
+
+    char* data{_blocks.back().get() + _block_used};
+    _block_used += size;
+
+    return data;
+}
+
+size_t StatementCache::Arena::GetUsed() const noexcept {
+    return _used;
+}
+
+StatementCache::StatementCache(size_t max_entries, size_t max_bytes) :
+    _max_entries(std::max<size_t>(max_entries, 1)),
+    _max_bytes(max_bytes)
+{}
+
+void StatementCache::SetCaptureParams(bool capture) noexcept {
+    _capture_params = capture;
+}
+
+bool StatementCache::Process(const FrontendMessage& message, QueryText& text) {
+    switch (message.type) {
+        case 'Q':
+            text.type = 'Q';
+            text.query = message.body;
+            text.params = {};
+
+            if (!text.query.empty() && text.query.back() == '\0') {
+                text.query.remove_suffix(1);
+            }
+
+            return true;
+        case 'P':
+            OnParse(message.body, message.truncated);
+            break;
+        case 'B':
+            OnBind(message.body);
+            break;
+        case 'C':
+            OnClose(message.body);
+            break;
+        case 'E':
+            return OnExecute(message.body, text);
+        default:
+            break;
+    }
+
+    return false;
+}
+
+void StatementCache::Reserve(size_t bytes) {
+    if (_arena.GetUsed() + bytes > _max_bytes) {
+        Compact();
+    }
+}
+
+void StatementCache::OnParse(std::string_view body, bool truncated) {
+    std::string_view name;
+    std::string_view query;
+
+    if (!ReadCString(body, name)) {
+        return;
+    }
+
+    if (!ReadCString(body, query)) {
+        if (!truncated) {
+            return;
+        }
+
+        query = body;
+    }
+
+    if (name.size() + query.size() > _max_bytes / 2) {
+        _statements.erase(name);
+
+        return;
+    }
+
+    Reserve(name.size() + query.size());
+
+    auto it{_statements.find(name)};
+
+    if (it != _statements.end()) {
+        it->second = _arena.Store(query);
+
+        return;
+    }
+
+    if (_statements.size() >= _max_entries) {
+        _statements.erase(_statements.begin());
+    }
+
+    _statements.emplace(_arena.Store(name), _arena.Store(query));
+}
+
+void StatementCache::OnBind(std::string_view body) {
+    std::string_view portal_name;
+    std::string_view statement_name;
+
+    if (!ReadCString(body, portal_name) || !ReadCString(body, statement_name)) {
+        return;
+    }
+
+    Reserve(portal_name.size() + statement_name.size() + MAX_PARAMS_TEXT + 32);
+
+    Portal portal;
+    auto statement{_statements.find(statement_name)};
+
+    if (statement != _statements.end()) {
+        portal.query = statement->second;
+    } else {
+        std::string unknown{"<unknown statement " + std::string(statement_name) + ">"};
+        portal.query = _arena.Store(unknown);
+    }
+
+    if (_capture_params) {
+        portal.params = FormatParams(body);
+    }
+
+    auto it{_portals.find(portal_name)};
+
+    if (it != _portals.end()) {
+        it->second = portal;
+
+        return;
+    }
+
+    if (_portals.size() >= _max_entries) {
+        _portals.erase(_portals.begin());
+    }
+
+    _portals.emplace(_arena.Store(portal_name), portal);
+}
+
+void StatementCache::OnClose(std::string_view body) {
+    if (body.empty()) {
+        return;
+    }
+
+    char kind{body[0]};
+    body.remove_prefix(1);
+
+    std::string_view name;
+
+    if (!ReadCString(body, name)) {
+        return;
+    }
+
+    if (kind == 'S') {
+        _statements.erase(name);
+    } else if (kind == 'P') {
+        _portals.erase(name);
+    }
+}
+
+bool StatementCache::OnExecute(std::string_view body, QueryText& text) {
+    std::string_view portal_name;
+
+    if (!ReadCString(body, portal_name)) {
+        return false;
+    }
+
+    auto it{_portals.find(portal_name)};
+
+    text.type = 'E';
+
+    if (it == _portals.end()) {
+        _unknown = "<unknown portal " + std::string(portal_name) + ">";
+        text.query = _unknown;
+        text.params = {};
+
+        return true;
+    }
+
+    text.query = it->second.query;
+    text.params = it->second.params;
+
+    return true;
+}
+
+std::string_view StatementCache::FormatParams(std::string_view body) {
+    int16_t format_count{};
+
+    if (!ReadInt16(body, format_count) || format_count < 0 || body.size() < static_cast<size_t>(format_count) * 2) {
+        return {};
+    }
+
+    std::string_view formats{body.substr(0, static_cast<size_t>(format_count) * 2)};
+    body.remove_prefix(formats.size());
+
+    int16_t param_count{};
+
+    if (!ReadInt16(body, param_count) || param_count <= 0) {
+        return {};
+    }
+
+    _scratch.clear();
+
+    for (int16_t i{}; i < param_count && _scratch.size() < MAX_PARAMS_TEXT; ++i) {
+        int32_t length{};
+
+        if (!ReadInt32(body, length) || (length > 0 && body.size() < static_cast<size_t>(length))) {
+            _scratch += _scratch.empty() ? "<truncated>" : ", <truncated>";
+
+            break;
+        }
+
+        int16_t format{};
+
+        if (format_count == 1 || format_count > i) {
+            std::string_view code{formats.substr(format_count == 1 ? 0 : static_cast<size_t>(i) * 2)};
+            ReadInt16(code, format);
+        }
+
+        if (!_scratch.empty()) {
+            _scratch += ", ";
+        }
+
+        _scratch += '$';
+        _scratch += std::to_string(i + 1);
+        _scratch += '=';
+
+        if (length < 0) {
+            _scratch += "NULL";
+
+            continue;
+        }
+
+        std::string_view value{body.substr(0, static_cast<size_t>(length))};
+        body.remove_prefix(value.size());
+
+        if (format != 0) {
+            _scratch += "<binary " + std::to_string(value.size()) + " bytes>";
+
+            continue;
+        }
+
+        _scratch += '\'';
+
+        for (char c : value.substr(0, MAX_PARAM_VALUE)) {
+            if (c == '\'') {
+                _scratch += '\'';
+            }
+
+            _scratch += c;
+        }
+
+        _scratch += value.size() > MAX_PARAM_VALUE ? "'..." : "'";
+    }
+
+    return _arena.Store(std::string_view(_scratch).substr(0, MAX_PARAMS_TEXT));
+}
+
+void StatementCache::Compact() {
+    Arena arena;
+    std::unordered_map<std::string_view, std::string_view> statements;
+    std::unordered_map<std::string_view, Portal> portals;
+
+    // Живые записи переносятся, пока новая арена занимает не больше половины лимита:
+    // остальные вытесняются, чтобы сжатие не повторялось на каждом сообщении.
+    size_t budget{_max_bytes / 2};
+
+    for (const auto& [name, query] : _statements) {
+        if (arena.GetUsed() + name.size() + query.size() > budget) {
+            break;
+        }
+
+        statements.emplace(arena.Store(name), arena.Store(query));
+    }
+
+    for (const auto& [name, portal] : _portals) {
+        if (arena.GetUsed() + name.size() + portal.query.size() + portal.params.size() > budget) {
+            break;
+        }
+
+        portals.emplace(arena.Store(name), Portal{arena.Store(portal.query), arena.Store(portal.params)});
+    }
+
+    _arena = std::move(arena);
+    _statements = std::move(statements);
+    _portals = std::move(portals);
+}
@@ -0,0 +1,160 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_PROTOCOL_STATEMENT_CACHE_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_PROTOCOL_STATEMENT_CACHE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+#include "frame_parser.h"
+
+/**
+ * @brief Текст выполняемого запроса.
+ */
+struct QueryText {
+    std::string_view query; ///< SQL-текст запроса.
+    std::string_view params; ///< Параметры в виде "$1='a', $2=NULL" (пусто, если не собираются).
+    int64_t latency_us{-1}; ///< Время выполнения запроса в микросекундах (-1 — не измерялось).
+    char type{'Q'}; ///< Тип сообщения: 'Q' (Query) или 'E' (Execute).
+};
+
+/**
+ * @brief Кэш подготовленных операторов и порталов сессии (расширенный протокол запросов).
+ *
+ * Разбирает сообщения Parse, Bind, Close и Execute: Parse запоминает текст оператора по имени,
+ * Bind связывает портал с текстом оператора (и, при необходимости, со строкой параметров),
+ * Execute возвращает текст запроса портала без повторного разбора. Для Query возвращается
+ * текст самого сообщения.
+ *
+ * Имена и тексты хранятся в арене блоками, таблицы содержат string_view на арену. Размер кэша
+ * ограничен по количеству операторов и порталов и по объему арены: при переполнении арены живые
+ * записи переносятся в новую арену, а если их все еще слишком много — вытесняются.
+ * Запрос для вытесненного оператора логируется как "<unknown statement NAME>".
+ */
+class StatementCache {
+public:
+    /**
+     * @brief Конструктор кэша.
+     * @param max_entries Максимальное количество операторов (и отдельно порталов).
+     * @param max_bytes Максимальный объем арены в байтах.
+     */
+    explicit StatementCache(size_t max_entries = 1024, size_t max_bytes = size_t{1} << 20);
+
+    /**
+     * @brief Включает сбор параметров Bind для логирования.
+     * @param capture true — собирать параметры.
+     */
+    void SetCaptureParams(bool capture) noexcept;
+
+    /**
+     * @brief Обрабатывает сообщение клиента.
+     *
+     * @param message Сообщение клиента.
+     * @param text Текст запроса для Query/Execute; действителен до следующего вызова Process().
+     * @return true Если сообщение выполняет запрос (Query или Execute).
+     * @return false Иначе.
+     */
+    bool Process(const FrontendMessage& message, QueryText& text);
+
+private:
+    /**
+     * @brief Портал: текст оператора и параметры.
+     */
+    struct Portal {
+        std::string_view query; ///< Текст запроса.
+        std::string_view params; ///< Строка параметров.
+    };
+
+    /**
+     * @brief Арена строк: блоки памяти, строки никогда не перемещаются.
+     */
+    class Arena {
+    public:
+        /**
+         * @brief Копирует строку в арену.
+         * @param text Строка.
+         * @return std::string_view Копия в арене.
+         */
+        std::string_view Store(std::string_view text);
+
+        /**
+         * @brief Выделяет в арене неинициализированную строку.
+         * @param size Размер.
+         * @return char* Начало выделенной памяти.
+         */
+        char* Allocate(size_t size);
+
+        /**
+         * @brief Возвращает объем, занятый строками.
+         */
+        size_t GetUsed() const noexcept;
+
+    private:
+        static constexpr size_t BLOCK_SIZE{16384}; ///< Размер обычного блока.
+
+        std::vector<std::unique_ptr<char[]>> _blocks; ///< Блоки арены.
+        size_t _block_used{BLOCK_SIZE}; ///< Занято в последнем блоке.
+        size_t _used{}; ///< Всего занято строками.
+    };
+
+    /**
+     * @brief Parse: запоминает текст оператора.
+     * @param body Тело сообщения.
+     * @param truncated Тело усечено (текст запроса сохраняется частично).
+     */
+    void OnParse(std::string_view body, bool truncated);
+
+    /**
+     * @brief Bind: связывает портал с текстом оператора и параметрами.
+     * @param body Тело сообщения.
+     */
+    void OnBind(std::string_view body);
+
+    /**
+     * @brief Close: удаляет оператор или портал.
+     * @param body Тело сообщения.
+     */
+    void OnClose(std::string_view body);
+
+    /**
+     * @brief Execute: возвращает текст запроса портала.
+     * @param body Тело сообщения.
+     * @param text Текст запроса.
+     * @return true Если сообщение разобрано.
+     */
+    bool OnExecute(std::string_view body, QueryText& text);
+
+    /**
+     * @brief Сжимает арену, если в ней не хватает места для bytes байт.
+     * @param bytes Требуемый объем.
+     */
+    void Reserve(size_t bytes);
+
+    /**
+     * @brief Форматирует значения параметров Bind в арену.
+     * @param body Тело Bind, начиная с количества кодов формата.
+     * @return std::string_view Строка параметров или пустая строка при ошибке разбора.
+     */
+    std::string_view FormatParams(std::string_view body);
+
+    /**
+     * @brief Освобождает место в арене: переносит живые записи, при необходимости вытесняет их.
+     */
+    void Compact();
+
+private:
+    size_t _max_entries; ///< Лимит количества записей.
+    size_t _max_bytes; ///< Лимит объема арены.
+    bool _capture_params{false}; ///< Собирать ли параметры Bind.
+
+    Arena _arena; ///< Арена имен и текстов.
+    std::unordered_map<std::string_view, std::string_view> _statements; ///< Имя оператора -> текст.
+    std::unordered_map<std::string_view, Portal> _portals; ///< Имя портала -> портал.
+    std::string _unknown; ///< Текст для неизвестного портала.
+    std::string _scratch; ///< Буфер форматирования параметров.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_PROTOCOL_STATEMENT_CACHE_H
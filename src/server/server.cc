@@ -1,28 +1,65 @@
-#include <atomic>
+#include <thread>
 #include <csignal>
 #include <cstring>
 #include <iostream>
 
 #include <fcntl.h>
+#include <unistd.h>
 #include <arpa/inet.h>
-#include <sys/socket.h>
+#include <sys/eventfd.h>
 
 #include "server.h"
 
 static volatile sig_atomic_t stop_flag = 0;
+static volatile sig_atomic_t drain_flag = 0;
+static int wakeup_fd = -1;
+static Logger* signal_logger = nullptr;
+
+static void wake_up() {
+    uint64_t value{1};
+    [[maybe_unused]] ssize_t n{write(wakeup_fd, &value, sizeof(value))};
+}
 
 void signal_handler(int sig) {
-    if (sig == SIGINT) {
-        stop_flag = 1;
+    if (sig == SIGINT || sig == SIGTERM) {
+        // Первый сигнал начинает плавную остановку, повторный останавливает сразу.
+        if (drain_flag) {
+            stop_flag = 1;
+        } else {
+            drain_flag = 1;
+        }
+
+        wake_up();
+    } else if (sig == SIGHUP && signal_logger) {
+        signal_logger->Reopen();
     }
 }
 
-Server::Server(int listen_port, const std::string& db_host, int db_port, const std::string& log_file) :
-    _listen_port(CheckPort(listen_port)),
-    _db_host(CheckHost(db_host)),
-    _db_port(CheckPort(db_port)),
-    _logger(_db_host, _db_port, log_file)
-{}
+static void request_stop() {
+    stop_flag = 1;
+
+    wake_up();
+}
+
+Server::Server(const Options& options) :
+    _options(options),
+    _logger(options.log),
+    _flow(options.flow),
+    _tls(options.tls),
+    _metrics(options.workers, options.latency),
+    _upstreams(UpstreamAddress{CheckHost(options.db_host), CheckPort(options.db_port)}, options.upstreams,
+               options.replicas, options.health.interval_ms > 0 ? options.health.eject_failures : 0)
+{
+    CheckPort(_options.listen_port);
+
+    if (_options.admin_port != 0) {
+        CheckPort(_options.admin_port);
+    }
+
+    if (_options.workers == 0) {
+        throw std::invalid_argument("Invalid number of workers: 0");
+    }
+}
 
 int Server::CheckPort(int port) {
     if (port > 0 && port <= 65535) {
@@ -42,238 +79,158 @@ std::string Server::CheckHost(const std::string& host) {
     throw std::invalid_argument("Invalid host: " + host);
 }
 
-void Server::SetupEpoll() {
-    _epoll_fd = UniqueFD(epoll_create1(0));
-    
-    if (!_epoll_fd.Valid()) {
-        throw std::runtime_error("SetupEpoll(): " + std::string(strerror(errno)));
+void Server::SetupWakeup() {
+    _wakeup_fd = UniqueFD(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+
+    if (!_wakeup_fd.Valid()) {
+        throw std::runtime_error("SetupWakeup(): " + std::string(strerror(errno)));
     }
+
+    wakeup_fd = _wakeup_fd;
 }
 
-void Server::UpdateEpollEvents(int fd, uint32_t events) {
-    epoll_event event;
-    event.data.fd = fd;
-    event.events = events;
+void Server::Run() {
+    SetupWakeup();
 
-    epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, fd, &event);
-}
+    signal_logger = &_logger;
 
-void Server::SetupServerSocket() {
-    _proxy_fd = UniqueFD(socket(AF_INET, SOCK_STREAM, 0));
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+    std::signal(SIGHUP, signal_handler);
 
-    if (!_proxy_fd.Valid()) {
-        throw std::runtime_error("SetupServerSocket(): " + std::string(strerror(errno)));
-    }
+    // OpenSSL пишет в сокет через write(): разрыв соединения должен вернуть EPIPE, а не завершить процесс.
+    std::signal(SIGPIPE, SIG_IGN);
 
-    int flags{fcntl(_proxy_fd, F_GETFL, 0)};
-    fcntl(_proxy_fd, F_SETFL, flags | O_NONBLOCK);
+    auto is_stopped{[]() { return stop_flag != 0; }};
+    auto is_draining{[]() { return drain_flag != 0; }};
+    auto is_closing{[]() { return drain_flag != 0 || stop_flag != 0; }};
 
-    int opt{1};
+    std::unique_ptr<UpgradeClient> upgrade;
+    std::vector<std::vector<UniqueFD>> listeners(_options.workers);
+    size_t inherited{};
 
-    if (setsockopt(_proxy_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1) {
-        throw std::runtime_error("SetupServerSocket(): " + std::string(strerror(errno)));
+    if (!_options.upgrade_socket.empty()) {
+        upgrade = std::make_unique<UpgradeClient>(_options.upgrade_socket);
     }
 
-    struct sockaddr_in server_addr = {};
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = INADDR_ANY;
-    server_addr.sin_port = htons(_listen_port);
-
-    auto s_addr{reinterpret_cast<struct sockaddr*>(&server_addr)};
+    if (upgrade && upgrade->IsConnected()) {
+        auto fds{upgrade->TakeListeners(_options.listen_port)};
+        inherited = fds.size();
 
-    if (bind(_proxy_fd, s_addr, sizeof(server_addr)) == -1) {
-        throw std::runtime_error("SetupServerSocket(): " + std::string(strerror(errno)));
+        // Все полученные сокеты остаются открытыми: закрытый сокет сбросил бы соединения в своей очереди.
+        // Если рабочих потоков больше, чем сокетов, остальные потоки создают свои (SO_REUSEPORT).
+        for (size_t i{}; i < fds.size(); ++i) {
+            listeners[i % _options.workers].push_back(std::move(fds[i]));
+        }
     }
 
-    if (listen(_proxy_fd, SOMAXCONN) == -1) {
-        throw std::runtime_error("SetupServerSocket(): " + std::string(strerror(errno)));
+    for (size_t id{}; id < _options.workers; ++id) {
+        _workers.push_back(std::make_unique<Worker>(id, _options, _logger, _flow, _tls, _versions, _upstreams,
+                                                    _metrics, _wakeup_fd, is_stopped, is_draining,
+                                                    std::move(listeners[id])));
     }
 
-    epoll_event event;
-    event.events = EPOLLIN | EPOLLET;
-    event.data.fd = _proxy_fd;
-
-    if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _proxy_fd, &event) == -1) {
-        throw std::runtime_error("SetupServerSocket(): " + std::string(strerror(errno)));
-    }
-}
+    if (inherited > 0) {
+        auto backends{upgrade->Finish()};
 
-UniqueFD Server::SetupPGSQLSocket() {
-    UniqueFD pgsql_fd(socket(AF_INET, SOCK_STREAM, 0));
+        for (size_t i{}; i < backends.size(); ++i) {
+            _workers[i % _workers.size()]->AdoptBackend(std::move(backends[i]));
+        }
 
-    if (!pgsql_fd.Valid()) {
-        throw std::runtime_error("SetupPGSQLSocket(): " + std::string(strerror(errno)));
+        std::cout << "Upgrade: took over " << inherited << " listening sockets and " << backends.size()
+                  << " idle pooled connections\n";
     }
 
-    struct sockaddr_in pgsql_addr = {};
-    pgsql_addr.sin_family = AF_INET;
-    pgsql_addr.sin_port = htons(_db_port);
+    upgrade.reset();
 
-    if (inet_pton(AF_INET, _db_host.c_str(), &pgsql_addr.sin_addr) <= 0) {
-        throw std::runtime_error("SetupPGSQLSocket(): " + std::string(strerror(errno)));
+    if (!_options.upgrade_socket.empty()) {
+        SetupUpgrade(is_closing);
     }
 
-    auto p_addr{reinterpret_cast<struct sockaddr*>(&pgsql_addr)};
+    if (_options.admin_port != 0) {
+        // Метрики останавливающегося процесса не отдаются: порт нужен преемнику.
+        _admin = std::make_unique<AdminServer>(_options.admin_port, _metrics, _flow, _logger, _upstreams, _wakeup_fd,
+                                               is_closing);
 
-    if (connect(pgsql_fd, p_addr, sizeof(pgsql_addr))) {
-        throw std::runtime_error("SetupPGSQLSocket(): " + std::string(strerror(errno)));
+        std::cout << "Metrics: http://0.0.0.0:" << _options.admin_port << "/metrics\n";
     }
 
-    int flags{fcntl(pgsql_fd, F_GETFL, 0)};
-    fcntl(pgsql_fd, F_SETFL, flags | O_NONBLOCK);
-
-    epoll_event event;
-    event.events = EPOLLIN | EPOLLET;
-    event.data.fd = pgsql_fd;
+    for (size_t node{1}; node < _upstreams.GetSize(); ++node) {
+        bool replica{_upstreams.GetRole(node) == UpstreamRole::K_REPLICA};
 
-    if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, pgsql_fd, &event) == -1) {
-        throw std::runtime_error("SetupPGSQLSocket(): " + std::string(strerror(errno)));
+        std::cout << (replica ? "Read replica: " : "Upstream: ") << _upstreams.GetName(node) << '\n';
     }
 
-    return pgsql_fd;
-}
+    if (_options.health.interval_ms > 0) {
+        std::cout << "Health checks: every " << _options.health.interval_ms << " ms, eject after "
+                  << _options.health.eject_failures << " consecutive failures\n";
+    }
 
-void Server::AcceptNewConnections() {
-    while (true) {
-        struct sockaddr_in client_addr = {};
-        auto c_addr{reinterpret_cast<sockaddr*>(&client_addr)};
-        socklen_t c_addr_len{sizeof(client_addr)};
+    std::cout << "Waiting...\n";
 
-        UniqueFD client_fd(accept(_proxy_fd, c_addr, &c_addr_len));
+    std::vector<std::thread> workers;
 
-        if (!client_fd.Valid()) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                break;
-            } else if (errno == EINTR) {
-                continue;
-            } else {
-                std::cerr << "accept(): " << strerror(errno) << '\n';
+    for (auto& worker : _workers) {
+        workers.emplace_back([&worker]() {
+            try {
+                worker->Run();
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << '\n';
 
-                break;
+                request_stop();
             }
-        }
-
-        int flags{fcntl(client_fd, F_GETFL, 0)};
-        fcntl(client_fd, F_SETFL, flags | O_NONBLOCK);
-
-        epoll_event event;
-        event.events = EPOLLIN | EPOLLET;
-        event.data.fd = client_fd;
-
-        if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, client_fd, &event) == -1) {
-            std::cerr << "epoll_ctl(): " << strerror(errno) << '\n';
-
-            continue;
-        }
-
-        try {
-            UniqueFD pgsql_fd{SetupPGSQLSocket()};
-
-            auto session{std::make_shared<Session>(std::move(pgsql_fd), std::move(client_fd),
-            [this](int fd, uint32_t events) {
-                UpdateEpollEvents(fd, events);
-            })};
-
-            _fd_session_ht[session->GetPGSQLFD()] = session;
-            _fd_session_ht[session->GetClientFD()] = session;
-
-            Endpoint& client_ep{_fd_endpoint_ht[session->GetClientFD()]};
-            client_ep.ip = inet_ntoa(client_addr.sin_addr);
-            client_ep.port = ntohs(client_addr.sin_port);
-
-            _logger.PrintInTerminal(client_ep, ConnectionStatus::K_OPEN);
-        } catch (const std::exception& e) {
-            std::cerr << "ConnectToPGSQL() connection failed: " << e.what() << '\n';
-        }
+        });
     }
-}
-
-void Server::CloseSession(std::shared_ptr<Session> session) {
-    int pgsql_fd{session->GetPGSQLFD()};
-    int client_fd{session->GetClientFD()};
 
-    epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, pgsql_fd, nullptr);
-    epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, client_fd, nullptr);
+    std::vector<std::thread> services;
 
-    _fd_session_ht.erase(pgsql_fd);
-    _fd_session_ht.erase(client_fd);
-
-    _logger.PrintInTerminal(_fd_endpoint_ht[client_fd], ConnectionStatus::K_CLOSED);
-
-    _fd_endpoint_ht.erase(client_fd);
-}
-
-void Server::HandleEvent(epoll_event& event) {
-    int fd{event.data.fd};
-
-    auto it{_fd_session_ht.find(fd)};
-
-    if (it == _fd_session_ht.end()) {
-        return;
+    if (_admin) {
+        services.emplace_back([this]() {
+            _admin->Run();
+        });
     }
 
-    auto& session{it->second};
-
-    int peer_fd{session->GetPeerFD(fd)};
-
-    if (event.events & EPOLLOUT) {
-        if (!session->TrySend(fd)) {
-            CloseSession(session);
-        }
-
-        return;
+    if (_upgrade) {
+        services.emplace_back([this]() {
+            _upgrade->Run();
+        });
     }
 
-    if (!session->RecvAll(fd)) {
-        CloseSession(session);
-
-        return;
+    for (auto& thread : workers) {
+        thread.join();
     }
 
-    if (session->IsClientFD(fd)) {
-        auto message{session->GetDataToPGSQL()};
-
-        _logger.SaveLogs(_fd_endpoint_ht[fd], message);
-    }
+    // Рабочие потоки завершились: останавливаем и службы, даже если остановку начали не сигналом.
+    request_stop();
 
-    if (!session->TrySend(peer_fd)) {
-        CloseSession(session);
+    for (auto& thread : services) {
+        thread.join();
     }
 }
 
-void Server::EventLoop() {
-    std::cout << "Waiting...\n";
-
-    constexpr size_t MAX_EVENTS{1024};
-    std::vector<epoll_event> events(MAX_EVENTS);
+void Server::SetupUpgrade(UpgradeServer::StopCallback is_stopped) {
+    std::vector<UniqueFD> listeners;
 
-    while (!stop_flag) {
-        int num_events{epoll_wait(_epoll_fd, events.data(), MAX_EVENTS, -1)};
+    for (const auto& worker : _workers) {
+        for (int fd : worker->GetListenFDs()) {
+            UniqueFD copy(fcntl(fd, F_DUPFD_CLOEXEC, 0));
 
-        if (num_events == -1) {
-            if (errno == EINTR) {
-                continue;
+            if (!copy.Valid()) {
+                throw std::runtime_error("SetupUpgrade(): " + std::string(strerror(errno)));
             }
 
-            throw std::runtime_error("epoll_wait(): " + std::string(strerror(errno)));
-        }
-
-        for (int i{}; i < num_events; ++i) {
-            int fd{events[i].data.fd};
-
-            if (fd == _proxy_fd) {
-                AcceptNewConnections();
-            } else {
-                HandleEvent(events[i]);
-            }
+            listeners.push_back(std::move(copy));
         }
     }
-}
 
-void Server::Run() {
-    std::signal(SIGINT, signal_handler);
+    _upgrade = std::make_unique<UpgradeServer>(_options.upgrade_socket, _options.listen_port, std::move(listeners),
+                                               _workers.size(), _wakeup_fd, std::move(is_stopped), []() {
+        drain_flag = 1;
 
-    SetupEpoll();
-    SetupServerSocket();
-    EventLoop();
+        wake_up();
+    });
+
+    for (auto& worker : _workers) {
+        worker->SetUpgradeServer(_upgrade.get());
+    }
 }
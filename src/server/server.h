@@ -4,109 +4,64 @@
 #include <string>
 #include <vector>
 #include <memory>
-#include <string_view>
-#include <unordered_map>
-
-#include <sys/epoll.h>
 
 #include "logger/logger.h"
-#include "session/session.h"
+#include "worker/worker.h"
+#include "options/options.h"
+#include "metrics/metrics.h"
+#include "metrics/admin_server.h"
 #include "unique_fd/unique_fd.h"
-#include "connection/connection.h"
+#include "upgrade/upgrade_client.h"
+#include "upgrade/upgrade_server.h"
 
 /**
  * @class Server
  * @brief Класс для реализации асинхронного прокси-сервера с использованием epoll и подключением к PostgreSQL.
  *
  * Сервер принимает клиентские соединения, устанавливает соединение с PostgreSQL, проксирует данные
- * и логирует запросы. Основан на неблокирующем вводе-выводе и механизме epoll.
+ * и логирует запросы. Основан на неблокирующем вводе-выводе и механизме epoll. Работа распределяется
+ * между несколькими рабочими потоками (Worker), каждый из которых слушает порт через SO_REUSEPORT.
+ * Если задан admin-порт, метрики рабочих потоков отдаются отдельным потоком (AdminServer).
+ * С сертификатом прокси сам завершает TLS клиентов (TlsContext), а с backend-tls шифрует соединения с PostgreSQL.
+ * Серверы PostgreSQL (основные и реплики) и их исправность общие для рабочих потоков (UpstreamRegistry).
+ *
+ * SIGINT и SIGTERM начинают плавную остановку: прием соединений прекращается, сессии закрываются
+ * по завершении транзакций (не дольше drain_timeout_ms); повторный сигнал останавливает сервер сразу.
+ * С upgrade_socket новый процесс забирает у работающего слушающие сокеты и простаивающие соединения
+ * пула (UpgradeClient/UpgradeServer), после чего работающий процесс плавно останавливается.
  */
 class Server {
 public:
     /**
      * @brief Конструктор сервера.
-     * @param listen_port Порт, на котором сервер будет слушать входящие подключения.
-     * @param db_host IP-адрес хоста PostgreSQL.
-     * @param db_port Порт PostgreSQL.
-     * @param log_file Путь к файлу логов.
-     * @throw std::invalid_argument Если передан некорректный порт или хост.
+     * @param options Параметры запуска сервера.
+     * @throw std::invalid_argument Если передан некорректный порт, хост или количество потоков.
+     * @throw std::runtime_error Если не удалось загрузить сертификат или ключ TLS.
      */
-    Server(int listen_port, const std::string& db_host, int db_port, const std::string& log_file);
+    explicit Server(const Options& options);
 
     /**
      * @brief Запускает сервер.
      *
-     * Устанавливает обработчик сигналов, настраивает epoll, серверный сокет и запускает основной цикл обработки событий.
+     * Устанавливает обработчик сигналов, при обновлении забирает сокеты у работающего процесса,
+     * создает рабочие потоки и ожидает их завершения.
+     * @throw std::runtime_error Если не удалось настроить рабочие потоки или получить сокеты при обновлении.
      */
     void Run();
 
 private:
     /**
-     * @brief Создает epoll-дескриптор и проверяет корректность.
-     * @throw std::runtime_error Если epoll не удалось создать.
-     */
-    void SetupEpoll();
-
-    /**
-     * @brief Настраивает серверный сокет для прослушивания клиентских подключений.
-     *
-     * Сокет устанавливается в неблокирующий режим, привязывается к IP/порту, включается опция SO_REUSEADDR
-     * и добавляется в epoll.
-     * @throw std::runtime_error Если не удалось создать, настроить или привязать сокет.
-     */
-    void SetupServerSocket();
-
-    /**
-     * @brief Устанавливает подключение к PostgreSQL.
-     *
-     * Создает сокет, подключается к указанному хосту и порту PostgreSQL, переводит его в неблокирующий режим
-     * и добавляет в epoll для отслеживания событий.
-     * @return Объект UniqueFD с файловым дескриптором PostgreSQL.
-     * @throw std::runtime_error Если не удалось создать или подключить сокет.
-     */
-    UniqueFD SetupPGSQLSocket();
-
-    /**
-     * @brief Основной цикл обработки событий epoll.
-     *
-     * Обрабатывает клиентские подключения и обмен данными между клиентами и PostgreSQL до тех пор,
-     * пока не будет установлен флаг завершения (stop_flag).
-     * @throw std::runtime_error Если epoll_wait вернет ошибку, отличную от EINTR.
-     */
-    void EventLoop();
-
-    /**
-     * @brief Обновляет маску событий для указанного файлового дескриптора в epoll.
-     * @param fd Файловый дескриптор.
-     * @param events Новая маска событий (EPOLLIN, EPOLLOUT и т.д.).
+     * @brief Создает дескриптор пробуждения рабочих потоков (eventfd).
+     * @throw std::runtime_error Если eventfd не удалось создать.
      */
-    void UpdateEpollEvents(int fd, uint32_t events);
+    void SetupWakeup();
 
     /**
-     * @brief Принимает новые клиентские подключения.
-     *
-     * Создает неблокирующий сокет для клиента, добавляет его в epoll,
-     * открывает соединение с PostgreSQL и создает сессию.
-     * В случае ошибок выводит сообщение в stderr.
-     */
-    void AcceptNewConnections();
-
-    /**
-     * @brief Закрывает сессию (клиент + PostgreSQL).
-     * @param session Умный указатель на объект Session.
-     *
-     * Удаляет оба дескриптора из epoll, очищает хэштейблы сессий и эндпоинтов, логирует закрытие соединения.
-     */
-    void CloseSession(std::shared_ptr<Session> session);
-
-    /**
-     * @brief Обрабатывает событие epoll для конкретного дескриптора.
-     * @param event Структура epoll_event, содержащая информацию о событии.
-     *
-     * Выполняет чтение/запись данных, проксирование между клиентом и PostgreSQL,
-     * и логирование сообщений от клиента.
+     * @brief Создает канал обновления с копиями слушающих сокетов рабочих потоков.
+     * @param is_stopped Коллбэк, возвращающий true, если процесс останавливается.
+     * @throw std::runtime_error Если сокеты не удалось скопировать или UNIX-сокет не удалось создать.
      */
-    void HandleEvent(epoll_event& event);
+    void SetupUpgrade(UpgradeServer::StopCallback is_stopped);
 
     /**
      * @brief Проверяет корректность порта.
@@ -125,16 +80,19 @@ private:
     std::string CheckHost(const std::string& host);
 
 private:
-    int _listen_port; ///< Порт для прослушивания клиентских соединений.
-    std::string _db_host; ///< IP-адрес хоста PostgreSQL.
-    int _db_port; ///< Порт PostgreSQL.
+    Options _options; ///< Параметры запуска сервера.
     Logger _logger; ///< Логгер для записи информации о соединениях и сообщениях.
+    FlowControl _flow; ///< Общие границы буферизации сессий.
+    TlsContext _tls; ///< Контексты TLS клиентов и PostgreSQL.
+    TableVersions _versions; ///< Номера изменений таблиц для кэшей результатов рабочих потоков.
+    Metrics _metrics; ///< Счетчики рабочих потоков.
+    UpstreamRegistry _upstreams; ///< Серверы PostgreSQL и их исправность.
 
-    UniqueFD _proxy_fd{}; ///< Файловый дескриптор серверного сокета (слушающего).
-    UniqueFD _epoll_fd{}; ///< Файловый дескриптор epoll.
+    UniqueFD _wakeup_fd{}; ///< eventfd для пробуждения рабочих потоков при остановке.
 
-    std::unordered_map<int, Endpoint> _fd_endpoint_ht; ///< Соотношение клиентский fd <-> структура Endpoint.
-    std::unordered_map<int, std::shared_ptr<Session>> _fd_session_ht; ///< Соотношение fd <-> сессия.
+    std::vector<std::unique_ptr<Worker>> _workers; ///< Рабочие потоки.
+    std::unique_ptr<AdminServer> _admin; ///< HTTP-сервер метрик (nullptr, если admin-порт не задан).
+    std::unique_ptr<UpgradeServer> _upgrade; ///< Канал обновления (nullptr, если upgrade_socket не задан).
 };
 
 #endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_SERVER_H
@@ -1,19 +1,69 @@
 #include <iostream>
 #include <cstring>
+#include <algorithm>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
 
 #include "session.h"
+#include "../pool/pool.h"
 
-Session::Session(UniqueFD&& pgsql_fd, UniqueFD&& client_fd, ModEventsCallback cb) :
-    _pgsql_fd(std::move(pgsql_fd)),
+namespace {
+
+// AuthenticationOk и ReadyForQuery ('I'), которыми прокси отвечает клиенту в режиме пула.
+constexpr char AUTHENTICATION_OK[]{'R', 0, 0, 0, 8, 0, 0, 0, 0};
+constexpr char READY_FOR_QUERY[]{'Z', 0, 0, 0, 5, 'I'};
+constexpr char SSL_NOT_SUPPORTED{'N'};
+constexpr char SSL_SUPPORTED{'S'};
+
+// Длина SSLRequest: до решения о TLS клиент читается не дальше нее, чтобы не захватить начало рукопожатия.
+constexpr size_t SSL_REQUEST_LENGTH{8};
+
+// Порция данных механизма ввода-вывода, с которой его блок забирается в очередь без копирования.
+// Меньшая копируется: блок целиком занимал бы сегмент ради нескольких сообщений.
+constexpr size_t ADOPT_SIZE{Buffer::SEGMENT_SIZE / 4};
+
+// Terminate, которым прокси закрывает соединение с PostgreSQL при остановке.
+constexpr char TERMINATE[]{'X', 0, 0, 0, 4};
+
+// Поля ErrorResponse FATAL 57P01 (admin_shutdown), как при остановке самого PostgreSQL.
+// Завершающий ноль литерала — конец списка полей.
+constexpr char ADMIN_SHUTDOWN_FIELDS[]{"SFATAL\0VFATAL\0C57P01\0Mterminating connection due to administrator command\0"};
+
+// Поля ErrorResponse FATAL 57P05 (idle_session_timeout), как у idle_session_timeout PostgreSQL.
+constexpr char IDLE_TIMEOUT_FIELDS[]{"SFATAL\0VFATAL\0C57P05\0Mterminating connection due to idle-session timeout\0"};
+
+// Поля ErrorResponse FATAL 57P03 (cannot_connect_now): все серверы PostgreSQL исключены.
+constexpr char UNAVAILABLE_FIELDS[]{"SFATAL\0VFATAL\0C57P03\0Mno PostgreSQL server is available\0"};
+
+uint32_t ReadUInt32(std::string_view data) {
+    uint32_t value{};
+    std::memcpy(&value, data.data(), sizeof(value));
+
+    return ntohl(value);
+}
+
+} // namespace
+
+Session::Session(std::unique_ptr<Backend> backend, UniqueFD&& client_fd, ModEventsCallback cb) :
+    _backend(std::move(backend)),
     _client_fd(std::move(client_fd)),
-    _mod_events_cb(cb)
+    _mod_events_cb(cb),
+    _client_handler([this](const FrontendMessage& message) { OnClientMessage(message); }),
+    _pgsql_handler([this](const FrontendMessage& message) { OnPGSQLMessage(message); })
 {}
 
+Session::~Session() {
+    if (_flow && IsThrottled()) {
+        _flow->OnResumed();
+    }
+}
+
 int Session::GetPGSQLFD() const noexcept {
-    return _pgsql_fd;
+    return _backend ? _backend->GetFD() : -1;
 }
 
 int Session::GetClientFD() const noexcept {
@@ -21,50 +71,770 @@ int Session::GetClientFD() const noexcept {
 }
 
 int Session::GetPeerFD(int fd) const noexcept {
-    return fd == _client_fd ? _pgsql_fd : _client_fd;
+    return fd == _client_fd ? GetPGSQLFD() : _client_fd;
 }
 
-std::string_view Session::GetDataToClient() const {
-    return std::string_view(_client_send_buffer.data(), _client_send_buffer.size());
+bool Session::IsPGSQLFD(int fd) const noexcept {
+    return _backend && fd == _backend->GetFD();
 }
 
-std::string_view Session::GetDataToPGSQL() const {
-    return std::string_view(_pgsql_send_buffer.data(), _pgsql_send_buffer.size());
+bool Session::IsClientFD(int fd) const noexcept {
+    return fd == _client_fd;
 }
 
-bool Session::IsPGSQLFD(int fd) const noexcept {
-    return fd == _pgsql_fd;
+bool Session::IsConnecting() const noexcept {
+    return _backend && _backend->IsConnecting();
 }
 
-bool Session::IsClientFD(int fd) const noexcept {
-    return fd == _client_fd;
+bool Session::EnableSplice() {
+    constexpr int PIPE_CAPACITY{1 << 20};
+
+    int fds[2];
+
+    if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) == -1) {
+        std::cerr << "pipe2() error: " << strerror(errno) << '\n';
+
+        return false;
+    }
+
+    _pipe_read = UniqueFD(fds[0]);
+    _pipe_write = UniqueFD(fds[1]);
+
+    int capacity{fcntl(_pipe_write, F_SETPIPE_SZ, PIPE_CAPACITY)};
+
+    if (capacity == -1) {
+        capacity = fcntl(_pipe_write, F_GETPIPE_SZ);
+    }
+
+    _pipe_capacity = capacity > 0 ? static_cast<size_t>(capacity) : 0;
+
+    return true;
+}
+
+void Session::SetMessageCallback(FrameParser::Callback cb) {
+    _message_cb = std::move(cb);
+}
+
+StatementCache& Session::GetStatementCache() noexcept {
+    return _statement_cache;
+}
+
+void Session::SetEndpoint(const Endpoint& endpoint) {
+    _endpoint = endpoint;
+}
+
+const Endpoint& Session::GetEndpoint() const noexcept {
+    return _endpoint;
+}
+
+void Session::SetFlowControl(FlowControl* flow) noexcept {
+    _flow = flow;
+}
+
+void Session::SetMetrics(WorkerMetrics* metrics) noexcept {
+    _metrics = metrics;
+}
+
+void Session::EnableTls(const TlsContext* context) noexcept {
+    _tls = context;
+}
+
+TlsStream* Session::GetTls(int fd) const noexcept {
+    if (IsClientFD(fd)) {
+        return _client_tls.get();
+    }
+
+    return _backend ? _backend->GetTls() : nullptr;
+}
+
+bool Session::CanSplice() const noexcept {
+    return _pipe_write.Valid() && (!_client_tls || _client_tls->IsKernelSend());
+}
+
+bool Session::CanStream(int fd) const noexcept {
+    if (_pipe_write.Valid()) {
+        return false;
+    }
+
+    if (IsClientFD(fd)) {
+        return !_tls;
+    }
+
+    return IsPGSQLFD(fd) && !_pooling && !_backend->IsConnecting() && !_backend->GetTls();
+}
+
+void Session::EnableStream(int fd) noexcept {
+    (IsClientFD(fd) ? _client_stream : _pgsql_stream) = true;
+}
+
+void Session::SetSendCallback(SendCallback cb) {
+    _send_cb = std::move(cb);
+}
+
+bool Session::IsStream(int fd) const noexcept {
+    return IsClientFD(fd) ? _client_stream : IsPGSQLFD(fd) && _pgsql_stream;
+}
+
+ssize_t Session::Receive(int fd, char* data, size_t size) {
+    TlsStream* tls{GetTls(fd)};
+
+    return tls ? tls->Read(data, size) : recv(fd, data, size, 0);
+}
+
+ssize_t Session::Send(int fd, const iovec* iov, size_t count) {
+    TlsStream* tls{GetTls(fd)};
+
+    if (!tls || tls->IsKernelSend()) {
+        msghdr msg = {};
+        msg.msg_iov = const_cast<iovec*>(iov);
+        msg.msg_iovlen = count;
+
+        return sendmsg(fd, &msg, MSG_NOSIGNAL);
+    }
+
+    // OpenSSL шифрует каждый вызов отдельно: сегменты отправляются по одному, пока сокет их принимает.
+    ssize_t total{};
+
+    for (size_t i{}; i < count; ++i) {
+        ssize_t n{tls->Write(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len)};
+
+        if (n <= 0) {
+            return total > 0 ? total : n;
+        }
+
+        total += n;
+
+        if (static_cast<size_t>(n) < iov[i].iov_len) {
+            break;
+        }
+    }
+
+    return total;
+}
+
+bool Session::AcceptTls() {
+    _tls_requested = false;
+
+    // Ответ уходит открытым текстом до рукопожатия. Клиент ждет его, ничего не отправляя,
+    // а очередь отправки только что принятого сокета пуста, поэтому байт помещается сразу.
+    if (send(_client_fd, &SSL_SUPPORTED, 1, MSG_NOSIGNAL) != 1) {
+        std::cerr << "send() error to client: " << strerror(errno) << '\n';
+
+        return false;
+    }
+
+    try {
+        _client_tls = _tls->AcceptClient(_client_fd);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+
+        return false;
+    }
+
+    return true;
+}
+
+int Session::ContinueHandshake() {
+    int result{_client_tls->Handshake()};
+
+    if (result == 0) {
+        UpdateEpoll(_client_fd);
+
+        return 0;
+    }
+
+    if (_metrics) {
+        if (result == -1) {
+            _metrics->tls_failures.Add();
+        } else {
+            _metrics->tls_handshakes.Add();
+
+            if (_client_tls->IsKernelSend()) {
+                _metrics->tls_kernel_send.Add();
+            }
+
+            if (_client_tls->IsKernelRecv()) {
+                _metrics->tls_kernel_recv.Add();
+            }
+        }
+    }
+
+    if (result == 1) {
+        UpdateEpoll(_client_fd);
+    }
+
+    return result;
+}
+
+void Session::EnableLatency(LatencyStats* stats) noexcept {
+    _queries.Enable(stats);
+}
+
+void Session::TrackQuery(char type, const QueryText& text, LatencyStats::Entry* entry, bool log) {
+    _queries.OnQuery(type, text, entry, log);
+}
+
+void Session::SetQueryDoneCallback(QueryTracker::Callback cb) {
+    _query_done_cb = std::move(cb);
+}
+
+void Session::FlushQueries() {
+    _queries.Flush(_query_done_cb);
+}
+
+void Session::EnableResultCache(ResultCache* cache) noexcept {
+    _cache = cache;
+}
+
+bool Session::IsQueryCandidate(const FrontendMessage& message) const noexcept {
+    // Счетчик Sync уже учел это сообщение: других ожидающих ответа запросов нет.
+    return message.type == 'Q' && !message.truncated && _ready_for_query && !_startup_pending &&
+           _transaction_status == 'I' && _pending_syncs == 1 && !_unsynced;
+}
+
+void Session::InspectQuery(const FrontendMessage& message, const QueryClass& query_class) {
+    if (message.type == 'Q' && !message.truncated && query_class.read_only) {
+        _replica_candidate = message.length + size_t{1};
+    }
+
+    if (!_cache) {
+        return;
+    }
+
+    if (query_class.session_state) {
+        _cache_bypass = true;
+    }
+
+    // Конец усеченного запроса не виден: он может изменить что угодно.
+    bool all{message.truncated || query_class.access == QueryAccess::K_WRITE_ALL};
+
+    if (all || query_class.access == QueryAccess::K_WRITE) {
+        _cache->Invalidate(query_class.tables, all);
+        _written_all = _written_all || all;
+
+        for (uint16_t table : query_class.tables) {
+            if (std::find(_written_tables.begin(), _written_tables.end(), table) == _written_tables.end()) {
+                _written_tables.push_back(table);
+            }
+        }
+
+        return;
+    }
+
+    if (message.type != 'Q' || query_class.access != QueryAccess::K_READ || _cache_bypass || _capturing ||
+        _startup_params.empty()) {
+        return;
+    }
+
+    // Номер изменения берется до отправки: ответ, который мог застать более позднее изменение, не сохранится.
+    _cache_query.key.assign(_startup_params);
+    _cache_query.key.push_back('\0');
+    _cache_query.key.append(query_class.normalized);
+    _cache_query.tables = query_class.tables;
+    _cache_query.sequence = _cache->GetSequence();
+    _cache_candidate = message.length + 1;
+}
+
+bool Session::CanUseReplica() const noexcept {
+    // В очереди ровно этот Query, а ответы на предыдущие запросы получены вне транзакции.
+    return _replica_candidate > 0 && _pgsql_send_buffer.Size() == _replica_candidate && _pending_syncs == 1 &&
+           !_unsynced && !_startup_pending && _transaction_status == 'I';
+}
+
+void Session::ResolveCachedQuery() {
+    size_t length{_cache_candidate};
+    _cache_candidate = 0;
+
+    bool alone{_pgsql_send_buffer.Size() == length && _pending_syncs == 1 && !_unsynced && _ready_for_query &&
+               !_startup_pending && _transaction_status == 'I' && !_capturing &&
+               _pgsql_parser.GetState() == FrameParser::State::K_MESSAGES && _pgsql_parser.IsAtBoundary()};
+
+    if (!alone) {
+        return;
+    }
+
+    if (const std::string* response{_cache->Find(_cache_query)}) {
+        _pgsql_send_buffer.Consume(length);
+        _client_send_buffer.Append(response->data(), response->size());
+
+        // Ответ проходит тот же разбор, что и ответ сервера: ReadyForQuery завершает запрос и его задержку.
+        _pgsql_parser.Feed(*response, _pgsql_handler);
+
+        return;
+    }
+
+    _capturing = true;
+    _capture_failed = false;
+    _capture_parsed = 0;
+    _capture.clear();
+}
+
+void Session::OnCapturedMessage(const FrontendMessage& message) {
+    _capture_parsed += message.length + size_t{1};
+
+    // Кэшируются только строки: ошибка, уведомление или смена параметров сервера ответ не повторяют.
+    if (message.type != 'T' && message.type != 'D' && message.type != 'C' && message.type != 'Z') {
+        _capture_failed = true;
+    }
+
+    if (message.type != 'Z') {
+        return;
+    }
+
+    _capturing = false;
+
+    if (!_capture_failed && !message.body.empty() && message.body[0] == 'I') {
+        // За ReadyForQuery в той же порции могут идти асинхронные сообщения: они в ответ не входят.
+        _capture.resize(_capture_parsed);
+        _cache->Store(std::move(_cache_query), std::move(_capture));
+    }
+
+    _capture.clear();
+}
+
+bool Session::IsThrottled() const noexcept {
+    return _client_paused || _pgsql_paused;
+}
+
+bool Session::IsWaitingBudget() const noexcept {
+    if (!_flow) {
+        return false;
+    }
+
+    size_t low{_flow->GetLowWatermark()};
+
+    return (_client_paused && _pgsql_send_buffer.Size() <= low) ||
+           (_pgsql_paused && _client_send_buffer.Size() <= low);
+}
+
+bool Session::ShouldPause(const Buffer& buffer) const noexcept {
+    return _flow && (buffer.Size() >= _flow->GetHighWatermark() || _flow->IsOverBudget());
+}
+
+void Session::SetPaused(int fd, bool paused) {
+    bool& flag{IsClientFD(fd) ? _client_paused : _pgsql_paused};
+
+    if (flag == paused) {
+        return;
+    }
+
+    bool was_throttled{IsThrottled()};
+    flag = paused;
+
+    if (was_throttled != IsThrottled()) {
+        paused ? _flow->OnThrottled() : _flow->OnResumed();
+    }
+
+    UpdateEpoll(fd);
+}
+
+void Session::ResumeReading() {
+    if (!IsThrottled()) {
+        return;
+    }
+
+    if (!_flow->HasHeadroom()) {
+        return;
+    }
+
+    size_t low{_flow->GetLowWatermark()};
+
+    if (_client_paused && _pgsql_send_buffer.Size() <= low) {
+        SetPaused(_client_fd, false);
+    }
+
+    if (_pgsql_paused && _backend && _client_send_buffer.Size() <= low) {
+        SetPaused(_backend->GetFD(), false);
+    }
+}
+
+bool Session::FinishConnect() {
+    if (!_backend->IsNegotiating() && !_backend->FinishConnect()) {
+        return false;
+    }
+
+    if (_backend->IsNegotiating()) {
+        int result{_backend->ContinueTls()};
+
+        if (result == -1) {
+            return false;
+        } else if (result == 0) {
+            UpdateEpoll(_backend->GetFD());
+
+            return true;
+        }
+    }
+
+    return TrySend(_backend->GetFD());
+}
+
+void Session::EnablePooling() {
+    _pooling = true;
+    _track_transactions = true;
+}
+
+void Session::EnableTransactionTracking() noexcept {
+    _track_transactions = true;
+}
+
+bool Session::IsIdle() const noexcept {
+    bool parsed{_client_parser.GetState() == FrameParser::State::K_MESSAGES &&
+                _pgsql_parser.GetState() == FrameParser::State::K_MESSAGES};
+
+    return _track_transactions && parsed && _ready_for_query && !_startup_pending && !_unsynced &&
+           _pending_syncs == 0 && _transaction_status == 'I' && !IsConnecting() && _pgsql_send_buffer.Empty() &&
+           _client_send_buffer.Empty() && _pipe_size == 0;
+}
+
+void Session::NotifyShutdown() {
+    NotifyClose(ADMIN_SHUTDOWN_FIELDS, sizeof(ADMIN_SHUTDOWN_FIELDS));
+}
+
+void Session::NotifyIdleTimeout() {
+    NotifyClose(IDLE_TIMEOUT_FIELDS, sizeof(IDLE_TIMEOUT_FIELDS));
+}
+
+void Session::NotifyUnavailable() {
+    NotifyClose(UNAVAILABLE_FIELDS, sizeof(UNAVAILABLE_FIELDS));
+}
+
+void Session::NotifyClose(const char* fields, size_t size) {
+    uint32_t length{htonl(static_cast<uint32_t>(sizeof(uint32_t) + size))};
+
+    _client_send_buffer.Append("E", 1);
+    _client_send_buffer.Append(reinterpret_cast<const char*>(&length), sizeof(length));
+    _client_send_buffer.Append(fields, size);
+
+    // Соединение пула переживет сессию, поэтому Terminate отправляется только собственному соединению.
+    if (_backend && !_pooling) {
+        _pgsql_send_buffer.Append(TERMINATE, sizeof(TERMINATE));
+    }
+}
+
+bool Session::IsWaitingResponse() const noexcept {
+    return _track_transactions && _pending_syncs > 0;
+}
+
+uint64_t Session::GetReadyCount() const noexcept {
+    return _ready_count;
+}
+
+SessionTimer& Session::GetTimer() noexcept {
+    return _timer;
+}
+
+bool Session::HasBackend() const noexcept {
+    return _backend != nullptr;
+}
+
+const Backend* Session::GetBackend() const noexcept {
+    return _backend.get();
+}
+
+void Session::AttachBackend(std::unique_ptr<Backend> backend) {
+    _backend = std::move(backend);
+    // Счетчики Q/Sync не сбрасываются: сообщения, ради которых выдано соединение, уже учтены.
+    _pgsql_parser = FrameParser(16, FrameParser::State::K_MESSAGES);
+
+    if (_startup_pending) {
+        CompleteStartup(_backend->GetParameters());
+    }
+}
+
+std::unique_ptr<Backend> Session::DetachBackend() {
+    // Приостановка чтения относится к этой сессии, а не к соединению, уходящему в пул.
+    if (_pgsql_paused) {
+        _pgsql_paused = false;
+
+        if (!_client_paused) {
+            _flow->OnResumed();
+        }
+    }
+
+    return std::move(_backend);
+}
+
+bool Session::NeedsBackend() const noexcept {
+    return _pooling && !_backend && (_startup_pending || (!_user.empty() && !_pgsql_send_buffer.Empty()));
+}
+
+bool Session::CanReleaseBackend() const noexcept {
+    // Если один из потоков перестал разбираться, состояние соединения неизвестно: в пул его не вернуть.
+    bool parsed{_client_parser.GetState() == FrameParser::State::K_MESSAGES &&
+                _pgsql_parser.GetState() == FrameParser::State::K_MESSAGES};
+
+    return _pooling && _backend && _backend->IsReady() && parsed && !_startup_pending && !_unsynced &&
+           _pending_syncs == 0 && _transaction_status == 'I' && _pgsql_send_buffer.Empty();
+}
+
+bool Session::IsStartupPending() const noexcept {
+    return _startup_pending;
+}
+
+void Session::CompleteStartup(std::string_view parameters) {
+    _client_send_buffer.Append(AUTHENTICATION_OK, sizeof(AUTHENTICATION_OK));
+    _client_send_buffer.Append(parameters.data(), parameters.size());
+    _client_send_buffer.Append(READY_FOR_QUERY, sizeof(READY_FOR_QUERY));
+
+    _startup_pending = false;
+    _ready_for_query = true;
+}
+
+const std::string& Session::GetPoolKey() const noexcept {
+    return _pool_key;
+}
+
+const std::string& Session::GetUser() const noexcept {
+    return _user;
+}
+
+const std::string& Session::GetDatabase() const noexcept {
+    return _database;
+}
+
+bool Session::IsWaitingBackend() const noexcept {
+    return _waiting_backend;
+}
+
+void Session::SetWaitingBackend(bool waiting) noexcept {
+    _waiting_backend = waiting;
+}
+
+void Session::OnClientStartup(const FrontendMessage& message) {
+    _discard_front += message.length;
+
+    uint32_t code{message.body.size() >= 4 ? ReadUInt32(message.body) : 0};
+
+    if (code == FrameParser::SSL_REQUEST_CODE || code == FrameParser::GSSENC_REQUEST_CODE) {
+        _client_send_buffer.Append(&SSL_NOT_SUPPORTED, 1);
+
+        return;
+    }
+
+    if (code != FrameParser::PROTOCOL_VERSION_3) {
+        return;
+    }
+
+    ParseStartupParameters(message.body.substr(4));
+
+    _pool_key = BackendPool::MakeKey(_user, _database);
+    _startup_pending = !_user.empty();
+}
+
+void Session::ParseStartupParameters(std::string_view params) {
+    _startup_params = std::string(params);
+
+    while (!params.empty() && params[0] != '\0') {
+        size_t name_end{params.find('\0')};
+        size_t value_end{name_end == std::string_view::npos ? name_end : params.find('\0', name_end + 1)};
+
+        if (value_end == std::string_view::npos) {
+            break;
+        }
+
+        std::string_view name{params.substr(0, name_end)};
+        std::string_view value{params.substr(name_end + 1, value_end - name_end - 1)};
+
+        if (name == "user") {
+            _user = std::string(value);
+        } else if (name == "database") {
+            _database = std::string(value);
+        }
+
+        params.remove_prefix(value_end + 1);
+    }
+
+    if (_database.empty()) {
+        _database = _user;
+    }
+}
+
+void Session::OnClientMessage(const FrontendMessage& message) {
+    // Реплике достается только последнее сообщение клиента: любое следующее снимает отметку.
+    _replica_candidate = 0;
+
+    if (_metrics) {
+        _metrics->OnClientMessage(message.type);
+    }
+
+    if (message.type == '\0' && _tls && !_client_tls && message.body.size() >= 4 &&
+        ReadUInt32(message.body) == FrameParser::SSL_REQUEST_CODE) {
+        // TLS клиента завершает прокси: SSLRequest не уходит в PostgreSQL, ответ отправит RecvAll().
+        _discard_front += message.length;
+        _tls_requested = true;
+
+        return;
+    }
+
+    if (_pooling) {
+        if (message.type == '\0') {
+            OnClientStartup(message);
+
+            return;
+        }
+
+        if (message.type == 'X') {
+            // Terminate закрывает только клиента: соединение с PostgreSQL остается в пуле.
+            _discard_back += message.length + 1;
+
+            return;
+        }
+    }
+
+    // Без пула этап запуска уходит в PostgreSQL как есть, а параметры нужны только для ключа кэша.
+    if (_cache && message.type == '\0' && !message.truncated && message.body.size() >= 4 &&
+        ReadUInt32(message.body) == FrameParser::PROTOCOL_VERSION_3) {
+        ParseStartupParameters(message.body.substr(4));
+    }
+
+    if (_track_transactions) {
+        switch (message.type) {
+            case 'Q':
+            case 'S':
+                ++_pending_syncs;
+                _unsynced = false;
+                break;
+            case 'P':
+            case 'B':
+            case 'E':
+            case 'D':
+            case 'C':
+            case 'H':
+                _unsynced = true;
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (_message_cb) {
+        _message_cb(message);
+    }
+
+    if (message.type == 'S' && _queries.IsEnabled()) {
+        _queries.OnSync();
+    } else if (message.type == '\0' && message.body.size() >= 4 && (_track_transactions || _queries.IsEnabled())) {
+        // На SSLRequest/GSSENCRequest сервер отвечает одним байтом без заголовка сообщения.
+        uint32_t code{ReadUInt32(message.body)};
+
+        _ssl_answer_pending = code == FrameParser::SSL_REQUEST_CODE || code == FrameParser::GSSENC_REQUEST_CODE;
+    }
+}
+
+void Session::OnPGSQLMessage(const FrontendMessage& message) {
+    _queries.OnBackendMessage(message.type, _query_done_cb);
+
+    if (_capturing) {
+        OnCapturedMessage(message);
+    }
+
+    if (message.type != 'Z') {
+        return;
+    }
+
+    if (_pending_syncs > 0) {
+        --_pending_syncs;
+    }
+
+    _transaction_status = message.body.empty() ? 'E' : message.body[0];
+    _ready_for_query = true;
+    ++_ready_count;
+
+    // Изменения видны другим сессиям только после фиксации: результаты, прочитанные до нее, тоже устарели.
+    if (_transaction_status == 'I' && (_written_all || !_written_tables.empty())) {
+        _cache->Invalidate(_written_tables, _written_all);
+        _written_tables.clear();
+        _written_all = false;
+    }
 }
 
 void Session::UpdateEpoll(int fd) {
+    if (!IsClientFD(fd) && !IsPGSQLFD(fd)) {
+        return;
+    }
+
     auto& buffer{IsClientFD(fd) ? _client_send_buffer : _pgsql_send_buffer};
 
-    uint32_t events{EPOLLIN | EPOLLET};
+    bool paused{IsClientFD(fd) ? _client_paused : _pgsql_paused};
+    uint32_t events{paused ? EPOLLET : EPOLLIN | EPOLLET};
+
+    TlsStream* tls{GetTls(fd)};
+    bool pending{!buffer.Empty() || (IsClientFD(fd) && _pipe_size > 0) || (tls && tls->WantsWrite())};
 
-    if (!buffer.empty()) {
+    // Готовность к записи сокету механизма ввода-вывода не нужна: отправку завершает OnSent().
+    if ((pending && !IsStream(fd)) || (IsPGSQLFD(fd) && IsConnecting())) {
         events |= EPOLLOUT;
     }
 
+    uint32_t current{IsClientFD(fd) ? _client_events : _backend->GetEvents()};
+
+    if (events == current) {
+        return;
+    }
+
+    if (IsClientFD(fd)) {
+        _client_events = events;
+    } else {
+        _backend->SetEvents(events);
+    }
+
     _mod_events_cb(fd, events);
 }
 
 bool Session::TrySend(int fd) {
     auto& buffer{IsClientFD(fd) ? _client_send_buffer : _pgsql_send_buffer};
 
-    while (!buffer.empty()) {
-        ssize_t n{send(fd, buffer.data(), buffer.size(), MSG_NOSIGNAL)};
-        
+    if (!IsClientFD(fd) && !IsPGSQLFD(fd)) {
+        return true;
+    }
+
+    if (IsPGSQLFD(fd) && IsConnecting()) {
+        UpdateEpoll(fd);
+
+        return true;
+    }
+
+    if (IsClientFD(fd) && _client_tls && !_client_tls->IsEstablished()) {
+        return ContinueHandshake() != -1;
+    }
+
+    if (IsStream(fd)) {
+        return SubmitSend(fd, buffer);
+    }
+
+    if (IsClientFD(fd) && _pipe_size > 0) {
+        int flushed{FlushPipe()};
+
+        if (flushed == -1) {
+            return false;
+        } else if (flushed == 0) {
+            UpdateEpoll(fd);
+
+            return true;
+        }
+    }
+
+    constexpr size_t MAX_IOVECS{64};
+
+    while (!buffer.Empty()) {
+        iovec iov[MAX_IOVECS];
+        size_t count{buffer.FillIovecs(iov, MAX_IOVECS)};
+
+        ssize_t n{Send(fd, iov, count)};
+
         if (n > 0) {
-            buffer.erase(buffer.begin(), buffer.begin() + n);
+            buffer.Consume(n);
+
+            if (_metrics) {
+                (IsClientFD(fd) ? _metrics->bytes_to_client : _metrics->bytes_to_pgsql).Add(n);
+            }
         } else if (n == -1) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                UpdateEpoll(fd);
+                if (_metrics) {
+                    _metrics->send_eagain.Add();
+                }
 
-                return true;
+                break;
             } else if (errno == EINTR) {
                 continue;
             }
@@ -76,24 +846,191 @@ bool Session::TrySend(int fd) {
     }
 
     UpdateEpoll(fd);
+    ResumeReading();
+
+    return true;
+}
+
+bool Session::SubmitSend(int fd, Buffer& buffer) {
+    constexpr size_t MAX_IOVECS{256};
+
+    size_t& sending{IsClientFD(fd) ? _client_sending : _pgsql_sending};
+
+    if (sending == 0 && !buffer.Empty()) {
+        iovec iov[MAX_IOVECS];
+        size_t count{buffer.FillIovecs(iov, MAX_IOVECS)};
+        size_t size{};
+
+        for (size_t i{}; i < count; ++i) {
+            size += iov[i].iov_len;
+        }
+
+        if (!_send_cb(fd, iov, count)) {
+            std::cerr << "Poller::Send() error: " << strerror(errno) << '\n';
+
+            return false;
+        }
+
+        sending = size;
+    }
+
+    ResumeReading();
+
+    return true;
+}
+
+bool Session::OnSent(int fd, size_t size) {
+    if (!IsClientFD(fd) && !IsPGSQLFD(fd)) {
+        return true;
+    }
+
+    auto& buffer{IsClientFD(fd) ? _client_send_buffer : _pgsql_send_buffer};
+
+    (IsClientFD(fd) ? _client_sending : _pgsql_sending) = 0;
+    buffer.Consume(size);
+
+    if (_metrics) {
+        (IsClientFD(fd) ? _metrics->bytes_to_client : _metrics->bytes_to_pgsql).Add(size);
+    }
+
+    return TrySend(fd);
+}
+
+int Session::FlushPipe() {
+    while (_pipe_size > 0) {
+        ssize_t n{splice(_pipe_read, nullptr, _client_fd, nullptr, _pipe_size, SPLICE_F_MOVE | SPLICE_F_NONBLOCK)};
+
+        if (n > 0) {
+            _pipe_size -= n;
+
+            if (_metrics) {
+                _metrics->bytes_to_client.Add(n);
+            }
+        } else if (n == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (_metrics) {
+                    _metrics->send_eagain.Add();
+                }
+
+                return 0;
+            } else if (errno == EINTR) {
+                continue;
+            }
+
+            std::cerr << "splice() error to client: " << strerror(errno) << '\n';
+
+            return -1;
+        } else {
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+bool Session::SpliceToClient() {
+    while (_pipe_size == 0 && _client_send_buffer.Empty()) {
+        ssize_t n{splice(_backend->GetFD(), nullptr, _pipe_write, nullptr, _pipe_capacity, SPLICE_F_MOVE | SPLICE_F_NONBLOCK)};
+
+        if (n > 0) {
+            _pipe_size += n;
+
+            if (_metrics) {
+                _metrics->bytes_from_pgsql.Add(n);
+            }
+
+            if (FlushPipe() == -1) {
+                return false;
+            }
+        } else if (n == 0) {
+            return false;
+        } else {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (_metrics) {
+                    _metrics->recv_eagain.Add();
+                }
+
+                return true;
+            } else if (errno == EINTR) {
+                continue;
+            }
+
+            std::cerr << "splice() error from PostgreSQL: " << strerror(errno) << '\n';
+
+            return false;
+        }
+    }
 
     return true;
 }
 
 bool Session::RecvAll(int fd) {
+    if (IsClientFD(fd) && _client_tls && !_client_tls->IsEstablished()) {
+        int handshake{ContinueHandshake()};
+
+        if (handshake != 1) {
+            return handshake == 0;
+        }
+    }
+
+    if (IsPGSQLFD(fd) && CanSplice()) {
+        if (!SpliceToClient()) {
+            return false;
+        }
+
+        if (_pipe_size == 0 && _client_send_buffer.Empty()) {
+            return true;
+        }
+    }
+
     auto& buffer{IsClientFD(fd) ? _pgsql_send_buffer : _client_send_buffer};
-    constexpr size_t BUFFER_SIZE{4096};
+
+    if (IsClientFD(fd) ? _client_paused : _pgsql_paused) {
+        return true;
+    }
+
+    TlsStream* tls{GetTls(fd)};
 
     while (true) {
-        char temp[BUFFER_SIZE];
-        ssize_t n{recv(fd, temp, sizeof(temp), 0)};
+        // Расшифрованные данные, оставшиеся в OpenSSL, Poller не увидит: их дочитываем и сверх границы.
+        if (ShouldPause(buffer) && !(tls && tls->HasPending())) {
+            // Получатель не успевает: данные остаются в сокете-источнике, а не в памяти прокси.
+            SetPaused(fd, true);
+
+            break;
+        }
+
+        auto [data, size]{buffer.PrepareWrite()};
+        bool probe{IsClientFD(fd) && _tls && !_client_tls && _tls_probe < SSL_REQUEST_LENGTH};
+
+        if (probe) {
+            size = std::min(size, SSL_REQUEST_LENGTH - _tls_probe);
+        }
+
+        ssize_t n{Receive(fd, data, size)};
 
         if (n > 0) {
-            buffer.insert(buffer.end(), temp, temp + n);
+            if (probe) {
+                _tls_probe += n;
+            }
+
+            buffer.CommitWrite(n);
+            ProcessReceived(fd, buffer, data, n);
+
+            // Рукопожатие начинается сразу: ClientHello может уже лежать в сокете.
+            if (_tls_requested) {
+                return AcceptTls() && RecvAll(fd);
+            }
         } else if (n == 0) {
             return false;
         } else {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                buffer.ReleaseUnused();
+
+                if (_metrics) {
+                    _metrics->recv_eagain.Add();
+                }
+
                 break;
             } else if (errno == EINTR) {
                 continue;
@@ -107,3 +1044,81 @@ bool Session::RecvAll(int fd) {
 
     return true;
 }
+
+void Session::OnReceived(int fd, char* data, size_t size, std::unique_ptr<char[]>* block) {
+    auto& buffer{IsClientFD(fd) ? _pgsql_send_buffer : _client_send_buffer};
+
+    if (block && size >= ADOPT_SIZE) {
+        buffer.AdoptSegment(*block, size);
+        ProcessReceived(fd, buffer, data, size);
+    } else {
+        while (size > 0) {
+            auto [chunk, space]{buffer.PrepareWrite()};
+            size_t n{std::min(size, space)};
+
+            std::memcpy(chunk, data, n);
+            buffer.CommitWrite(n);
+            ProcessReceived(fd, buffer, chunk, n);
+
+            data += n;
+            size -= n;
+        }
+    }
+
+    if (ShouldPause(buffer)) {
+        SetPaused(fd, true);
+    }
+}
+
+void Session::ProcessReceived(int fd, const Buffer& buffer, char* data, size_t n) {
+    if (_metrics) {
+        bool from_client{IsClientFD(fd)};
+
+        (from_client ? _metrics->bytes_from_client : _metrics->bytes_from_pgsql).Add(n);
+        (from_client ? _metrics->pgsql_queue_peak : _metrics->client_queue_peak).Max(buffer.Size());
+    }
+
+    if (IsClientFD(fd)) {
+        _client_parser.Feed(std::string_view(data, n), _client_handler);
+
+        // Этап запуска и Terminate в режиме пула обслуживает прокси: они не уходят в PostgreSQL.
+        // Буфер меняется только после разбора, пока на его память не указывают сообщения.
+        if (_discard_front > 0 || _discard_back > 0) {
+            _pgsql_send_buffer.Consume(_discard_front);
+            _pgsql_send_buffer.DropBack(_discard_back);
+            _discard_front = 0;
+            _discard_back = 0;
+        }
+
+        if (_cache_candidate > 0) {
+            ResolveCachedQuery();
+        }
+    } else if (_track_transactions || _queries.IsEnabled()) {
+        std::string_view chunk(data, n);
+
+        if (_ssl_answer_pending) {
+            _ssl_answer_pending = false;
+
+            // 'N' — отказ, клиент повторит этап запуска открытым текстом; иначе поток шифруется.
+            if (chunk[0] != 'N') {
+                _queries.Disable();
+                _track_transactions = false;
+            }
+
+            chunk.remove_prefix(1);
+        }
+
+        if (_capturing && !_capture_failed) {
+            if (_capture.size() + chunk.size() > _cache->GetMaxEntry()) {
+                _capture_failed = true;
+                std::string().swap(_capture);
+            } else {
+                _capture.append(chunk);
+            }
+        }
+
+        if (_track_transactions || _queries.IsEnabled()) {
+            _pgsql_parser.Feed(chunk, _pgsql_handler);
+        }
+    }
+}
@@ -2,35 +2,114 @@
 #define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_SESSION_SESSION_H
 
 #include <string>
+#include <memory>
 #include <vector>
+#include <cstdint>
 #include <functional>
 
+#include <sys/epoll.h>
+
+#include "../buffer/buffer.h"
+#include "../flow/flow_control.h"
+#include "../metrics/metrics.h"
+#include "../latency/query_tracker.h"
+#include "../backend/backend.h"
+#include "../protocol/frame_parser.h"
+#include "../protocol/statement_cache.h"
 #include "../unique_fd/unique_fd.h"
+#include "../timer/timer_wheel.h"
+#include "../tls/tls_context.h"
+#include "../connection/connection.h"
+#include "../cache/result_cache.h"
+
+/**
+ * @brief Таймаут, который отсчитывает таймер сессии.
+ */
+enum class SessionTimeout : uint8_t {
+    K_NONE, ///< Таймер не взведен
+    K_CONNECT, ///< Подключение к PostgreSQL
+    K_QUERY, ///< Ответ PostgreSQL на запрос
+    K_IDLE ///< Простой сессии
+};
+
+/**
+ * @brief Таймер сессии. Взводит и обрабатывает Worker.
+ *
+ * Отсчет ведется от since: при каждом событии сессии Worker только сдвигает since, а таймер в колесе
+ * остается на прежнем сроке. Когда он истекает, срок пересчитывается (since + таймаут), и таймер
+ * переставляется, если сессия была активна. Так колесо меняется не чаще одного раза за таймаут.
+ */
+struct SessionTimer {
+    TimerWheel::Timer timer; ///< Узел колеса таймеров (данные — дескриптор сессии).
+    SessionTimeout timeout{SessionTimeout::K_NONE}; ///< Отсчитываемый таймаут.
+    TimerWheel::Clock::time_point since{}; ///< Начало отсчета.
+    TimerWheel::Clock::time_point expires{}; ///< Срок, на который взведен таймер.
+    uint64_t ready_count{}; ///< Количество ReadyForQuery на момент since (таймаут запроса).
+};
 
 /**
  * @brief Класс, представляющий сессию между клиентским сокетом и сокетом PostgreSQL.
  * 
- * Сессия инкапсулирует два сокета и буферы для проксирования данных между ними.
- * Также управляет событиями epoll через коллбэк ModEventsCallback.
+ * Сессия инкапсулирует клиентский сокет, соединение с PostgreSQL (Backend) и буферы для проксирования
+ * данных между ними. Также управляет событиями epoll через коллбэк ModEventsCallback.
+ * Данные клиента по мере чтения разбираются на сообщения протокола PostgreSQL (FrameParser),
+ * каждое полное сообщение передается коллбэку сообщений ровно один раз.
+ *
+ * В режиме пула (EnablePooling()) соединение с PostgreSQL выдается сессии на время транзакции:
+ * этап запуска клиента обслуживает прокси (ответ воспроизводится из ParameterStatus пула),
+ * Terminate клиента не пересылается, а ответы сервера разбираются, чтобы по ReadyForQuery
+ * со статусом 'I' определить момент, когда соединение можно вернуть в пул.
+ *
+ * С FlowControl (SetFlowControl()) очередь каждого направления ограничена: при достижении
+ * верхней границы или исчерпании общего бюджета памяти сессия снимает EPOLLIN с сокета-источника
+ * и возобновляет чтение, когда очередь опустится до нижней границы (ResumeReading()).
+ *
+ * С отслеживанием задержек (EnableLatency()) ответы сервера разбираются и в обычном режиме:
+ * QueryTracker сопоставляет запросы клиента (TrackQuery()) с CommandComplete/ReadyForQuery.
+ *
+ * С отслеживанием транзакций (EnableTransactionTracking()) границы транзакций известны и без пула:
+ * при плавной остановке сессия закрывается, как только становится простаивающей (IsIdle()).
+ *
+ * С завершением TLS (EnableTls()) на SSLRequest клиента отвечает сам прокси: запрос не пересылается
+ * в PostgreSQL, после рукопожатия поток клиента расшифровывается и разбирается как открытый текст.
+ * Если ядро взяло отправку на себя (kTLS), данные клиенту уходят обычными sendmsg() и splice().
+ *
+ * С кэшем результатов (EnableResultCache()) читающий Query вне транзакции, который оказался единственным
+ * сообщением в очереди к PostgreSQL, снимается с очереди, если кэш знает ответ, а иначе ответ сервера
+ * собирается для кэша. Изменяющие запросы отмечают свои таблицы измененными при отправке и еще раз
+ * по завершении транзакции.
+ *
+ * Запрос, который можно выполнить на реплике (InspectQuery(), CanUseReplica()), отмечается при разборе:
+ * Worker выбирает для него соединение с репликой, если это единственный запрос в очереди вне транзакции.
  */
 class Session {
 public:
     /// Тип коллбэка для обновления событий epoll (fd и новые события).
     using ModEventsCallback = std::function<void(int fd, uint32_t events)>;
 
+    /// Тип коллбэка, ставящего отправку в очередь механизма ввода-вывода (Poller::Send()).
+    using SendCallback = std::function<bool(int fd, const iovec* iov, size_t count)>;
+
 public:
     /**
      * @brief Конструктор сессии.
      * 
-     * @param pgsql_fd Сокет PostgreSQL.
+     * Пока соединение с PostgreSQL не установлено (или не выдано пулом), данные клиента буферизуются.
+     * 
+     * @param backend Соединение с PostgreSQL (connect() уже вызван) или nullptr в режиме пула.
      * @param client_fd Клиентский сокет.
      * @param cb Коллбэк для модификации событий epoll.
      */
-    Session(UniqueFD&& pgsql_fd, UniqueFD&& client_fd, ModEventsCallback cb);
+    Session(std::unique_ptr<Backend> backend, UniqueFD&& client_fd, ModEventsCallback cb);
+
+    /**
+     * @brief Деструктор. Снимает сессию со счета приостановленных.
+     */
+    ~Session();
 
     /**
      * @brief Получить дескриптор сокета PostgreSQL.
-     * @return int Дескриптор PostgreSQL.
+     * @return int Дескриптор PostgreSQL или -1, если соединение не выдано.
      */
     int GetPGSQLFD() const noexcept;
 
@@ -50,18 +129,6 @@ public:
      */
     int GetPeerFD(int fd) const noexcept;
 
-    /**
-     * @brief Получить данные, готовые для отправки в PostgreSQL.
-     * @return std::string_view Данные из буфера PostgreSQL.
-     */
-    std::string_view GetDataToPGSQL() const;
-
-    /**
-     * @brief Получить данные, готовые для отправки клиенту.
-     * @return std::string_view Данные из клиентского буфера.
-     */
-    std::string_view GetDataToClient() const;
-
     /**
      * @brief Проверяет, является ли fd сокетом PostgreSQL.
      * @param fd Дескриптор.
@@ -78,11 +145,337 @@ public:
      */
     bool IsClientFD(int fd) const noexcept;
 
+    /**
+     * @brief Проверяет, ожидает ли сессия завершения подключения к PostgreSQL.
+     * 
+     * Ожидание выдачи соединения пулом подключением не считается.
+     * @return true Если connect() еще не завершен.
+     * @return false Иначе.
+     */
+    bool IsConnecting() const noexcept;
+
+    /**
+     * @brief Включает пересылку PostgreSQL -> клиент через splice().
+     * 
+     * Создает pipe сессии. Данные ответа PostgreSQL перемещаются из сокета в pipe и из pipe
+     * в клиентский сокет внутри ядра, не попадая в пространство пользователя.
+     * 
+     * @return true Если pipe создан.
+     * @return false Если создать pipe не удалось (сессия остается в буферизованном режиме).
+     */
+    bool EnableSplice();
+
+    /**
+     * @brief Проверяет, может ли сокет сессии читаться и писаться механизмом ввода-вывода (Poller::StartStream()).
+     *
+     * Подходит открытый текст без splice(): TLS прокси расшифровывает сам, а соединение пула переходит
+     * между сессиями. Сокет PostgreSQL — только после завершения подключения.
+     *
+     * @param fd Дескриптор.
+     */
+    bool CanStream(int fd) const noexcept;
+
+    /**
+     * @brief Отмечает сокет, переведенный Poller на ввод-вывод механизмом.
+     *
+     * Данные такого сокета приходят в OnReceived(), а TrySend() ставит отправку через коллбэк
+     * SetSendCallback() и ждет OnSent(), не вызывая sendmsg().
+     *
+     * @param fd Дескриптор.
+     */
+    void EnableStream(int fd) noexcept;
+
+    /**
+     * @brief Устанавливает коллбэк отправки для сокетов, переведенных EnableStream().
+     * @param cb Коллбэк отправки.
+     */
+    void SetSendCallback(SendCallback cb);
+
+    /**
+     * @brief Устанавливает коллбэк для сообщений клиента.
+     * 
+     * Коллбэк вызывается из RecvAll() для каждого полного сообщения клиента; тело сообщения
+     * действительно только на время вызова.
+     * 
+     * @param cb Коллбэк сообщений.
+     */
+    void SetMessageCallback(FrameParser::Callback cb);
+
+    /**
+     * @brief Получить кэш подготовленных операторов сессии.
+     * @return StatementCache& Кэш операторов и порталов.
+     */
+    StatementCache& GetStatementCache() noexcept;
+
+    /**
+     * @brief Запоминает адрес клиента.
+     * @param endpoint Адрес клиента.
+     */
+    void SetEndpoint(const Endpoint& endpoint);
+
+    /**
+     * @brief Адрес клиента (для логов).
+     */
+    const Endpoint& GetEndpoint() const noexcept;
+
+    /**
+     * @brief Включает ограничение очередей сессии.
+     * @param flow Общие границы буферизации (должны жить дольше сессии).
+     */
+    void SetFlowControl(FlowControl* flow) noexcept;
+
+    /**
+     * @brief Включает учет трафика сессии в счетчиках рабочего потока.
+     * @param metrics Счетчики рабочего потока (должны жить дольше сессии).
+     */
+    void SetMetrics(WorkerMetrics* metrics) noexcept;
+
+    /**
+     * @brief Проверяет, приостановлено ли чтение хотя бы одного сокета сессии.
+     */
+    bool IsThrottled() const noexcept;
+
+    /**
+     * @brief Проверяет, держит ли чтение приостановленным только общий бюджет памяти.
+     *
+     * Такую сессию не разбудит отправка ее собственных данных: возобновление нужно проверять
+     * по мере освобождения памяти другими сессиями (ResumeReading()).
+     */
+    bool IsWaitingBudget() const noexcept;
+
+    /**
+     * @brief Возобновляет чтение направлений, очередь которых опустилась до нижней границы.
+     */
+    void ResumeReading();
+
+    /**
+     * @brief Включает завершение TLS клиента: на SSLRequest прокси отвечает 'S' и проходит рукопожатие сам.
+     * @param context Контексты TLS с серверной стороной (должны жить дольше сессии).
+     */
+    void EnableTls(const TlsContext* context) noexcept;
+
+    /**
+     * @brief Включает измерение задержек запросов.
+     * @param stats Статистика задержек рабочего потока (должна жить дольше сессии).
+     */
+    void EnableLatency(LatencyStats* stats) noexcept;
+
+    /**
+     * @brief Начинает измерение задержки запроса.
+     * @param type Тип сообщения ('Q' или 'E').
+     * @param text Текст запроса.
+     * @param entry Запись отпечатка запроса (может быть nullptr).
+     * @param log Сохранить текст до завершения и передать запрос обработчику (для лога с задержкой).
+     */
+    void TrackQuery(char type, const QueryText& text, LatencyStats::Entry* entry, bool log);
+
+    /**
+     * @brief Устанавливает обработчик завершенных запросов (текст и задержка).
+     * @param cb Обработчик.
+     */
+    void SetQueryDoneCallback(QueryTracker::Callback cb);
+
+    /**
+     * @brief Передает обработчику завершения незавершенные запросы (без задержки).
+     */
+    void FlushQueries();
+
+    /**
+     * @brief Включает кэш результатов. Требует отслеживания транзакций (ответы сервера разбираются).
+     * @param cache Кэш рабочего потока (должен жить дольше сессии).
+     */
+    void EnableResultCache(ResultCache* cache) noexcept;
+
+    /**
+     * @brief Проверяет, может ли разобранное сообщение получить ответ из кэша или уйти на реплику.
+     *
+     * Вызывается из коллбэка сообщений до разбора текста: полный ClassifyQuery() нужен только Query,
+     * отправленному вне транзакции после того, как получены ответы на все прежние запросы;
+     * остальным хватает ClassifyWrite().
+     *
+     * @param message Сообщение клиента.
+     * @return true Если это такой Query.
+     */
+    bool IsQueryCandidate(const FrontendMessage& message) const noexcept;
+
+    /**
+     * @brief Учитывает разобранный запрос: изменения инвалидируют таблицы кэша, чтение может получить ответ
+     * из кэша или уйти на реплику.
+     *
+     * Вызывается из коллбэка сообщений для Query и Execute; ответ из кэша подставляется в RecvAll(),
+     * когда разобрана вся порция данных клиента.
+     *
+     * @param message Сообщение клиента.
+     * @param query_class Результат ClassifyQuery() или ClassifyWrite() (IsQueryCandidate()) для текста запроса.
+     */
+    void InspectQuery(const FrontendMessage& message, const QueryClass& query_class);
+
+    /**
+     * @brief Проверяет, можно ли выполнить ожидающий запрос на реплике.
+     * @return true Если очередь к PostgreSQL — один Query только для чтения, а сессия вне транзакции.
+     */
+    bool CanUseReplica() const noexcept;
+
+public:
+    /**
+     * @brief Включает режим пула соединений (транзакционный).
+     */
+    void EnablePooling();
+
+    /**
+     * @brief Включает отслеживание границ транзакций без пула (для плавной остановки).
+     *
+     * Ответы сервера разбираются, чтобы по ReadyForQuery знать статус транзакции и незавершенные запросы.
+     */
+    void EnableTransactionTracking() noexcept;
+
+    /**
+     * @brief Проверяет, можно ли закрыть сессию, не оборвав транзакцию или ответ.
+     *
+     * Сессия простаивает, если этап запуска завершен, все запросы клиента получили ReadyForQuery
+     * со статусом 'I' и очереди в обе стороны пусты. Без отслеживания транзакций (splice,
+     * зашифрованный поток) сессия простаивающей не считается.
+     *
+     * @return true Если сессию можно закрыть.
+     */
+    bool IsIdle() const noexcept;
+
+    /**
+     * @brief Ставит в очередь уведомления о закрытии при остановке прокси.
+     *
+     * Клиенту — ErrorResponse FATAL с кодом 57P01 (admin_shutdown), собственному соединению
+     * с PostgreSQL (без пула) — Terminate. Вызывается только для простаивающей сессии (IsIdle()),
+     * когда сообщение не может разорвать ответ сервера.
+     */
+    void NotifyShutdown();
+
+    /**
+     * @brief Ставит в очередь уведомления о закрытии по таймауту простоя.
+     *
+     * Клиенту — ErrorResponse FATAL с кодом 57P05 (idle_session_timeout), как и NotifyShutdown(),
+     * только для простаивающей сессии (IsIdle()).
+     */
+    void NotifyIdleTimeout();
+
+    /**
+     * @brief Ставит в очередь отказ клиенту, когда ни один сервер PostgreSQL не исправен.
+     *
+     * Клиенту — ErrorResponse FATAL с кодом 57P03 (cannot_connect_now), как у сервера, который
+     * еще не принимает подключения. После вызова сессия закрывается.
+     */
+    void NotifyUnavailable();
+
+    /**
+     * @brief Проверяет, ждет ли клиент ответа PostgreSQL (есть Query/Sync без ReadyForQuery).
+     *
+     * Без отслеживания транзакций всегда false.
+     */
+    bool IsWaitingResponse() const noexcept;
+
+    /**
+     * @brief Количество ReadyForQuery, полученных от PostgreSQL (растет по мере завершения запросов).
+     */
+    uint64_t GetReadyCount() const noexcept;
+
+    /**
+     * @brief Таймер сессии (таймауты подключения, запроса и простоя).
+     */
+    SessionTimer& GetTimer() noexcept;
+
+    /**
+     * @brief Проверяет, выдано ли сессии соединение с PostgreSQL.
+     */
+    bool HasBackend() const noexcept;
+
+    /**
+     * @brief Соединение с PostgreSQL, выданное сессии (nullptr — нет).
+     */
+    const Backend* GetBackend() const noexcept;
+
+    /**
+     * @brief Выдает сессии соединение из пула.
+     * 
+     * Если клиент ждет ответа на этап запуска, ответ воспроизводится из ParameterStatus соединения.
+     * 
+     * @param backend Готовое соединение.
+     */
+    void AttachBackend(std::unique_ptr<Backend> backend);
+
+    /**
+     * @brief Забирает соединение у сессии.
+     * @return std::unique_ptr<Backend> Соединение.
+     */
+    std::unique_ptr<Backend> DetachBackend();
+
+    /**
+     * @brief Проверяет, нужно ли сессии соединение из пула.
+     * @return true Если есть данные для PostgreSQL или ответ на этап запуска, а соединения нет.
+     */
+    bool NeedsBackend() const noexcept;
+
+    /**
+     * @brief Проверяет, можно ли вернуть соединение в пул.
+     * @return true Если все запросы клиента завершены ReadyForQuery со статусом 'I'.
+     */
+    bool CanReleaseBackend() const noexcept;
+
+    /**
+     * @brief Проверяет, ждет ли клиент ответа на этап запуска.
+     */
+    bool IsStartupPending() const noexcept;
+
+    /**
+     * @brief Отвечает клиенту на этап запуска: AuthenticationOk, ParameterStatus и ReadyForQuery.
+     * @param parameters Сообщения ParameterStatus.
+     */
+    void CompleteStartup(std::string_view parameters);
+
+    /**
+     * @brief Ключ пула (user, database) из StartupMessage клиента.
+     */
+    const std::string& GetPoolKey() const noexcept;
+
+    /**
+     * @brief Имя пользователя из StartupMessage клиента.
+     */
+    const std::string& GetUser() const noexcept;
+
+    /**
+     * @brief Имя базы данных из StartupMessage клиента.
+     */
+    const std::string& GetDatabase() const noexcept;
+
+    /**
+     * @brief Проверяет, стоит ли сессия в очереди ожидания соединения.
+     */
+    bool IsWaitingBackend() const noexcept;
+
+    /**
+     * @brief Отмечает постановку в очередь ожидания соединения или выход из нее.
+     * @param waiting true — сессия ждет соединения.
+     */
+    void SetWaitingBackend(bool waiting) noexcept;
+
 public:
+    /**
+     * @brief Завершает неблокирующее подключение к PostgreSQL.
+     * 
+     * Вызывается по событиям сокета PostgreSQL, пока подключение не завершено. Проверяет SO_ERROR,
+     * с шифрованием продолжает согласование TLS и, в случае успеха, отправляет данные клиента,
+     * накопленные за время подключения.
+     * 
+     * @return true Если подключение установлено.
+     * @return false Если подключиться не удалось.
+     */
+    bool FinishConnect();
+
     /**
      * @brief Пытается отправить все данные из буфера на указанный fd.
      * 
-     * Если отправка невозможна (EAGAIN), вызывает UpdateEpoll.
+     * Сегменты буфера отправляются одним вызовом sendmsg() через iovec. Если отправка невозможна (EAGAIN),
+     * вызывает UpdateEpoll. Пока подключение к PostgreSQL не завершено, данные для него остаются в буфере.
+     * Для клиента сначала отправляются данные из pipe (режим splice), затем из буфера.
+     * Для сокета после EnableStream() отправка ставится в очередь механизма ввода-вывода (SubmitSend()).
      * 
      * @param fd Дескриптор для отправки.
      * @return true Если данные отправлены или ждут повторной попытки.
@@ -93,7 +486,10 @@ public:
     /**
      * @brief Считывает все доступные данные с указанного fd.
      * 
-     * Читает данные и помещает их в буфер противоположного сокета.
+     * Читает данные напрямую в хвостовой сегмент буфера противоположного сокета.
+     * Прочитанные данные клиента передаются разборщику сообщений. Чтение прекращается до EAGAIN,
+     * если очередь к получателю достигла верхней границы (см. FlowControl).
+     * Для сокета PostgreSQL в режиме splice вызывает SpliceToClient().
      * 
      * @param fd Дескриптор для чтения.
      * @return true Если данные успешно считаны или достигнут EAGAIN.
@@ -101,23 +497,259 @@ public:
      */
     bool RecvAll(int fd);
 
+    /**
+     * @brief Принимает данные, прочитанные механизмом ввода-вывода.
+     *
+     * Данные добавляются в буфер противоположного сокета и разбираются, как в RecvAll(): крупная порция —
+     * блоком механизма без копирования (Buffer::AdoptSegment()), мелкая — копированием в хвост. Данные уже
+     * прочитаны, поэтому принимаются и при приостановленном чтении; полная очередь лишь приостанавливает
+     * дальнейшее.
+     *
+     * @param fd Сокет-источник (после EnableStream()).
+     * @param data Данные (в начале block, если он передан).
+     * @param size Размер данных.
+     * @param block Блок Buffer::SEGMENT_SIZE байт с данными, который можно забрать (nullptr — только копировать).
+     */
+    void OnReceived(int fd, char* data, size_t size, std::unique_ptr<char[]>* block);
+
+    /**
+     * @brief Завершает отправку, поставленную TrySend() через механизм ввода-вывода, и ставит следующую.
+     * @param fd Дескриптор (после EnableStream()).
+     * @param size Отправлено байт.
+     * @return true Если отправка продолжается или очередь пуста.
+     * @return false Если следующую отправку поставить не удалось.
+     */
+    bool OnSent(int fd, size_t size);
+
     /**
      * @brief Обновляет события epoll для указанного fd.
      * 
-     * Добавляет EPOLLOUT, если в буфере есть данные для отправки.
+     * Добавляет EPOLLOUT, если в буфере (или pipe) есть данные для отправки, TLS ждет готовности
+     * к записи или подключение к PostgreSQL не завершено, и EPOLLIN, если чтение не приостановлено.
+     * Коллбэк вызывается только при изменении маски.
      * 
      * @param fd Дескриптор, для которого обновляются события.
      */
     void UpdateEpoll(int fd);
 
 private:
-    UniqueFD _pgsql_fd; ///< Сокет PostgreSQL.
+    /**
+     * @brief Пересылает данные PostgreSQL клиенту через pipe сессии.
+     * 
+     * Пока клиент успевает принимать данные, они перемещаются через splice(). Если клиент
+     * не принимает данные (EAGAIN) и в pipe остались байты, дальнейшие данные PostgreSQL
+     * читаются в клиентский буфер до тех пор, пока pipe и буфер не опустеют.
+     * 
+     * @return true Если данные пересланы или достигнут EAGAIN.
+     * @return false Если соединение закрыто или произошла ошибка.
+     */
+    bool SpliceToClient();
+
+    /**
+     * @brief Проверяет, можно ли пересылать ответы PostgreSQL клиенту через splice().
+     *
+     * Нужен pipe сессии, а зашифрованный поток клиента допускает splice() только с kTLS отправки.
+     */
+    bool CanSplice() const noexcept;
+
+    /**
+     * @brief Проверяет, читается и пишется ли сокет механизмом ввода-вывода (EnableStream()).
+     */
+    bool IsStream(int fd) const noexcept;
+
+    /**
+     * @brief Ставит отправку очереди через механизм ввода-вывода, если предыдущая уже завершилась.
+     *
+     * Отправляемые сегменты не меняются до OnSent(): Consume() вызывается только по завершении.
+     *
+     * @return true Если отправка поставлена, еще идет или очередь пуста.
+     * @return false Если поставить отправку не удалось.
+     */
+    bool SubmitSend(int fd, Buffer& buffer);
+
+    /**
+     * @brief Учитывает n байт, добавленных в конец буфера получателя, и передает их разборщикам.
+     * @param fd Сокет-источник.
+     * @param buffer Очередь к получателю.
+     * @param data Начало добавленных данных (в хвостовом сегменте buffer).
+     * @param n Количество байт.
+     */
+    void ProcessReceived(int fd, const Buffer& buffer, char* data, size_t n);
+
+    /**
+     * @brief TLS-соединение сокета сессии.
+     * @param fd Дескриптор.
+     * @return TlsStream* Соединение или nullptr, если сокет не зашифрован.
+     */
+    TlsStream* GetTls(int fd) const noexcept;
+
+    /**
+     * @brief Читает из сокета сессии (через TLS, если он зашифрован).
+     * @return ssize_t Результат в соглашениях recv().
+     */
+    ssize_t Receive(int fd, char* data, size_t size);
+
+    /**
+     * @brief Отправляет сегменты в сокет сессии.
+     *
+     * Открытый текст и kTLS отправки — одним sendmsg(), иначе — по сегменту через OpenSSL.
+     *
+     * @return ssize_t Результат в соглашениях sendmsg().
+     */
+    ssize_t Send(int fd, const iovec* iov, size_t count);
+
+    /**
+     * @brief Отвечает клиенту на SSLRequest и начинает рукопожатие TLS.
+     * @return true Если ответ отправлен.
+     * @return false Если произошла ошибка.
+     */
+    bool AcceptTls();
+
+    /**
+     * @brief Продолжает рукопожатие TLS с клиентом.
+     * @return int 1 — рукопожатие завершено, 0 — ожидается сокет, -1 — ошибка.
+     */
+    int ContinueHandshake();
+
+    /**
+     * @brief Отправляет клиенту данные, накопленные в pipe.
+     * @return int 1 — pipe опустошен, 0 — клиент не принимает данные (EAGAIN), -1 — ошибка.
+     */
+    int FlushPipe();
+
+    /**
+     * @brief Обрабатывает сообщение клиента: в режиме пула — этап запуска и Terminate, а также границы транзакций.
+     * @param message Сообщение клиента.
+     */
+    void OnClientMessage(const FrontendMessage& message);
+
+    /**
+     * @brief Обрабатывает сообщение сервера: ReadyForQuery и завершение запросов для измерения задержек.
+     * @param message Сообщение сервера.
+     */
+    void OnPGSQLMessage(const FrontendMessage& message);
+
+    /**
+     * @brief Обрабатывает сообщение этапа запуска клиента в режиме пула.
+     * @param message Сообщение этапа запуска.
+     */
+    void OnClientStartup(const FrontendMessage& message);
+
+    /**
+     * @brief Запоминает пользователя, базу данных и параметры StartupMessage (ключ кэша результатов).
+     * @param params Параметры: пары "имя\0значение\0", завершаются пустым именем.
+     */
+    void ParseStartupParameters(std::string_view params);
+
+    /**
+     * @brief Отвечает на Query из кэша результатов или начинает собирать ответ сервера.
+     *
+     * Кэш отвечает, только если Query — единственное неотправленное сообщение, прежние ответы получены,
+     * а сессия вне транзакции: тогда ответ не смешается с другими и не зависит от незавершенных изменений.
+     */
+    void ResolveCachedQuery();
+
+    /**
+     * @brief Учитывает сообщение собираемого для кэша ответа и сохраняет ответ по ReadyForQuery.
+     * @param message Сообщение сервера.
+     */
+    void OnCapturedMessage(const FrontendMessage& message);
+
+    /**
+     * @brief Проверяет, нужно ли прекратить чтение в очередь.
+     * @param buffer Очередь к получателю.
+     */
+    bool ShouldPause(const Buffer& buffer) const noexcept;
+
+    /**
+     * @brief Приостанавливает или возобновляет чтение сокета и обновляет счетчик FlowControl.
+     * @param fd Сокет-источник.
+     * @param paused Приостановить ли чтение.
+     */
+    void SetPaused(int fd, bool paused);
+
+    /**
+     * @brief Ставит в очередь ErrorResponse клиенту и Terminate собственному соединению с PostgreSQL.
+     * @param fields Поля ErrorResponse с завершающим нулем.
+     * @param size Размер полей.
+     */
+    void NotifyClose(const char* fields, size_t size);
+
+private:
+    std::unique_ptr<Backend> _backend; ///< Соединение с PostgreSQL.
     UniqueFD _client_fd; ///< Клиентский сокет.
+    std::unique_ptr<TlsStream> _client_tls; ///< TLS клиента (закрывается раньше сокета).
+    Endpoint _endpoint{}; ///< Адрес клиента.
 
     ModEventsCallback _mod_events_cb; ///< Коллбэк для обновления событий epoll.
+    SendCallback _send_cb; ///< Коллбэк отправки через механизм ввода-вывода.
+    FrameParser::Callback _message_cb; ///< Коллбэк для сообщений клиента.
+    FrameParser::Callback _client_handler; ///< Обработчик разборщика клиента (OnClientMessage).
+    FrameParser::Callback _pgsql_handler; ///< Обработчик разборщика сервера (OnPGSQLMessage).
+
+    FrameParser _client_parser; ///< Разборщик сообщений клиента.
+    FrameParser _pgsql_parser{16, FrameParser::State::K_MESSAGES}; ///< Разборщик ответов сервера (транзакции, задержки).
+    StatementCache _statement_cache; ///< Операторы и порталы расширенного протокола.
+
+    uint32_t _client_events{EPOLLIN | EPOLLET}; ///< Текущая маска событий клиентского сокета.
+
+    bool _client_stream{false}; ///< Клиентский сокет читается и пишется механизмом ввода-вывода.
+    bool _pgsql_stream{false}; ///< Сокет PostgreSQL читается и пишется механизмом ввода-вывода.
+    size_t _client_sending{}; ///< Байты начала очереди к клиенту в незавершенной отправке механизма.
+    size_t _pgsql_sending{}; ///< Байты начала очереди к PostgreSQL в незавершенной отправке механизма.
+
+    FlowControl* _flow{nullptr}; ///< Границы буферизации (nullptr — без ограничений).
+    bool _client_paused{false}; ///< Чтение клиента приостановлено (очередь к PostgreSQL полна).
+    bool _pgsql_paused{false}; ///< Чтение PostgreSQL приостановлено (очередь к клиенту полна).
+
+    WorkerMetrics* _metrics{nullptr}; ///< Счетчики рабочего потока (nullptr — без учета).
+
+    QueryTracker _queries; ///< Запросы, ожидающие ответа (измерение задержек).
+    QueryTracker::Callback _query_done_cb; ///< Обработчик завершенных запросов.
+    bool _ssl_answer_pending{false}; ///< Ожидается однобайтовый ответ сервера на SSLRequest/GSSENCRequest.
+
+    const TlsContext* _tls{nullptr}; ///< Контексты TLS (nullptr — TLS клиента не завершается прокси).
+    bool _tls_requested{false}; ///< Клиент прислал SSLRequest, ответ еще не отправлен.
+    size_t _tls_probe{}; ///< Прочитано байт начала потока клиента (до длины SSLRequest).
+
+    bool _pooling{false}; ///< Режим пула соединений.
+    bool _track_transactions{false}; ///< Границы транзакций отслеживаются (пул или плавная остановка).
+    bool _ready_for_query{false}; ///< Клиент получил первый ReadyForQuery (этап запуска завершен).
+    bool _startup_pending{false}; ///< Клиент ждет ответа на этап запуска.
+    bool _waiting_backend{false}; ///< Сессия стоит в очереди пула.
+    bool _unsynced{false}; ///< Есть сообщения расширенного протокола после последнего Sync.
+    char _transaction_status{'I'}; ///< Статус транзакции из последнего ReadyForQuery.
+    size_t _pending_syncs{}; ///< Query/Sync, на которые еще не пришел ReadyForQuery.
+    uint64_t _ready_count{}; ///< Количество ReadyForQuery от PostgreSQL.
+    size_t _discard_front{}; ///< Байты этапа запуска, которые нужно убрать из начала буфера PostgreSQL.
+    size_t _discard_back{}; ///< Байты Terminate, которые нужно убрать из конца буфера PostgreSQL.
+
+    std::string _user; ///< Пользователь из StartupMessage.
+    std::string _database; ///< База данных из StartupMessage.
+    std::string _pool_key; ///< Ключ пула.
+    std::string _startup_params; ///< Параметры StartupMessage (пусто — этап запуска не разобран).
+
+    ResultCache* _cache{nullptr}; ///< Кэш результатов рабочего потока (nullptr — выключен).
+    bool _cache_bypass{false}; ///< Сессия меняла свое состояние (SET, временные таблицы): кэш не используется.
+    CachedQuery _cache_query; ///< Запрос, ответ на который ищется в кэше или собирается.
+    size_t _cache_candidate{}; ///< Размер Query, на который может ответить кэш (0 — такого нет).
+    size_t _replica_candidate{}; ///< Размер последнего Query, который может выполнить реплика (0 — такого нет).
+    bool _capturing{false}; ///< Собирается ответ сервера на _cache_query.
+    bool _capture_failed{false}; ///< Собираемый ответ не кэшируется (слишком велик или не только строки).
+    size_t _capture_parsed{}; ///< Байты разобранных сообщений собираемого ответа.
+    std::string _capture; ///< Собираемый ответ.
+    std::vector<uint16_t> _written_tables; ///< Таблицы, измененные в текущей транзакции.
+    bool _written_all{false}; ///< В текущей транзакции изменено все (DDL или неизвестная команда).
+
+    UniqueFD _pipe_read{}; ///< Читающий конец pipe для splice().
+    UniqueFD _pipe_write{}; ///< Пишущий конец pipe для splice().
+    size_t _pipe_size{}; ///< Количество байт в pipe.
+    size_t _pipe_capacity{}; ///< Емкость pipe.
+
+    Buffer _pgsql_send_buffer; ///< Буфер для данных PostgreSQL.
+    Buffer _client_send_buffer; ///< Буфер для данных клиента.
 
-    std::vector<char> _pgsql_send_buffer; ///< Буфер для данных PostgreSQL.
-    std::vector<char> _client_send_buffer; ///< Буфер для данных клиента.
+    SessionTimer _timer; ///< Таймер сессии.
 };
 
 
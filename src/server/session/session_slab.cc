@@ -0,0 +1,105 @@
+#include <stdexcept>
+
+#include "session_slab.h"
+
+uint64_t SessionSlab::MakeToken(Handle handle, Direction direction) noexcept {
+    return handle | (static_cast<uint64_t>(direction) << 31);
+}
+
+bool SessionSlab::IsSessionToken(uint64_t token) noexcept {
+    return (token >> 32) != 0;
+}
+
+SessionSlab::Handle SessionSlab::GetHandle(uint64_t token) noexcept {
+    return token & ~(uint64_t{1} << 31);
+}
+
+SessionSlab::Direction SessionSlab::GetDirection(uint64_t token) noexcept {
+    return static_cast<Direction>((token >> 31) & 1);
+}
+
+uint32_t SessionSlab::GetIndex(Handle handle) noexcept {
+    return static_cast<uint32_t>(handle & INDEX_MASK);
+}
+
+SessionSlab::Slot& SessionSlab::GetSlot(uint32_t index) noexcept {
+    return _chunks[index / CHUNK_SIZE][index % CHUNK_SIZE];
+}
+
+SessionSlab::Handle SessionSlab::Reserve() {
+    if (_free.empty()) {
+        uint64_t first{uint64_t{_chunks.size()} * CHUNK_SIZE};
+
+        if (first + CHUNK_SIZE > INDEX_MASK) {
+            throw std::runtime_error("SessionSlab::Reserve(): too many sessions");
+        }
+
+        _chunks.push_back(std::make_unique<Slot[]>(CHUNK_SIZE));
+
+        // В обратном порядке, чтобы первыми выдавались младшие индексы.
+        for (uint32_t i{CHUNK_SIZE}; i > 0; --i) {
+            _free.push_back(static_cast<uint32_t>(first + i - 1));
+        }
+    }
+
+    uint32_t index{_free.back()};
+    _free.pop_back();
+    ++_size;
+
+    return (static_cast<uint64_t>(GetSlot(index).generation) << 32) | index;
+}
+
+Session* SessionSlab::Get(Handle handle) noexcept {
+    uint32_t index{GetIndex(handle)};
+
+    if (index >= _chunks.size() * CHUNK_SIZE) {
+        return nullptr;
+    }
+
+    Slot& slot{GetSlot(index)};
+
+    if (slot.generation != (handle >> 32) || !slot.session) {
+        return nullptr;
+    }
+
+    return &*slot.session;
+}
+
+void SessionSlab::Release(Handle handle) {
+    uint32_t index{GetIndex(handle)};
+    Slot& slot{GetSlot(index)};
+
+    if (slot.generation != (handle >> 32)) {
+        return;
+    }
+
+    slot.session.reset();
+
+    if (++slot.generation == 0) {
+        slot.generation = 1;
+    }
+
+    _free.push_back(index);
+    --_size;
+}
+
+size_t SessionSlab::Size() const noexcept {
+    return _size;
+}
+
+std::vector<SessionSlab::Handle> SessionSlab::GetHandles() const {
+    std::vector<Handle> handles;
+    handles.reserve(_size);
+
+    for (size_t chunk{}; chunk < _chunks.size(); ++chunk) {
+        for (uint32_t i{}; i < CHUNK_SIZE; ++i) {
+            const Slot& slot{_chunks[chunk][i]};
+
+            if (slot.session) {
+                handles.push_back((static_cast<uint64_t>(slot.generation) << 32) | (chunk * CHUNK_SIZE + i));
+            }
+        }
+    }
+
+    return handles;
+}
@@ -0,0 +1,146 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_SESSION_SESSION_SLAB_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_SESSION_SESSION_SLAB_H
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <optional>
+
+#include "session.h"
+
+/**
+ * @brief Хранилище сессий рабочего потока со стабильными индексами.
+ *
+ * Сессии размещаются в слотах, выделяемых блоками по CHUNK_SIZE, поэтому адрес сессии не меняется
+ * до ее удаления, а освобожденные слоты переиспользуются без обращения к аллокатору.
+ * Сессия адресуется дескриптором (Handle): номер слота и поколение слота. Поколение увеличивается
+ * при каждом освобождении, поэтому устаревший дескриптор (например, из события, полученного
+ * в той же пачке, что и закрытие сессии) не находит новую сессию в том же слоте.
+ *
+ * Дескриптор вместе с направлением (клиент или PostgreSQL) упаковывается в токен, который
+ * передается в Poller как epoll_event.data.u64:
+ *
+ *     [ поколение : 32 ][ направление : 1 ][ индекс : 31 ]
+ *
+ * Токены с нулевым поколением не принадлежат сессиям: в младших битах у них хранится fd
+ * (слушающий сокет, eventfd пробуждения, соединения во владении пула).
+ */
+class SessionSlab {
+public:
+    /// Дескриптор сессии: поколение и индекс слота.
+    using Handle = uint64_t;
+
+    /**
+     * @brief Сокет сессии, к которому относится событие.
+     */
+    enum class Direction : uint64_t {
+        K_CLIENT = 0, ///< Клиентский сокет
+        K_PGSQL = 1 ///< Сокет PostgreSQL
+    };
+
+    /// Дескриптор, не указывающий ни на одну сессию.
+    static constexpr Handle NULL_HANDLE{0};
+
+public:
+    /**
+     * @brief Формирует токен события для сокета сессии.
+     * @param handle Дескриптор сессии.
+     * @param direction Сокет сессии.
+     * @return uint64_t Токен для Poller.
+     */
+    static uint64_t MakeToken(Handle handle, Direction direction) noexcept;
+
+    /**
+     * @brief Проверяет, относится ли токен к сессии (а не к fd вне сессий).
+     * @param token Токен события.
+     */
+    static bool IsSessionToken(uint64_t token) noexcept;
+
+    /**
+     * @brief Извлекает дескриптор сессии из токена.
+     * @param token Токен события.
+     */
+    static Handle GetHandle(uint64_t token) noexcept;
+
+    /**
+     * @brief Извлекает направление из токена.
+     * @param token Токен события.
+     */
+    static Direction GetDirection(uint64_t token) noexcept;
+
+    /**
+     * @brief Резервирует пустой слот.
+     *
+     * Дескриптор известен до создания сессии, поэтому его можно передать в Poller и в коллбэки
+     * сессии. Слот нужно заполнить через Emplace() или вернуть через Release().
+     *
+     * @return Handle Дескриптор слота.
+     */
+    Handle Reserve();
+
+    /**
+     * @brief Создает сессию в зарезервированном слоте.
+     * @param handle Дескриптор, полученный от Reserve().
+     * @param args Аргументы конструктора Session.
+     * @return Session& Созданная сессия.
+     */
+    template <typename... Args>
+    Session& Emplace(Handle handle, Args&&... args) {
+        return GetSlot(GetIndex(handle)).session.emplace(std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Ищет сессию по дескриптору.
+     * @param handle Дескриптор.
+     * @return Session* Сессия или nullptr, если слот освобожден или переиспользован.
+     */
+    Session* Get(Handle handle) noexcept;
+
+    /**
+     * @brief Удаляет сессию и освобождает слот.
+     * @param handle Дескриптор.
+     */
+    void Release(Handle handle);
+
+    /**
+     * @brief Количество занятых слотов.
+     */
+    size_t Size() const noexcept;
+
+    /**
+     * @brief Дескрипторы всех созданных сессий (обход всего хранилища, не для горячего пути).
+     */
+    std::vector<Handle> GetHandles() const;
+
+private:
+    /**
+     * @brief Слот хранилища.
+     */
+    struct Slot {
+        std::optional<Session> session; ///< Сессия (пусто, если слот свободен или только зарезервирован).
+        uint32_t generation{1}; ///< Поколение слота (никогда не равно нулю).
+    };
+
+    /// Количество слотов в блоке.
+    static constexpr uint32_t CHUNK_SIZE{256};
+
+    /// Маска индекса в дескрипторе и токене.
+    static constexpr uint64_t INDEX_MASK{0x7fffffff};
+
+    /**
+     * @brief Извлекает индекс слота из дескриптора.
+     */
+    static uint32_t GetIndex(Handle handle) noexcept;
+
+    /**
+     * @brief Слот по индексу (индекс должен быть выделен).
+     */
+    Slot& GetSlot(uint32_t index) noexcept;
+
+private:
+    std::vector<std::unique_ptr<Slot[]>> _chunks; ///< Блоки слотов.
+    std::vector<uint32_t> _free; ///< Свободные индексы (стек: недавно освобожденные слоты первыми).
+    size_t _size{}; ///< Количество занятых слотов.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_SESSION_SESSION_SLAB_H
@@ -0,0 +1,235 @@
+#include <algorithm>
+
+#include "timer_wheel.h"
+
+namespace {
+
+// Циклический сдвиг вправо (shift в [0, 64)).
+uint64_t RotateRight(uint64_t value, unsigned shift) noexcept {
+    return shift == 0 ? value : (value >> shift) | (value << (64 - shift));
+}
+
+} // namespace
+
+TimerWheel::Timer::~Timer() {
+    Cancel();
+}
+
+void TimerWheel::Timer::Cancel() noexcept {
+    if (prev) {
+        TimerWheel::Unlink(*this);
+    }
+}
+
+bool TimerWheel::Timer::IsScheduled() const noexcept {
+    return prev != nullptr;
+}
+
+void TimerWheel::Timer::SetData(uint64_t data) noexcept {
+    _data = data;
+}
+
+uint64_t TimerWheel::Timer::GetData() const noexcept {
+    return _data;
+}
+
+TimerWheel::TimerWheel(Clock::time_point start) :
+    _start(start)
+{
+    for (auto& level : _slots) {
+        for (auto& slot : level) {
+            Reset(slot);
+        }
+    }
+
+    Reset(_expired);
+}
+
+TimerWheel::~TimerWheel() {
+    auto detach{[](Link& head) {
+        for (Link* link{head.next}; link != &head;) {
+            Link* next{link->next};
+            link->prev = link->next = nullptr;
+            link = next;
+        }
+    }};
+
+    for (auto& level : _slots) {
+        for (auto& slot : level) {
+            detach(slot);
+        }
+    }
+
+    detach(_expired);
+}
+
+void TimerWheel::Reset(Link& head) noexcept {
+    head.prev = head.next = &head;
+}
+
+void TimerWheel::Append(Link& head, Link& link) noexcept {
+    link.prev = head.prev;
+    link.next = &head;
+    head.prev->next = &link;
+    head.prev = &link;
+}
+
+void TimerWheel::Unlink(Link& link) noexcept {
+    link.prev->next = link.next;
+    link.next->prev = link.prev;
+    link.prev = link.next = nullptr;
+}
+
+void TimerWheel::Splice(Link& from, Link& to) noexcept {
+    if (from.next == &from) {
+        return;
+    }
+
+    from.next->prev = to.prev;
+    to.prev->next = from.next;
+    from.prev->next = &to;
+    to.prev = from.prev;
+
+    Reset(from);
+}
+
+void TimerWheel::Schedule(Timer& timer, Clock::time_point when) noexcept {
+    timer.Cancel();
+
+    auto delay{std::chrono::ceil<std::chrono::milliseconds>(when - _start).count()};
+    timer._expires = delay > 0 ? static_cast<uint64_t>(delay) : 0;
+
+    Place(timer);
+}
+
+void TimerWheel::Place(Timer& timer) noexcept {
+    if (timer._expires <= _now) {
+        Append(_expired, timer);
+
+        return;
+    }
+
+    // Срок за пределами охвата ждет в последнем слоте и переставляется при каскаде.
+    uint64_t expires{std::min(timer._expires, _now + SPAN - 1)};
+    uint64_t delta{expires - _now};
+
+    // Уровень — по старшему биту расстояния: на уровне l расстояние меньше SLOTS^(l + 1).
+    size_t level{static_cast<size_t>(63 - __builtin_clzll(delta)) / SLOT_BITS};
+    size_t slot{static_cast<size_t>(expires >> (level * SLOT_BITS)) & SLOT_MASK};
+
+    Append(_slots[level][slot], timer);
+    _occupied[level] |= uint64_t{1} << slot;
+}
+
+void TimerWheel::Cascade() noexcept {
+    size_t top{1};
+
+    while (top + 1 < LEVELS && (_now & ((uint64_t{1} << ((top + 1) * SLOT_BITS)) - 1)) == 0) {
+        ++top;
+    }
+
+    // Сверху вниз: таймеры верхнего уровня могут спуститься в слот, который разбирается следом.
+    for (size_t level{top}; level > 0; --level) {
+        size_t slot{static_cast<size_t>(_now >> (level * SLOT_BITS)) & SLOT_MASK};
+        Link pending;
+
+        Reset(pending);
+        Splice(_slots[level][slot], pending);
+        _occupied[level] &= ~(uint64_t{1} << slot);
+
+        while (pending.next != &pending) {
+            Timer& timer{static_cast<Timer&>(*pending.next)};
+
+            Unlink(timer);
+            Place(timer);
+        }
+    }
+}
+
+void TimerWheel::Advance(Clock::time_point now) noexcept {
+    auto elapsed{std::chrono::floor<std::chrono::milliseconds>(now - _start).count()};
+    uint64_t target{elapsed > 0 ? static_cast<uint64_t>(elapsed) : 0};
+
+    while (_now < target) {
+        // Следующий такт, на котором есть работа: непустой слот нулевого уровня в текущем обороте
+        // или начало следующего оборота (каскад).
+        uint64_t next{(_now | SLOT_MASK) + 1};
+        unsigned offset{static_cast<unsigned>(_now & SLOT_MASK) + 1};
+
+        if (offset < SLOTS) {
+            uint64_t pending{_occupied[0] & (~uint64_t{0} << offset)};
+
+            if (pending != 0) {
+                next = (_now & ~SLOT_MASK) + static_cast<uint64_t>(__builtin_ctzll(pending));
+            }
+        }
+
+        _now = std::min(next, target);
+
+        if ((_now & SLOT_MASK) == 0) {
+            Cascade();
+        }
+
+        size_t slot{static_cast<size_t>(_now & SLOT_MASK)};
+
+        Splice(_slots[0][slot], _expired);
+        _occupied[0] &= ~(uint64_t{1} << slot);
+    }
+}
+
+TimerWheel::Timer* TimerWheel::PopExpired() noexcept {
+    if (_expired.next == &_expired) {
+        return nullptr;
+    }
+
+    Timer& timer{static_cast<Timer&>(*_expired.next)};
+    Unlink(timer);
+
+    return &timer;
+}
+
+uint64_t TimerWheel::FindNextSlot(size_t level) noexcept {
+    unsigned current{static_cast<unsigned>((_now >> (level * SLOT_BITS)) & SLOT_MASK)};
+
+    while (_occupied[level] != 0) {
+        // Бит слота s оказывается на позиции (s - current - 1) mod SLOTS: первый бит — ближайший слот после текущего.
+        uint64_t rotated{RotateRight(_occupied[level], (current + 1) & SLOT_MASK)};
+        uint64_t distance{static_cast<uint64_t>(__builtin_ctzll(rotated)) + 1};
+        size_t slot{static_cast<size_t>((current + distance) & SLOT_MASK)};
+
+        if (_slots[level][slot].next != &_slots[level][slot]) {
+            return distance;
+        }
+
+        // Таймеры слота отменены: снимаем устаревший бит.
+        _occupied[level] &= ~(uint64_t{1} << slot);
+    }
+
+    return 0;
+}
+
+TimerWheel::Clock::time_point TimerWheel::GetNextExpiry() noexcept {
+    if (_expired.next != &_expired) {
+        return _start + std::chrono::milliseconds(_now);
+    }
+
+    uint64_t next{UINT64_MAX};
+
+    for (size_t level{}; level < LEVELS; ++level) {
+        uint64_t distance{FindNextSlot(level)};
+
+        if (distance == 0) {
+            continue;
+        }
+
+        // Слот уровня l разбирается в начале своего блока из SLOTS^l тактов.
+        size_t shift{level * SLOT_BITS};
+        next = std::min(next, ((_now >> shift) + distance) << shift);
+    }
+
+    if (next == UINT64_MAX) {
+        return Clock::time_point::max();
+    }
+
+    return _start + std::chrono::milliseconds(next);
+}
@@ -0,0 +1,197 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_TIMER_TIMER_WHEEL_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_TIMER_TIMER_WHEEL_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Иерархическое колесо таймеров с шагом в одну миллисекунду.
+ *
+ * LEVELS уровней по SLOTS слотов: слот уровня l покрывает SLOTS^l миллисекунд, всего колесо охватывает
+ * SLOTS^LEVELS мс (около 4,6 часа; более далекие сроки ждут на последнем уровне и переставляются
+ * при каждом его обороте). Таймер стоит на уровне, соответствующем расстоянию до срока, и при подходе
+ * срока спускается на нижние уровни (каскад), пока не попадет в слот нулевого уровня своей миллисекунды.
+ *
+ * Таймеры — интрузивные узлы двусвязных списков, которыми владеет вызывающий (например, сессия):
+ * постановка, перестановка и отмена — O(1) без выделения памяти. Непустые слоты отмечены битовыми
+ * масками уровней, поэтому Advance() перескакивает пустые слоты, а GetNextExpiry() находит ближайший
+ * срок за несколько инструкций. Маски обновляются лениво: отмена таймера не трогает колесо,
+ * и бит опустевшего слота снимается при следующем обращении к нему.
+ *
+ * Объект не потокобезопасен: у каждого рабочего потока свое колесо.
+ */
+class TimerWheel {
+public:
+    /// Монотонные часы для отсчета сроков.
+    using Clock = std::chrono::steady_clock;
+
+    /// Бит индекса слота на уровень.
+    static constexpr size_t SLOT_BITS{6};
+
+    /// Количество слотов на уровне.
+    static constexpr size_t SLOTS{size_t{1} << SLOT_BITS};
+
+    /// Количество уровней.
+    static constexpr size_t LEVELS{4};
+
+private:
+    /**
+     * @brief Звено кольцевого двусвязного списка (заголовок слота или таймер).
+     */
+    struct Link {
+        Link* prev{nullptr}; ///< Предыдущее звено (nullptr — таймер не стоит в колесе).
+        Link* next{nullptr}; ///< Следующее звено.
+    };
+
+public:
+    /**
+     * @brief Таймер. Принадлежит вызывающему и должен жить по тому же адресу, пока стоит в колесе.
+     *
+     * Деструктор снимает таймер с колеса, поэтому владелец может быть удален в любой момент.
+     */
+    class Timer : private Link {
+    public:
+        Timer() = default;
+
+        /**
+         * @brief Деструктор. Снимает таймер с колеса.
+         */
+        ~Timer();
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        /**
+         * @brief Снимает таймер с колеса (или из списка истекших). Ничего не делает, если таймер не взведен.
+         */
+        void Cancel() noexcept;
+
+        /**
+         * @brief Проверяет, взведен ли таймер (или истек, но еще не получен через PopExpired()).
+         */
+        bool IsScheduled() const noexcept;
+
+        /**
+         * @brief Устанавливает данные владельца (например, дескриптор сессии).
+         */
+        void SetData(uint64_t data) noexcept;
+
+        /**
+         * @brief Данные владельца.
+         */
+        uint64_t GetData() const noexcept;
+
+    private:
+        friend class TimerWheel;
+
+        uint64_t _expires{}; ///< Срок в миллисекундах от создания колеса.
+        uint64_t _data{}; ///< Данные владельца.
+    };
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param start Начало отсчета (обычно текущее время).
+     */
+    explicit TimerWheel(Clock::time_point start);
+
+    /**
+     * @brief Деструктор. Отвязывает оставшиеся таймеры: их владельцы могут пережить колесо.
+     */
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /**
+     * @brief Взводит таймер (или переставляет уже взведенный).
+     *
+     * Срок округляется вверх до миллисекунды, поэтому таймер не истекает раньше when.
+     * Срок в прошлом ставит таймер сразу в список истекших.
+     *
+     * @param timer Таймер.
+     * @param when Срок.
+     */
+    void Schedule(Timer& timer, Clock::time_point when) noexcept;
+
+    /**
+     * @brief Продвигает колесо до момента now: истекшие таймеры переходят в список истекших.
+     * @param now Текущее время.
+     */
+    void Advance(Clock::time_point now) noexcept;
+
+    /**
+     * @brief Снимает с колеса очередной истекший таймер.
+     *
+     * Пока истекшие таймеры обрабатываются, можно взводить и отменять любые таймеры, в том числе
+     * удалять их владельцев.
+     *
+     * @return Timer* Таймер или nullptr, если истекших нет.
+     */
+    Timer* PopExpired() noexcept;
+
+    /**
+     * @brief Время, до которого колесо заведомо не изменится.
+     *
+     * Это срок ближайшего таймера нулевого уровня или ближайший каскад верхнего уровня (после него
+     * срок пересчитывается), то есть ожидание событий до этого момента не пропустит ни одного таймера.
+     *
+     * @return Clock::time_point Время или Clock::time_point::max(), если таймеров нет.
+     */
+    Clock::time_point GetNextExpiry() noexcept;
+
+private:
+    /// Сроки дальше этого расстояния ставятся в последний слот охвата колеса.
+    static constexpr uint64_t SPAN{uint64_t{1} << (SLOT_BITS * LEVELS)};
+
+    /// Маска индекса слота.
+    static constexpr uint64_t SLOT_MASK{SLOTS - 1};
+
+    /**
+     * @brief Делает список пустым (звено ссылается на себя).
+     */
+    static void Reset(Link& head) noexcept;
+
+    /**
+     * @brief Добавляет звено в конец списка.
+     */
+    static void Append(Link& head, Link& link) noexcept;
+
+    /**
+     * @brief Вынимает звено из списка.
+     */
+    static void Unlink(Link& link) noexcept;
+
+    /**
+     * @brief Переносит все звенья списка from в конец списка to.
+     */
+    static void Splice(Link& from, Link& to) noexcept;
+
+    /**
+     * @brief Ставит таймер в слот по его сроку относительно текущего такта.
+     */
+    void Place(Timer& timer) noexcept;
+
+    /**
+     * @brief Переставляет таймеры слотов верхних уровней, оборот которых начинается на текущем такте.
+     */
+    void Cascade() noexcept;
+
+    /**
+     * @brief Циклическое расстояние (1..SLOTS) от текущего слота уровня до ближайшего непустого.
+     * @param level Уровень.
+     * @return uint64_t Расстояние или 0, если уровень пуст.
+     */
+    uint64_t FindNextSlot(size_t level) noexcept;
+
+private:
+    Clock::time_point _start; ///< Начало отсчета.
+    uint64_t _now{}; ///< Текущий такт (миллисекунды от начала отсчета).
+
+    Link _slots[LEVELS][SLOTS]; ///< Заголовки списков слотов.
+    uint64_t _occupied[LEVELS]{}; ///< Маски слотов, которые могут быть непусты.
+    Link _expired; ///< Истекшие таймеры, еще не полученные через PopExpired().
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_TIMER_TIMER_WHEEL_H
@@ -0,0 +1,109 @@
+#include <stdexcept>
+
+#include <openssl/err.h>
+
+#include "tls_context.h"
+
+namespace {
+
+std::string GetErrorText() {
+    unsigned long code{ERR_get_error()};
+    char reason[256]{};
+
+    ERR_error_string_n(code, reason, sizeof(reason));
+    ERR_clear_error();
+
+    return code != 0 ? reason : "unknown error";
+}
+
+} // namespace
+
+TlsContext::TlsContext(const TlsOptions& options) {
+    if (!options.cert_file.empty()) {
+        _client = CreateContext(TLS_server_method());
+
+        if (SSL_CTX_use_certificate_chain_file(_client.get(), options.cert_file.c_str()) != 1) {
+            throw std::runtime_error("TlsContext(): certificate " + options.cert_file + ": " + GetErrorText());
+        }
+
+        if (SSL_CTX_use_PrivateKey_file(_client.get(), options.key_file.c_str(), SSL_FILETYPE_PEM) != 1) {
+            throw std::runtime_error("TlsContext(): private key " + options.key_file + ": " + GetErrorText());
+        }
+
+        if (SSL_CTX_check_private_key(_client.get()) != 1) {
+            throw std::runtime_error("TlsContext(): private key does not match the certificate: " + GetErrorText());
+        }
+
+        // Клиент сессии обслуживает один рабочий поток; возобновление — через билеты, без общего кэша.
+        SSL_CTX_set_session_cache_mode(_client.get(), SSL_SESS_CACHE_OFF);
+    }
+
+    if (options.backend) {
+        _backend = CreateContext(TLS_client_method());
+
+        if (!options.backend_ca_file.empty()) {
+            if (SSL_CTX_load_verify_locations(_backend.get(), options.backend_ca_file.c_str(), nullptr) != 1) {
+                throw std::runtime_error("TlsContext(): CA file " + options.backend_ca_file + ": " + GetErrorText());
+            }
+
+            SSL_CTX_set_verify(_backend.get(), SSL_VERIFY_PEER, nullptr);
+        }
+    }
+}
+
+TlsContext::ContextPtr TlsContext::CreateContext(const SSL_METHOD* method) {
+    ContextPtr context{SSL_CTX_new(method), SSL_CTX_free};
+
+    if (!context) {
+        throw std::runtime_error("TlsContext(): " + GetErrorText());
+    }
+
+    SSL_CTX_set_min_proto_version(context.get(), TLS1_2_VERSION);
+
+    // Обрыв без close_notify считается закрытием: границы данных задает протокол PostgreSQL.
+    SSL_CTX_set_options(context.get(), SSL_OP_ENABLE_KTLS | SSL_OP_IGNORE_UNEXPECTED_EOF | SSL_OP_NO_RENEGOTIATION);
+
+    // Буфер сессии переиспользуется между повторами записи, а отправлять можно частями, как send().
+    SSL_CTX_set_mode(context.get(), SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER |
+                                    SSL_MODE_RELEASE_BUFFERS);
+
+    return context;
+}
+
+SSL* TlsContext::CreateSSL(SSL_CTX* context, int fd) {
+    SSL* ssl{SSL_new(context)};
+
+    if (!ssl) {
+        throw std::runtime_error("TlsContext::CreateSSL(): " + GetErrorText());
+    }
+
+    if (SSL_set_fd(ssl, fd) != 1) {
+        SSL_free(ssl);
+
+        throw std::runtime_error("TlsContext::CreateSSL(): " + GetErrorText());
+    }
+
+    return ssl;
+}
+
+bool TlsContext::IsClientEnabled() const noexcept {
+    return _client != nullptr;
+}
+
+bool TlsContext::IsBackendEnabled() const noexcept {
+    return _backend != nullptr;
+}
+
+std::unique_ptr<TlsStream> TlsContext::AcceptClient(int fd) const {
+    SSL* ssl{CreateSSL(_client.get(), fd)};
+    SSL_set_accept_state(ssl);
+
+    return std::make_unique<TlsStream>(ssl);
+}
+
+std::unique_ptr<TlsStream> TlsContext::ConnectBackend(int fd) const {
+    SSL* ssl{CreateSSL(_backend.get(), fd)};
+    SSL_set_connect_state(ssl);
+
+    return std::make_unique<TlsStream>(ssl);
+}
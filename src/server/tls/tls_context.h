@@ -0,0 +1,91 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_TLS_TLS_CONTEXT_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_TLS_TLS_CONTEXT_H
+
+#include <string>
+#include <memory>
+
+#include <openssl/ssl.h>
+
+#include "tls_stream.h"
+
+/**
+ * @brief Параметры TLS.
+ */
+struct TlsOptions {
+    std::string cert_file; ///< Сертификат прокси для клиентов в формате PEM (пусто — TLS клиентов выключен).
+    std::string key_file; ///< Закрытый ключ сертификата в формате PEM.
+    bool backend{false}; ///< Шифровать соединения с PostgreSQL (сервер обязан принять SSLRequest).
+    std::string backend_ca_file; ///< Корневые сертификаты для проверки PostgreSQL (пусто — без проверки).
+};
+
+/**
+ * @brief Общие для всех рабочих потоков контексты OpenSSL.
+ *
+ * Серверный контекст завершает TLS клиентов: прокси сам отвечает на SSLRequest и расшифровывает поток,
+ * поэтому запросы разбираются и логируются так же, как открытым текстом. Клиентский контекст шифрует
+ * соединения прокси с PostgreSQL. Оба разрешают kTLS (SSL_OP_ENABLE_KTLS): если ядро поддерживает
+ * шифр сессии, после рукопожатия шифрование записей выполняет ядро, и данные отправляются обычными
+ * sendmsg() и splice() без копирования через OpenSSL.
+ *
+ * Контексты неизменны после создания, поэтому потоки создают соединения (TlsStream) без блокировок.
+ */
+class TlsContext {
+public:
+    /**
+     * @brief Конструктор. Загружает сертификат и ключ и создает включенные контексты.
+     * @param options Параметры TLS.
+     * @throw std::runtime_error Если сертификат, ключ или корневые сертификаты не удалось загрузить.
+     */
+    explicit TlsContext(const TlsOptions& options);
+
+    /**
+     * @brief Проверяет, завершает ли прокси TLS клиентов.
+     */
+    bool IsClientEnabled() const noexcept;
+
+    /**
+     * @brief Проверяет, шифруются ли соединения с PostgreSQL.
+     */
+    bool IsBackendEnabled() const noexcept;
+
+    /**
+     * @brief Создает серверную сторону TLS для клиентского сокета.
+     * @param fd Клиентский сокет (неблокирующий).
+     * @return std::unique_ptr<TlsStream> Соединение, ожидающее рукопожатия.
+     * @throw std::runtime_error Если соединение OpenSSL не удалось создать.
+     */
+    std::unique_ptr<TlsStream> AcceptClient(int fd) const;
+
+    /**
+     * @brief Создает клиентскую сторону TLS для сокета PostgreSQL.
+     * @param fd Сокет PostgreSQL (неблокирующий, подключение завершено).
+     * @return std::unique_ptr<TlsStream> Соединение, ожидающее рукопожатия.
+     * @throw std::runtime_error Если соединение OpenSSL не удалось создать.
+     */
+    std::unique_ptr<TlsStream> ConnectBackend(int fd) const;
+
+private:
+    /// Владеющий указатель на контекст OpenSSL.
+    using ContextPtr = std::unique_ptr<SSL_CTX, decltype(&SSL_CTX_free)>;
+
+    /**
+     * @brief Создает контекст с общими настройками: TLS 1.2+, kTLS, неблокирующая частичная запись.
+     * @param method Метод OpenSSL (серверный или клиентский).
+     * @throw std::runtime_error Если контекст не удалось создать.
+     */
+    static ContextPtr CreateContext(const SSL_METHOD* method);
+
+    /**
+     * @brief Создает соединение OpenSSL на сокете.
+     * @param context Контекст.
+     * @param fd Сокет.
+     * @throw std::runtime_error Если соединение не удалось создать.
+     */
+    static SSL* CreateSSL(SSL_CTX* context, int fd);
+
+private:
+    ContextPtr _client{nullptr, SSL_CTX_free}; ///< Серверный контекст для клиентов (nullptr — выключен).
+    ContextPtr _backend{nullptr, SSL_CTX_free}; ///< Клиентский контекст для PostgreSQL (nullptr — выключен).
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_TLS_TLS_CONTEXT_H
@@ -0,0 +1,138 @@
+#include <cerrno>
+#include <iostream>
+
+#include <openssl/err.h>
+
+#include "tls_stream.h"
+
+TlsStream::TlsStream(SSL* ssl) noexcept :
+    _ssl(ssl)
+{}
+
+TlsStream::~TlsStream() {
+    // Неблокирующий сокет: close_notify отправляется, если помещается, ответ не ждется.
+    if (_established && !_failed) {
+        ERR_clear_error();
+        SSL_shutdown(_ssl);
+    }
+
+    SSL_free(_ssl);
+    ERR_clear_error();
+}
+
+int TlsStream::OnError(int result, const char* operation) {
+    int error{SSL_get_error(_ssl, result)};
+
+    _want_write = error == SSL_ERROR_WANT_WRITE;
+
+    switch (error) {
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            errno = EAGAIN;
+
+            return 0;
+        case SSL_ERROR_ZERO_RETURN:
+            return 1;
+        case SSL_ERROR_SYSCALL:
+            _failed = true;
+
+            // errno сокета сохраняется для вызывающего.
+            if (errno == 0) {
+                errno = ECONNRESET;
+            }
+
+            return -1;
+        default: {
+            _failed = true;
+
+            unsigned long code{ERR_get_error()};
+            char reason[256]{};
+
+            ERR_error_string_n(code, reason, sizeof(reason));
+            std::cerr << std::string(operation) + "() TLS error: " + (code != 0 ? reason : "unknown") + "\n";
+            ERR_clear_error();
+
+            errno = EPROTO;
+
+            return -1;
+        }
+    }
+}
+
+int TlsStream::Handshake() {
+    if (_established) {
+        return 1;
+    }
+
+    ERR_clear_error();
+    errno = 0;
+
+    int result{SSL_do_handshake(_ssl)};
+
+    if (result == 1) {
+        _established = true;
+        _want_write = false;
+
+        return 1;
+    }
+
+    // Закрытие посреди рукопожатия — тоже ошибка.
+    return OnError(result, "SSL_do_handshake") == 0 ? 0 : -1;
+}
+
+bool TlsStream::IsEstablished() const noexcept {
+    return _established;
+}
+
+ssize_t TlsStream::Read(char* data, size_t size) {
+    size_t read{};
+
+    ERR_clear_error();
+    errno = 0;
+
+    if (SSL_read_ex(_ssl, data, size, &read) == 1) {
+        _want_write = false;
+
+        return static_cast<ssize_t>(read);
+    }
+
+    int status{OnError(0, "SSL_read")};
+
+    return status == 1 ? 0 : -1;
+}
+
+ssize_t TlsStream::Write(const char* data, size_t size) {
+    size_t written{};
+
+    ERR_clear_error();
+    errno = 0;
+
+    if (SSL_write_ex(_ssl, data, size, &written) == 1) {
+        _want_write = false;
+
+        return static_cast<ssize_t>(written);
+    }
+
+    // close_notify от собеседника при отправке — закрытие соединения, как EPIPE у send().
+    if (OnError(0, "SSL_write") == 1) {
+        errno = EPIPE;
+    }
+
+    return -1;
+}
+
+bool TlsStream::HasPending() const noexcept {
+    return SSL_pending(_ssl) > 0;
+}
+
+bool TlsStream::WantsWrite() const noexcept {
+    return _want_write;
+}
+
+bool TlsStream::IsKernelSend() const noexcept {
+    return _established && BIO_get_ktls_send(SSL_get_wbio(_ssl));
+}
+
+bool TlsStream::IsKernelRecv() const noexcept {
+    return _established && BIO_get_ktls_recv(SSL_get_rbio(_ssl));
+}
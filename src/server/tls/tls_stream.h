@@ -0,0 +1,107 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_TLS_TLS_STREAM_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_TLS_TLS_STREAM_H
+
+#include <cstddef>
+
+#include <sys/types.h>
+#include <openssl/ssl.h>
+
+/**
+ * @brief TLS-соединение поверх неблокирующего сокета.
+ *
+ * Read() и Write() повторяют соглашения recv()/send(): количество байт, 0 при закрытии соединения
+ * (close_notify или обрыв), -1 с errno == EAGAIN, когда OpenSSL ждет сокет, и -1 с errno == EPROTO
+ * при ошибке TLS (ее текст печатается). Поэтому сессия читает и пишет TLS теми же циклами,
+ * что и открытый текст.
+ *
+ * Если после рукопожатия ядро взяло шифрование на себя (kTLS), IsKernelSend() возвращает true:
+ * в сокет можно писать открытый текст напрямую (sendmsg(), splice()), ядро само оформит записи TLS.
+ * Чтение всегда идет через Read(): с kTLS приема OpenSSL получает уже расшифрованные данные
+ * и обрабатывает служебные записи (alert, KeyUpdate), которые recv() вернул бы ошибкой.
+ */
+class TlsStream {
+public:
+    /**
+     * @brief Конструктор.
+     * @param ssl Соединение OpenSSL, привязанное к сокету (переходит во владение).
+     */
+    explicit TlsStream(SSL* ssl) noexcept;
+
+    /**
+     * @brief Деструктор. Отправляет close_notify (без ожидания) и освобождает соединение.
+     */
+    ~TlsStream();
+
+    TlsStream(const TlsStream&) = delete;
+    TlsStream& operator=(const TlsStream&) = delete;
+
+    /**
+     * @brief Продолжает рукопожатие.
+     * @return int 1 — рукопожатие завершено, 0 — ожидается сокет (WantsWrite()), -1 — ошибка.
+     */
+    int Handshake();
+
+    /**
+     * @brief Проверяет, завершено ли рукопожатие.
+     */
+    bool IsEstablished() const noexcept;
+
+    /**
+     * @brief Читает расшифрованные данные.
+     * @param data Буфер.
+     * @param size Размер буфера.
+     * @return ssize_t Количество байт, 0 при закрытии или -1 (errno: EAGAIN или EPROTO).
+     */
+    ssize_t Read(char* data, size_t size);
+
+    /**
+     * @brief Шифрует и отправляет данные (возможна частичная запись).
+     * @param data Данные.
+     * @param size Размер данных.
+     * @return ssize_t Количество отправленных байт или -1 (errno: EAGAIN, EPROTO или ошибка сокета).
+     */
+    ssize_t Write(const char* data, size_t size);
+
+    /**
+     * @brief Проверяет, остались ли в OpenSSL расшифрованные данные, не полученные через Read().
+     *
+     * Такие данные уже ушли из сокета, и Poller о них не сообщит: их нужно дочитать, прежде чем
+     * приостанавливать чтение.
+     */
+    bool HasPending() const noexcept;
+
+    /**
+     * @brief Проверяет, ждет ли последняя операция готовности сокета к записи.
+     *
+     * Рукопожатие или чтение могут требовать отправки (например, NewSessionTicket в TLS 1.3),
+     * тогда сокет нужно подписать на EPOLLOUT, даже если очередь отправки пуста.
+     */
+    bool WantsWrite() const noexcept;
+
+    /**
+     * @brief Проверяет, шифрует ли отправку ядро (kTLS).
+     */
+    bool IsKernelSend() const noexcept;
+
+    /**
+     * @brief Проверяет, расшифровывает ли прием ядро (kTLS).
+     */
+    bool IsKernelRecv() const noexcept;
+
+private:
+    /**
+     * @brief Разбирает результат операции OpenSSL.
+     * @param result Результат SSL_*().
+     * @param operation Название операции для сообщения об ошибке.
+     * @return int 0 — ожидается сокет (errno = EAGAIN), 1 — соединение закрыто, -1 — ошибка (errno = EPROTO или ошибка сокета).
+     */
+    int OnError(int result, const char* operation);
+
+private:
+    SSL* _ssl; ///< Соединение OpenSSL.
+    bool _established{false}; ///< Рукопожатие завершено.
+    bool _want_write{false}; ///< Последняя операция ждет готовности к записи.
+    bool _failed{false}; ///< Соединение прервано ошибкой (close_notify не отправляется).
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_TLS_TLS_STREAM_H
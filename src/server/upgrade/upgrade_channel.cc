@@ -0,0 +1,191 @@
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/un.h>
+#include <sys/time.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "upgrade_channel.h"
+
+namespace {
+
+constexpr size_t MAX_MESSAGE_SIZE{size_t{64} << 10};
+
+} // namespace
+
+UpgradeChannel::UpgradeChannel(UniqueFD&& fd) :
+    _fd(std::move(fd))
+{}
+
+UniqueFD UpgradeChannel::Connect(const std::string& path) {
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::invalid_argument("Invalid upgrade socket path: " + path);
+    }
+
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    UniqueFD fd(socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0));
+
+    if (!fd.Valid()) {
+        throw std::runtime_error("UpgradeChannel::Connect(): " + std::string(strerror(errno)));
+    }
+
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1) {
+        // Сокета нет или он остался от завершенного процесса: обновлять некого.
+        if (errno == ENOENT || errno == ECONNREFUSED) {
+            return UniqueFD();
+        }
+
+        throw std::runtime_error("UpgradeChannel::Connect(): " + std::string(strerror(errno)));
+    }
+
+    return fd;
+}
+
+bool UpgradeChannel::Valid() const {
+    return _fd.Valid();
+}
+
+void UpgradeChannel::SetTimeout(size_t timeout_ms) {
+    struct timeval timeout = {};
+    timeout.tv_sec = static_cast<time_t>(timeout_ms / 1000);
+    timeout.tv_usec = static_cast<suseconds_t>(timeout_ms % 1000 * 1000);
+
+    setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+bool UpgradeChannel::Send(Type type, std::string_view data, const std::vector<int>& fds) {
+    if (fds.size() > MAX_FDS) {
+        return false;
+    }
+
+    std::string message(1, static_cast<char>(type));
+    message.append(data);
+
+    iovec iov{message.data(), message.size()};
+
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * fds.size()));
+
+    if (!fds.empty()) {
+        msg.msg_control = control.data();
+        msg.msg_controllen = control.size();
+
+        cmsghdr* cmsg{CMSG_FIRSTHDR(&msg)};
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+        std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+    }
+
+    while (true) {
+        ssize_t n{sendmsg(_fd, &msg, MSG_NOSIGNAL)};
+
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+
+        return n == static_cast<ssize_t>(message.size());
+    }
+}
+
+bool UpgradeChannel::Receive(Type& type, std::string& data, std::vector<UniqueFD>& fds) {
+    std::vector<char> buffer(MAX_MESSAGE_SIZE);
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * MAX_FDS));
+
+    iovec iov{buffer.data(), buffer.size()};
+
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    ssize_t n{};
+
+    do {
+        n = recvmsg(_fd, &msg, MSG_CMSG_CLOEXEC);
+    } while (n == -1 && errno == EINTR);
+
+    fds.clear();
+
+    if (n == -1) {
+        return false;
+    }
+
+    // Дескрипторы забираются до проверок: иначе при ошибке они останутся открытыми в процессе.
+    for (cmsghdr* cmsg{CMSG_FIRSTHDR(&msg)}; cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+
+        size_t count{(cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int)};
+
+        for (size_t i{}; i < count; ++i) {
+            int fd{};
+            std::memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+            fds.emplace_back(fd);
+        }
+    }
+
+    if (n == 0 || (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))) {
+        return false;
+    }
+
+    type = static_cast<Type>(buffer[0]);
+    data.assign(buffer.data() + 1, static_cast<size_t>(n) - 1);
+
+    return true;
+}
+
+int UpgradeChannel::GetPeer(unsigned& uid) const {
+    struct ucred credentials = {};
+    socklen_t length{sizeof(credentials)};
+
+    if (getsockopt(_fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == -1) {
+        return -1;
+    }
+
+    uid = credentials.uid;
+
+    return credentials.pid;
+}
+
+std::string UpgradeChannel::EncodeBackend(const HandedBackend& backend) {
+    uint32_t length{htonl(static_cast<uint32_t>(backend.key.size()))};
+
+    std::string data(reinterpret_cast<const char*>(&length), sizeof(length));
+    data += backend.key;
+    data += backend.parameters;
+
+    return data;
+}
+
+bool UpgradeChannel::DecodeBackend(std::string_view data, HandedBackend& backend) {
+    uint32_t length{};
+
+    if (data.size() < sizeof(length)) {
+        return false;
+    }
+
+    std::memcpy(&length, data.data(), sizeof(length));
+    length = ntohl(length);
+    data.remove_prefix(sizeof(length));
+
+    if (data.size() < length) {
+        return false;
+    }
+
+    backend.key = std::string(data.substr(0, length));
+    backend.parameters = std::string(data.substr(length));
+
+    return true;
+}
@@ -0,0 +1,117 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_UPGRADE_UPGRADE_CHANNEL_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_UPGRADE_UPGRADE_CHANNEL_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <string_view>
+
+#include "../unique_fd/unique_fd.h"
+
+/**
+ * @brief Простаивающее соединение пула, передаваемое новому процессу при обновлении.
+ */
+struct HandedBackend {
+    UniqueFD fd; ///< Сокет PostgreSQL (соединение готово, вне транзакции).
+    std::string key; ///< Ключ пула (user, database).
+    std::string parameters; ///< Сообщения ParameterStatus этапа запуска.
+};
+
+/**
+ * @brief Канал обновления между старым и новым процессом прокси (UNIX-сокет SOCK_SEQPACKET).
+ *
+ * Каждое сообщение — тип (один байт), данные и, возможно, дескрипторы (SCM_RIGHTS). SOCK_SEQPACKET
+ * сохраняет границы сообщений, поэтому дескрипторы всегда приходят вместе со своим сообщением.
+ *
+ * Обмен при обновлении:
+ * - новый процесс: K_TAKEOVER;
+ * - старый: K_LISTENERS (порт, дескрипторы слушающих сокетов);
+ * - новый, настроив рабочие потоки на полученных сокетах: K_READY;
+ * - старый перестает принимать соединения и начинает плавную остановку, затем передает
+ *   простаивающие соединения пула (K_BACKEND, по одному) и завершает обмен K_END.
+ */
+class UpgradeChannel {
+public:
+    /**
+     * @brief Тип сообщения.
+     */
+    enum Type : char {
+        K_TAKEOVER = 'T', ///< Запрос нового процесса на передачу сокетов
+        K_LISTENERS = 'L', ///< Слушающие сокеты (данные — порт в сетевом порядке)
+        K_READY = 'R', ///< Новый процесс принимает соединения
+        K_BACKEND = 'B', ///< Соединение пула (данные — длина ключа, ключ, ParameterStatus)
+        K_END = 'E' ///< Передача завершена
+    };
+
+    /// Максимум дескрипторов в одном сообщении (SCM_MAX_FD).
+    static constexpr size_t MAX_FDS{253};
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param fd Подключенный сокет SOCK_SEQPACKET.
+     */
+    explicit UpgradeChannel(UniqueFD&& fd);
+
+    /**
+     * @brief Подключается к каналу обновления работающего процесса.
+     * @param path Путь к UNIX-сокету.
+     * @return UniqueFD Подключенный сокет или недействительный, если сокета нет или его никто не слушает.
+     * @throw std::runtime_error Если подключение не удалось по другой причине.
+     */
+    static UniqueFD Connect(const std::string& path);
+
+    /**
+     * @brief Проверяет, подключен ли канал.
+     */
+    bool Valid() const;
+
+    /**
+     * @brief Устанавливает таймаут приема и отправки.
+     * @param timeout_ms Таймаут в миллисекундах.
+     */
+    void SetTimeout(size_t timeout_ms);
+
+    /**
+     * @brief Отправляет сообщение.
+     * @param type Тип сообщения.
+     * @param data Данные.
+     * @param fds Дескрипторы (не больше MAX_FDS).
+     * @return true Если сообщение отправлено.
+     */
+    bool Send(Type type, std::string_view data = {}, const std::vector<int>& fds = {});
+
+    /**
+     * @brief Принимает сообщение.
+     * @param type Тип сообщения.
+     * @param data Данные.
+     * @param fds Полученные дескрипторы.
+     * @return true Если сообщение принято; false при ошибке, таймауте или закрытии канала.
+     */
+    bool Receive(Type& type, std::string& data, std::vector<UniqueFD>& fds);
+
+    /**
+     * @brief Возвращает идентификатор процесса на другом конце канала (SO_PEERCRED).
+     * @param uid Пользователь процесса.
+     * @return int PID или -1.
+     */
+    int GetPeer(unsigned& uid) const;
+
+    /**
+     * @brief Кодирует соединение пула в данные сообщения K_BACKEND.
+     */
+    static std::string EncodeBackend(const HandedBackend& backend);
+
+    /**
+     * @brief Разбирает данные сообщения K_BACKEND.
+     * @param data Данные.
+     * @param backend Соединение (ключ и параметры; дескриптор заполняет вызывающий).
+     * @return true Если данные корректны.
+     */
+    static bool DecodeBackend(std::string_view data, HandedBackend& backend);
+
+private:
+    UniqueFD _fd; ///< Сокет канала.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_UPGRADE_UPGRADE_CHANNEL_H
@@ -0,0 +1,90 @@
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#include "upgrade_client.h"
+
+namespace {
+
+constexpr size_t HANDSHAKE_TIMEOUT_MS{30000};
+
+} // namespace
+
+UpgradeClient::UpgradeClient(const std::string& path) :
+    _channel(UpgradeChannel::Connect(path))
+{
+    if (_channel.Valid()) {
+        _channel.SetTimeout(HANDSHAKE_TIMEOUT_MS);
+    }
+}
+
+bool UpgradeClient::IsConnected() const {
+    return _channel.Valid();
+}
+
+std::vector<UniqueFD> UpgradeClient::TakeListeners(int port) {
+    unsigned uid{};
+
+    if (_channel.GetPeer(uid) == -1 || uid != geteuid()) {
+        throw std::runtime_error("Upgrade: the running process belongs to another user");
+    }
+
+    if (!_channel.Send(UpgradeChannel::K_TAKEOVER)) {
+        throw std::runtime_error("Upgrade: send(): " + std::string(strerror(errno)));
+    }
+
+    UpgradeChannel::Type type{};
+    std::string data;
+    std::vector<UniqueFD> listeners;
+    uint16_t listen_port{};
+
+    if (!_channel.Receive(type, data, listeners) || type != UpgradeChannel::K_LISTENERS ||
+        data.size() != sizeof(listen_port) || listeners.empty()) {
+        throw std::runtime_error("Upgrade: the running process did not pass listening sockets");
+    }
+
+    std::memcpy(&listen_port, data.data(), sizeof(listen_port));
+
+    if (ntohs(listen_port) != port) {
+        throw std::runtime_error("Upgrade: the running process listens on port " + std::to_string(ntohs(listen_port)));
+    }
+
+    return listeners;
+}
+
+std::vector<HandedBackend> UpgradeClient::Finish() {
+    std::vector<HandedBackend> backends;
+
+    if (!_channel.Send(UpgradeChannel::K_READY)) {
+        std::cerr << "Upgrade: send(): " << strerror(errno) << '\n';
+
+        return backends;
+    }
+
+    UpgradeChannel::Type type{};
+    std::string data;
+    std::vector<UniqueFD> fds;
+
+    while (_channel.Receive(type, data, fds)) {
+        if (type == UpgradeChannel::K_END) {
+            return backends;
+        }
+
+        HandedBackend backend;
+
+        if (type != UpgradeChannel::K_BACKEND || fds.size() != 1 || !UpgradeChannel::DecodeBackend(data, backend)) {
+            continue;
+        }
+
+        backend.fd = std::move(fds[0]);
+        backends.push_back(std::move(backend));
+    }
+
+    std::cerr << "Upgrade: the running process closed the channel before passing all pooled connections\n";
+
+    return backends;
+}
@@ -0,0 +1,53 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_UPGRADE_UPGRADE_CLIENT_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_UPGRADE_UPGRADE_CLIENT_H
+
+#include <string>
+#include <vector>
+
+#include "upgrade_channel.h"
+#include "../unique_fd/unique_fd.h"
+
+/**
+ * @brief Сторона нового процесса в обновлении без простоя.
+ *
+ * Подключается к UNIX-сокету работающего процесса и забирает его слушающие сокеты (TakeListeners()).
+ * Когда рабочие потоки настроены на этих сокетах, Finish() сообщает о готовности: старый процесс
+ * перестает принимать соединения, начинает плавную остановку и передает простаивающие соединения пула.
+ */
+class UpgradeClient {
+public:
+    /**
+     * @brief Конструктор. Подключается к работающему процессу, если он есть.
+     * @param path Путь к UNIX-сокету.
+     * @throw std::runtime_error Если подключение не удалось не из-за отсутствия процесса.
+     */
+    explicit UpgradeClient(const std::string& path);
+
+    /**
+     * @brief Проверяет, найден ли работающий процесс.
+     */
+    bool IsConnected() const;
+
+    /**
+     * @brief Забирает слушающие сокеты работающего процесса.
+     * @param port Порт, который должен слушать новый процесс.
+     * @return std::vector<UniqueFD> Слушающие сокеты.
+     * @throw std::runtime_error Если обмен не удался или процесс слушает другой порт.
+     */
+    std::vector<UniqueFD> TakeListeners(int port);
+
+    /**
+     * @brief Сообщает о готовности и принимает простаивающие соединения пула.
+     *
+     * Ошибка на этом шаге не мешает новому процессу работать: сокеты уже получены,
+     * а соединения пула будут открыты заново.
+     *
+     * @return std::vector<HandedBackend> Соединения пула.
+     */
+    std::vector<HandedBackend> Finish();
+
+private:
+    UpgradeChannel _channel; ///< Канал к работающему процессу.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_UPGRADE_UPGRADE_CLIENT_H
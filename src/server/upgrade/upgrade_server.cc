@@ -0,0 +1,203 @@
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "upgrade_server.h"
+
+UpgradeServer::UpgradeServer(const std::string& path, int port, std::vector<UniqueFD> listeners, size_t workers,
+                             int wakeup_fd, StopCallback is_stopped, DrainCallback start_drain) :
+    _path(path),
+    _port(port),
+    _listeners(std::move(listeners)),
+    _workers(workers),
+    _wakeup_fd(wakeup_fd),
+    _is_stopped(std::move(is_stopped)),
+    _start_drain(std::move(start_drain))
+{
+    SetupSocket(path);
+}
+
+UpgradeServer::~UpgradeServer() {
+    CloseSocket();
+}
+
+void UpgradeServer::SetupSocket(const std::string& path) {
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::invalid_argument("Invalid upgrade socket path: " + path);
+    }
+
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    _listen_fd = UniqueFD(socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0));
+
+    if (!_listen_fd.Valid()) {
+        throw std::runtime_error("UpgradeServer::SetupSocket(): " + std::string(strerror(errno)));
+    }
+
+    // Живой процесс на этом пути уже передал сокеты (UpgradeChannel::Connect()): файл остался от завершенного.
+    unlink(path.c_str());
+
+    if (bind(_listen_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1) {
+        throw std::runtime_error("UpgradeServer::SetupSocket(): " + std::string(strerror(errno)));
+    }
+
+    chmod(path.c_str(), S_IRUSR | S_IWUSR);
+
+    if (listen(_listen_fd, 4) == -1) {
+        throw std::runtime_error("UpgradeServer::SetupSocket(): " + std::string(strerror(errno)));
+    }
+}
+
+void UpgradeServer::CloseSocket() {
+    if (!_listen_fd.Valid()) {
+        return;
+    }
+
+    _listen_fd.Close();
+    unlink(_path.c_str());
+}
+
+bool UpgradeServer::IsHandingOff() const noexcept {
+    return _handing_off.load(std::memory_order_acquire);
+}
+
+void UpgradeServer::Offer(std::vector<HandedBackend> backends) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        for (auto& backend : backends) {
+            _offered.push_back(std::move(backend));
+        }
+
+        ++_offers;
+    }
+
+    _cv.notify_one();
+}
+
+std::vector<HandedBackend> UpgradeServer::WaitOffers() {
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    _cv.wait_for(lock, std::chrono::milliseconds(OFFER_TIMEOUT_MS), [this]() { return _offers >= _workers; });
+
+    return std::move(_offered);
+}
+
+void UpgradeServer::Run() {
+    while (!_is_stopped()) {
+        struct pollfd fds[2] = {{_listen_fd, POLLIN, 0}, {_wakeup_fd, POLLIN, 0}};
+
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            std::cerr << "UpgradeServer poll(): " << strerror(errno) << '\n';
+
+            break;
+        }
+
+        if (!(fds[0].revents & POLLIN)) {
+            continue;
+        }
+
+        UniqueFD connection(accept4(_listen_fd, nullptr, nullptr, SOCK_CLOEXEC));
+
+        if (!connection.Valid()) {
+            continue;
+        }
+
+        UpgradeChannel channel(std::move(connection));
+
+        if (Serve(channel)) {
+            break;
+        }
+    }
+
+    // Слушающие сокеты остаются у нового процесса (или закрываются рабочими потоками): копии больше не нужны.
+    _listeners.clear();
+    CloseSocket();
+}
+
+bool UpgradeServer::Serve(UpgradeChannel& channel) {
+    channel.SetTimeout(HANDSHAKE_TIMEOUT_MS);
+
+    unsigned uid{};
+    int pid{channel.GetPeer(uid)};
+
+    if (pid == -1 || uid != geteuid()) {
+        std::cerr << "Upgrade: rejected process " << pid << " of user " << uid << '\n';
+
+        return false;
+    }
+
+    UpgradeChannel::Type type{};
+    std::string data;
+    std::vector<UniqueFD> received;
+
+    if (!channel.Receive(type, data, received) || type != UpgradeChannel::K_TAKEOVER) {
+        std::cerr << "Upgrade: unexpected request from process " << pid << '\n';
+
+        return false;
+    }
+
+    std::vector<int> fds;
+
+    for (const auto& listener : _listeners) {
+        fds.push_back(listener);
+    }
+
+    uint16_t port{htons(static_cast<uint16_t>(_port))};
+
+    if (!channel.Send(UpgradeChannel::K_LISTENERS, std::string_view(reinterpret_cast<const char*>(&port), sizeof(port)), fds)) {
+        std::cerr << "Upgrade: failed to pass listening sockets to process " << pid << '\n';
+
+        return false;
+    }
+
+    // Пока новый процесс не готов, этот продолжает принимать соединения из тех же очередей.
+    if (!channel.Receive(type, data, received) || type != UpgradeChannel::K_READY) {
+        std::cerr << "Upgrade: process " << pid << " did not start, keep serving\n";
+
+        return false;
+    }
+
+    std::cout << "Upgrade: process " + std::to_string(pid) + " took over " + std::to_string(fds.size()) +
+                 " listening sockets\n";
+
+    // Путь освобождается до остановки: новый процесс займет его для следующего обновления.
+    CloseSocket();
+
+    _handing_off.store(true, std::memory_order_release);
+    _start_drain();
+
+    size_t sent{};
+
+    for (auto& backend : WaitOffers()) {
+        if (!channel.Send(UpgradeChannel::K_BACKEND, UpgradeChannel::EncodeBackend(backend), {backend.fd})) {
+            break;
+        }
+
+        ++sent;
+    }
+
+    channel.Send(UpgradeChannel::K_END);
+
+    if (sent > 0) {
+        std::cout << "Upgrade: handed " + std::to_string(sent) + " idle pooled connections\n";
+    }
+
+    return true;
+}
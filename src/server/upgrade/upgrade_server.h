@@ -0,0 +1,122 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_UPGRADE_UPGRADE_SERVER_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_UPGRADE_UPGRADE_SERVER_H
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <functional>
+#include <condition_variable>
+
+#include "upgrade_channel.h"
+#include "../unique_fd/unique_fd.h"
+
+/**
+ * @brief Сторона работающего процесса в обновлении без простоя.
+ *
+ * Слушает UNIX-сокет (--upgrade-socket) в отдельном потоке. Новый процесс, запущенный с тем же путем,
+ * подключается и получает копии слушающих сокетов рабочих потоков (SCM_RIGHTS): это те же сокеты,
+ * с теми же очередями, поэтому ни одно соединение не теряется и не получает отказ. Когда новый
+ * процесс сообщает о готовности, этот процесс освобождает путь и начинает плавную остановку,
+ * а рабочие потоки передают сюда простаивающие соединения пула (Offer()) для отправки новому процессу.
+ *
+ * Подключения принимаются только от процессов того же пользователя (SO_PEERCRED).
+ */
+class UpgradeServer {
+public:
+    /// Тип коллбэка для проверки запроса на остановку.
+    using StopCallback = std::function<bool()>;
+
+    /// Тип коллбэка, начинающего плавную остановку процесса.
+    using DrainCallback = std::function<void()>;
+
+public:
+    /**
+     * @brief Конструктор. Создает UNIX-сокет (оставшийся от завершенного процесса файл удаляется).
+     * @param path Путь к UNIX-сокету.
+     * @param port Порт слушающих сокетов.
+     * @param listeners Копии слушающих сокетов рабочих потоков.
+     * @param workers Количество рабочих потоков (каждый вызывает Offer() при остановке).
+     * @param wakeup_fd Дескриптор пробуждения при остановке.
+     * @param is_stopped Коллбэк, возвращающий true, если процесс останавливается.
+     * @param start_drain Коллбэк, начинающий плавную остановку процесса.
+     * @throw std::runtime_error Если сокет не удалось создать.
+     */
+    UpgradeServer(const std::string& path, int port, std::vector<UniqueFD> listeners, size_t workers, int wakeup_fd,
+                  StopCallback is_stopped, DrainCallback start_drain);
+
+    /**
+     * @brief Деструктор. Удаляет UNIX-сокет, если путь еще принадлежит этому процессу.
+     */
+    ~UpgradeServer();
+
+    UpgradeServer(const UpgradeServer&) = delete;
+    UpgradeServer& operator=(const UpgradeServer&) = delete;
+
+    /**
+     * @brief Обслуживает подключения до остановки процесса или до завершения обновления.
+     */
+    void Run();
+
+    /**
+     * @brief Проверяет, остановка ли это ради обновления (соединения пула нужно передать).
+     */
+    bool IsHandingOff() const noexcept;
+
+    /**
+     * @brief Передает простаивающие соединения пула рабочего потока. Каждый рабочий поток вызывает один раз.
+     * @param backends Соединения (могут быть пусты).
+     */
+    void Offer(std::vector<HandedBackend> backends);
+
+private:
+    /**
+     * @brief Создает, привязывает и начинает слушать UNIX-сокет.
+     * @param path Путь.
+     * @throw std::runtime_error Если сокет не удалось настроить.
+     */
+    void SetupSocket(const std::string& path);
+
+    /**
+     * @brief Проводит обмен с новым процессом.
+     * @param channel Канал.
+     * @return true Если сокеты переданы и процесс останавливается.
+     */
+    bool Serve(UpgradeChannel& channel);
+
+    /**
+     * @brief Ждет соединения пула от всех рабочих потоков (не дольше OFFER_TIMEOUT_MS).
+     */
+    std::vector<HandedBackend> WaitOffers();
+
+    /**
+     * @brief Закрывает UNIX-сокет и удаляет его файл.
+     */
+    void CloseSocket();
+
+private:
+    /// Таймаут каждого шага обмена с новым процессом.
+    static constexpr size_t HANDSHAKE_TIMEOUT_MS{30000};
+
+    /// Сколько ждать, пока рабочие потоки отдадут соединения пула.
+    static constexpr size_t OFFER_TIMEOUT_MS{2000};
+
+    std::string _path; ///< Путь к UNIX-сокету.
+    int _port; ///< Порт слушающих сокетов.
+    std::vector<UniqueFD> _listeners; ///< Копии слушающих сокетов рабочих потоков.
+    size_t _workers; ///< Количество рабочих потоков.
+    int _wakeup_fd; ///< Дескриптор пробуждения (принадлежит Server).
+    StopCallback _is_stopped; ///< Коллбэк проверки остановки.
+    DrainCallback _start_drain; ///< Коллбэк начала плавной остановки.
+
+    UniqueFD _listen_fd{}; ///< UNIX-сокет.
+    std::atomic<bool> _handing_off{false}; ///< Остановка ради обновления.
+
+    std::mutex _mutex; ///< Защищает _offered и _offers.
+    std::condition_variable _cv; ///< Сигнал о передаче соединений рабочим потоком.
+    std::vector<HandedBackend> _offered; ///< Соединения пула для передачи.
+    size_t _offers{}; ///< Сколько рабочих потоков вызвали Offer().
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_UPGRADE_UPGRADE_SERVER_H
@@ -0,0 +1,240 @@
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "health_checker.h"
+#include "../protocol/frame_parser.h"
+
+namespace {
+
+// Ответ сервера на StartupMessage умещается в начало: дальше него ничего не читается.
+constexpr size_t MAX_RESPONSE{1024};
+
+void AppendUInt32(std::string& out, uint32_t value) {
+    uint32_t net{htonl(value)};
+    out.append(reinterpret_cast<const char*>(&net), sizeof(net));
+}
+
+uint32_t ReadUInt32(const char* data) {
+    uint32_t value{};
+    std::memcpy(&value, data, sizeof(value));
+
+    return ntohl(value);
+}
+
+} // namespace
+
+HealthChecker::HealthChecker(UpstreamRegistry& registry, Poller& poller, const HealthOptions& options,
+                             std::chrono::milliseconds timeout) :
+    _registry(registry),
+    _poller(poller),
+    _interval(options.interval_ms),
+    _timeout(std::min(timeout, _interval)),
+    _probes(registry.GetSize())
+{
+    std::string body;
+    AppendUInt32(body, FrameParser::PROTOCOL_VERSION_3);
+    body.append("user").push_back('\0');
+    body.append(options.user).push_back('\0');
+    body.append("database").push_back('\0');
+    body.append(options.user).push_back('\0');
+    body.push_back('\0');
+
+    AppendUInt32(_startup, static_cast<uint32_t>(body.size() + 4));
+    _startup += body;
+}
+
+bool HealthChecker::HandleEvent(int fd, uint32_t events) {
+    auto it{std::find_if(_probes.begin(), _probes.end(), [fd](const Probe& probe) {
+        return probe.fd.Valid() && probe.fd == fd;
+    })};
+
+    if (it == _probes.end()) {
+        return false;
+    }
+
+    size_t node{static_cast<size_t>(it - _probes.begin())};
+    Probe& probe{*it};
+
+    if (!probe.connected) {
+        if (!(events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+            return true;
+        }
+
+        int error{};
+        socklen_t error_len{sizeof(error)};
+
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_len) == -1 || error != 0) {
+            Finish(node, false);
+
+            return true;
+        }
+
+        // StartupMessage короче буфера отправки нового сокета: он уходит одним send().
+        ssize_t sent{send(fd, _startup.data(), _startup.size(), MSG_NOSIGNAL)};
+
+        if (sent != static_cast<ssize_t>(_startup.size())) {
+            Finish(node, false);
+
+            return true;
+        }
+
+        probe.connected = true;
+    }
+
+    char data[MAX_RESPONSE];
+
+    while (probe.response.size() < MAX_RESPONSE) {
+        ssize_t n{recv(fd, data, MAX_RESPONSE - probe.response.size(), 0)};
+
+        if (n > 0) {
+            probe.response.append(data, n);
+
+            continue;
+        }
+
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            break;
+        }
+
+        // Сервер закрыл соединение, не ответив.
+        Finish(node, CheckResponse(probe.response) == 1);
+
+        return true;
+    }
+
+    int result{CheckResponse(probe.response)};
+
+    if (result != 0 || probe.response.size() >= MAX_RESPONSE) {
+        Finish(node, result >= 0);
+    }
+
+    return true;
+}
+
+void HealthChecker::Run(Clock::time_point now) {
+    for (size_t node{}; node < _probes.size(); ++node) {
+        if (_probes[node].fd.Valid() && now >= _probes[node].deadline) {
+            Finish(node, false);
+        }
+    }
+
+    if (now < _next_round) {
+        return;
+    }
+
+    _next_round = now + _interval;
+
+    for (size_t node{}; node < _probes.size(); ++node) {
+        if (!_probes[node].fd.Valid()) {
+            Start(node, now);
+        }
+    }
+}
+
+int HealthChecker::GetWaitTimeout(Clock::time_point now) const noexcept {
+    Clock::time_point next{_next_round};
+
+    for (const Probe& probe : _probes) {
+        if (probe.fd.Valid()) {
+            next = std::min(next, probe.deadline);
+        }
+    }
+
+    if (next <= now) {
+        return 0;
+    }
+
+    return static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(next - now).count());
+}
+
+void HealthChecker::Start(size_t node, Clock::time_point now) {
+    Probe& probe{_probes[node]};
+    UniqueFD fd(socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0));
+
+    if (!fd.Valid()) {
+        std::cerr << "HealthChecker::Start(): " << strerror(errno) << '\n';
+
+        return;
+    }
+
+    const sockaddr_in& address{_registry.GetAddress(node)};
+
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1 && errno != EINPROGRESS) {
+        _registry.OnFailure(node);
+
+        return;
+    }
+
+    if (!_poller.Add(fd, EPOLLIN | EPOLLOUT | EPOLLET, static_cast<uint64_t>(static_cast<int>(fd)))) {
+        std::cerr << "Poller::Add(): " << strerror(errno) << '\n';
+
+        return;
+    }
+
+    probe.fd = std::move(fd);
+    probe.deadline = now + _timeout;
+    probe.connected = false;
+    probe.response.clear();
+}
+
+void HealthChecker::Finish(size_t node, bool healthy) {
+    Probe& probe{_probes[node]};
+
+    _poller.Remove(probe.fd);
+    probe.fd.Close();
+
+    if (healthy) {
+        _registry.OnSuccess(node);
+    } else {
+        _registry.OnFailure(node);
+    }
+}
+
+int HealthChecker::CheckResponse(std::string_view response) noexcept {
+    if (response.size() < 5) {
+        return 0;
+    }
+
+    char type{response[0]};
+
+    // Запрос аутентификации или согласование версии протокола: сервер принимает подключения.
+    if (type == 'R' || type == 'v') {
+        return 1;
+    }
+
+    if (type != 'E') {
+        return -1;
+    }
+
+    uint32_t length{ReadUInt32(response.data() + 1)};
+
+    if (response.size() < length + size_t{1} && response.size() < MAX_RESPONSE) {
+        return 0;
+    }
+
+    // Поля ErrorResponse: байт кода и строка с нулем; 'C' — SQLSTATE.
+    std::string_view fields{response.substr(5, length >= 4 ? length - 4 : 0)};
+
+    while (!fields.empty() && fields[0] != '\0') {
+        size_t end{fields.find('\0')};
+
+        if (end == std::string_view::npos) {
+            break;
+        }
+
+        if (fields[0] == 'C') {
+            std::string_view code{fields.substr(1, end - 1)};
+
+            return code.substr(0, 3) == "57P" || code.substr(0, 2) == "53" ? -1 : 1;
+        }
+
+        fields.remove_prefix(end + 1);
+    }
+
+    return 1;
+}
@@ -0,0 +1,117 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_UPSTREAM_HEALTH_CHECKER_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_UPSTREAM_HEALTH_CHECKER_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "upstream_registry.h"
+#include "../poller/poller.h"
+#include "../unique_fd/unique_fd.h"
+
+/**
+ * @brief Параметры проверки исправности серверов PostgreSQL.
+ */
+struct HealthOptions {
+    size_t interval_ms{}; ///< Период активной проверки в миллисекундах (0 — выключена вместе с исключением узлов).
+    size_t eject_failures{3}; ///< Ошибок подряд, после которых узел исключается.
+    std::string user{"postgres"}; ///< Пользователь (и база данных) StartupMessage проверки.
+};
+
+/**
+ * @brief Активная проверка серверов PostgreSQL из цикла событий рабочего потока.
+ *
+ * Раз в interval_ms к каждому узлу открывается неблокирующее соединение, и после connect() ему
+ * отправляется StartupMessage. Узел исправен, если сервер ответил запросом аутентификации или
+ * ошибкой, не говорящей о его недоступности (например, неверный пользователь). Ошибки классов
+ * 57P (остановка, запуск, восстановление) и 53 (нехватка ресурсов, too many connections), отказ
+ * в подключении, обрыв и отсутствие ответа за timeout считаются неисправностью. Соединение
+ * закрывается сразу после первого ответа: аутентификация не проходится.
+ *
+ * Результаты передаются в UpstreamRegistry, поэтому исключенный узел возвращается, как только
+ * проверка прошла. Сокеты проверок регистрируются в Poller рабочего потока с токеном-fd
+ * (HandleEvent()); объект не потокобезопасен и работает в одном рабочем потоке.
+ */
+class HealthChecker {
+public:
+    /// Монотонные часы для отсчета периода и таймаутов.
+    using Clock = std::chrono::steady_clock;
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param registry Серверы и их исправность.
+     * @param poller Poller рабочего потока.
+     * @param options Параметры проверки (interval_ms > 0).
+     * @param timeout Время на подключение и ответ сервера.
+     */
+    HealthChecker(UpstreamRegistry& registry, Poller& poller, const HealthOptions& options,
+                  std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Обрабатывает событие сокета проверки.
+     * @param fd Дескриптор из токена события.
+     * @param events Маска событий.
+     * @return true Если дескриптор принадлежит проверке.
+     */
+    bool HandleEvent(int fd, uint32_t events);
+
+    /**
+     * @brief Завершает просроченные проверки и начинает новый круг, если подошел срок.
+     * @param now Текущее время.
+     */
+    void Run(Clock::time_point now);
+
+    /**
+     * @brief Время до следующего вызова Run(), который что-то сделает.
+     * @param now Текущее время.
+     * @return int Миллисекунды (не меньше 0).
+     */
+    int GetWaitTimeout(Clock::time_point now) const noexcept;
+
+private:
+    /**
+     * @brief Проверка одного узла.
+     */
+    struct Probe {
+        UniqueFD fd; ///< Сокет (невалиден, пока проверка не идет).
+        Clock::time_point deadline{}; ///< Срок ответа.
+        bool connected{false}; ///< connect() завершен, StartupMessage отправлен.
+        std::string response; ///< Начало ответа сервера.
+    };
+
+    /**
+     * @brief Начинает проверку узла.
+     * @param node Номер узла.
+     * @param now Текущее время.
+     */
+    void Start(size_t node, Clock::time_point now);
+
+    /**
+     * @brief Завершает проверку и сообщает результат UpstreamRegistry.
+     * @param node Номер узла.
+     * @param healthy Узел исправен.
+     */
+    void Finish(size_t node, bool healthy);
+
+    /**
+     * @brief Оценивает ответ сервера на StartupMessage.
+     * @param response Прочитанное начало ответа.
+     * @return int 1 — исправен, -1 — неисправен, 0 — нужно больше данных.
+     */
+    static int CheckResponse(std::string_view response) noexcept;
+
+private:
+    UpstreamRegistry& _registry; ///< Серверы и их исправность.
+    Poller& _poller; ///< Poller рабочего потока.
+    std::chrono::milliseconds _interval; ///< Период проверки.
+    std::chrono::milliseconds _timeout; ///< Время на подключение и ответ.
+    std::string _startup; ///< StartupMessage проверки.
+    std::vector<Probe> _probes; ///< Проверки по номерам узлов.
+    Clock::time_point _next_round{}; ///< Начало следующего круга.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_UPSTREAM_HEALTH_CHECKER_H
@@ -0,0 +1,88 @@
+#include <iostream>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+
+#include "upstream_registry.h"
+
+UpstreamRegistry::UpstreamRegistry(const UpstreamAddress& primary, const std::vector<UpstreamAddress>& upstreams,
+                                   const std::vector<UpstreamAddress>& replicas, size_t eject_failures) :
+    _nodes(std::make_unique<Node[]>(1 + upstreams.size() + replicas.size())),
+    _size(1 + upstreams.size() + replicas.size()),
+    _eject_failures(static_cast<uint32_t>(eject_failures))
+{
+    for (size_t i{}; i < _size; ++i) {
+        bool replica{i > upstreams.size()};
+        const UpstreamAddress& upstream{i == 0 ? primary : replica ? replicas[i - 1 - upstreams.size()]
+                                                                   : upstreams[i - 1]};
+        Node& node{_nodes[i]};
+
+        node.name = upstream.host + ":" + std::to_string(upstream.port);
+        node.role = replica ? UpstreamRole::K_REPLICA : UpstreamRole::K_PRIMARY;
+        node.address.sin_family = AF_INET;
+        node.address.sin_port = htons(upstream.port);
+
+        if (inet_pton(AF_INET, upstream.host.c_str(), &node.address.sin_addr) <= 0) {
+            throw std::runtime_error("UpstreamRegistry(): invalid IPv4 address " + upstream.host);
+        }
+    }
+}
+
+size_t UpstreamRegistry::GetSize() const noexcept {
+    return _size;
+}
+
+UpstreamRole UpstreamRegistry::GetRole(size_t node) const noexcept {
+    return _nodes[node].role;
+}
+
+const sockaddr_in& UpstreamRegistry::GetAddress(size_t node) const noexcept {
+    return _nodes[node].address;
+}
+
+const std::string& UpstreamRegistry::GetName(size_t node) const noexcept {
+    return _nodes[node].name;
+}
+
+bool UpstreamRegistry::IsHealthy(size_t node) const noexcept {
+    return _nodes[node].healthy.load(std::memory_order_relaxed);
+}
+
+uint64_t UpstreamRegistry::GetFailures(size_t node) const noexcept {
+    return _nodes[node].failures.load(std::memory_order_relaxed);
+}
+
+void UpstreamRegistry::OnSuccess(size_t node) noexcept {
+    Node& entry{_nodes[node]};
+
+    // Запись только при смене состояния: успешные подключения разных потоков не делят кеш-линию.
+    if (entry.consecutive.load(std::memory_order_relaxed) != 0) {
+        entry.consecutive.store(0, std::memory_order_relaxed);
+    }
+
+    bool ejected{false};
+
+    if (!entry.healthy.load(std::memory_order_relaxed) &&
+        entry.healthy.compare_exchange_strong(ejected, true, std::memory_order_relaxed)) {
+        std::cout << "Upstream " + entry.name + " is healthy again\n";
+    }
+}
+
+void UpstreamRegistry::OnFailure(size_t node) noexcept {
+    Node& entry{_nodes[node]};
+    uint32_t consecutive{entry.consecutive.fetch_add(1, std::memory_order_relaxed) + 1};
+
+    entry.failures.fetch_add(1, std::memory_order_relaxed);
+
+    if (_eject_failures == 0 || consecutive < _eject_failures) {
+        return;
+    }
+
+    bool healthy{true};
+
+    // Исключение сообщается один раз, каким бы потоком ни была замечена последняя ошибка.
+    if (entry.healthy.compare_exchange_strong(healthy, false, std::memory_order_relaxed)) {
+        std::cout << "Upstream " + entry.name + " ejected after " + std::to_string(consecutive) +
+                     " consecutive failures\n";
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_UPSTREAM_UPSTREAM_REGISTRY_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_UPSTREAM_UPSTREAM_REGISTRY_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <netinet/in.h>
+
+/**
+ * @brief Адрес сервера PostgreSQL.
+ */
+struct UpstreamAddress {
+    std::string host; ///< IPv4-адрес.
+    int port{}; ///< Порт.
+};
+
+/**
+ * @brief Роль сервера PostgreSQL.
+ */
+enum class UpstreamRole : uint8_t {
+    K_PRIMARY, ///< Принимает любые запросы
+    K_REPLICA ///< Выполняет только читающие запросы вне транзакций
+};
+
+/**
+ * @brief Серверы PostgreSQL и их исправность, общие для всех рабочих потоков.
+ *
+ * Узел 0 — сервер из командной строки, за ним дополнительные основные серверы (--upstream),
+ * затем реплики (--replica). Адреса разбираются один раз при создании.
+ *
+ * Исправность меняется по результатам подключений: рабочие потоки сообщают об ошибках подключения
+ * и этапа запуска (пассивная проверка), HealthChecker — о результатах пробных подключений (активная).
+ * После eject_failures ошибок подряд узел исключается: новые сессии его не выбирают, пока
+ * подключение к нему снова не завершится успешно. Состояние узла — атомарные переменные, рабочие
+ * потоки читают его без блокировок; записи бывают только при подключениях, а не на каждый запрос.
+ */
+class UpstreamRegistry {
+public:
+    /**
+     * @brief Конструктор.
+     * @param primary Сервер из командной строки.
+     * @param upstreams Дополнительные основные серверы.
+     * @param replicas Реплики.
+     * @param eject_failures Ошибок подряд, после которых узел исключается (0 — не исключать).
+     * @throw std::runtime_error Если адрес не является IPv4-адресом.
+     */
+    UpstreamRegistry(const UpstreamAddress& primary, const std::vector<UpstreamAddress>& upstreams,
+                     const std::vector<UpstreamAddress>& replicas, size_t eject_failures);
+
+    /**
+     * @brief Количество узлов.
+     */
+    size_t GetSize() const noexcept;
+
+    /**
+     * @brief Роль узла.
+     * @param node Номер узла.
+     */
+    UpstreamRole GetRole(size_t node) const noexcept;
+
+    /**
+     * @brief Адрес узла для connect().
+     * @param node Номер узла.
+     */
+    const sockaddr_in& GetAddress(size_t node) const noexcept;
+
+    /**
+     * @brief Адрес узла в виде "host:port" (для лога и метрик).
+     * @param node Номер узла.
+     */
+    const std::string& GetName(size_t node) const noexcept;
+
+    /**
+     * @brief Проверяет, можно ли выбирать узел для новых соединений.
+     * @param node Номер узла.
+     */
+    bool IsHealthy(size_t node) const noexcept;
+
+    /**
+     * @brief Количество неудачных подключений и проверок узла с запуска.
+     * @param node Номер узла.
+     */
+    uint64_t GetFailures(size_t node) const noexcept;
+
+    /**
+     * @brief Учитывает успешное подключение: сбрасывает счетчик ошибок и возвращает исключенный узел.
+     * @param node Номер узла.
+     */
+    void OnSuccess(size_t node) noexcept;
+
+    /**
+     * @brief Учитывает неудачное подключение и исключает узел после eject_failures ошибок подряд.
+     * @param node Номер узла.
+     */
+    void OnFailure(size_t node) noexcept;
+
+private:
+    /**
+     * @brief Узел. Выровнен по кеш-линии: потоки, обновляющие разные узлы, не мешают друг другу.
+     */
+    struct alignas(64) Node {
+        std::string name; ///< "host:port".
+        UpstreamRole role{UpstreamRole::K_PRIMARY}; ///< Роль.
+        sockaddr_in address{}; ///< Адрес для connect().
+        std::atomic<bool> healthy{true}; ///< Узел можно выбирать.
+        std::atomic<uint32_t> consecutive{}; ///< Ошибки подряд.
+        std::atomic<uint64_t> failures{}; ///< Ошибки с запуска.
+    };
+
+    std::unique_ptr<Node[]> _nodes; ///< Узлы.
+    size_t _size{}; ///< Количество узлов.
+    uint32_t _eject_failures{}; ///< Порог исключения (0 — не исключать).
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_UPSTREAM_UPSTREAM_REGISTRY_H
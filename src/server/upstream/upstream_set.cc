@@ -0,0 +1,79 @@
+#include "upstream_set.h"
+
+UpstreamSet::UpstreamSet(UpstreamRegistry& registry) :
+    _registry(registry),
+    _outstanding(registry.GetSize())
+{
+    for (size_t node{}; node < registry.GetSize(); ++node) {
+        _roles[static_cast<size_t>(registry.GetRole(node))].push_back(node);
+    }
+}
+
+size_t UpstreamSet::GetSize() const noexcept {
+    return _registry.GetSize();
+}
+
+bool UpstreamSet::HasReplicas() const noexcept {
+    return !_roles[static_cast<size_t>(UpstreamRole::K_REPLICA)].empty();
+}
+
+UpstreamRole UpstreamSet::GetRole(size_t node) const noexcept {
+    return _registry.GetRole(node);
+}
+
+bool UpstreamSet::IsHealthy(size_t node) const noexcept {
+    return _registry.IsHealthy(node);
+}
+
+const sockaddr_in& UpstreamSet::GetAddress(size_t node) const noexcept {
+    return _registry.GetAddress(node);
+}
+
+const std::string& UpstreamSet::GetName(size_t node) const noexcept {
+    return _registry.GetName(node);
+}
+
+size_t UpstreamSet::Select(UpstreamRole role, size_t exclude) noexcept {
+    const std::vector<size_t>& nodes{_roles[static_cast<size_t>(role)]};
+    size_t& next{_next[static_cast<size_t>(role)]};
+    size_t best{NONE};
+    size_t best_position{};
+
+    for (size_t i{}; i < nodes.size(); ++i) {
+        size_t position{(next + i) % nodes.size()};
+        size_t node{nodes[position]};
+
+        if (node == exclude || !_registry.IsHealthy(node)) {
+            continue;
+        }
+
+        if (best == NONE || _outstanding[node] < _outstanding[best]) {
+            best = node;
+            best_position = position;
+        }
+    }
+
+    if (best != NONE) {
+        next = (best_position + 1) % nodes.size();
+    }
+
+    return best;
+}
+
+void UpstreamSet::OnAttached(size_t node) noexcept {
+    ++_outstanding[node];
+}
+
+void UpstreamSet::OnDetached(size_t node) noexcept {
+    if (_outstanding[node] > 0) {
+        --_outstanding[node];
+    }
+}
+
+void UpstreamSet::OnSuccess(size_t node) noexcept {
+    _registry.OnSuccess(node);
+}
+
+void UpstreamSet::OnFailure(size_t node) noexcept {
+    _registry.OnFailure(node);
+}
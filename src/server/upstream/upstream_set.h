@@ -0,0 +1,114 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_UPSTREAM_UPSTREAM_SET_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_UPSTREAM_UPSTREAM_SET_H
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "upstream_registry.h"
+
+/**
+ * @brief Выбор сервера PostgreSQL в рабочем потоке: наименее занятый из исправных.
+ *
+ * Для выбора считаются соединения узла, выданные сессиям (OnAttached()/OnDetached()): без пула —
+ * это сессии, в режиме пула — выполняющиеся запросы и транзакции. Счетчики у каждого рабочего потока
+ * свои, поэтому выбор обходится без синхронизации; соединения распределяются между потоками через
+ * SO_REUSEPORT, и локальные выборы в сумме близки к общему балансу. Узлов немного, поэтому выбирается
+ * точный минимум перебором, а не две случайные пробы.
+ *
+ * Исправность узлов общая (UpstreamRegistry): исключенный узел не выбирается ни одним потоком.
+ *
+ * Объект не потокобезопасен: у каждого рабочего потока свой.
+ */
+class UpstreamSet {
+public:
+    /// Узел не выбран.
+    static constexpr size_t NONE{SIZE_MAX};
+
+public:
+    /**
+     * @brief Конструктор.
+     * @param registry Серверы и их исправность (должны жить дольше объекта).
+     */
+    explicit UpstreamSet(UpstreamRegistry& registry);
+
+    /**
+     * @brief Количество серверов.
+     */
+    size_t GetSize() const noexcept;
+
+    /**
+     * @brief Проверяет, заданы ли реплики.
+     */
+    bool HasReplicas() const noexcept;
+
+    /**
+     * @brief Роль узла.
+     * @param node Номер узла.
+     */
+    UpstreamRole GetRole(size_t node) const noexcept;
+
+    /**
+     * @brief Проверяет, не исключен ли узел.
+     * @param node Номер узла.
+     */
+    bool IsHealthy(size_t node) const noexcept;
+
+    /**
+     * @brief Адрес узла для connect().
+     * @param node Номер узла.
+     */
+    const sockaddr_in& GetAddress(size_t node) const noexcept;
+
+    /**
+     * @brief Адрес узла в виде "host:port".
+     * @param node Номер узла.
+     */
+    const std::string& GetName(size_t node) const noexcept;
+
+    /**
+     * @brief Выбирает исправный узел роли с наименьшим числом выданных соединений.
+     *
+     * Из равных выбирается следующий по кругу за предыдущим выбором, чтобы простаивающие узлы
+     * нагружались поровну.
+     *
+     * @param role Роль.
+     * @param exclude Узел, который выбирать нельзя (NONE — любой).
+     * @return size_t Номер узла или NONE, если исправных узлов роли нет.
+     */
+    size_t Select(UpstreamRole role, size_t exclude) noexcept;
+
+    /**
+     * @brief Учитывает соединение узла, выданное сессии.
+     * @param node Номер узла.
+     */
+    void OnAttached(size_t node) noexcept;
+
+    /**
+     * @brief Учитывает соединение узла, возвращенное сессией.
+     * @param node Номер узла.
+     */
+    void OnDetached(size_t node) noexcept;
+
+    /**
+     * @brief Сообщает об успешном подключении к узлу (UpstreamRegistry::OnSuccess()).
+     * @param node Номер узла.
+     */
+    void OnSuccess(size_t node) noexcept;
+
+    /**
+     * @brief Сообщает о неудачном подключении к узлу (UpstreamRegistry::OnFailure()).
+     * @param node Номер узла.
+     */
+    void OnFailure(size_t node) noexcept;
+
+private:
+    UpstreamRegistry& _registry; ///< Серверы и их исправность.
+    std::vector<size_t> _outstanding; ///< Соединения узлов, выданные сессиям.
+    std::array<std::vector<size_t>, 2> _roles; ///< Номера узлов каждой роли.
+    std::array<size_t, 2> _next{}; ///< Позиция в _roles, с которой начинается следующий выбор.
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_UPSTREAM_UPSTREAM_SET_H
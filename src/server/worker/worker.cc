@@ -0,0 +1,1262 @@
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "worker.h"
+#include "../protocol/fingerprint.h"
+
+namespace {
+
+// Простаивающее соединение принадлежит пулу: токеном события служит fd.
+constexpr uint32_t IDLE_EVENTS{EPOLLIN | EPOLLET};
+
+// При плавной остановке дескриптор пробуждения снят с Poller: запрос на немедленную остановку
+// и срок остановки проверяются не реже этого интервала.
+constexpr int DRAIN_CHECK_MS{100};
+
+// Первые мгновения остановки простаивающие сессии не закрываются: короткие клиенты успевают
+// завершиться сами и не получают ошибку между запросами.
+constexpr int DRAIN_GRACE_MS{1000};
+
+// Блок, прочитанный механизмом ввода-вывода, встает в очередь сессии сегментом Buffer.
+static_assert(Poller::RECEIVE_BLOCK_SIZE == Buffer::SEGMENT_SIZE, "Poller blocks must be Buffer segments");
+
+} // namespace
+
+Worker::Worker(size_t id, const Options& options, Logger& logger, FlowControl& flow, const TlsContext& tls,
+               TableVersions& versions, UpstreamRegistry& upstreams, Metrics& metrics, int wakeup_fd,
+               StopCallback is_stopped, StopCallback is_draining, std::vector<UniqueFD> listeners) :
+    _id(id),
+    _options(options),
+    _logger(logger),
+    _flow(flow),
+    _tls(tls),
+    _metrics(metrics.GetWorker(id)),
+    _latency(metrics.GetLatency(id)),
+    _wakeup_fd(wakeup_fd),
+    _is_stopped(std::move(is_stopped)),
+    _is_draining(std::move(is_draining)),
+    _listeners(std::move(listeners)),
+    _timers(Clock::now()),
+    _upstreams(upstreams),
+    _pool(options.pool_size, std::chrono::milliseconds(options.pool_idle_timeout_ms),
+          std::chrono::milliseconds(options.connect_timeout_ms))
+{
+    SetupPoller();
+    SetupServerSocket();
+    SetupWakeup();
+
+    if (_options.cache.max_bytes > 0) {
+        _cache = std::make_unique<ResultCache>(_options.cache.max_bytes / _options.workers,
+                                               std::chrono::milliseconds(_options.cache.ttl_ms), versions, _time,
+                                               _metrics);
+    }
+
+    // Проверки одного потока достаточно: исправность серверов общая для всех рабочих потоков.
+    if (_id == 0 && _options.health.interval_ms > 0) {
+        size_t timeout_ms{_options.connect_timeout_ms > 0 ? _options.connect_timeout_ms : _options.health.interval_ms};
+
+        _health = std::make_unique<HealthChecker>(upstreams, *_poller, _options.health,
+                                                  std::chrono::milliseconds(timeout_ms));
+    }
+
+    if (_id == 0 && IsPooling() && _options.splice) {
+        std::cout << "--splice is ignored in transaction pooling mode\n";
+    } else if (_id == 0 && _latency && _options.splice) {
+        std::cout << "--splice is ignored when query latency is measured\n";
+    } else if (_id == 0 && _tls.IsBackendEnabled() && _options.splice) {
+        std::cout << "--splice is ignored with --backend-tls\n";
+    } else if (_id == 0 && _cache && _options.splice) {
+        std::cout << "--splice is ignored with --result-cache\n";
+    }
+}
+
+std::vector<int> Worker::GetListenFDs() const {
+    std::vector<int> fds;
+
+    for (const auto& listener : _listeners) {
+        fds.push_back(listener);
+    }
+
+    return fds;
+}
+
+void Worker::SetUpgradeServer(UpgradeServer* upgrade) noexcept {
+    _upgrade = upgrade;
+}
+
+void Worker::AdoptBackend(HandedBackend&& handed) {
+    if (!IsPooling() || !_pool.CanOpen(handed.key)) {
+        return;
+    }
+
+    size_t node{BackendPool::GetNode(handed.key)};
+
+    // Предыдущий процесс был запущен с другим списком серверов.
+    if (node >= _upstreams.GetSize()) {
+        return;
+    }
+
+    int fd{handed.fd};
+    auto backend{std::make_unique<Backend>(std::move(handed.fd))};
+
+    backend->Restore(handed.key, handed.parameters);
+    backend->SetNode(node);
+    backend->SetEvents(IDLE_EVENTS);
+
+    if (!_poller->Add(fd, IDLE_EVENTS, static_cast<uint64_t>(fd))) {
+        std::cerr << "Poller::Add(): " << strerror(errno) << '\n';
+
+        return;
+    }
+
+    _pool.AddIdle(std::move(backend));
+}
+
+bool Worker::IsPooling() const noexcept {
+    return _options.pool_mode == PoolMode::K_TRANSACTION;
+}
+
+void Worker::SetupPoller() {
+    _poller = Poller::Create(_options.io_engine);
+
+    if (_id == 0) {
+        std::cout << "I/O engine: " << _poller->GetName() << '\n';
+    }
+}
+
+void Worker::SetupWakeup() {
+    if (!_poller->Add(_wakeup_fd, EPOLLIN, _wakeup_fd)) {
+        throw std::runtime_error("SetupWakeup(): " + std::string(strerror(errno)));
+    }
+}
+
+void Worker::UpdateEpollEvents(int fd, uint32_t events, uint64_t data) {
+    _poller->Modify(fd, events, data);
+}
+
+void Worker::StartStream(Session& session, int fd) {
+    if (session.CanStream(fd) && _poller->StartStream(fd)) {
+        session.EnableStream(fd);
+    }
+}
+
+void Worker::SetupServerSocket() {
+    if (_listeners.empty()) {
+        UniqueFD listener(socket(AF_INET, SOCK_STREAM, 0));
+
+        if (!listener.Valid()) {
+            throw std::runtime_error("SetupServerSocket(): " + std::string(strerror(errno)));
+        }
+
+        int flags{fcntl(listener, F_GETFL, 0)};
+        fcntl(listener, F_SETFL, flags | O_NONBLOCK);
+
+        int opt{1};
+
+        if (setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1) {
+            throw std::runtime_error("SetupServerSocket(): " + std::string(strerror(errno)));
+        }
+
+        if (setsockopt(listener, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == -1) {
+            throw std::runtime_error("SetupServerSocket(): " + std::string(strerror(errno)));
+        }
+
+        struct sockaddr_in server_addr = {};
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_addr.s_addr = INADDR_ANY;
+        server_addr.sin_port = htons(_options.listen_port);
+
+        auto s_addr{reinterpret_cast<struct sockaddr*>(&server_addr)};
+
+        if (bind(listener, s_addr, sizeof(server_addr)) == -1) {
+            throw std::runtime_error("SetupServerSocket(): " + std::string(strerror(errno)));
+        }
+
+        if (listen(listener, SOMAXCONN) == -1) {
+            throw std::runtime_error("SetupServerSocket(): " + std::string(strerror(errno)));
+        }
+
+        _listeners.push_back(std::move(listener));
+    }
+
+    for (const auto& listener : _listeners) {
+        if (!_poller->AddListener(listener, static_cast<uint64_t>(static_cast<int>(listener)))) {
+            throw std::runtime_error("SetupServerSocket(): " + std::string(strerror(errno)));
+        }
+    }
+}
+
+UniqueFD Worker::SetupPGSQLSocket(SessionSlab::Handle handle, size_t node) {
+    UniqueFD pgsql_fd(socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0));
+
+    if (!pgsql_fd.Valid()) {
+        throw std::runtime_error("SetupPGSQLSocket(): " + std::string(strerror(errno)));
+    }
+
+    const sockaddr_in& pgsql_addr{_upstreams.GetAddress(node)};
+    auto p_addr{reinterpret_cast<const struct sockaddr*>(&pgsql_addr)};
+
+    if (connect(pgsql_fd, p_addr, sizeof(pgsql_addr)) == -1 && errno != EINPROGRESS) {
+        int error{errno};
+
+        _upstreams.OnFailure(node);
+
+        throw std::runtime_error("SetupPGSQLSocket(): " + std::string(strerror(error)));
+    }
+
+    uint64_t data{handle == SessionSlab::NULL_HANDLE
+        ? static_cast<uint64_t>(static_cast<int>(pgsql_fd))
+        : SessionSlab::MakeToken(handle, SessionSlab::Direction::K_PGSQL)};
+
+    if (!_poller->Add(pgsql_fd, EPOLLIN | EPOLLOUT | EPOLLET, data)) {
+        throw std::runtime_error("SetupPGSQLSocket(): " + std::string(strerror(errno)));
+    }
+
+    return pgsql_fd;
+}
+
+bool Worker::IsListener(int fd) const noexcept {
+    for (const auto& listener : _listeners) {
+        if (listener == fd) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Worker::AcceptNewConnections(int listen_fd) {
+    while (true) {
+        struct sockaddr_in client_addr = {};
+        auto c_addr{reinterpret_cast<sockaddr*>(&client_addr)};
+        socklen_t c_addr_len{sizeof(client_addr)};
+
+        UniqueFD client_fd(accept4(listen_fd, c_addr, &c_addr_len, SOCK_NONBLOCK));
+
+        if (!client_fd.Valid()) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            } else if (errno == EINTR) {
+                continue;
+            } else {
+                std::cerr << "accept(): " << strerror(errno) << '\n';
+
+                break;
+            }
+        }
+
+        AcceptConnection(std::move(client_fd), client_addr);
+    }
+}
+
+void Worker::OnAccepted(int client) {
+    UniqueFD client_fd(client);
+    struct sockaddr_in client_addr = {};
+    socklen_t c_addr_len{sizeof(client_addr)};
+
+    // Multishot accept не возвращает адрес клиента.
+    if (getpeername(client_fd, reinterpret_cast<sockaddr*>(&client_addr), &c_addr_len) == -1) {
+        std::cerr << "getpeername(): " << strerror(errno) << '\n';
+
+        return;
+    }
+
+    AcceptConnection(std::move(client_fd), client_addr);
+}
+
+void Worker::AcceptConnection(UniqueFD&& client_fd, const sockaddr_in& client_addr) {
+    int client{client_fd};
+    SessionSlab::Handle handle{_sessions.Reserve()};
+
+    if (!_poller->Add(client, EPOLLIN | EPOLLET, SessionSlab::MakeToken(handle, SessionSlab::Direction::K_CLIENT))) {
+        std::cerr << "Poller::Add(): " << strerror(errno) << '\n';
+
+        _sessions.Release(handle);
+
+        return;
+    }
+
+    try {
+        std::unique_ptr<Backend> backend;
+
+        // Без исправного сервера сессия создается без соединения, чтобы отправить клиенту отказ.
+        size_t node{IsPooling() ? UpstreamSet::NONE : _upstreams.Select(UpstreamRole::K_PRIMARY, UpstreamSet::NONE)};
+
+        if (node != UpstreamSet::NONE) {
+            UniqueFD pgsql_fd;
+
+            try {
+                pgsql_fd = SetupPGSQLSocket(handle, node);
+            } catch (const std::exception&) {
+                // Сервер сразу отказал в подключении: пробуем другой исправный сервер, если он есть.
+                node = _upstreams.Select(UpstreamRole::K_PRIMARY, node);
+
+                if (node == UpstreamSet::NONE) {
+                    throw;
+                }
+
+                pgsql_fd = SetupPGSQLSocket(handle, node);
+            }
+
+            backend = std::make_unique<Backend>(std::move(pgsql_fd));
+            backend->SetNode(node);
+
+            if (_tls.IsBackendEnabled()) {
+                backend->EnableTls(&_tls);
+            }
+        }
+
+        // Коллбэки захватывают не больше двух указателей, чтобы std::function не выделял память.
+        Session& session{_sessions.Emplace(handle, std::move(backend), std::move(client_fd),
+        [this, handle](int fd, uint32_t events) {
+            bool is_client{_sessions.Get(handle)->IsClientFD(fd)};
+            auto direction{is_client ? SessionSlab::Direction::K_CLIENT : SessionSlab::Direction::K_PGSQL};
+
+            UpdateEpollEvents(fd, events, SessionSlab::MakeToken(handle, direction));
+        })};
+
+        if (node != UpstreamSet::NONE) {
+            _upstreams.OnAttached(node);
+        }
+
+        session.GetStatementCache().SetCaptureParams(_options.log_params);
+        session.SetFlowControl(&_flow);
+        session.SetMetrics(&_metrics);
+
+        session.SetMessageCallback([this, &session](const FrontendMessage& message) {
+            QueryText text;
+
+            if (!session.GetStatementCache().Process(message, text)) {
+                return;
+            }
+
+            OnQuery(session, message.type, text);
+
+            if (_cache || _upstreams.HasReplicas()) {
+                if (session.IsQueryCandidate(message)) {
+                    ClassifyQuery(text.query, _query_class);
+                } else {
+                    ClassifyWrite(text.query, _query_class);
+                }
+
+                session.InspectQuery(message, _query_class);
+            }
+        });
+
+        if (_cache) {
+            session.EnableResultCache(_cache.get());
+        }
+
+        if (_latency) {
+            session.EnableLatency(_latency);
+        }
+
+        if (_tls.IsClientEnabled()) {
+            session.EnableTls(&_tls);
+        }
+
+        session.SetSendCallback([this](int fd, const iovec* iov, size_t count) {
+            return _poller->Send(fd, iov, count);
+        });
+
+        if (_options.log_latency) {
+            session.SetQueryDoneCallback([this, &session](const QueryText& text) {
+                _logger.SaveLogs(session.GetEndpoint(), text, _time.GetNanoseconds());
+            });
+        }
+
+        // Ответы зашифрованного соединения с PostgreSQL расшифровывает OpenSSL: splice() их не перешлет.
+        // Кэшу результатов ответы нужны в памяти прокси.
+        bool spliced{!IsPooling() && _options.splice && !_latency && !_tls.IsBackendEnabled() && !_cache &&
+                     session.EnableSplice()};
+
+        // Границы транзакций нужны плавной остановке. Ответы через splice() не разбираются:
+        // такие сессии закрываются по истечении срока остановки.
+        if (IsPooling()) {
+            session.EnablePooling();
+        } else if (!spliced) {
+            session.EnableTransactionTracking();
+        }
+
+        StartStream(session, client);
+
+        // Для сессии с подключением к PostgreSQL взводится таймаут подключения, иначе — простоя.
+        session.GetTimer().timer.SetData(handle);
+        UpdateTimer(session);
+
+        Endpoint client_ep;
+        client_ep.ip = inet_ntoa(client_addr.sin_addr);
+        client_ep.port = ntohs(client_addr.sin_port);
+        client_ep.address = client_addr.sin_addr.s_addr;
+        client_ep.session_id = (static_cast<uint64_t>(_id) << 48) | ++_session_counter;
+
+        session.SetEndpoint(client_ep);
+        _metrics.connections_accepted.Add();
+
+        _logger.PrintInTerminal(session.GetEndpoint(), GetServerName(session), ConnectionStatus::K_OPEN, _time);
+
+        if (!IsPooling() && !session.HasBackend()) {
+            _metrics.upstream_unavailable.Add();
+            session.NotifyUnavailable();
+            SendAndClose(handle);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "ConnectToPGSQL() connection failed: " << e.what() << '\n';
+
+        _poller->Remove(client);
+        _sessions.Release(handle);
+    }
+}
+
+void Worker::CloseSession(SessionSlab::Handle handle) {
+    Session& session{*_sessions.Get(handle)};
+    int client_fd{session.GetClientFD()};
+    std::string server{GetServerName(session)};
+
+    if (session.HasBackend()) {
+        bool reusable{session.CanReleaseBackend()};
+        auto backend{session.DetachBackend()};
+
+        _upstreams.OnDetached(backend->GetNode());
+
+        if (reusable) {
+            OfferBackend(std::move(backend));
+        } else {
+            CloseBackend(std::move(backend));
+        }
+    }
+
+    _poller->Remove(client_fd);
+
+    // Запросы без ответа все равно попадают в лог (без задержки).
+    session.FlushQueries();
+
+    _logger.PrintInTerminal(session.GetEndpoint(), server, ConnectionStatus::K_CLOSED, _time);
+    _metrics.connections_closed.Add();
+
+    _sessions.Release(handle);
+}
+
+std::string Worker::GetServerName(const Session& session) const {
+    // В режиме пула соединения выдаются на время транзакции: сессия относится к пулу (user, database).
+    if (IsPooling()) {
+        return session.GetUser().empty() ? "pool" : "pool " + session.GetUser() + "/" + session.GetDatabase();
+    }
+
+    if (const Backend* backend{session.GetBackend()}) {
+        return _upstreams.GetName(backend->GetNode());
+    }
+
+    return "none";
+}
+
+void Worker::SendAndClose(SessionSlab::Handle handle) {
+    Session& session{*_sessions.Get(handle)};
+
+    // Очереди сессии пусты, а уведомления малы: отправка не упирается в EAGAIN, и ее ошибка уже не важна.
+    session.TrySend(session.GetClientFD());
+
+    if (session.HasBackend()) {
+        session.TrySend(session.GetPGSQLFD());
+    }
+
+    CloseSession(handle);
+}
+
+void Worker::HandleEvent(const Poller::Event& event) {
+    if (!SessionSlab::IsSessionToken(event.data)) {
+        int fd{static_cast<int>(event.data)};
+
+        if (_health && _health->HandleEvent(fd, event.events)) {
+            return;
+        }
+
+        if (IsPooling()) {
+            HandlePoolEvent(fd, event.events);
+        }
+
+        return;
+    }
+
+    SessionSlab::Handle handle{SessionSlab::GetHandle(event.data)};
+    Session* session{_sessions.Get(handle)};
+
+    // Событие из той же пачки, что и закрытие сессии: слот освобожден или занят новой сессией.
+    if (!session) {
+        return;
+    }
+
+    bool is_client{SessionSlab::GetDirection(event.data) == SessionSlab::Direction::K_CLIENT};
+    int fd{is_client ? session->GetClientFD() : session->GetPGSQLFD()};
+
+    // Соединение с PostgreSQL уже возвращено в пул.
+    if (fd == -1) {
+        return;
+    }
+
+    if (session->IsPGSQLFD(fd) && session->IsConnecting()) {
+        size_t node{session->GetBackend()->GetNode()};
+
+        if (!session->FinishConnect()) {
+            _upstreams.OnFailure(node);
+            CloseSession(handle);
+        } else if (!session->IsConnecting()) {
+            _upstreams.OnSuccess(node);
+            StartStream(*session, fd);
+
+            // Данные, которые сокет не принял до перехода, больше не дождутся EPOLLOUT.
+            if (!session->TrySend(fd)) {
+                CloseSession(handle);
+            }
+        }
+
+        return;
+    }
+
+    if (event.sent) {
+        if ((event.events & EPOLLERR) || !session->OnSent(fd, event.size)) {
+            CloseSession(handle);
+        }
+
+        return;
+    }
+
+    if (event.events & EPOLLOUT) {
+        if (!session->TrySend(fd)) {
+            CloseSession(handle);
+        }
+
+        return;
+    }
+
+    if (event.received) {
+        session->OnReceived(fd, event.received, event.size, event.block);
+    } else if (!session->RecvAll(fd)) {
+        CloseSession(handle);
+
+        return;
+    }
+
+    if (session->IsWaitingBudget()) {
+        _budget_waiters.push_back(handle);
+    }
+
+    if ((IsPooling() || _cache) && session->IsClientFD(fd)) {
+        if (session->NeedsBackend() && !AssignBackend(handle, UpstreamSet::NONE)) {
+            return;
+        }
+
+        // Ответы прокси клиенту (этап запуска, отказ в SSL, результаты из кэша).
+        if (!session->TrySend(fd)) {
+            CloseSession(handle);
+
+            return;
+        }
+    }
+
+    if (!session->TrySend(session->GetPeerFD(fd))) {
+        CloseSession(handle);
+
+        return;
+    }
+
+    if (IsPooling()) {
+        ReleaseBackend(handle);
+    }
+}
+
+void Worker::HandlePoolEvent(int fd, uint32_t events) {
+    Backend* backend{_pool.Find(fd)};
+
+    if (!backend) {
+        return;
+    }
+
+    if (backend->IsReady()) {
+        // Простаивающее соединение: данные от сервера или закрытие с его стороны. Соединение
+        // вне транзакции не должно ничего получать, поэтому оно закрывается.
+        char byte{};
+        ssize_t n{recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT)};
+
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            return;
+        }
+
+        CloseBackend(_pool.Take(fd));
+
+        return;
+    }
+
+    int result{};
+
+    if (backend->IsConnecting() && !backend->IsNegotiating()) {
+        if (!(events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+            return;
+        }
+
+        result = backend->FinishConnect() ? backend->ContinueStartup() : -1;
+    } else {
+        result = backend->ContinueStartup();
+    }
+
+    if (result == 0) {
+        return;
+    }
+
+    auto owned{_pool.Take(fd)};
+
+    if (result == -1) {
+        // Ошибка после подключения и TLS — ответ сервера на этап запуска клиента (например, аутентификация).
+        bool server_failure{owned->IsConnecting()};
+
+        FailBackend(std::move(owned), server_failure);
+
+        return;
+    }
+
+    _upstreams.OnSuccess(owned->GetNode());
+    _pool.SetParameters(owned->GetKey(), owned->GetParameters());
+    OfferBackend(std::move(owned));
+}
+
+bool Worker::AssignBackend(SessionSlab::Handle handle, size_t exclude) {
+    Session& session{*_sessions.Get(handle)};
+
+    // Этап запуска воспроизводится по параметрам основного сервера.
+    if (session.IsStartupPending()) {
+        if (const std::string* parameters{_pool.GetParameters(session.GetPoolKey())}) {
+            session.CompleteStartup(*parameters);
+        }
+    }
+
+    if (!session.NeedsBackend()) {
+        return true;
+    }
+
+    size_t node{UpstreamSet::NONE};
+
+    if (_upstreams.HasReplicas() && session.CanUseReplica()) {
+        node = _upstreams.Select(UpstreamRole::K_REPLICA, exclude);
+    }
+
+    // Без исправных реплик читающий запрос выполняет основной сервер.
+    if (node == UpstreamSet::NONE) {
+        node = _upstreams.Select(UpstreamRole::K_PRIMARY, exclude);
+    }
+
+    if (node == UpstreamSet::NONE) {
+        _metrics.upstream_unavailable.Add();
+        session.NotifyUnavailable();
+        SendAndClose(handle);
+
+        return false;
+    }
+
+    BackendPool::MakeNodeKey(session.GetPoolKey(), node, _node_key);
+    const std::string& key{_node_key};
+
+    if (auto backend{_pool.TakeIdle(key)}) {
+        return AttachBackend(handle, std::move(backend));
+    }
+
+    if (session.IsWaitingBackend()) {
+        return true;
+    }
+
+    session.SetWaitingBackend(true);
+    _pool.AddWaiter(key, handle);
+
+    if (!_pool.CanOpen(key)) {
+        return true;
+    }
+
+    try {
+        auto backend{std::make_unique<Backend>(SetupPGSQLSocket(SessionSlab::NULL_HANDLE, node))};
+
+        backend->SetNode(node);
+        backend->SetStartup(key, session.GetUser(), session.GetDatabase());
+
+        if (_tls.IsBackendEnabled()) {
+            backend->EnableTls(&_tls);
+        }
+        _pool.AddStarting(std::move(backend));
+    } catch (const std::exception& e) {
+        std::cerr << "ConnectToPGSQL() connection failed: " << e.what() << '\n';
+
+        // Сервер сразу отказал в подключении: сессия один раз пробует другой исправный сервер.
+        if (exclude == UpstreamSet::NONE) {
+            session.SetWaitingBackend(false);
+
+            return AssignBackend(handle, node);
+        }
+
+        CloseSession(handle);
+
+        return false;
+    }
+
+    return true;
+}
+
+bool Worker::AttachBackend(SessionSlab::Handle handle, std::unique_ptr<Backend> backend) {
+    Session& session{*_sessions.Get(handle)};
+    int pgsql_fd{backend->GetFD()};
+
+    // Соединение пула зарегистрировано с токеном-fd: переводим его события на токен сессии.
+    UpdateEpollEvents(pgsql_fd, backend->GetEvents(), SessionSlab::MakeToken(handle, SessionSlab::Direction::K_PGSQL));
+
+    size_t node{backend->GetNode()};
+    bool replica{_upstreams.GetRole(node) == UpstreamRole::K_REPLICA};
+
+    _upstreams.OnAttached(node);
+    (replica ? _metrics.replica_assignments : _metrics.primary_assignments).Add();
+
+    session.SetWaitingBackend(false);
+    session.AttachBackend(std::move(backend));
+
+    if (!session.TrySend(pgsql_fd) || !session.TrySend(session.GetClientFD())) {
+        CloseSession(handle);
+
+        return false;
+    }
+
+    ReleaseBackend(handle);
+
+    return true;
+}
+
+void Worker::ReleaseBackend(SessionSlab::Handle handle) {
+    Session& session{*_sessions.Get(handle)};
+
+    if (!session.CanReleaseBackend()) {
+        return;
+    }
+
+    auto backend{session.DetachBackend()};
+
+    _upstreams.OnDetached(backend->GetNode());
+    OfferBackend(std::move(backend));
+}
+
+void Worker::OfferBackend(std::unique_ptr<Backend> backend) {
+    SessionSlab::Handle handle{};
+
+    while (_pool.PopWaiter(backend->GetKey(), handle)) {
+        Session* waiter{_sessions.Get(handle)};
+
+        if (!waiter || !waiter->IsWaitingBackend() || !waiter->NeedsBackend()) {
+            continue;
+        }
+
+        // Пока сессия ждала реплику, клиент дослал запросы, которые реплике не отдать: ее очередь — к основному серверу.
+        if (_upstreams.GetRole(backend->GetNode()) == UpstreamRole::K_REPLICA && !waiter->CanUseReplica()) {
+            waiter->SetWaitingBackend(false);
+            AssignBackend(handle, UpstreamSet::NONE);
+
+            continue;
+        }
+
+        AttachBackend(handle, std::move(backend));
+
+        return;
+    }
+
+    backend->SetEvents(IDLE_EVENTS);
+    UpdateEpollEvents(backend->GetFD(), IDLE_EVENTS, static_cast<uint64_t>(backend->GetFD()));
+
+    _pool.PutIdle(std::move(backend));
+}
+
+void Worker::FailBackend(std::unique_ptr<Backend> backend, bool server_failure) {
+    std::string key{backend->GetKey()};
+    size_t node{backend->GetNode()};
+
+    if (server_failure) {
+        _upstreams.OnFailure(node);
+    }
+
+    // Исключенный сервер больше не выбирается, поэтому переназначение не зациклится.
+    bool reassign{server_failure && !_upstreams.IsHealthy(node)};
+
+    CloseBackend(std::move(backend));
+
+    // Без готового соединения ожидающие сессии этого ключа не дождутся ответа: закрываем их
+    // или, если сервер исключен, отправляем к другому.
+    SessionSlab::Handle handle{};
+
+    while (_pool.PopWaiter(key, handle)) {
+        Session* waiter{_sessions.Get(handle)};
+
+        if (!waiter || !waiter->IsWaitingBackend() || waiter->HasBackend()) {
+            continue;
+        }
+
+        if (reassign) {
+            waiter->SetWaitingBackend(false);
+            AssignBackend(handle, node);
+        } else {
+            CloseSession(handle);
+        }
+    }
+}
+
+void Worker::CloseBackend(std::unique_ptr<Backend> backend) {
+    _poller->Remove(backend->GetFD());
+
+    if (IsPooling()) {
+        _pool.OnClosed(backend->GetKey());
+    }
+}
+
+void Worker::ExpirePool() {
+    if (!IsPooling() || _pool.Empty()) {
+        return;
+    }
+
+    auto now{_time.GetSteady()};
+
+    if (now < _next_pool_check) {
+        return;
+    }
+
+    _next_pool_check = now + std::chrono::seconds(1);
+
+    for (auto& backend : _pool.TakeExpired(now)) {
+        if (backend->IsReady()) {
+            CloseBackend(std::move(backend));
+        } else {
+            std::cerr << "connect() error to PostgreSQL: timed out\n";
+
+            FailBackend(std::move(backend), true);
+        }
+    }
+}
+
+void Worker::ResumeBudgetWaiters() {
+    if (_budget_waiters.empty() || !_flow.HasHeadroom()) {
+        return;
+    }
+
+    // Сессия могла попасть в список несколько раз (по событию каждого из сокетов).
+    std::sort(_budget_waiters.begin(), _budget_waiters.end());
+    _budget_waiters.erase(std::unique(_budget_waiters.begin(), _budget_waiters.end()), _budget_waiters.end());
+
+    std::vector<SessionSlab::Handle> waiters;
+    waiters.swap(_budget_waiters);
+
+    for (SessionSlab::Handle handle : waiters) {
+        Session* session{_sessions.Get(handle)};
+
+        if (!session) {
+            continue;
+        }
+
+        // Возобновленный сокет снова регистрируется с EPOLLIN, и Poller сообщит о готовых данных.
+        session->ResumeReading();
+
+        if (session->IsWaitingBudget()) {
+            _budget_waiters.push_back(handle);
+        }
+    }
+}
+
+void Worker::ReportFlow() {
+    if (_id != 0) {
+        return;
+    }
+
+    size_t throttled{_flow.GetThrottled()};
+    auto now{_time.GetSteady()};
+
+    if (throttled == _reported_throttled || now < _next_flow_report) {
+        return;
+    }
+
+    _reported_throttled = throttled;
+    _next_flow_report = now + std::chrono::seconds(1);
+
+    std::cout << "Backpressure: " + std::to_string(throttled) + " sessions throttled, " +
+                 std::to_string(Buffer::GetAllocatedBytes() >> 10) + " KiB buffered\n";
+}
+
+void Worker::ExpireTimers() {
+    _timers.Advance(_time.GetSteady());
+
+    // Обработка таймера может закрыть сессию: ее таймер снимается с колеса деструктором.
+    while (TimerWheel::Timer* timer{_timers.PopExpired()}) {
+        OnTimer(timer->GetData());
+    }
+}
+
+SessionTimeout Worker::SelectTimeout(const Session& session) const noexcept {
+    if (session.IsConnecting()) {
+        return SessionTimeout::K_CONNECT;
+    }
+
+    // Долгий запрос — не простой: пока клиент ждет ответа, отсчитывается только таймаут запроса.
+    if (session.IsWaitingResponse()) {
+        return _options.query_timeout_ms > 0 ? SessionTimeout::K_QUERY : SessionTimeout::K_NONE;
+    }
+
+    return _options.idle_timeout_ms > 0 ? SessionTimeout::K_IDLE : SessionTimeout::K_NONE;
+}
+
+Worker::Clock::duration Worker::GetTimeoutLimit(SessionTimeout timeout) const noexcept {
+    switch (timeout) {
+        case SessionTimeout::K_CONNECT:
+            return std::chrono::milliseconds(_options.connect_timeout_ms);
+        case SessionTimeout::K_QUERY:
+            return std::chrono::milliseconds(_options.query_timeout_ms);
+        case SessionTimeout::K_IDLE:
+            return std::chrono::milliseconds(_options.idle_timeout_ms);
+        default:
+            return Clock::duration::zero();
+    }
+}
+
+void Worker::UpdateTimer(Session& session) {
+    SessionTimer& timer{session.GetTimer()};
+    SessionTimeout timeout{SelectTimeout(session)};
+    auto now{_time.GetSteady()};
+
+    if (timeout == timer.timeout) {
+        // Простой отсчитывается от последнего события, запрос — от последнего завершенного запроса.
+        if (timeout == SessionTimeout::K_IDLE || session.GetReadyCount() != timer.ready_count) {
+            timer.since = now;
+            timer.ready_count = session.GetReadyCount();
+        }
+
+        return;
+    }
+
+    timer.timeout = timeout;
+    timer.since = now;
+    timer.ready_count = session.GetReadyCount();
+
+    if (timeout == SessionTimeout::K_NONE) {
+        timer.timer.Cancel();
+
+        return;
+    }
+
+    auto deadline{now + GetTimeoutLimit(timeout)};
+
+    // Таймер, взведенный раньше нового срока, остается: истекая, он переставится на срок по since.
+    if (timer.timer.IsScheduled() && timer.expires <= deadline) {
+        return;
+    }
+
+    timer.expires = deadline;
+    _timers.Schedule(timer.timer, deadline);
+}
+
+void Worker::OnTimer(SessionSlab::Handle handle) {
+    Session* session{_sessions.Get(handle)};
+
+    if (!session) {
+        return;
+    }
+
+    SessionTimer& timer{session->GetTimer()};
+
+    // Состояние сессии могло измениться без ее собственного события (например, пул выдал соединение).
+    if (SelectTimeout(*session) != timer.timeout) {
+        UpdateTimer(*session);
+
+        return;
+    }
+
+    auto deadline{timer.since + GetTimeoutLimit(timer.timeout)};
+
+    if (_time.GetSteady() < deadline) {
+        timer.expires = deadline;
+        _timers.Schedule(timer.timer, deadline);
+
+        return;
+    }
+
+    switch (timer.timeout) {
+        case SessionTimeout::K_CONNECT:
+            std::cerr << "connect() error to PostgreSQL: timed out\n";
+
+            _upstreams.OnFailure(session->GetBackend()->GetNode());
+            _metrics.connect_timeouts.Add();
+            CloseSession(handle);
+
+            break;
+        case SessionTimeout::K_QUERY:
+            std::cerr << "Query timeout: closing session of " + session->GetEndpoint().ip + ":" +
+                         std::to_string(session->GetEndpoint().port) + "\n";
+
+            _metrics.query_timeouts.Add();
+            CloseSession(handle);
+
+            break;
+        case SessionTimeout::K_IDLE:
+            _metrics.idle_timeouts.Add();
+
+            // Посреди транзакции или ответа сервера уведомление разорвало бы поток: сессия просто закрывается.
+            if (session->IsIdle()) {
+                session->NotifyIdleTimeout();
+                SendAndClose(handle);
+            } else {
+                CloseSession(handle);
+            }
+
+            break;
+        default:
+            break;
+    }
+}
+
+int Worker::GetWaitTimeout() {
+    // Таймауты пула проверяются раз в секунду, поэтому при непустом пуле ожидание не дольше секунды.
+    int timeout{IsPooling() && !_pool.Empty() ? 1000 : -1};
+
+    // Освобождение общего бюджета не порождает событий для ждущих его сессий: проверяем его сами.
+    if (!_budget_waiters.empty()) {
+        timeout = 10;
+    } else if (_id == 0 && _flow.GetThrottled() != _reported_throttled && timeout == -1) {
+        timeout = 1000;
+    } else if (!_digest.Empty() && timeout == -1) {
+        // Сводка запросов передается логгеру раз в секунду.
+        timeout = 1000;
+    }
+
+    if (_draining) {
+        timeout = timeout == -1 ? DRAIN_CHECK_MS : std::min(timeout, DRAIN_CHECK_MS);
+    }
+
+    if (_health) {
+        int health_timeout{_health->GetWaitTimeout(Clock::now())};
+
+        timeout = timeout == -1 ? health_timeout : std::min(timeout, health_timeout);
+    }
+
+    auto next{_timers.GetNextExpiry()};
+
+    if (next == Clock::time_point::max()) {
+        return timeout;
+    }
+
+    auto left_ms{std::chrono::ceil<std::chrono::milliseconds>(next - Clock::now()).count()};
+    int timer_timeout{left_ms <= 0 ? 0 : static_cast<int>(std::min<decltype(left_ms)>(left_ms, INT_MAX))};
+
+    return timeout == -1 ? timer_timeout : std::min(timeout, timer_timeout);
+}
+
+void Worker::StartDrain() {
+    _draining = true;
+    _drain_deadline = _time.GetSteady() + std::chrono::milliseconds(_options.drain_timeout_ms);
+    _drain_grace_end = std::min(_drain_deadline, _time.GetSteady() + std::chrono::milliseconds(DRAIN_GRACE_MS));
+
+    for (const auto& listener : _listeners) {
+        _poller->Remove(listener);
+    }
+
+    _listeners.clear();
+
+    // Дескриптор пробуждения остается взведенным до выхода: без снятия с Poller цикл не засыпал бы.
+    _poller->Remove(_wakeup_fd);
+
+    if (_upgrade) {
+        _upgrade->Offer(TakeHandedBackends());
+    }
+
+    if (_id == 0) {
+        std::cout << "Draining: waiting up to " + std::to_string(_options.drain_timeout_ms) +
+                     " ms for sessions to finish their transactions\n";
+    }
+}
+
+std::vector<HandedBackend> Worker::TakeHandedBackends() {
+    std::vector<HandedBackend> handed;
+
+    if (!IsPooling() || !_upgrade->IsHandingOff()) {
+        return handed;
+    }
+
+    for (auto& backend : _pool.TakeAllIdle()) {
+        _poller->Remove(backend->GetFD());
+        _pool.OnClosed(backend->GetKey());
+
+        // Состояние TLS остается в OpenSSL этого процесса: зашифрованное соединение не передать.
+        if (backend->GetTls()) {
+            continue;
+        }
+
+        std::string key{backend->GetKey()};
+        std::string parameters{backend->GetParameters()};
+
+        handed.push_back(HandedBackend{backend->ReleaseFD(), std::move(key), std::move(parameters)});
+    }
+
+    return handed;
+}
+
+void Worker::CloseIfIdle(SessionSlab::Handle handle) {
+    Session* session{_sessions.Get(handle)};
+
+    if (!session || !session->IsIdle()) {
+        return;
+    }
+
+    session->NotifyShutdown();
+    SendAndClose(handle);
+}
+
+bool Worker::IsDrained() {
+    if (_sessions.Size() == 0) {
+        return true;
+    }
+
+    auto now{_time.GetSteady()};
+
+    if (!_closing_idle && now >= _drain_grace_end) {
+        _closing_idle = true;
+
+        for (SessionSlab::Handle handle : _sessions.GetHandles()) {
+            CloseIfIdle(handle);
+        }
+    }
+
+    if (now < _drain_deadline) {
+        return _sessions.Size() == 0;
+    }
+
+    std::cout << "Drain timeout: closing " + std::to_string(_sessions.Size()) + " sessions\n";
+
+    for (SessionSlab::Handle handle : _sessions.GetHandles()) {
+        CloseSession(handle);
+    }
+
+    return true;
+}
+
+void Worker::EventLoop() {
+    constexpr size_t MAX_EVENTS{1024};
+    std::vector<Poller::Event> events(MAX_EVENTS);
+
+    while (!_is_stopped()) {
+        int num_events{_poller->Wait(events.data(), MAX_EVENTS, GetWaitTimeout())};
+
+        // Время читается один раз за пробуждение: им пользуются лог, сводки и проверки раз в секунду.
+        _time.Update();
+
+        if (num_events == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            throw std::runtime_error("Poller::Wait(): " + std::string(strerror(errno)));
+        }
+
+        _metrics.OnWakeup(num_events);
+
+        for (int i{}; i < num_events; ++i) {
+            uint64_t token{events[i].data};
+            int fd{static_cast<int>(token)};
+
+            if (SessionSlab::IsSessionToken(token)) {
+                SessionSlab::Handle handle{SessionSlab::GetHandle(token)};
+
+                HandleEvent(events[i]);
+
+                // Сессия становится простаивающей только после события на одном из ее сокетов.
+                if (_closing_idle) {
+                    CloseIfIdle(handle);
+                }
+
+                if (Session* session{_sessions.Get(handle)}) {
+                    UpdateTimer(*session);
+                }
+            } else if (IsListener(fd)) {
+                if (events[i].accepted != -1) {
+                    OnAccepted(events[i].accepted);
+                } else {
+                    AcceptNewConnections(fd);
+                }
+            } else if (fd == _wakeup_fd) {
+                continue;
+            } else {
+                HandleEvent(events[i]);
+            }
+        }
+
+        ExpireTimers();
+        ExpirePool();
+
+        if (_health) {
+            _health->Run(_time.GetSteady());
+        }
+
+        ResumeBudgetWaiters();
+        ReportFlow();
+        SubmitDigest();
+
+        if (!_draining && _is_draining()) {
+            StartDrain();
+        }
+
+        if (_draining && IsDrained()) {
+            break;
+        }
+    }
+}
+
+void Worker::OnQuery(Session& session, char type, const QueryText& text) {
+    bool log{_options.log.mode == LogMode::K_RAW};
+    uint64_t fingerprint{};
+
+    // Отпечаток вычисляется один раз и для сводки лога, и для статистики задержек.
+    if (_latency || !log) {
+        fingerprint = FingerprintQuery(text.query, _normalized);
+    }
+
+    if (!log) {
+        _digest.Add(fingerprint, _normalized, text.query.size(), _time.GetNanoseconds());
+
+        log = _options.log.mode == LogMode::K_SAMPLE && _sample_counter++ % _options.log.sample_rate == 0;
+    }
+
+    LatencyStats::Entry* entry{_latency ? _latency->Intern(fingerprint, _normalized) : nullptr};
+
+    // С --log-latency запрос логируется по завершении (SetQueryDoneCallback).
+    session.TrackQuery(type, text, entry, log && _options.log_latency);
+
+    if (log && !_options.log_latency) {
+        _logger.SaveLogs(session.GetEndpoint(), text, _time.GetNanoseconds());
+    }
+}
+
+void Worker::SubmitDigest() {
+    auto now{_time.GetSteady()};
+
+    // Секунда отсчитывается от первого запроса в пустой сводке.
+    if (_digest.Empty()) {
+        _next_digest_submit = now + std::chrono::seconds(1);
+
+        return;
+    }
+
+    if (now < _next_digest_submit) {
+        return;
+    }
+
+    _next_digest_submit = now + std::chrono::seconds(1);
+    _logger.SubmitDigest(_digest.Take());
+}
+
+void Worker::Run() {
+    EventLoop();
+
+    if (!_digest.Empty()) {
+        _logger.SubmitDigest(_digest.Take());
+    }
+}
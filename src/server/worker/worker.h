@@ -0,0 +1,460 @@
+#ifndef CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_WORKER_WORKER_H
+#define CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_WORKER_WORKER_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include <sys/epoll.h>
+#include <netinet/in.h>
+
+#include "../pool/pool.h"
+#include "../poller/poller.h"
+#include "../logger/logger.h"
+#include "../metrics/metrics.h"
+#include "../session/session_slab.h"
+#include "../options/options.h"
+#include "../unique_fd/unique_fd.h"
+#include "../clock/timestamp_cache.h"
+#include "../timer/timer_wheel.h"
+#include "../tls/tls_context.h"
+#include "../cache/result_cache.h"
+#include "../upstream/upstream_set.h"
+#include "../upstream/health_checker.h"
+#include "../connection/connection.h"
+#include "../upgrade/upgrade_server.h"
+
+/**
+ * @class Worker
+ * @brief Рабочий поток прокси-сервера со своим циклом событий.
+ *
+ * Каждый Worker владеет собственным слушающим сокетом (SO_REUSEPORT), собственным Poller'ом (epoll или io_uring)
+ * и собственным хранилищем сессий (SessionSlab). Сессия обслуживается тем Worker'ом, который принял
+ * соединение, поэтому обработка событий не требует блокировок. Токен события в Poller содержит
+ * дескриптор сессии и направление, поэтому диспетчеризация обходится без хеш-таблиц и подсчета ссылок.
+ *
+ * В режиме транзакционного пула у каждого Worker'а свой пул соединений с PostgreSQL (BackendPool):
+ * соединение выдается сессии, когда у клиента появляются данные для PostgreSQL, и возвращается в пул
+ * по завершении транзакции.
+ *
+ * Таймауты сессий (подключение к PostgreSQL, запрос, простой) отсчитывает иерархическое колесо таймеров
+ * (TimerWheel) с таймером в каждой сессии: постановка и отмена — O(1) без выделения памяти, а Poller
+ * ждет событий не дольше, чем до ближайшего срока колеса.
+ *
+ * При плавной остановке (is_draining) рабочий поток перестает принимать соединения, закрывает сессии
+ * по мере завершения их транзакций и выходит из цикла, когда сессий не осталось или истек
+ * drain_timeout_ms. При обновлении процесса слушающие сокеты передаются новому процессу
+ * (UpgradeServer), и рабочие потоки нового процесса принимают соединения из тех же очередей.
+ *
+ * С кэшем результатов у каждого рабочего потока свой ResultCache (своя доля общего объема), а номера
+ * изменений таблиц общие: изменение, отправленное сессией любого потока, инвалидирует кэши всех.
+ *
+ * С репликами (UpstreamSet) пул держит соединения с каждым сервером под своим ключом. Одиночный
+ * читающий Query вне транзакции получает соединение с наименее занятой репликой, все остальное —
+ * с основным сервером; транзакция остается на выданном соединении до ReadyForQuery со статусом 'I'.
+ *
+ * Основных серверов может быть несколько (--upstream): новое соединение открывается к исправному серверу
+ * с наименьшим числом выданных сессиям соединений. Ошибки подключения исключают сервер (пассивная проверка),
+ * а рабочий поток 0 проверяет серверы сам (HealthChecker) и возвращает исправные. Если исправных серверов
+ * нет, клиент сразу получает ErrorResponse FATAL 57P03 вместо ожидания таймаута подключения.
+ */
+class Worker {
+public:
+    /// Тип коллбэка для проверки запроса на остановку.
+    using StopCallback = std::function<bool()>;
+
+    /// Монотонные часы для отсчета таймаутов.
+    using Clock = std::chrono::steady_clock;
+
+public:
+    /**
+     * @brief Конструктор рабочего потока.
+     *
+     * Создает Poller, слушающий сокет (если сокеты не получены от предыдущего процесса)
+     * и подписывается на дескриптор пробуждения.
+     *
+     * @param id Порядковый номер рабочего потока.
+     * @param options Параметры запуска сервера.
+     * @param logger Общий логгер.
+     * @param flow Общие границы буферизации сессий.
+     * @param tls Контексты TLS клиентов и PostgreSQL.
+     * @param versions Общие номера изменений таблиц (кэш результатов).
+     * @param upstreams Общие серверы PostgreSQL и их исправность.
+     * @param metrics Метрики (рабочий поток пишет в свои счетчики и статистику задержек).
+     * @param wakeup_fd Дескриптор, по которому рабочий поток пробуждается для проверки остановки.
+     * @param is_stopped Коллбэк, возвращающий true, если работу нужно завершить немедленно.
+     * @param is_draining Коллбэк, возвращающий true, если начата плавная остановка.
+     * @param listeners Слушающие сокеты, полученные от предыдущего процесса (может быть пусто).
+     * @throw std::runtime_error Если не удалось настроить Poller или сокет.
+     */
+    Worker(size_t id, const Options& options, Logger& logger, FlowControl& flow, const TlsContext& tls,
+           TableVersions& versions, UpstreamRegistry& upstreams, Metrics& metrics, int wakeup_fd, StopCallback is_stopped, StopCallback is_draining,
+           std::vector<UniqueFD> listeners);
+
+    /**
+     * @brief Запускает цикл обработки событий до остановки.
+     * @throw std::runtime_error Если Poller::Wait вернет ошибку, отличную от EINTR.
+     */
+    void Run();
+
+    /**
+     * @brief Дескрипторы слушающих сокетов рабочего потока.
+     */
+    std::vector<int> GetListenFDs() const;
+
+    /**
+     * @brief Подключает канал обновления: при остановке ради обновления простаивающие соединения пула
+     * передаются ему.
+     * @param upgrade Канал обновления (должен жить дольше рабочего потока).
+     */
+    void SetUpgradeServer(UpgradeServer* upgrade) noexcept;
+
+    /**
+     * @brief Принимает в пул простаивающее соединение, переданное предыдущим процессом.
+     *
+     * Вызывается до Run(). Соединение закрывается, если пул выключен или лимит ключа исчерпан.
+     *
+     * @param handed Соединение.
+     */
+    void AdoptBackend(HandedBackend&& handed);
+
+private:
+    /**
+     * @brief Создает Poller для механизма, выбранного в параметрах (io_uring с откатом на epoll).
+     * @throw std::runtime_error Если Poller не удалось создать.
+     */
+    void SetupPoller();
+
+    /**
+     * @brief Настраивает серверный сокет для прослушивания клиентских подключений.
+     *
+     * Если сокеты получены от предыдущего процесса, новый не создается. Иначе сокет устанавливается
+     * в неблокирующий режим, включаются опции SO_REUSEADDR и SO_REUSEPORT, чтобы каждый рабочий поток
+     * мог слушать один и тот же порт. Слушающие сокеты добавляются в Poller.
+     * @throw std::runtime_error Если не удалось создать, настроить или привязать сокет.
+     */
+    void SetupServerSocket();
+
+    /**
+     * @brief Подписывает Poller на дескриптор пробуждения.
+     * @throw std::runtime_error Если не удалось добавить дескриптор в Poller.
+     */
+    void SetupWakeup();
+
+    /**
+     * @brief Начинает подключение к PostgreSQL.
+     *
+     * Создает неблокирующий сокет, вызывает connect() и добавляет сокет в Poller (EPOLLIN | EPOLLOUT).
+     * Завершение подключения (EINPROGRESS) обрабатывается в HandleEvent через Session::FinishConnect().
+     * @param handle Дескриптор сессии, которой принадлежит соединение, или NULL_HANDLE для соединения пула
+     * (тогда токеном события служит сам fd).
+     * @param node Номер сервера в UpstreamSet.
+     * @return Объект UniqueFD с файловым дескриптором PostgreSQL.
+     * @throw std::runtime_error Если не удалось создать сокет или connect() сразу вернул ошибку
+     * (ошибка connect() учитывается как отказ сервера).
+     */
+    UniqueFD SetupPGSQLSocket(SessionSlab::Handle handle, size_t node);
+
+    /**
+     * @brief Основной цикл обработки событий.
+     *
+     * Обрабатывает клиентские подключения и обмен данными между клиентами и PostgreSQL до тех пор,
+     * пока коллбэк остановки не вернет true.
+     * @throw std::runtime_error Если Poller::Wait вернет ошибку, отличную от EINTR.
+     */
+    void EventLoop();
+
+    /**
+     * @brief Продвигает колесо таймеров и обрабатывает истекшие таймеры сессий.
+     */
+    void ExpireTimers();
+
+    /**
+     * @brief Выбирает таймаут, который должен отсчитываться для сессии в ее текущем состоянии.
+     * @param session Сессия.
+     * @return SessionTimeout Таймаут (K_NONE, если соответствующий таймаут выключен).
+     */
+    SessionTimeout SelectTimeout(const Session& session) const noexcept;
+
+    /**
+     * @brief Длительность таймаута из параметров запуска.
+     * @param timeout Таймаут.
+     */
+    Clock::duration GetTimeoutLimit(SessionTimeout timeout) const noexcept;
+
+    /**
+     * @brief Обновляет таймер сессии после ее события.
+     *
+     * При смене таймаута таймер переставляется (если новый срок раньше взведенного), иначе сдвигается
+     * только начало отсчета: колесо не трогается на каждом событии.
+     *
+     * @param session Сессия.
+     */
+    void UpdateTimer(Session& session);
+
+    /**
+     * @brief Обрабатывает истекший таймер сессии: переставляет его, если сессия была активна, или закрывает сессию.
+     *
+     * По таймауту простоя простаивающая сессия получает ErrorResponse FATAL 57P05.
+     *
+     * @param handle Дескриптор сессии.
+     */
+    void OnTimer(SessionSlab::Handle handle);
+
+    /**
+     * @brief Вычисляет таймаут ожидания событий до ближайшего срока колеса таймеров.
+     * @return int Таймаут в миллисекундах или -1, если ждать нечего.
+     */
+    int GetWaitTimeout();
+
+    /**
+     * @brief Обновляет маску событий для указанного файлового дескриптора в Poller.
+     * @param fd Файловый дескриптор.
+     * @param events Новая маска событий (EPOLLIN, EPOLLOUT и т.д.).
+     * @param data Токен события.
+     */
+    void UpdateEpollEvents(int fd, uint32_t events, uint64_t data);
+
+    /**
+     * @brief Переводит сокет сессии на ввод-вывод механизмом Poller, если это допускают сессия и механизм.
+     * @param session Сессия.
+     * @param fd Клиентский сокет или сокет PostgreSQL с завершенным подключением.
+     */
+    void StartStream(Session& session, int fd);
+
+    /**
+     * @brief Проверяет, является ли fd слушающим сокетом рабочего потока.
+     * @param fd Дескриптор.
+     */
+    bool IsListener(int fd) const noexcept;
+
+    /**
+     * @brief Принимает новые клиентские подключения.
+     *
+     * Вызывает accept4() до EAGAIN и передает каждый сокет в AcceptConnection().
+     * В случае ошибок выводит сообщение в stderr.
+     * @param listen_fd Слушающий сокет, о готовности которого сообщил Poller.
+     */
+    void AcceptNewConnections(int listen_fd);
+
+    /**
+     * @brief Обслуживает подключение, уже принятое Poller'ом (multishot accept в io_uring).
+     * @param client Принятый неблокирующий сокет (владение передается).
+     */
+    void OnAccepted(int client);
+
+    /**
+     * @brief Создает сессию для принятого подключения.
+     *
+     * Добавляет сокет клиента в Poller, открывает соединение с PostgreSQL и создает сессию.
+     * В случае ошибок выводит сообщение в stderr.
+     * @param client_fd Неблокирующий сокет клиента.
+     * @param client_addr Адрес клиента.
+     */
+    void AcceptConnection(UniqueFD&& client_fd, const sockaddr_in& client_addr);
+
+    /**
+     * @brief Закрывает сессию (клиент + PostgreSQL).
+     * @param handle Дескриптор сессии.
+     *
+     * Удаляет дескрипторы из Poller, логирует закрытие соединения и освобождает слот сессии.
+     * После вызова объект сессии недействителен.
+     */
+    void CloseSession(SessionSlab::Handle handle);
+
+    /**
+     * @brief Сервер сессии для вывода в терминал.
+     * @param session Сессия.
+     * @return std::string "host:port" узла соединения, "pool user/database" в режиме пула
+     *         или "none", если исправного сервера не нашлось.
+     */
+    std::string GetServerName(const Session& session) const;
+
+    /**
+     * @brief Отправляет уведомления о закрытии, поставленные в очереди простаивающей сессии, и закрывает ее.
+     * @param handle Дескриптор сессии.
+     */
+    void SendAndClose(SessionSlab::Handle handle);
+
+    /**
+     * @brief Начинает плавную остановку.
+     *
+     * Снимает с Poller и закрывает слушающие сокеты (соединения, ожидающие в их очередях, при обновлении
+     * примет новый процесс) и передает каналу обновления простаивающие соединения пула. Простаивающие
+     * сессии начинают закрываться после короткого льготного периода (IsDrained()).
+     */
+    void StartDrain();
+
+    /**
+     * @brief Закрывает сессию, если она простаивает (вне транзакции, очереди пусты).
+     *
+     * Клиент получает ErrorResponse FATAL 57P01, как при остановке PostgreSQL.
+     * @param handle Дескриптор сессии.
+     */
+    void CloseIfIdle(SessionSlab::Handle handle);
+
+    /**
+     * @brief Проверяет, завершена ли плавная остановка.
+     *
+     * По окончании льготного периода закрывает простаивающие сессии (дальше — каждую, как только она
+     * станет простаивающей), по истечении срока остановки — все оставшиеся.
+     *
+     * @return true Если сессий не осталось.
+     */
+    bool IsDrained();
+
+    /**
+     * @brief Забирает простаивающие соединения пула для передачи новому процессу.
+     */
+    std::vector<HandedBackend> TakeHandedBackends();
+
+    /**
+     * @brief Обрабатывает событие готовности конкретного дескриптора.
+     * @param event Событие Poller (data содержит токен SessionSlab или fd соединения пула).
+     *
+     * Выполняет чтение/запись данных, проксирование между клиентом и PostgreSQL,
+     * и логирование сообщений от клиента.
+     */
+    void HandleEvent(const Poller::Event& event);
+
+    /**
+     * @brief Проверяет, включен ли транзакционный пул соединений.
+     */
+    bool IsPooling() const noexcept;
+
+    /**
+     * @brief Обрабатывает событие соединения, которым владеет пул (этап запуска или простой).
+     * @param fd Дескриптор соединения.
+     * @param events Маска событий.
+     */
+    void HandlePoolEvent(int fd, uint32_t events);
+
+    /**
+     * @brief Выдает сессии соединение: простаивающее, новое или через очередь ожидания.
+     *
+     * Если параметры сервера для ключа уже известны, отвечает клиенту на этап запуска без соединения.
+     * Запрос, который может выполнить реплика (Session::CanUseReplica()), ждет соединения с исправной
+     * репликой, если она есть. Без исправных серверов сессия получает отказ (57P03) и закрывается.
+     *
+     * @param handle Дескриптор сессии.
+     * @param exclude Сервер, который выбирать нельзя (UpstreamSet::NONE — любой); connect() к другому серверу,
+     * сразу вернувший ошибку, повторяется с ним.
+     * @return true Если сессия жива.
+     * @return false Если сессия закрыта.
+     */
+    bool AssignBackend(SessionSlab::Handle handle, size_t exclude);
+
+    /**
+     * @brief Передает соединение сессии и отправляет накопленные данные.
+     * @param handle Дескриптор сессии.
+     * @param backend Готовое соединение.
+     * @return true Если сессия жива.
+     * @return false Если сессия закрыта.
+     */
+    bool AttachBackend(SessionSlab::Handle handle, std::unique_ptr<Backend> backend);
+
+    /**
+     * @brief Возвращает соединение сессии в пул, если транзакция завершена.
+     * @param handle Дескриптор сессии.
+     */
+    void ReleaseBackend(SessionSlab::Handle handle);
+
+    /**
+     * @brief Отдает готовое соединение первой ожидающей сессии или помещает его в пул простаивающих.
+     * @param backend Соединение.
+     */
+    void OfferBackend(std::unique_ptr<Backend> backend);
+
+    /**
+     * @brief Закрывает соединение, не прошедшее этап запуска, и сессии, ожидающие соединения его ключа.
+     *
+     * Если отказал сервер и он исключен, ожидающие сессии получают соединения с другим сервером.
+     *
+     * @param backend Соединение.
+     * @param server_failure Отказал сервер (подключение, TLS, таймаут), а не этап запуска клиента
+     * (например, аутентификация).
+     */
+    void FailBackend(std::unique_ptr<Backend> backend, bool server_failure);
+
+    /**
+     * @brief Закрывает соединение с PostgreSQL.
+     * @param backend Соединение.
+     */
+    void CloseBackend(std::unique_ptr<Backend> backend);
+
+    /**
+     * @brief Закрывает простаивающие дольше таймаута соединения пула (не чаще раза в секунду).
+     */
+    void ExpirePool();
+
+    /**
+     * @brief Возобновляет чтение сессий, приостановленных общим бюджетом памяти, когда память освободилась.
+     */
+    void ResumeBudgetWaiters();
+
+    /**
+     * @brief Обрабатывает запрос клиента: сводка и выборка лога, измерение задержки, запись в лог.
+     * @param session Сессия клиента.
+     * @param type Тип сообщения ('Q' или 'E').
+     * @param text Текст запроса.
+     */
+    void OnQuery(Session& session, char type, const QueryText& text);
+
+    /**
+     * @brief Передает накопленную сводку запросов логгеру (не чаще раза в секунду).
+     */
+    void SubmitDigest();
+
+    /**
+     * @brief Печатает количество приостановленных сессий при его изменении (рабочий поток 0, не чаще раза в секунду).
+     */
+    void ReportFlow();
+
+private:
+    size_t _id; ///< Порядковый номер рабочего потока.
+    const Options& _options; ///< Параметры запуска сервера.
+    Logger& _logger; ///< Общий логгер.
+    FlowControl& _flow; ///< Общие границы буферизации сессий.
+    const TlsContext& _tls; ///< Контексты TLS клиентов и PostgreSQL.
+    WorkerMetrics& _metrics; ///< Счетчики рабочего потока.
+    LatencyStats* _latency; ///< Статистика задержек рабочего потока (nullptr — задержки не измеряются).
+    int _wakeup_fd; ///< Дескриптор пробуждения (принадлежит Server).
+    StopCallback _is_stopped; ///< Коллбэк проверки немедленной остановки.
+    StopCallback _is_draining; ///< Коллбэк проверки плавной остановки.
+    UpgradeServer* _upgrade{nullptr}; ///< Канал обновления (nullptr — не настроен).
+
+    std::vector<UniqueFD> _listeners; ///< Слушающие сокеты (обычно один; больше — после обновления).
+    bool _draining{false}; ///< Идет плавная остановка.
+    Clock::time_point _drain_grace_end{}; ///< Время, с которого простаивающие сессии закрываются.
+    bool _closing_idle{false}; ///< Простаивающие сессии закрываются (льготный период истек).
+    Clock::time_point _drain_deadline{}; ///< Срок, после которого оставшиеся сессии закрываются.
+    std::unique_ptr<Poller> _poller; ///< Механизм ожидания событий.
+
+    SessionSlab _sessions; ///< Сессии рабочего потока.
+    TimestampCache _time; ///< Время текущего пробуждения цикла событий.
+    TimerWheel _timers; ///< Таймеры сессий.
+    std::unique_ptr<ResultCache> _cache; ///< Кэш результатов запросов (nullptr — выключен).
+    QueryClass _query_class; ///< Результат разбора запроса для кэша и реплик (память переиспользуется).
+
+    UpstreamSet _upstreams; ///< Выбор основного сервера или реплики.
+    std::unique_ptr<HealthChecker> _health; ///< Проверка серверов (рабочий поток 0; nullptr — выключена).
+    std::string _node_key; ///< Ключ пула выбранного сервера (память переиспользуется).
+
+    BackendPool _pool; ///< Пул соединений с PostgreSQL (режим транзакционного пула).
+    Clock::time_point _next_pool_check{}; ///< Время следующей проверки таймаутов пула.
+
+    std::vector<SessionSlab::Handle> _budget_waiters; ///< Сессии, чтение которых держит общий бюджет памяти.
+    Clock::time_point _next_flow_report{}; ///< Время следующей проверки статистики управления потоком.
+    size_t _reported_throttled{}; ///< Последнее напечатанное количество приостановленных сессий.
+
+    uint64_t _session_counter{}; ///< Количество принятых сессий (младшие биты идентификатора сессии).
+
+    QueryDigest _digest; ///< Сводка запросов рабочего потока (режимы summary и sample).
+    Clock::time_point _next_digest_submit{}; ///< Время следующей передачи сводки логгеру.
+    uint64_t _sample_counter{}; ///< Счетчик запросов для выборки каждого N-го.
+    std::string _normalized; ///< Нормализованный текст запроса (буфер переиспользуется).
+};
+
+#endif // CPP_POSTGRESQL_TCP_PROXY_SERVER_SERVER_WORKER_WORKER_H